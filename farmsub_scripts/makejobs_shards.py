@@ -0,0 +1,86 @@
+# This script is used to submit g4sbs jobs on the farm, splitting ONE run into N shards.
+# Each job runs a small wrapper macro:
+#    /g4sbs/shard i N
+#    /control/execute <your macro>.mac
+# so that job i simulates events [i*nevt/N, (i+1)*nevt/N) of the "/g4sbs/run nevt" in your macro
+# (for PYTHIA6/SIMC generators, the corresponding slice of the input chain).
+# Add "/g4sbs/rngstreams true" and a fixed "/g4sbs/rngseed" to your macro to make the shards
+# reproduce exactly the events of one big job.
+# Example: to split the 1M events of gep12_elastic_sig.mac (with /g4sbs/run 1000000) into 50 jobs:
+# > python2 makejobs_shards.py gep12_elastic_sig.mac 50
+# if one wants to include a preinit script (e.g preinit_ckov_noscint.mac to turn off scintillation), type:
+# > python2 makejobs_shards.py gep12_elastic_sig.mac 50 preinit_ckov_noscint.mac
+# Merge the outputs with root_macros/g4sbs_merge_shards.C, which sums the run_data normalization:
+# root [0] g4sbs_merge_shards("gep12_elastic_sig.root", "/volatile/.../gep12_elastic_sig_shard_*.root")
+# Obviously, before using this script for your own, change all paths indicated by "/your_/path_/to_/your_/..."
+
+#!/usr/bin/python
+
+import sys
+import os
+import datetime
+
+if len(sys.argv) != 3 and len(sys.argv) != 4:
+    print("Supply macro and number of shards")
+    print(" you may supply a preinit macro as a last argument")
+    sys.exit()
+
+macro = sys.argv[1][:-4]
+nshards = int(sys.argv[2])
+cwd = os.getcwd()
+
+if len(sys.argv) == 4:
+    macro_pre = sys.argv[3][:-4]
+
+runfiletxt="""#!/bin/csh
+#setenv ROOTSYS /apps/root/5.34.13/root
+#setenv LD_LIBRARY_PATH $LD_LIBRARY_PATH':'$ROOTSYS
+"""
+
+mytime = datetime.datetime.today()
+suffix2 = macro+'_'+mytime.strftime("%Y%m%d_%H")
+
+for i in range(0, nshards):
+    suffix = macro+'_'+mytime.strftime("%Y%m%d_%H%M%S")+'_shard_'+str(i)
+    suffix3 = str(i)
+
+    print('Creating job '+suffix)
+
+    shardmacro = open("shard_"+suffix+".mac", 'w')
+    shardmacro.write("/g4sbs/shard "+str(i)+" "+str(nshards)+"\n")
+    shardmacro.write("/control/execute "+macro+".mac\n")
+    shardmacro.close()
+
+    runfile = open("runjob_"+suffix+".sh", 'w')
+    runfile.write(runfiletxt)
+    runfile.write("\n")
+    runfile.write("ln -s /group/halla/www/hallaweb/html/12GeV/SuperBigBite/downloads/map_696A.dat .\n")
+    runfile.write("ln -s /group/halla/www/hallaweb/html/12GeV/SuperBigBite/downloads/GEP_12map0_newheader.table .\n")
+    runfile.write("mkdir -p /volatile/your_/path_/to_/your_/output_/"+suffix2+"\n")
+    if len(sys.argv) == 3:
+        runfile.write("time ./g4sbs shard_"+suffix+".mac > run.out\n")
+    if len(sys.argv) == 4:
+        runfile.write("time ./g4sbs "+macro_pre+".mac shard_"+suffix+".mac > run.out\n")
+    runfile.write("mv "+macro+".root /volatile/your_/path_/to_/your_/output_/"+suffix2+"/"+macro+"_shard_"+suffix3+".root\n")
+# NB: it is important that the name of the root file you produce (in your .mac file) is the same as the first file name in the previous line. If not, your output file will be lost.
+    runfile.write("mv run.out /volatile/your_/path_/to_/your_/output_/run_"+suffix+".out\n")
+    runfile.close()
+
+    subfile = open("g4sbs_work_"+suffix+".jsub", 'w')
+
+    subfile.write("PROJECT: sbs\n")
+    subfile.write("TRACK: simulation\n")
+    subfile.write("OS: centos7\n")
+    subfile.write("JOBNAME: g4sbs_"+suffix+"\n")
+    subfile.write("MEMORY: 1500 MB\n")
+    subfile.write("COMMAND: csh runjob_"+suffix+".sh\n")
+    subfile.write("OTHER_FILES:\n")
+    subfile.write("/your_/path_/to_/your_/submit_dir_/runjob_"+suffix+".sh\n")
+    subfile.write("/your_/path_/to_/your_/g4sbs_build_dir_/g4sbs\n")
+    subfile.write(cwd+"/shard_"+suffix+".mac\n")
+    subfile.write(cwd+'/'+macro+".mac\n")
+    if len(sys.argv) == 4:
+        subfile.write(cwd+'/'+macro_pre+".mac\n")
+    subfile.close()
+
+    os.system("jsub g4sbs_work_"+suffix+".jsub")
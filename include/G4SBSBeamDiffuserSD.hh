@@ -32,6 +32,7 @@ class G4SBSBeamDiffuserSD : public G4VSensitiveDetector
 
    private:
       G4SBSBDHitsCollection* fHitsCollection;
+      G4int fProfileID; //timer of this SD in G4SBSProfiler
 };
 
 #endif
@@ -18,7 +18,10 @@ public:
   int ntimebins;
 
   vector<double> hold_tbins; //******
+  int pulseshape; //G4SBS::PulseShape_t: whether edep_vs_time or the sparse ps_* vectors are filled
   vector< vector<double> > edep_vs_time;  //time dependence of energy deposition within timewindow
+  vector<int> ps_idx, ps_bin; //sparse pulse shape: hit index and time bin of each non-empty bin of edep_vs_time
+  vector<double> ps_val;
   double gatewidth;
 
   double Esum; //energy deposition sum over entire sensitive detector
@@ -32,6 +35,7 @@ public:
   vector<double> xhit, yhit, zhit; //weighted "average" local position of energy deposition
   vector<double> xhitg, yhitg, zhitg; //weighted "average" global position of energy deposition
   vector<double> sumedep, tavg, trms, tmin, tmax; //Sum of energy deposition, average, rms, min and max global times of energy depositions in this cell
+  vector<double> weight; //energy-deposition-weighted average track weight of the hit (importance biasing)
   
   //"Part" keeps track of all unique particles depositing energy in a "calorimeter" sensitive volume:
   int npart_CAL; //Number of particles depositing energy in a given cell
@@ -44,6 +48,9 @@ public:
 
   //Add bookkeeping indices for "original", "primary", and "SD boundary" tracks:
   vector<int> otridx,ptridx,sdtridx;
+
+  //Pile-up flag: 0 = signal hit, 1 = background hit, 2 = signal hit with background added (see G4SBSPileup):
+  vector<int> bkgd;
   
   bool keeppart;
   
@@ -42,6 +42,7 @@ private:
   double edep; //energy deposition of the hit
   double energy; //Initial energy of the particle prior to the hit.
   double Lstep; //spatial length of the step (magnitude)
+  double weight; //track weight (importance biasing)
 
   G4int cell, row, col, plane, wire; //Channel information 
   G4ThreeVector CellCoords; //"local" coordinates of center of cell in which hit occurred
@@ -84,6 +85,9 @@ public:
   inline void SetLstep(G4double L)
   { Lstep = L; }
 
+  inline void SetWeight(G4double w)
+  { weight = w; }
+
   inline void SetCell(G4int c)
   { cell = c; }
   
@@ -144,6 +148,9 @@ public:
 
   inline G4double GetLstep()
   { return Lstep; }
+
+  inline G4double GetWeight()
+  { return weight; }
   
   inline G4int GetCell() { return cell; }
   inline G4int GetRow() { return row; }
@@ -48,6 +48,7 @@ private:
   G4double fHitTimeWindow;   //Maximum time after the first tracking step of the hit before starting a new hit. 
   G4double fEnergyThreshold; //Threshold on the minimum summed energy deposition of a hit to record to the output.
   G4SBSCalHitsCollection *hitCollection;
+  G4int fProfileID; //timer of this SD in G4SBSProfiler
 
 };
 
@@ -0,0 +1,71 @@
+#ifndef G4SBSCulling_h
+#define G4SBSCulling_h 1
+
+/*!
+ * Macro-configurable culling of tracks that cannot contribute to any sensitive detector.
+ *
+ * Volume rules (/g4sbs/cull): a track in the named logical volume, or in any logical volume of the
+ * named G4Region, is killed as soon as its kinetic energy is below the threshold for its particle
+ * species ("all" matches every species). This generalizes the G4UserLimits(0,0,0,DBL_MAX,DBL_MAX)
+ * settings hard-coded in the builders, with an energy threshold and a per-rule counter.
+ *
+ * Escape rule (/g4sbs/cullescape): a track outside a sphere of radius R centered on the target, with
+ * momentum pointing away from the origin, is killed, as it can no longer reach any detector.
+ *
+ * The number of tracks killed and the kinetic energy removed are reported for each rule at the end of
+ * the run.
+ *
+ * This is implemented in the singleton model, like G4SBSRun.
+ */
+
+#include "globals.hh"
+#include <map>
+#include <vector>
+
+using namespace std;
+
+class G4Step;
+class G4LogicalVolume;
+class G4ParticleDefinition;
+
+struct G4SBSCullRule {
+  G4String volume;    //logical volume or region name
+  G4String particle;  //particle name, or "all"
+  G4double Ethresh;   //kinetic energy threshold
+  const G4ParticleDefinition *pdef; //resolved at the beginning of the run; NULL for "all"
+  G4long nkilled;
+  G4double Ekilled;
+};
+
+class G4SBSCulling {
+private:
+  static G4SBSCulling *gSingleton;
+  G4SBSCulling();
+
+public:
+  static G4SBSCulling *GetCulling();
+  ~G4SBSCulling();
+
+  void AddRule( G4String volume, G4String particle, G4double Ethresh );
+  void ClearRules();
+  void SetEscapeRadius( G4double R ){ fEscapeRadius = R; }
+
+  G4bool IsActive() const { return !fRules.empty() || fEscapeRadius > 0.0; }
+
+  //Resolve volume and particle names, reset counters:
+  void BeginOfRun();
+  void EndOfRun();
+
+  //Called from the stepping action; returns true if the track was killed:
+  G4bool ProcessStep( const G4Step *aStep );
+
+private:
+  vector<G4SBSCullRule> fRules;
+  map<const G4LogicalVolume*, vector<size_t> > fVolumeRules; //rules indexed by logical volume
+
+  G4double fEscapeRadius;
+  G4long fNescaped;
+  G4double fEescaped;
+};
+
+#endif
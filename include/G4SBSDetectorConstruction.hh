@@ -221,6 +221,11 @@ public:
 
   void SetOpticalPhotonDisabled(G4String material){ fMaterialsListOpticalPhotonDisabled.insert( material ); }
 
+  //Optical properties (RINDEX, scintillation) are only attached to materials when Cerenkov or scintillation is on:
+  void SetUsingCerenkov( G4bool b );
+  void SetUsingScintillation( G4bool b );
+  G4bool OpticalPropertiesEnabled( G4String material ) const;
+
   void SetThresholdTimeWindowAndNTimeBins( G4String SDname, G4double Ethresh=0.0*MeV, G4double Twindow=1000.0*ns, G4int NTBins=25 ); //utility function to set time window, # of time bins and threshold by sensitive detector name
 
   inline set<G4String> GetTargetVolumes() const { return fTargetVolumes; }
@@ -245,6 +250,8 @@ private:
   set<G4String> fMaterialsListOpticalPhotonDisabled; //Allows us to disable definition of refractive index and
   //scintillation parameter definition for individual materials, to prevent optical photon production and tracking
 
+  G4bool fUseCerenkov, fUseScintillation; //set by /g4sbs/useckov and /g4sbs/usescint
+
   set<G4String> fTargetVolumes; //list of logical volume names to be flagged as "TARGET"
   set<G4String> fAnalyzerVolumes; //list of logical volume names to be flagged as "ANALYZER"
   
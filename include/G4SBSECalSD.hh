@@ -6,6 +6,7 @@
 #include "G4SBSDetMap.hh"
 #include "G4Step.hh"
 #include "G4SBSSDTrackOutput.hh"
+#include <set>
 
 class G4SBSECalSD : public G4VSensitiveDetector
 {
@@ -21,6 +22,9 @@ public:
   void DrawAll();
   void PrintAll();
 
+  //Add a hit for a photon whose transport is handled by the optical lookup table (see G4SBSOpticalLUT):
+  void InjectHit( G4Track *track, G4int PMT, G4double time, G4ThreeVector xgpmt );
+
   G4SBSDetMap detmap;
 
   // *****
@@ -41,6 +45,9 @@ private:
   G4double fHitTimeWindow;   //Maximum time after the first tracking step of the hit before starting a new hit. 
   G4double fPEThreshold; //Threshold on the minimum summed energy deposition of a hit to record to the output.
   G4SBSECalHitsCollection *hitCollection;
+  G4int fProfileID; //timer of this SD in G4SBSProfiler
+
+  std::set<G4int> fLUTphotons; //photons already recorded in the optical LUT during this event (calibration mode)
 };
 
 #endif
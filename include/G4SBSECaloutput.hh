@@ -19,7 +19,10 @@ public:
   double timewindow, threshold; //Number of photo-electrons within timewindow must exceed threshold
   int ntimebins;
 
+  int pulseshape; //G4SBS::PulseShape_t: whether NPE_vs_time or the sparse ps_* vectors are filled
   vector< vector<double> > NPE_vs_time;
+  vector<int> ps_idx, ps_bin; //sparse pulse shape: index in NPE_vs_time and time bin of each non-empty bin
+  vector<double> ps_val;
   double gatewidth;
 
   int SumPhotoelectrons; //total NPE in the whole detector
@@ -32,7 +32,10 @@
 #include "G4SBSTargetHit.hh"
 #include "G4SBSTargetoutput.hh"
 
+#include "G4ThreeVector.hh"
+
 #include <set> 
+#include <vector>
 
 using namespace std;
 
@@ -41,6 +44,33 @@ using namespace std;
 class G4Event;
 class G4SBSIO;
 class G4SBSEventGen;
+class G4SBSDetMap;
+
+//Per-photon state of the optical photons in the hits of one RICH or ECAL detector (see FillRICHData and FillECalData):
+struct G4SBSOpticalPhoton {
+  G4int tid, firststep, nsteps;
+  G4bool used, detected;
+  G4double energy, hittime;
+  G4ThreeVector pos, dir, vertex, vdir;
+  G4ThreeVector xpmt, xgpmt; //"local" and global PMT coordinates
+  G4int pmt, row, col, plane, mtid, origvol;
+  G4int otridx, ptridx, sdtridx;
+};
+
+//Per-PMT accumulators, indexed by PMT number:
+struct G4SBSOpticalPMT {
+  G4long fillID; //Fill call in which this PMT was last reset
+  G4long passID; //Pass over the detected photons in which this PMT was last started
+  G4int npe, row, col, plane, mtid, origvol;
+  G4double hittime, hittime2, tmin, tmax;
+  G4ThreeVector pos, dir, vpos, vdir, x, xg;
+  //Track indices of the detected photons, kept over all passes of an event:
+  vector<G4int> otridx, ptridx, sdtridx;
+  //ECAL pulse shape: time-ordered detected steps, start time and time-binned NPE of each hit:
+  vector<G4int> steps;
+  vector<G4double> tbinstart;
+  vector<vector<G4double> > npe_tbin;
+};
 
 class G4SBSEventAction : public G4UserEventAction
 {
@@ -66,7 +96,7 @@ public:
   void FillGEMData( const G4Event*, G4SBSGEMHitsCollection*, G4SBSGEMoutput &, G4SBSSDTrackOutput & );
   void FillCalData( const G4Event*, G4SBSCalHitsCollection*, G4SBSCALoutput &, G4SBSSDTrackOutput & );
   void FillRICHData( const G4Event*, G4SBSRICHHitsCollection*, G4SBSRICHoutput &, G4SBSSDTrackOutput & );
-  void FillTrackData( G4SBSGEMoutput, G4SBSTrackerOutput & );
+  void FillTrackData( const G4SBSGEMoutput &, G4SBSTrackerOutput & );
   void FillECalData( G4SBSECalHitsCollection*, G4SBSECaloutput &, G4SBSSDTrackOutput & );
   // for D Flay studies 
   void FillBDData(const G4Event *evt,G4SBSBDHitsCollection *hc,G4SBSBDoutput &out); // for the Beam Diffuser (BD)
@@ -103,6 +133,26 @@ private:
   G4int fEventStatusEvery; //< Print event status at every N-entries
 
   G4int fhistogram_index;
+
+  //Scratch buffers of FillRICHData and FillECalData, reused from event to event:
+  vector<G4SBSOpticalPhoton> fPhotons; //in order of increasing track ID
+  vector<pair<G4int,G4int> > fPhotonSteps; //(track ID, step) pairs, sorted
+  vector<G4int> fStepPhoton; //index in fPhotons of each step, -1 for skipped steps
+  vector<G4SBSOpticalPMT> fPMTs;
+  vector<G4int> fPassPMTs; //PMTs started in the current pass
+  G4long fOpticalFillID, fOpticalPassID;
+
+  //Pooled pulse-shape buffer of the hits of one CAL cell (FillCalData): non-empty time bins of all hits,
+  //fPulseFirst = index of the first bin of each hit
+  vector<size_t> fPulseFirst;
+  vector<G4int> fPulseBin;
+  vector<G4double> fPulseVal;
+  void AddToPulseShape( G4int ibin, G4double val ); //adds to a bin of the last hit
+
+  void ReservePMTs( G4int npmt );
+  void ReservePMTs( const G4SBSDetMap &detmap ); //makes room for all PMTs of a RICH or ECAL detector
+  G4SBSOpticalPMT &GetPMT( G4int pmt ); //resets the PMT at its first use in a Fill call
+  void SortPhotons(); //fills fPhotons and fStepPhoton from fPhotonSteps
   
 public:
 };
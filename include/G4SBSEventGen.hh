@@ -11,6 +11,7 @@
 #include "DSS2007FF.hh"
 #include "G4SBSPythiaOutput.hh"
 #include "G4SBSSIMCOutput.hh"
+#include "G4SBSPhaseSpace.hh"
 #include "G4SBSUtil.hh"
 #include "TFile.h"
 #include "TTree.h"
@@ -145,10 +146,13 @@ public:
   TChain *GetPythiaChain(){ return fPythiaChain; }
   
   void LoadPythiaChain(G4String fname);
+  void SetChainEntry( long n ){ fchainentry = n; } //Next entry to read from the PYTHIA6/SIMC chain
 
   void SetSIMCEvent( G4SBSSIMCOutput ev ){ fSIMCEvent = ev; }
   G4SBSSIMCOutput GetSIMCEvent(){ return fSIMCEvent; }
 
+  const vector<G4SBSPhaseSpaceRecord> &GetPhaseSpaceEvent() const { return fPhaseSpaceEvent; }
+
   simc_tree *GetSIMCTree(){ return fSIMCTree; }
   TChain *GetSIMCChain(){ return fSIMCChain; }
   
@@ -373,6 +377,7 @@ private:
   bool GeneratePythia(); //Generates primaries from a ROOT Tree containing PYTHIA6 events.
   bool GenerateCosmics(); //Generates muons from the top of the world geometry, directed towards a point in space
   bool GenerateSIMC(); //Generates primaries from a ROOT Tree containing PYTHIA6 events.
+  bool GeneratePhaseSpace(); //Replays particles recorded on a phase space surface (see G4SBSPhaseSpace)
   
   //AJRP: June 5, 2021: calculate soffer bounds for transversity calculations:
 
@@ -433,6 +438,8 @@ private:
   
   G4SBSSIMCOutput fSIMCEvent;
 
+  vector<G4SBSPhaseSpaceRecord> fPhaseSpaceEvent;
+
   G4double TriangleFunc(G4double a, G4double b, G4double c );
 };
 
@@ -0,0 +1,101 @@
+#ifndef G4SBSGEMDigitizer_h
+#define G4SBSGEMDigitizer_h 1
+
+/*!
+ * Strip-level digitization of the GEM hits (/g4sbs/gemdigitize true), as done downstream by
+ * gmn_tree_digitized.C, but directly on the aggregated G4SBSGEMoutput at the end of each event.
+ *
+ * The charge of each hit, proportional to its energy deposition, is spread uniformly along the
+ * track segment from (xin,yin) to (xout,yout), smeared by a Gaussian avalanche spread, and shared
+ * equally between the X and Y readout strips of the plane. Each fired strip is sampled by an APV25
+ * CR-RC shaper at 6 times, 25 ns apart, with Gaussian noise. Strips whose largest sample is below the
+ * zero-suppression threshold are not written.
+ *
+ * The strips of each GEM SD are written to the branches <SD>.dighit.nstrips, .module (plane), .axis
+ * (0 = X, 1 = Y), .strip and .adc_0 to .adc_5. With /g4sbs/gemdigitizekeephits false, only a few truth
+ * variables of the hits are written (see G4SBSIO::BranchGEM).
+ *
+ * Noise is only added to strips with signal; common-mode noise and cross-talk are not simulated.
+ *
+ * This is implemented in the singleton model, like G4SBSRun.
+ */
+
+#include "globals.hh"
+#include "G4SBSGEMoutput.hh"
+#include <map>
+#include <vector>
+
+using namespace std;
+
+class TTree;
+class G4SBSGEMSD;
+
+//Digitized strips of one GEM SD:
+class G4SBSGEMdigioutput {
+public:
+  void Clear();
+
+  int nstrips;
+  vector<int> module, axis, strip;
+  vector<int> adc[6];
+};
+
+class G4SBSGEMDigitizer {
+private:
+  static G4SBSGEMDigitizer *gSingleton;
+  G4SBSGEMDigitizer();
+
+public:
+  static G4SBSGEMDigitizer *GetDigitizer();
+  ~G4SBSGEMDigitizer();
+
+  enum { kNsamples = 6 };
+
+  void SetEnabled( G4bool b ){ fEnabled = b; }
+  G4bool IsEnabled() const { return fEnabled; }
+
+  void SetKeepHits( G4bool b ){ fKeepHits = b; }
+  G4bool KeepHits() const { return !fEnabled || fKeepHits; }
+
+  void SetPitch( G4double p ){ fPitch = p; }
+  void SetSpread( G4double s ){ fSpread = s; }
+  void SetADCperkeV( G4double g ){ fADCperkeV = g; }
+  void SetNoise( G4double n ){ fNoise = n; }
+  void SetThreshold( G4double t ){ fThreshold = t; }
+  void SetTimeOffset( G4double t ){ fTimeOffset = t; }
+
+  void BeginOfRun();
+  void EndOfRun();
+
+  void Branch( TTree *tree, G4String SDname );
+
+  //Digitize the hits of this event in GEM SD SDname (hits in tree units, m and ns):
+  void Digitize( G4String SDname, const G4SBSGEMSD *sd, const G4SBSGEMoutput &gd );
+
+private:
+  G4bool fEnabled;
+  G4bool fKeepHits;
+
+  G4double fPitch;      //strip pitch
+  G4double fSpread;     //rms of the avalanche charge spread
+  G4double fADCperkeV;  //peak ADC amplitude per keV of deposited energy, summed over the strips of both axes
+  G4double fNoise;      //rms noise of each sample, in ADC counts
+  G4double fThreshold;  //zero-suppression threshold on the largest sample, in ADC counts
+  G4double fTimeOffset; //time of the first sample relative to the event start
+  G4double fTau;        //APV25 shaping time
+  G4double fSampleTime; //APV25 sampling period
+  G4int fADCmax;
+
+  map<G4String, G4SBSGEMdigioutput> fDigiData;
+
+  //Strips of the current SD and event, keyed by (plane, axis, strip):
+  map<G4long, G4int> fStripIndex;
+  vector<G4long> fStripKey;
+  vector<G4double> fStripSamples; //kNsamples per strip
+
+  void AddCharge( G4int plane, G4int axis, G4int nstrips, G4double u, G4double q, G4double t );
+
+  G4long fNevents, fNhits, fNstrips;
+};
+
+#endif
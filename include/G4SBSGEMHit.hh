@@ -48,6 +48,7 @@ private:
   G4double p, edep;
   G4double hittime;
   G4double beta; //v/c, for timing:
+  G4double weight; //track weight (importance biasing)
 
   G4int otridx, ptridx, sdtridx;
 
@@ -82,6 +83,8 @@ public:
   { hittime = t; }
   inline void SetBeta( G4double b )
   { beta = b; }
+  inline void SetWeight( G4double w )
+  { weight = w; }
 
   inline G4ThreeVector GetPos()
   { return pos;};
@@ -109,6 +112,7 @@ public:
   inline G4double GetEdep(){ return edep; }
   inline G4double GetHittime(){ return hittime; }
   inline G4double GetBeta(){ return beta; }
+  inline G4double GetWeight(){ return weight; }
 
   inline void SetOTrIdx(G4int idx){ otridx = idx; }
   inline void SetPTrIdx(G4int idx){ ptridx = idx; }
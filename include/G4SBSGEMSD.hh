@@ -30,6 +30,10 @@ public:
   void SetZoffset(double z){ fZoffset = z; }
 
   double GetZoffset() const { return fZoffset; }
+
+  //Center (in "tracker box" coordinates) and transverse size of each plane, for the strip digitization:
+  void SetPlaneGeometry( G4int plane, G4ThreeVector center, double width, double height );
+  G4bool GetPlaneGeometry( G4int plane, G4ThreeVector &center, double &width, double &height ) const;
   
   // map<G4String, int> GEMTrackerIDs; //Map to associate logical volume names with tracking modules
   // map<int, Arm_t>    GEMArmIDs;
@@ -40,8 +44,12 @@ public:
 
 private:
   G4SBSGEMHitsCollection *hitCollection;
+  G4int fProfileID; //timer of this SD in G4SBSProfiler
   double fZoffset;
 
+  map<G4int, G4ThreeVector> fPlaneCenter;
+  map<G4int, pair<double,double> > fPlaneSize; //(width, height)
+
   
 };
 
@@ -27,8 +27,12 @@ public:
   vector<int> trid,mid,pid;
   vector<double> vx,vy,vz;
   vector<double> p,edep,beta;
+  vector<double> weight; //track weight (importance biasing)
   //Add bookkeeping indices for "original", "primary", and "SD boundary" tracks:
   vector<int> otridx,ptridx,sdtridx;
+
+  //Pile-up flag: 0 = signal hit, 1 = background hit (see G4SBSPileup):
+  vector<int> bkgd;
   
   G4SBSParticleOutput ParticleHistory;
 
@@ -21,6 +21,11 @@
 #include "G4SBSICoutput.hh"
 #include "G4SBSTargetoutput.hh"
 
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
 class TFile;
 class TTree;
 class G4SBSGlobalField;
@@ -91,6 +96,20 @@ typedef struct {
 
 } cal_t;
 
+//Event-level generator data of the event being generated. With the asynchronous writer (/g4sbs/asyncwrite), the
+//previous event may still be written while the next one is generated, so the primary generator action fills this
+//staged copy, which G4SBSIO::FillTree copies to the tree buffers once the writer is done with them:
+typedef struct {
+  ev_t evdata;
+  G4SBSPythiaOutput Primaries;
+  G4SBSSIMCOutput SIMCprimaries;
+  G4double TargPol, TargThetaSpin, TargPhiSpin;
+  G4double BeamPol, BeamThetaSpin, BeamPhiSpin;
+  G4double AUT_Collins, AUT_Sivers;
+  G4double AUT_Collins_min, AUT_Sivers_min;
+  G4double AUT_Collins_max, AUT_Sivers_max;
+} genevent_t;
+
 class G4SBSIO {
 public:
   G4SBSIO();
@@ -99,7 +118,7 @@ public:
   void SetFilename(const char *fn){strcpy(fFilename, fn);}
   //void SetTrackData(tr_t td){ trdata = td; }
   //void SetCalData(cal_t cd){ caldata = cd; }
-  void SetEventData(ev_t ed){ evdata = ed; }
+  void SetEventData(ev_t ed){ fStaged.evdata = ed; }
   //void SetHitData(hit_t ht){ hitdata = ht; }
   //void SetRICHData( G4SBSRICHoutput rd ) { richdata = rd; }
   //void SetTrackData( G4SBSTrackerOutput td ){ trackdata = td; }
@@ -120,7 +139,7 @@ public:
   void SetGEnTargetData_Al(G4String SDname,G4SBSTargetoutput data);     // for GEn target Al  
   void SetGEnTargetData_3He(G4String SDname,G4SBSTargetoutput data);    // for GEn target 3He  
 
-  inline void SetAllSDtrackData( G4SBSSDTrackOutput sd ){ allsdtrackdata = sd; } 
+  void SetAllSDtrackData( G4SBSSDTrackOutput sd );
 
   //inline G4SBSSDTrackOutput GetSDtrackData( G4String sdname ){ return sdtrackdata[sdname]; }
 
@@ -129,6 +148,13 @@ public:
   
   void FillTree();
   void WriteTree();
+
+  //Asynchronous output: the tree of each event is filled (and its baskets compressed and written) by a writer
+  //thread while the next event is tracked. WaitForWriter() blocks until the previous event has been written,
+  //and must be called before the tree buffers of the next event are set:
+  void SetAsyncWrite( G4bool b ){ fAsyncWrite = b; }
+  G4bool GetAsyncWrite() const { return fAsyncWrite; }
+  void WaitForWriter();
   
   void SetBeamE(double E){ gendata.Ebeam = E/CLHEP::GeV; }
   void SetBeamCur(double cur){ gendata.Ibeam = cur; }
@@ -149,7 +175,7 @@ public:
   
   void SetGlobalField(G4SBSGlobalField *gf){fGlobalField = gf; }
   
-  ev_t GetEventData(){ return evdata; }
+  ev_t GetEventData(){ return fStaged.evdata; }
   gen_t GetGenData(){ return gendata; }
   
   void InitializeTree();
@@ -169,6 +195,9 @@ public:
   void BranchGEnTarget_Cu(G4String SDname);    // for GEn target
   void BranchGEnTarget_Al(G4String SDname);    // for GEn target
   void BranchGEnTarget_3He(G4String SDname);   // for GEn target
+
+  TTree *GetSDTree( G4String SDname ); //tree to which the branches of this SD are attached
+  G4int GetNhitsSD( G4String SDname );
  
   void SetDetCon(G4SBSDetectorConstruction *dc ){ fdetcon = dc; }
 
@@ -179,10 +208,10 @@ public:
   //map<G4String,G4bool> KeepSDtracks;
   
   
-  void SetPythiaOutput( G4SBSPythiaOutput p ){ Primaries = p; }
+  void SetPythiaOutput( G4SBSPythiaOutput p ){ fStaged.Primaries = p; }
   void SetUsePythia6( G4bool b ){ fUsePythia = b; }
 
-  void SetSIMCOutput( G4SBSSIMCOutput p ){ SIMCprimaries = p; }
+  void SetSIMCOutput( G4SBSSIMCOutput p ){ fStaged.SIMCprimaries = p; }
   void SetUseSIMC( G4bool b ){ fUseSIMC = b; }
 
   map<G4String,G4int> histogram_index; //map with key = SDname, val = histogram index in TClonesArray
@@ -204,6 +233,18 @@ public:
   void SetKeepAllPulseShape( G4bool b ){ fKeepAllPulseShape=b; }
   G4bool GetKeepAllPulseShape() const { return fKeepAllPulseShape; }
   map<G4String,G4bool> GetKeepPulseShape() const { return fKeepPulseShape; }
+  G4bool KeepPulseShape( G4String sdname ) const {
+    map<G4String,G4bool>::const_iterator it = fKeepPulseShape.find( sdname );
+    return fKeepAllPulseShape || (it != fKeepPulseShape.end() && it->second);
+  }
+
+  //Sparse pulse shape: only the non-empty time bins are written, as (pulse, bin, value) triples:
+  void SetSparsePulseShape( G4bool b ){ fSparsePulseShape = b; }
+  G4bool GetSparsePulseShape() const { return fSparsePulseShape; }
+  G4SBS::PulseShape_t GetPulseShapeMode( G4String sdname ) const {
+    if( !KeepPulseShape( sdname ) ) return G4SBS::kPulseShapeOff;
+    return fSparsePulseShape ? G4SBS::kPulseShapeSparse : G4SBS::kPulseShapeDense;
+  }
 
   void SetUsingCerenkov( G4bool b ){ fUsingCerenkov = b; }
   void SetUsingScintillation( G4bool b ){ fUsingScintillation = b; }
@@ -213,26 +254,35 @@ public:
 
   void SetWriteFieldMaps( G4bool b ){ fWritePortableFieldMaps = b; }
 
+  //Sparse output: per-SD payload trees filled only for events with hits in that SD, indexed from the main tree:
+  void SetSparseOutput( G4bool b ){ fSparseOutput = b; }
+  G4bool GetSparseOutput() const { return fSparseOutput; }
+
+  //Compact output: floating-point hit data of GEM, CAL and SD track branches written as float32, with positions
+  //and times rounded to fixed steps (recorded in run_data):
+  void SetCompactOutput( G4bool b ){ fCompactOutput = b; }
+  G4bool GetCompactOutput() const { return fCompactOutput; }
+
   //Set Kinematics: this determines what generator-specific tree branches we create:
   void SetKine( G4SBS::Kine_t kine ){ fKineType = kine; }
 
   //Setters for beam and target polarization info;
-  void SetTargPol( G4double pol ){ fTargPol = pol; }
-  void SetTargThetaSpin( G4double theta ){ fTargThetaSpin = theta; }
-  void SetTargPhiSpin( G4double phi ){ fTargPhiSpin = phi; }
+  void SetTargPol( G4double pol ){ fStaged.TargPol = pol; }
+  void SetTargThetaSpin( G4double theta ){ fStaged.TargThetaSpin = theta; }
+  void SetTargPhiSpin( G4double phi ){ fStaged.TargPhiSpin = phi; }
 
-  void SetBeamPol( G4double pol ){ fBeamPol = pol; }
-  void SetBeamThetaSpin( G4double theta ){ fBeamThetaSpin = theta; }
-  void SetBeamPhiSpin( G4double phi ){ fBeamPhiSpin = phi; }
+  void SetBeamPol( G4double pol ){ fStaged.BeamPol = pol; }
+  void SetBeamThetaSpin( G4double theta ){ fStaged.BeamThetaSpin = theta; }
+  void SetBeamPhiSpin( G4double phi ){ fStaged.BeamPhiSpin = phi; }
 
-  void SetAUT_Collins( G4double Acoll ){ fAUT_Collins = Acoll; }
-  void SetAUT_Sivers( G4double Asiv ){ fAUT_Sivers = Asiv; }
+  void SetAUT_Collins( G4double Acoll ){ fStaged.AUT_Collins = Acoll; }
+  void SetAUT_Sivers( G4double Asiv ){ fStaged.AUT_Sivers = Asiv; }
 
-  void SetAUT_Collins_min( G4double Acoll ){ fAUT_Collins_min = Acoll; }
-  void SetAUT_Sivers_min( G4double Asiv ){ fAUT_Sivers_min = Asiv; }
+  void SetAUT_Collins_min( G4double Acoll ){ fStaged.AUT_Collins_min = Acoll; }
+  void SetAUT_Sivers_min( G4double Asiv ){ fStaged.AUT_Sivers_min = Asiv; }
 
-  void SetAUT_Collins_max( G4double Acoll ){ fAUT_Collins_max = Acoll; }
-  void SetAUT_Sivers_max( G4double Asiv ){ fAUT_Sivers_max = Asiv; }
+  void SetAUT_Collins_max( G4double Acoll ){ fStaged.AUT_Collins_max = Acoll; }
+  void SetAUT_Sivers_max( G4double Asiv ){ fStaged.AUT_Sivers_max = Asiv; }
   
 private:
   TFile *fFile;
@@ -245,6 +295,7 @@ private:
 
   G4bool fKeepAllPulseShape;
   map<G4String,G4bool> fKeepPulseShape;
+  G4bool fSparsePulseShape;
   
   ev_t evdata;
   gen_t gendata;
@@ -315,6 +366,35 @@ private:
 
   // Option to create "portable" field maps for SBS and/or BB from global TOSCA map:
   G4bool fWritePortableFieldMaps;
+
+  // Sparse output mode:
+  G4bool fSparseOutput;
+  map<G4String,TTree*> fSDTrees; //per-SD payload trees, key = SD name
+  vector<G4String> fSparseSDnames; //SD names in order of the payload tree index
+  Int_t fSparseNSD; //number of SDs with hits in this event
+  vector<Int_t> fSparseSDindex; //index (into fSparseSDnames) of each SD with hits in this event
+  vector<Long64_t> fSparseEntry; //entry of this event in the corresponding payload tree
+
+  // Compact output mode:
+  G4bool fCompactOutput;
+  deque<vector<double>*> fCompactAddr; //addresses of the vectors of float32 branches (ROOT keeps a pointer to each)
+  void BranchHits( TTree *tree, const char *name, vector<double> *v ); //vector<Double32_t> branch in compact mode
+  void QuantizeGEM( G4SBSGEMoutput & );
+  void QuantizeCAL( G4SBSCALoutput & );
+  void QuantizeSDtracks( G4SBSSDTrackOutput & );
+
+  // Asynchronous output mode:
+  genevent_t fStaged; //generator data of the next event to be filled
+  G4bool fAsyncWrite;
+  std::thread fWriter;
+  std::mutex fWriterMutex;
+  std::condition_variable fWriterCV;
+  G4bool fFillPending; //an event is handed to (or being filled by) the writer thread
+  G4bool fWriterStop;
+  void StartWriter();
+  void StopWriter(); //waits for the last event to be written
+  void WriterLoop();
+  void FillTreeNow();
   
 };
 
@@ -0,0 +1,83 @@
+#ifndef G4SBSImportance_h
+#define G4SBSImportance_h 1
+
+/*!
+ * Geometry-based importance sampling with splitting and Russian roulette.
+ *
+ * Importance values are assigned to logical volumes (or to all logical volumes of a G4Region) with
+ * /g4sbs/importance. Volumes without an explicit value inherit the importance of their mother volume;
+ * the world has importance 1. When a track crosses a boundary from importance I1 to importance I2:
+ *  - I2 > I1: the track is split into on average I2/I1 copies (the integer part plus one more with the
+ *    probability of the fractional part), each with its weight multiplied by I1/I2.
+ *  - I2 < I1: the track survives with probability I2/I1 ("Russian roulette"); survivors get their
+ *    weight multiplied by I1/I2.
+ * The weight is the standard G4Track weight, which Geant4 passes on to secondaries. It is recorded
+ * in the G4SBSTrackInformation at SD boundary crossing and written to the hit and SD track outputs,
+ * so that rates are obtained by weighting each hit.
+ *
+ * Split copies are new tracks starting at the boundary: their vertex (hit.vx, etc.) is the boundary
+ * crossing point, while the "original" and "primary" track information is copied from the parent.
+ *
+ * At the end of the run, the splitting/roulette counters and, for each SD, the effective number of
+ * hits (sum w)^2/(sum w^2) per CPU hour are printed; the ratio of that figure between a biased and an
+ * unbiased run is the variance reduction gain per unit CPU time.
+ *
+ * This is implemented in the singleton model, like G4SBSRun.
+ */
+
+#include "globals.hh"
+#include "G4TrackVector.hh"
+#include <map>
+#include <set>
+#include <vector>
+
+using namespace std;
+
+class G4Step;
+class G4LogicalVolume;
+class G4ParticleDefinition;
+class G4Track;
+class G4SBSTrackInformation;
+
+class G4SBSImportance {
+private:
+  static G4SBSImportance *gSingleton;
+  G4SBSImportance();
+
+public:
+  static G4SBSImportance *GetImportance();
+  ~G4SBSImportance();
+
+  void SetImportance( G4String volume, G4double importance ){ fImportanceByName[volume] = importance; }
+  void AddParticle( G4String particle ){ fParticleNames.insert( particle ); }
+  void Clear();
+
+  G4bool IsActive() const { return !fImportanceByName.empty(); }
+
+  void BeginOfRun();
+  void EndOfRun( G4double cputime );
+
+  //Called from the stepping action at each step; split copies are added to secondaries:
+  void ProcessStep( const G4Step *aStep, G4TrackVector *secondaries );
+
+  //Accumulate hit weights for the end-of-run figure of merit:
+  void ScoreHit( G4String SDname, G4double weight );
+
+private:
+  map<G4String,G4double> fImportanceByName;
+  set<G4String> fParticleNames; //empty = all particles except optical photons
+
+  map<const G4LogicalVolume*,G4double> fImportance; //resolved for all logical volumes in the geometry
+  set<const G4ParticleDefinition*> fParticles;
+
+  void AssignImportance( G4LogicalVolume *lv, G4double mother_importance );
+  void UpdateSDWeight( const G4Track *aTrack, G4SBSTrackInformation *info );
+
+  //Counters:
+  G4long fNsplit, fNclones, fNroulette, fNkilled;
+
+  map<G4String,G4double> fSumW, fSumW2;
+  map<G4String,G4long> fNhits;
+};
+
+#endif
@@ -32,6 +32,7 @@ class G4SBSIonChamberSD : public G4VSensitiveDetector
 
   private:
     G4SBSICHitsCollection* fHitsCollection;
+    G4int fProfileID; //timer of this SD in G4SBSProfiler
 };
 
 #endif
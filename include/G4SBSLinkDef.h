@@ -7,6 +7,7 @@
 #pragma link C++ class G4SBSRunData+;
 #pragma link C++ class G4SBSTextFile+;
 #pragma link C++ struct filedata_t+;
+#pragma link C++ class vector<Double32_t>+; //compact output branches (G4SBSIO::BranchHits)
 
 #endif
 
@@ -6,6 +6,7 @@
 #include "G4UImessenger.hh"
 #include "G4UIcommand.hh"
 #include "G4UIcmdWith3VectorAndUnit.hh"
+#include <set>
 
 class G4SBSIO;
 class G4SBSEventGen;
@@ -22,6 +23,7 @@ class G4UIcmdWithADouble;
 class G4UIcmdWithAString;
 class G4UIcmdWithABool;
 class G4UIcmdWith3Vector;
+class G4UIcmdWithoutParameter;
 
 class G4SBSMessenger : public G4UImessenger {
 public:
@@ -51,9 +53,23 @@ private:
   
 
   G4SBS::Exp_t fExpType;
+
+  //Geometry change tracking: commands in fGeometryNeutralCmds only affect event generation, physics
+  //or output; any other command sets fGeometryModified, and /g4sbs/run only rebuilds the world when it is set:
+  G4bool fGeometryModified;
+  std::set<G4UIcommand*> fGeometryNeutralCmds;
+
+  //Run cache (/g4sbs/cachedir): commands in fCacheNeutralCmds are not part of the cache key (see G4SBSRunCache):
+  std::set<G4UIcommand*> fCacheNeutralCmds;
+
+  //Event-range sharding (/g4sbs/shard): this job processes slice fShardIndex of fNshards of the run:
+  G4int fShardIndex;
+  G4int fNshards;
   
   G4UIcmdWithAnInteger *printCmd;  
   G4UIcmdWithAnInteger *runCmd;
+  G4UIcommand *scanCmd;
+  G4UIcommand *shardCmd;
   G4UIcmdWithAString   *fileCmd;
   G4UIcmdWithAString   *tgtCmd;
   
@@ -288,6 +304,9 @@ private:
   G4UIcmdWithAnInteger *buildBBsieveCmd;
   
   G4UIcmdWithAnInteger      *TreeFlagCmd; //Set criteria for filling output root tree
+  G4UIcmdWithABool          *SparseOutputCmd; //Per-SD payload trees filled only for events with hits
+  G4UIcmdWithABool          *CompactOutputCmd; //float32 hit data with rounded positions and times
+  G4UIcmdWithABool          *AsyncWriteCmd; //tree filling in a writer thread
 
   G4UIcmdWithABool *SBS_FT_absorberCmd; //Command to turn on absorber material in front of SBS FT.
   G4UIcmdWithAString *SBS_FT_absorberMaterialCmd; //Command to set material of SBS FT absorber material (default is aluminum)
@@ -306,7 +325,75 @@ private:
   G4UIcommand *SD_NTimeBinsCmd;
 
   G4UIcommand *KeepPulseShapeCmd; //Flag to turn on recording of Pulse Shape info  
+  G4UIcmdWithABool *SparsePulseShapeCmd; //Write only the non-empty time bins of the pulse shapes
   G4UIcommand *KeepSDtrackcmd; //Flag to turn on recording of "sensitive detector" track info
+
+  //Commands controlling the optical photon lookup table (see G4SBSOpticalLUT):
+  G4UIcmdWithAnInteger *OpticalLUTModeCmd;
+  G4UIcmdWithAString *OpticalLUTFileCmd;
+  G4UIcommand *OpticalLUTRegionCmd;
+  G4UIcommand *OpticalLUTBinsCmd;
+  G4UIcmdWithADouble *OpticalLUTMinEntriesCmd;
+
+  //Two-stage background simulation via a phase space surface:
+  G4UIcmdWithAString *PhaseSpaceRecordCmd;
+  G4UIcommand *PhaseSpaceSurfaceCmd;
+  G4UIcmdWithABool *PhaseSpaceKillCmd;
+  G4UIcmdWithAString *PhaseSpaceFileCmd;
+  G4UIcmdWithAnInteger *PhaseSpaceResampleCmd;
+
+  //Superposition of beam background from a library of g4sbs output files:
+  G4UIcmdWithABool *PileupCmd;
+  G4UIcmdWithAString *PileupFileCmd;
+  G4UIcmdWithADouble *PileupMeanCmd;
+
+  //Culling of tracks that cannot reach any SD:
+  G4UIcommand *CullCmd;
+  G4UIcmdWithADoubleAndUnit *CullEscapeCmd;
+  G4UIcmdWithoutParameter *CullClearCmd;
+
+  //Importance biasing (splitting/Russian roulette):
+  G4UIcommand *ImportanceCmd;
+  G4UIcmdWithAString *ImportanceParticleCmd;
+  G4UIcmdWithoutParameter *ImportanceClearCmd;
+
+  //Reproducible per-event random streams:
+  G4UIcmdWithABool *RngStreamsCmd;
+  G4UIcmdWithAnInteger *RngSeedCmd;
+  G4UIcmdWithAnInteger *EventOffsetCmd;
+
+  //Per-phase timing report:
+  G4UIcmdWithABool *ProfileCmd;
+
+  //Cache of physics tables, max. event weight and field maps shared between jobs:
+  G4UIcmdWithAString *CacheDirCmd;
+
+  //Pre-tracking acceptance filter on generated kinematics:
+  G4UIcmdWithAnInteger *AcceptanceFilterCmd;
+  G4UIcommand *AcceptanceFilterEarmCmd;
+  G4UIcommand *AcceptanceFilterHarmCmd;
+
+  //Quantum-efficiency pre-thinning of optical photons:
+  G4UIcmdWithABool *PhotonThinningCmd;
+  G4UIcmdWithADouble *PhotonThinningFactorCmd;
+
+  //Calorimeter trigger emulation:
+  G4UIcmdWithABool *TriggerCmd;
+  G4UIcommand *TriggerArmCmd;
+  G4UIcommand *TriggerThresholdCmd;
+  G4UIcommand *TriggerPheCmd;
+  G4UIcmdWithAString *TriggerL2FileCmd;
+  G4UIcmdWithAString *TriggerFilterCmd;
+
+  //GEM strip digitization:
+  G4UIcmdWithABool *GEMDigitizeCmd;
+  G4UIcmdWithABool *GEMDigitizeKeepHitsCmd;
+  G4UIcmdWithADoubleAndUnit *GEMStripPitchCmd;
+  G4UIcmdWithADoubleAndUnit *GEMChargeSpreadCmd;
+  G4UIcmdWithADouble *GEMADCperkeVCmd;
+  G4UIcmdWithADouble *GEMNoiseCmd;
+  G4UIcmdWithADouble *GEMZSThresholdCmd;
+  G4UIcmdWithADoubleAndUnit *GEMSampleOffsetCmd;
   
   //Commands to activate/de-activate parts of the optical physics list (which are CPU intensive!!!)
   G4UIcmdWithABool *UseCerenkovCmd;   //Cerenkov
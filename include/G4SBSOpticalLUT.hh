@@ -0,0 +1,105 @@
+#ifndef G4SBSOpticalLUT_h
+#define G4SBSOpticalLUT_h 1
+
+/*!
+ * Lookup table ("LUT") of optical photon collection for the optical photon detectors
+ * (RICH, GRINCH, ECAL-type sensitive detectors).
+ *
+ * In calibration mode, every optical photon emitted inside a user-defined region is counted
+ * in a bin of (emission position, emission direction), and every photon reaching a PMT of the
+ * associated sensitive detector adds its quantum efficiency and arrival delay to that bin.
+ *
+ * In production mode, the table is read back from a text file, and optical photons emitted in
+ * a well-populated bin are killed before they are tracked; instead, a PMT and arrival time are
+ * sampled from the table and a hit with QE = 1 is handed directly to the sensitive detector.
+ * Photons emitted outside any region, or in a bin with too few entries, are tracked normally.
+ *
+ * This is implemented in the singleton model, like G4SBSRun.
+ */
+
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+#include <map>
+#include <vector>
+
+using namespace std;
+
+class G4Track;
+
+struct G4SBSOpticalLUTChannel {
+  G4double sumw;  //sum of quantum efficiencies of photons reaching this PMT
+  G4double sumt;  //QE-weighted sum of emission-to-detection delay
+  G4double sumt2; //QE-weighted sum of delay squared
+};
+
+struct G4SBSOpticalLUTBin {
+  G4double nemitted; //number of photons emitted in this bin
+  map<G4int,G4SBSOpticalLUTChannel> channels; //key = PMT number
+
+  //Sampling tables, filled by G4SBSOpticalLUT::Finalize():
+  vector<G4int> pmt;
+  vector<G4double> cumprob; //cumulative detection probability
+  vector<G4double> tmean;
+  vector<G4double> trms;
+};
+
+struct G4SBSOpticalLUTTable {
+  G4ThreeVector xmin, xmax; //Emission region (global coordinates)
+  map<G4long,G4SBSOpticalLUTBin> bins;
+  map<G4int,G4ThreeVector> pmtcoord; //global coordinates of PMT centers, by PMT number
+};
+
+class G4SBSOpticalLUT {
+private:
+  static G4SBSOpticalLUT *gSingleton;
+  G4SBSOpticalLUT();
+
+public:
+  enum LUTMode_t { kOff=0, kCalibrate=1, kProduction=2 };
+
+  static G4SBSOpticalLUT *GetLUT();
+  ~G4SBSOpticalLUT();
+
+  void SetMode( G4int mode ){ fMode = mode; }
+  G4int GetMode() const { return fMode; }
+
+  void SetFileName( G4String fname ){ fFileName = fname; }
+  G4String GetFileName() const { return fFileName; }
+
+  void SetRegion( G4String SDname, G4ThreeVector xmin, G4ThreeVector xmax );
+  void SetBinning( G4int nx, G4int ny, G4int nz, G4int ncostheta, G4int nphi );
+  void SetMinEntries( G4double nmin ){ fMinEntries = nmin; }
+
+  void BeginOfRun();
+  void EndOfRun();
+
+  //Calibration: called for every new optical photon and for every photon reaching a PMT:
+  void RecordEmission( const G4Track *aTrack );
+  void RecordDetection( G4String SDname, const G4Track *aTrack, G4int PMT, G4double delay, G4double QE, G4ThreeVector xgpmt );
+
+  //Production: returns true if the photon was handled by the table (and should not be tracked):
+  G4bool ProcessPhoton( G4Track *aTrack );
+
+  G4bool Read( G4String fname );
+  void Write( G4String fname );
+
+private:
+  G4int fMode;
+  G4String fFileName;
+  G4String fLoadedFile; //file currently loaded for production mode
+  G4double fMinEntries; //minimum number of emitted photons in a bin to use it in production mode
+
+  G4int fNbinsX, fNbinsY, fNbinsZ, fNbinsCosTheta, fNbinsPhi;
+
+  map<G4String,G4SBSOpticalLUTTable> fTables; //key = sensitive detector name
+
+  //returns -1 if the photon vertex is outside the region:
+  G4long FindBin( const G4SBSOpticalLUTTable &table, G4ThreeVector vertex, G4ThreeVector direction ) const;
+
+  //Find the first region containing the photon vertex; returns fTables.end() if none:
+  map<G4String,G4SBSOpticalLUTTable>::iterator FindTable( G4ThreeVector vertex );
+
+  void Finalize();
+};
+
+#endif
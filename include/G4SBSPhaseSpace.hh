@@ -0,0 +1,97 @@
+#ifndef G4SBSPhaseSpace_h
+#define G4SBSPhaseSpace_h 1
+
+/*!
+ * Two-stage simulation of beam-related background via a phase-space surface.
+ *
+ * Stage 1 (recording): every particle crossing a virtual surface (a sphere centered on the target,
+ * or a plane at fixed z) in the outward direction is written to a compact binary file, and optionally
+ * killed so that nothing is tracked beyond the surface. The number of events thrown is stored in the
+ * file header for normalization.
+ *
+ * Stage 2 (replay, /g4sbs/kine phasespace): each event re-shoots all particles recorded for one
+ * stage-1 event. Each recorded event can be reused several times ("resampling"), with a random
+ * rotation about the beam axis for every reuse after the first.
+ *
+ * This is implemented in the singleton model, like G4SBSRun.
+ */
+
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+#include <vector>
+#include <cstdio>
+
+using namespace std;
+
+class G4Step;
+
+//One particle crossing the surface: positions in mm, momenta in MeV, time in ns
+struct G4SBSPhaseSpaceRecord {
+  G4int event;
+  G4int pid;
+  float x, y, z;
+  float px, py, pz;
+  float t;
+};
+
+//File header; nsource and nrecords are updated at the end of the recording run
+struct G4SBSPhaseSpaceHeader {
+  char magic[8];
+  G4int version;
+  G4int surface;
+  G4double surfacevalue; //mm
+  G4long nsource;        //number of stage-1 events thrown
+  G4long nrecords;       //number of particles recorded
+};
+
+class G4SBSPhaseSpace {
+private:
+  static G4SBSPhaseSpace *gSingleton;
+  G4SBSPhaseSpace();
+
+public:
+  enum Surface_t { kSphere=0, kPlaneZ=1 };
+
+  static G4SBSPhaseSpace *GetPhaseSpace();
+  ~G4SBSPhaseSpace();
+
+  //Recording:
+  void SetRecordFileName( G4String fname ){ fRecordFileName = fname; }
+  void SetSurface( G4int type, G4double value ){ fSurfaceType = type; fSurfaceValue = value; }
+  void SetKillAtSurface( G4bool b ){ fKillAtSurface = b; }
+  G4bool IsRecording() const { return fRecordFile != NULL; }
+
+  void BeginOfRun();
+  void EndOfRun( G4int nevents );
+
+  //Called from the stepping action; returns true if the track crossed the surface:
+  G4bool ProcessStep( const G4Step *aStep );
+
+  //Replay:
+  void SetReplayFileName( G4String fname ){ fReplayFileName = fname; }
+  void SetResample( G4int n ){ fResample = n > 1 ? n : 1; }
+  void LoadReplayFile();
+  void NextEvent( vector<G4SBSPhaseSpaceRecord> &particles );
+
+  //Ratio of the number of recorded events to the number of stage-1 events thrown:
+  G4double GetReplayFraction() const;
+
+private:
+  G4String fRecordFileName;
+  FILE *fRecordFile;
+  G4SBSPhaseSpaceHeader fRecordHeader;
+  G4int fSurfaceType;
+  G4double fSurfaceValue;
+  G4bool fKillAtSurface;
+
+  G4String fReplayFileName;
+  G4String fLoadedFile;
+  G4SBSPhaseSpaceHeader fReplayHeader;
+  vector<G4SBSPhaseSpaceRecord> fReplayRecords;
+  vector<size_t> fReplayEventStart; //index of the first record of each event; last element = number of records
+  size_t fReplayEvent; //current event
+  G4int fResample;
+  G4int fResampleCount; //number of times the current event has been used
+};
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef G4SBSPhiloxEngine_h
+#define G4SBSPhiloxEngine_h 1
+
+/*!
+ * Counter-based random engine (Philox4x32-10, Salmon et al., SC11) for use as a CLHEP engine.
+ *
+ * The 64-bit key is the run seed; the 128-bit counter holds the block number within the stream
+ * plus three stream identifiers (run, event, consumer). Any stream can be positioned directly,
+ * without generating the numbers of the preceding events, and different streams are
+ * statistically independent.
+ */
+
+#include "CLHEP/Random/RandomEngine.h"
+#include <stdint.h>
+#include <string>
+
+class G4SBSPhiloxEngine : public CLHEP::HepRandomEngine {
+public:
+  G4SBSPhiloxEngine( long seed=0 );
+  virtual ~G4SBSPhiloxEngine();
+
+  //Position the engine at the start of the stream (seed, run, event, consumer):
+  void SetStream( uint64_t seed, uint32_t run, uint32_t event, uint32_t consumer );
+
+  virtual double flat();
+  virtual void flatArray( const int size, double *vect );
+
+  virtual void setSeed( long seed, int dum=0 );
+  virtual void setSeeds( const long *seeds, int dum=0 );
+
+  virtual void saveStatus( const char filename[] = "G4SBSPhilox.conf" ) const;
+  virtual void restoreStatus( const char filename[] = "G4SBSPhilox.conf" );
+  virtual void showStatus() const;
+
+  virtual std::string name() const { return "G4SBSPhiloxEngine"; }
+
+  virtual operator unsigned int();
+
+private:
+  void NextBlock();
+
+  uint32_t fKey[2];
+  uint32_t fCounter[4]; //0 = block number, 1 = event, 2 = run, 3 = consumer
+  uint32_t fBuffer[4];
+  int fBufferPos;
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef G4SBSPhotonThinning_h
+#define G4SBSPhotonThinning_h 1
+
+/*!
+ * Quantum-efficiency pre-thinning of optical photons (/g4sbs/photonthinning true).
+ *
+ * Only a fraction f of the Cerenkov and scintillation photons is tracked: the others are killed before
+ * their first step. Photons re-emitted by wavelength shifters (OpWLS, e.g. in the CDet fibers) descend
+ * from a photon that was already thinned, and are always kept. The photocathode quantum efficiency applied in G4SBSRICHSD and G4SBSECalSD is
+ * divided by f, so the detection probability of every photon, and hence the photoelectron statistics,
+ * are unchanged. By default f is the largest "EFFICIENCY" of all materials, so that QE/f never exceeds
+ * 1; a user-given f below that value is raised to it.
+ *
+ * The SDs get the quantum efficiency through QuantumEfficiency(), which caches the "EFFICIENCY"
+ * property vector of each material instead of looking it up by name at every step.
+ *
+ * Thinning is not applied in optical LUT calibration or production mode, which count emitted photons.
+ *
+ * This is implemented in the singleton model, like G4SBSRun.
+ */
+
+#include "globals.hh"
+#include "G4MaterialPropertyVector.hh"
+#include <map>
+
+using namespace std;
+
+class G4Material;
+class G4Track;
+
+class G4SBSPhotonThinning {
+private:
+  static G4SBSPhotonThinning *gSingleton;
+  G4SBSPhotonThinning();
+
+public:
+  static G4SBSPhotonThinning *GetThinning();
+  ~G4SBSPhotonThinning();
+
+  void SetEnabled( G4bool b ){ fEnabled = b; }
+  G4bool IsEnabled() const { return fEnabled; }
+
+  void SetFactor( G4double f ){ fUserFactor = f; } //<= 0: largest quantum efficiency of all materials
+  G4double GetFactor() const { return fFactor; }
+
+  void BeginOfRun();
+  void EndOfRun();
+
+  //Called for each new optical photon; returns false if the photon is to be killed:
+  G4bool KeepPhoton( const G4Track *track );
+
+  //Quantum efficiency of the photocathode material at this photon energy, rescaled by 1/f if thinning is on:
+  G4double QuantumEfficiency( const G4Material *mat, G4double Ephoton );
+
+private:
+  G4bool fEnabled;
+  G4bool fActive; //enabled and not in optical LUT mode
+  G4double fUserFactor;
+  G4double fFactor;
+
+  G4long fNphotons, fNkilled;
+
+  map<const G4Material*, G4MaterialPropertyVector*> fQEcache; //NULL if the material has no EFFICIENCY
+};
+
+#endif
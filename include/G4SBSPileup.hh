@@ -0,0 +1,86 @@
+#ifndef G4SBSPileup_h
+#define G4SBSPileup_h 1
+
+/*!
+ * Superposition of pre-simulated beam background onto signal events ("pile-up").
+ *
+ * The background library is one or more g4sbs output files from a beam background run (standard,
+ * non-sparse tree layout). For each signal event, a Poisson-distributed number of library events is
+ * drawn, with a mean given by the beam current, the library normalization (Nthrown in run_data)
+ * and the mixing time window. Each background event gets a random time offset, uniform in
+ * [-T,+T], where T is the largest time window of the mixed detectors; a detector only receives the
+ * background events whose offset is within its own time window.
+ *
+ * GEM hits are appended to the signal hits. Calorimeter hits are merged with signal hits in the
+ * same cell and time window, or appended otherwise. The "bkgd" flag of each hit is 0 for signal
+ * hits, 1 for background hits and 2 for signal hits with background added.
+ *
+ * This is implemented in the singleton model, like G4SBSRun.
+ */
+
+#include "globals.hh"
+#include "G4SBSGEMoutput.hh"
+#include "G4SBSCALoutput.hh"
+#include "sbstypes.hh"
+#include "TString.h"
+#include <map>
+#include <list>
+#include <vector>
+
+using namespace std;
+
+class TChain;
+class G4SBSDetectorConstruction;
+
+class G4SBSPileup {
+private:
+  static G4SBSPileup *gSingleton;
+  G4SBSPileup();
+
+public:
+  static G4SBSPileup *GetPileup();
+  ~G4SBSPileup();
+
+  void SetEnabled( G4bool b ){ fEnabled = b; }
+  G4bool IsEnabled() const { return fEnabled; }
+
+  void AddLibraryFile( G4String fname );
+
+  //Override the mean number of library events per signal event (default: computed from the beam current):
+  void SetMeanEvents( G4double mu ){ fMeanOverride = mu; }
+
+  void BeginOfRun( G4SBSDetectorConstruction *fdetcon, G4double beamcurrent_uA );
+
+  //Draw the background events for this signal event; call once per event before mixing:
+  void SampleEvent();
+
+  void MixGEM( G4String SDname, G4SBSGEMoutput &gd );
+  void MixCAL( G4String SDname, G4SBSCALoutput &cd );
+
+private:
+  G4bool fEnabled;
+  vector<G4String> fLibraryFiles;
+  TChain *fChain;
+  G4double fNthrown; //number of beam electrons simulated in the library
+  G4double fMeanEvents; //mean number of library events per signal event
+  G4double fMeanOverride;
+  G4double fTmax; //largest mixing time window (ns)
+
+  map<G4String,G4SBS::SDet_t> fSDtype;
+  map<G4String,G4double> fTimeWindow; //ns
+
+  //Library read buffers:
+  map<G4String,G4SBSGEMoutput> fLibGEM;
+  map<G4String,G4SBSCALoutput> fLibCAL;
+  list<vector<int>*> fIntPtr;
+  list<vector<double>*> fDoublePtr;
+
+  //Background hits drawn for the current event, with time offsets applied:
+  map<G4String,G4SBSGEMoutput> fPileGEM;
+  map<G4String,G4SBSCALoutput> fPileCAL;
+
+  void Bind( TString branchname, vector<int> &v );
+  void Bind( TString branchname, vector<double> &v );
+};
+
+#endif
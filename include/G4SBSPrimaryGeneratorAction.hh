@@ -36,6 +36,13 @@ public:
   void SetParticleName( G4String pname ){ GunParticleName = pname; }
   void SetGunPolarization( G4ThreeVector S ){ GunPolarization = S; }
 
+  //Pre-tracking acceptance filter: 0 = off, 1 = electron arm, 2 = hadron arm, 3 = both arms
+  void SetAcceptanceFilter( G4int mode ){ fAcceptanceFilter = mode; }
+  void SetEarmFilterWindow( G4double dx, G4double dy ){ fEarmFilterDX = dx; fEarmFilterDY = dy; }
+  void SetHarmFilterWindow( G4double dx, G4double dy ){ fHarmFilterDX = dx; fHarmFilterDY = dy; }
+  //Exits with an error if the filter mode tests a particle the current generator does not produce; called by /g4sbs/run:
+  void CheckAcceptanceFilter();
+
 private:
   G4ParticleGun* particleGun;
   G4String GunParticleName;
@@ -47,6 +54,13 @@ private:
   G4ThreeVector GunPolarization;
 
   bool fUseGeantino;
+
+  G4int fAcceptanceFilter;
+  //Half-widths of the angular acceptance windows (horizontal, vertical) around the spectrometer central angles:
+  G4double fEarmFilterDX, fEarmFilterDY;
+  G4double fHarmFilterDX, fHarmFilterDY;
+
+  G4bool PassesAcceptanceFilter();
 };
 
 #endif
@@ -0,0 +1,80 @@
+#ifndef G4SBSProfiler_h
+#define G4SBSProfiler_h 1
+
+/*!
+ * Per-phase timing report (/g4sbs/profile true).
+ *
+ * Wall-clock time and number of calls are accumulated for event generation (including rejection
+ * sampling tries), Geant4 tracking, magnetic field queries, ProcessHits
+ * of each sensitive detector, the end-of-event hit aggregation, the output tree fill and, with
+ * /g4sbs/asyncwrite, the wait for the writer thread. Field and SD times are part of the tracking time.
+ *
+ * The report is printed at the end of the run and written to the output file as the TTree "profile",
+ * one entry per timer. When disabled, each instrumented call costs one pointer and flag test.
+ *
+ * This is implemented in the singleton model, like G4SBSRun.
+ */
+
+#include "globals.hh"
+#include <chrono>
+#include <vector>
+
+class G4SBSProfiler {
+private:
+  static G4SBSProfiler *gSingleton;
+  G4SBSProfiler();
+
+  typedef std::chrono::steady_clock Clock_t;
+
+public:
+  enum Phase_t { kGeneration=0, kTracking, kField, kEventAction, kFillTree, kWriterWait, kNPhases };
+
+  static G4SBSProfiler *GetProfiler();
+  ~G4SBSProfiler();
+
+  void SetEnabled( G4bool b ){ fEnabled = b; }
+  G4bool IsEnabled() const { return fEnabled; }
+
+  //Timer for a sensitive detector; returns the existing one if the name was already registered:
+  G4int RegisterSD( G4String SDname );
+
+  //For phases that begin and end in different user actions:
+  void Start( G4int id ){ if( fEnabled ) fStart[id] = Clock_t::now(); }
+  void Stop( G4int id ){ if( fEnabled ) Add( id, fStart[id] ); }
+
+  //Additional counter of a timer (e.g., generation tries):
+  void AddCount( G4int id, G4long n ){ if( fEnabled ) fCount[id] += n; }
+
+  void BeginOfRun( G4String genname );
+  void EndOfRun( G4double realtime );
+  void Write(); //TTree "profile" in the current directory
+
+  //Times the enclosing scope:
+  class Scope {
+  public:
+    Scope( G4int id ) : fID(id), fActive( gSingleton != NULL && gSingleton->fEnabled ){
+      if( fActive ) fStart = Clock_t::now();
+    }
+    ~Scope(){ if( fActive ) gSingleton->Add( fID, fStart ); }
+  private:
+    G4int fID;
+    G4bool fActive;
+    Clock_t::time_point fStart;
+  };
+
+private:
+  void Add( G4int id, Clock_t::time_point start ){
+    fTime[id] += std::chrono::duration<double>( Clock_t::now() - start ).count();
+    fNcalls[id]++;
+  }
+
+  G4bool fEnabled;
+
+  std::vector<G4String> fName;
+  std::vector<G4double> fTime; //seconds
+  std::vector<G4long> fNcalls;
+  std::vector<G4long> fCount;
+  std::vector<Clock_t::time_point> fStart;
+};
+
+#endif
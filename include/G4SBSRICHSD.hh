@@ -6,6 +6,10 @@
 #include "G4SBSDetMap.hh"
 #include "G4Step.hh"
 #include "G4SBSSDTrackOutput.hh"
+#include <set>
+#include <map>
+
+class G4LogicalVolume;
 
 class G4SBSRICHSD : public G4VSensitiveDetector
 {
@@ -21,12 +25,26 @@ public:
   void DrawAll();
   void PrintAll();
 
+  //Add a hit for a photon whose transport is handled by the optical lookup table (see G4SBSOpticalLUT):
+  void InjectHit( G4Track *track, G4int PMT, G4double time, G4ThreeVector xgpmt );
+
   G4SBSDetMap detmap;
 
   G4SBSSDTrackOutput SDtracks;
 
 private:
   G4SBSRICHHitsCollection *hitCollection;
+  G4int fProfileID; //timer of this SD in G4SBSProfiler
+
+  //Classification of the emission volume of a photon, resolved once per logical volume:
+  G4int OriginVolumeFlag( const G4Track *track );
+  static G4int OriginVolumeFlag( const G4String &lvname );
+  void BuildOriginVolumeFlags();
+
+  std::map<const G4LogicalVolume*,G4int> fOriginFlags;
+  G4int fOriginFlagsRunID; //run for which fOriginFlags was built
+
+  std::set<G4int> fLUTphotons; //photons already recorded in the optical LUT during this event (calibration mode)
 
 };
 
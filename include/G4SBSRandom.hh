@@ -0,0 +1,83 @@
+#ifndef G4SBSRandom_h
+#define G4SBSRandom_h 1
+
+/*!
+ * Reproducible per-event random number streams (/g4sbs/rngstreams true).
+ *
+ * The global CLHEP engine is replaced by a counter-based engine (G4SBSPhiloxEngine). At the start of
+ * every event it is positioned at the stream keyed on (seed, run, event number + offset, consumer), so
+ * that the random sequence of an event does not depend on any previous event: a single event, or a
+ * sub-range of a job (/g4sbs/eventoffset), can be regenerated with bitwise-identical results.
+ *
+ * Consumers get separate streams:
+ *  - kGenerator: event generation (G4SBSPrimaryGeneratorAction, G4SBSEventGen)
+ *  - kTransport: Geant4 tracking and physics, from G4SBSEventAction::BeginOfEventAction on
+ *  - kDigitization: smearing of detector hits at the end of the event
+ *  - kPileup: background mixing (G4SBSPileup)
+ * Random numbers used at the beginning of the run (before the first event) come from a run-level
+ * stream. The event generator initialization in /g4sbs/run (the rejection sampling warm-up) draws from
+ * its own stream keyed on (seed, run), which does not depend on the shard, so that all shards of a run
+ * find the same max. event weight.
+ *
+ * This is implemented in the singleton model, like G4SBSRun.
+ */
+
+#include "globals.hh"
+
+namespace CLHEP {
+  class HepRandomEngine;
+}
+class G4SBSPhiloxEngine;
+
+class G4SBSRandom {
+private:
+  static G4SBSRandom *gSingleton;
+  G4SBSRandom();
+
+public:
+  enum Consumer_t { kGenerator=0, kTransport=1, kDigitization=2, kPileup=3, kNConsumers=4 };
+
+  static G4SBSRandom *GetRandom();
+  ~G4SBSRandom();
+
+  void SetEnabled( G4bool b ){ fEnabled = b; }
+  G4bool IsEnabled() const { return fEnabled; }
+
+  //Default: the seed of the global engine chosen at startup (run_data seed)
+  void SetSeed( unsigned int seed ){ fSeed = seed; fSeedSet = true; }
+  unsigned int GetSeed() const { return fSeed; }
+  G4bool IsSeedSet() const { return fSeedSet; } //seed given with /g4sbs/rngseed
+
+  //Offset added to the Geant4 event ID to obtain the stream event number:
+  void SetEventOffset( G4int offset ){ fEventOffset = offset; }
+  G4int GetEventOffset() const { return fEventOffset; }
+
+  //Additional offset of the first event of the shard (/g4sbs/shard), set by /g4sbs/run:
+  void SetShardOffset( G4int offset ){ fShardOffset = offset; }
+
+  //Called by /g4sbs/run before the event generator is initialized, i.e., before /run/beamOn:
+  void BeginInitialization();
+  void BeginOfRun( G4int runID );
+  void BeginOfEvent( G4int eventID ); //positions all streams; the global engine on kGenerator
+  void BeginTransport(); //switches the global engine to kTransport
+
+  //Engine for a given consumer; the global CLHEP engine if streams are disabled:
+  CLHEP::HepRandomEngine *GetEngine( Consumer_t consumer );
+
+private:
+  G4bool fEnabled;
+  unsigned int fSeed;
+  G4bool fSeedSet;
+  G4int fEventOffset;
+  G4int fShardOffset;
+  G4int fRunID;
+  G4int fEventID;
+
+  G4SBSPhiloxEngine *fEngines[kNConsumers]; //kGenerator and kTransport share the global engine
+  CLHEP::HepRandomEngine *fDefaultEngine; //engine to restore when streams are turned off
+  G4bool fInstalled;
+
+  void Install(); //replaces the global engine and resolves the seed
+};
+
+#endif
@@ -28,8 +28,12 @@ public:
   void SetNtries( int n ){ Ntries = n; }
   G4int GetNtries(){ return Ntries; }
 
+  void SetNfiltered( G4long n ){ Nfiltered = n; }
+  G4long GetNfiltered(){ return Nfiltered; }
+
 private:
   G4int Ntries; //Keep track of total number of tries to throw an event during the run (efficiency of MC generation needed for correct normalization).
+  G4long Nfiltered; //Number of events not tracked because of the pre-tracking acceptance filter (included in Ntries)
   
   G4Timer* timer;
   
@@ -0,0 +1,91 @@
+#ifndef G4SBSRunCache_h
+#define G4SBSRunCache_h 1
+
+/*!
+ * Cache of expensive derived run state, shared between jobs (/g4sbs/cachedir <dir>).
+ *
+ * The cache key is the effective configuration of each run, taken from the G4UImanager command history
+ * (all commands, including /process, /run/setCut* and other physics settings): for every command, the
+ * values of the last run segment (between two /g4sbs/run) in which it was issued, in order of last use,
+ * so that a command repeated for a later run of a scan or multi-run macro replaces the earlier value.
+ * Commands that cannot change the cached state (run control, output file, random seed, profiling,
+ * /control, /vis, verbosity) are left out. The Geant4 version and the default production cut are added.
+ * The hash of this record keys a subdirectory <dir>/<key>, which holds:
+ *  - physics/: the Geant4 physics tables, stored after the first run of a configuration and retrieved
+ *    (/run/particle/retrievePhysicsTable) by later jobs instead of being rebuilt;
+ *  - maxweight.txt: the maximum event weight of the rejection sampling warm-up;
+ *  - config.txt: the recorded configuration, for reference.
+ * Parsed TOSCA field maps are cached in <dir>/fieldmaps, keyed by the path, size and modification time
+ * of the map file, so they are shared by all configurations using the same map.
+ *
+ * Entries are written to temporary names and renamed into place, so concurrent jobs sharing a cache
+ * directory never see partial entries.
+ *
+ * This is implemented in the singleton model, like G4SBSRun.
+ */
+
+#include "globals.hh"
+#include <vector>
+#include <set>
+
+using namespace std;
+
+class G4SBSRunCache {
+private:
+  static G4SBSRunCache *gSingleton;
+  G4SBSRunCache();
+
+public:
+  static G4SBSRunCache *GetCache();
+  ~G4SBSRunCache();
+
+  void SetDirectory( G4String dir ){ fDirectory = dir; }
+  G4bool IsEnabled() const { return !fDirectory.empty(); }
+
+  //Command (full path) that is not part of the cache key; a path ending in '/' excludes a whole directory:
+  void AddNeutralCommand( G4String path );
+
+  //Called by /g4sbs/run before event generator initialization and after /run/beamOn:
+  void BeginRun();
+  void EndRun();
+
+  //Maximum event weight of rejection sampling (internal units); GetMaxWeight returns false if not cached:
+  G4bool GetMaxWeight( G4double &w ) const;
+  void StoreMaxWeight( G4double w );
+
+  //Cache file of a TOSCA field map, empty if caching is off:
+  G4String GetFieldMapFile( G4String mapfile );
+
+  //Entries are written to GetTmpName( path ), then moved into place by Commit; if another job committed
+  //the same entry first, the temporary copy is removed and Commit returns false:
+  G4String GetTmpName( G4String path ) const;
+  G4bool Commit( G4String tmppath, G4String path ) const;
+
+private:
+  G4String fDirectory;
+
+  //Effective configuration, in order of last use:
+  struct ConfigEntry_t {
+    G4String command;
+    vector<G4String> values; //values issued in the last run segment that used the command
+    G4int segment;
+  };
+  vector<ConfigEntry_t> fConfig;
+  G4int fSegment; //number of runs begun so far
+  G4int fHistoryPos; //G4UImanager history entries already added to fConfig
+
+  set<G4String> fNeutralCommands;
+  vector<G4String> fNeutralDirs;
+
+  G4bool IsNeutral( const G4String &command ) const;
+  void UpdateConfig(); //adds the commands issued since the last call
+
+  G4String fKey; //hash of the configuration, set in BeginRun
+  G4String fConfigDir;
+  G4bool fPhysicsRetrieved;
+  G4bool fPhysicsStored;
+
+  static G4String Hash( const G4String &text );
+};
+
+#endif
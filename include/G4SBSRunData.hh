@@ -2,6 +2,7 @@
 #define __G4SBSRUNDATA_HH
 
 #include "TObject.h"
+#include "TCollection.h"
 
 #include <cstdlib> 
 #include <vector>
@@ -35,6 +36,7 @@ public:
   unsigned long long int GetNthrown(){ return fNthrown; }
   void SetNthrown(unsigned long long int n){ fNthrown = n; }
   void SetNtries(unsigned long long int n){ fNtries = n; } //Number of tries to generate Nthrown events.
+  void SetNfiltered(unsigned long long int n){ fNfiltered = n; } //Number of thrown events not tracked because of the pre-tracking acceptance filter
 
   void Init();
 
@@ -47,6 +49,13 @@ public:
   void SetBeamE(double E){ fBeamE = E; }
   void SetBeamCur(double cur){ fBeamCur = cur; }
   void SetSeed(unsigned int seed){ fSeed = seed; }
+  unsigned int GetSeed(){ return fSeed; }
+
+  //Event-range sharding: this job is shard ishard of nshards of a run of nevt_total events:
+  void SetShard( int ishard, int nshards, long nevt_total ){ fShardIndex = ishard; fNshards = nshards; fNevtTotal = nevt_total; }
+
+  //Compact output schema (/g4sbs/compactoutput): version (0 = full precision) and rounding steps of positions and times:
+  void SetCompactOutput( int version, double posstep, double timestep ){ fCompactVersion = version; fCompactPosStep = posstep; fCompactTimeStep = timestep; }
 
   void SetNormalization( double N ){ fNormalization = N; }
   void SetGenVol( double V ){ fGenVol = V; }
@@ -69,6 +78,10 @@ public:
   void SetFileName( TString fname ){ fFileName = fname; }
   
   void CalcNormalization();
+
+  //Combine the run data of several jobs (hadd, TFileMerger): event counts are summed and the
+  //normalization is recomputed. Returns -1 (no merge) if the generator settings or max. weights differ:
+  Long64_t Merge( TCollection *list );
   
   void AddMagData(filedata_t d){fMagData.push_back(d);}
 
@@ -99,7 +112,15 @@ public:
 
   long int  fNthrown;
   long int fNtries;
+  long int fNfiltered; //events of fNthrown not tracked because of the acceptance filter
   unsigned int  fSeed;
+  int fShardIndex; //index of this job's event slice (/g4sbs/shard); -1 once merged
+  int fNshards;    //number of slices the run was split into
+  long int fNevtTotal; //number of events of the full run; ev.rate is normalized to it
+  int fNmerged;    //number of job outputs combined in this object
+  int fCompactVersion; //compact output schema version; 0 = doubles at full precision
+  double fCompactPosStep; //m, rounding step of hit and track positions in compact output
+  double fCompactTimeStep; //ns, rounding step of hit and track times in compact output
   double fBeamE; //GeV
   double fBeamCur; //muA
   double fNormalization; //Normalization constant to convert observed counts to a rate. This accounts for efficiency of Monte Carlo generation, phase space volume, luminosity, etc
@@ -137,7 +158,7 @@ public:
 
   std::vector<filedata_t> fMagData;
 
-  ClassDef(G4SBSRunData, 1);
+  ClassDef(G4SBSRunData, 6);
 };
 
 #endif//__G4SBSRUNDATA_HH
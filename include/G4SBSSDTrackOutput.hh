@@ -13,6 +13,26 @@
 
 using namespace std;
 
+//Track ID -> track array index lookup, for one event: open addressing with linear probing on a power-of-two
+//table. Clear() only resets the slots in use, so the table keeps its size from event to event:
+class G4SBSTrackIndexTable {
+public:
+  G4SBSTrackIndexTable();
+
+  void Clear();
+  G4int Find( G4long key ) const; //returns -1 if not found
+  G4bool Insert( G4long key, G4int index ); //returns false, and leaves the table unchanged, if key exists
+
+private:
+  vector<G4long> fKeys;
+  vector<G4int> fIndex; //-1 = empty slot
+  vector<G4int> fUsed; //occupied slots
+  size_t fMask;
+
+  size_t Slot( G4long key ) const;
+  void Grow();
+};
+
 //Class to efficiently store "Original track", "Primary track", and "SD boundary track" information
 //for each sensitive detector: In conjunction with this routine 
 
@@ -34,20 +54,29 @@ public:
   void Merge( G4SBSSDTrackOutput & );
   
   void ConvertToTreeUnits();
+
+  //SD names are interned to small integers, used as keys of the SD track list:
+  static G4int InternSDname( const G4String &name );
+  static const G4String &GetSDname( G4int sdid );
+
+  //Index in the relevant track array of G4 track ID tid (-1 if not in the list):
+  G4int OTrackIndex( G4int tid ) const { return otracklist.Find( tid ); }
+  G4int PTrackIndex( G4int tid ) const { return ptracklist.Find( tid ); }
+  G4int SDTrackIndex( G4int tid, G4int sdid ) const { return tid < 0 ? -1 : sdtracklist.Find( SDTrackKey( tid, sdid ) ); }
   
   G4String sdname;
+  G4int sdnameid; //interned sdname
 
   //key value is track ID; mapped value is index in relevant track array:
-  map<int,int> otracklist;
-  map<int,int> ptracklist;
+  G4SBSTrackIndexTable otracklist;
+  G4SBSTrackIndexTable ptracklist;
 
   //sdtracklist has to be done differently since the same SD track can cross multiple SD boundary volumes,
   //But at the same time we only want to record each G4 Track ID exactly once for each SD boundary volume it crosses:
-
-  //So let's modify this structure to map<int,map<G4String,int> >,
-  //where the int key is the G4 track ID, and G4String key is an SD name, and the mapped value is the index in the
+  //the key combines the G4 track ID and the interned SD name, and the mapped value is the index in the
   //sd track array:
-  map<int,map<G4String,int> > sdtracklist;
+  G4SBSTrackIndexTable sdtracklist;
+  static G4long SDTrackKey( G4int tid, G4int sdid ){ return ( G4long(tid) << 16 ) + sdid; }
 
   // //Hit lists mapped by track index:
   // map<int,vector<int> > otrack_hits; //list of SD "hits" associated with each otrack
@@ -74,7 +103,9 @@ public:
   //vector<TVector3> sdpos, sdmom, sdpol;
   vector<double> sdposx,sdposy,sdposz,sdmomx,sdmomy,sdmomz,sdpolx,sdpoly,sdpolz;
   vector<double> sdenergy, sdtime;
+  vector<double> sdweight; //track weight when entering the SD (importance biasing)
   vector<double> sdvx,sdvy,sdvz,sdvnx,sdvny,sdvnz,sdEkin;
+  vector<int> sdsdid; //interned name of the SD boundary crossed (not written to the tree)
 
 };
 
@@ -32,6 +32,7 @@ class G4SBSTargetSD : public G4VSensitiveDetector
 
   private:
     G4SBSTargetHitsCollection* fHitsCollection;
+    G4int fProfileID; //timer of this SD in G4SBSProfiler
 };
 
 #endif
@@ -17,6 +17,11 @@ public:
   
 private:
   void ReadField();
+
+  //Binary copy of the parsed map in the run cache (/g4sbs/cachedir):
+  G4bool ReadFieldCache( G4String cachefile );
+  void WriteFieldCache( G4String cachefile, const double ang[3] );
+  void SetRotation( const double ang[3] );
 };
 
 #endif//G4SBSToscaField_hh
@@ -171,6 +171,7 @@ public:
   map<G4String,G4double>              fSDVertexKineticEnergy; //Kinetic energy at vertex of track entering SD volume
   map<G4String,G4double>              fSDEnergy; //Total energy of track when entering SD
   map<G4String,G4double>              fSDTime;   //Global time of track when entering SD
+  map<G4String,G4double>              fSDWeight; //Track weight when entering SD (importance biasing)
 
   // //"Source" track information means information about a track as it enters the "region of interest" of a detector
   // G4int                 fSourceTrackID;
@@ -0,0 +1,98 @@
+#ifndef G4SBSTrigger_h
+#define G4SBSTrigger_h 1
+
+/*!
+ * Emulation of the calorimeter trigger, evaluated at the end of each event (/g4sbs/trigger true).
+ *
+ * Two trigger arms are defined, "earm" and "harm" (ECAL and HCAL for GEp, BigBite shower and HCAL
+ * for GMn). For each arm, the energy deposits of the hits of one CAL sensitive detector (after
+ * pile-up mixing) are smeared by photoelectron statistics and summed over overlapping groups of cells
+ * ("logic sums") read from a database table. A sum fires if, normalized to its elastic peak position
+ * from the threshold table, it is above the threshold of the arm. The L2 coincidence fires if a harm
+ * sum fires together with any of the earm sums associated with it in the L2 table. This is the logic
+ * of root_macros/gep_trigger_analysis_L2_generic.C.
+ *
+ * Table formats (lines starting with # are ignored, commas are treated as blanks):
+ *   logic sums:  node ncells cell1 ... cellN   (GEP_ECAL_L2sums.txt, hcal_L2sums_4x4.txt), or
+ *                index center x y binx biny bin ncells cell1 ... cellN   (*_cluster_mapping.txt)
+ *                Sums are numbered from 1 (node/index + 1); cells are the copy numbers of hit.cell.
+ *   thresholds:  node mean sigma   (elastic peak position of each sum, GeV)
+ *   L2:          harmnode N earmnode1 ... earmnodeN
+ *
+ * The decision bits are written to the branch trig.bits (1 = earm, 2 = harm, 4 = L2), together with
+ * the number of fired sums and the largest normalized sum of each arm. With /g4sbs/triggerfilter, only
+ * events passing the selected trigger are written to the tree; the normalization is unchanged, as for
+ * events without hits that are not written either.
+ *
+ * This is implemented in the singleton model, like G4SBSRun.
+ */
+
+#include "globals.hh"
+#include "G4SBSCALoutput.hh"
+#include <map>
+#include <set>
+#include <vector>
+
+using namespace std;
+
+class TTree;
+
+class G4SBSTrigger {
+private:
+  static G4SBSTrigger *gSingleton;
+  G4SBSTrigger();
+
+public:
+  enum Arm_t { kEarm=0, kHarm=1, kNArms=2 };
+  enum Bit_t { kEarmBit=1, kHarmBit=2, kL2Bit=4 };
+
+  static G4SBSTrigger *GetTrigger();
+  ~G4SBSTrigger();
+
+  void SetEnabled( G4bool b ){ fEnabled = b; }
+  G4bool IsEnabled() const { return fEnabled; }
+
+  void SetArm( G4int arm, G4String SDname, G4String sumfile, G4String thresholdfile );
+  void SetThreshold( G4int arm, G4double frac ){ fThreshold[arm] = frac; }
+  void SetPhePerGeV( G4int arm, G4double npe ){ fPhePerGeV[arm] = npe; } //0 = no smearing
+  void SetL2File( G4String fname ){ fL2File = fname; }
+  void SetFilter( G4int mask ){ fFilterMask = mask; } //write only events with (bits & mask) != 0; 0 = all
+
+  void BeginOfRun(); //reads the tables
+  void Branch( TTree *tree );
+
+  void AddCalHits( G4String SDname, const G4SBSCALoutput &cd );
+  G4bool Evaluate(); //computes the decision bits of this event; returns false if the event is to be dropped
+  void EndOfRun();
+
+private:
+  G4bool fEnabled;
+  G4int fFilterMask;
+
+  G4String fSDname[kNArms];
+  G4String fSumFile[kNArms];
+  G4String fThresholdFile[kNArms];
+  G4double fThreshold[kNArms]; //fraction of the elastic peak position
+  G4double fPhePerGeV[kNArms];
+  G4String fL2File;
+
+  vector<G4double> fMean[kNArms]; //elastic peak position by sum, index = node number - 1
+  vector<G4double> fSum[kNArms]; //smeared energy sums of this event
+  map<G4int, vector<G4int> > fSumsByCell[kNArms]; //sums to which each cell contributes
+  vector<vector<G4int> > fL2Earm; //earm sums associated with each harm sum
+
+  //Tree variables:
+  G4int fBits;
+  G4int fNfired[kNArms];
+  G4double fMaxSum[kNArms];
+
+  //Run counters:
+  G4long fNevents, fNwritten;
+  G4long fNtrig[3];
+
+  void ReadSums( G4int arm );
+  void ReadThresholds( G4int arm );
+  void ReadL2();
+};
+
+#endif
@@ -18,7 +18,7 @@ namespace G4SBS {
   // target type; include fictional neutron target
   enum Targ_t   { kH2, kD2, kLH2, kLD2, k3He, kNeutTarg, kCfoil, kOptics };
   // kinematic type 
-  enum Kine_t   { kElastic, kFlat, kInelastic, kDIS, kBeam, kSIDIS, kGun, kWiser, kPYTHIA6, kSIMC, kGMnElasticCheck, kCosmics, kPionPhoto};
+  enum Kine_t   { kElastic, kFlat, kInelastic, kDIS, kBeam, kSIDIS, kGun, kWiser, kPYTHIA6, kSIMC, kGMnElasticCheck, kCosmics, kPionPhoto, kPhaseSpace};
   // experiment type
   // enum Exp_t    { kGEp, kNeutronExp, kSIDISExp, kC16, kA1n, kTDIS, kNDVCS, kGEnRP, kGEMHCtest};
   enum Exp_t    { kGEp, kGMN, kGEN, kSIDISExp, kC16, kA1n, kTDIS, kNDVCS, kGEnRP, kGEMHCtest, kGEPpositron, kWAPP, kGEp_BB, kALL };
@@ -26,6 +26,8 @@ namespace G4SBS {
   enum Arm_t    { kEarm, kHarm };
   // sensitive detector type  
   enum SDet_t   { kGEM, kCAL, kRICH, kECAL, kBD, kIC, kTarget_GEn_Glass, kTarget_GEn_Al, kTarget_GEn_Cu, kTarget_GEn_3He }; 
+  // pulse shape (time-binned energy deposition/NPE) of CAL and ECAL hits: not kept, dense vectors, or sparse (bin, value) list
+  enum PulseShape_t { kPulseShapeOff, kPulseShapeDense, kPulseShapeSparse };
   
   // switches for GEn
   // Helmholtz coils or shielding 
@@ -0,0 +1,265 @@
+#!/usr/bin/env python
+
+##############################################################################
+## Performance benchmarks of G4SBS.
+##
+## Runs the fixed macros in integration_tests/benchmarks (fixed seeds with
+## /g4sbs/rngstreams, fixed event counts) and records for each of them:
+##   events_per_s   : "simulation rate" printed at the end of the run
+##   startup_s      : wall time from program start to the start of the run
+##                    (geometry construction, physics tables, field maps)
+##   peak_rss_mb    : peak resident set size of the g4sbs process
+##   bytes_per_event: size of the output ROOT file divided by the number of events
+## and compares them with the stored baselines (benchmarks/baseline.json).
+##
+## Usage:
+##   python run_benchmarks.py [config file] [--update]
+## --update writes the measured values as the new baselines. Baselines depend
+## on the machine, so record them on the machine the benchmarks are run on.
+##############################################################################
+
+## Specify a default configuration
+conf = {}
+
+## Path to the build directory of G4SBS (g4sbs executable)
+conf['local_build_path']  = '/home/travis/build/Jeffersonlab/build_g4sbs'
+
+## Path to the local repository (macros and scripts/ directory)
+conf['local_repo_path']   = '/home/travis/build/Jeffersonlab/g4sbs'
+
+## Path to the field maps directory (linked into the working directory)
+conf['fieldmap_dir']      = '/work/halla/sbs/g4sbs_buildtests/fieldmaps'
+
+## PYTHIA6 tree for the PYTHIA input benchmark; the benchmark is skipped if empty
+conf['pythia_file']       = ''
+
+## Working directory for the benchmark runs
+conf['work_dir']          = '/volatile/halla/sbs/g4sbs_benchmarks'
+
+## File with the baseline values
+conf['baseline_file']     = 'benchmarks/baseline.json'
+
+## Relative tolerances: a benchmark fails if it is slower or larger than the
+## baseline by more than this fraction. Output size is deterministic for fixed
+## seeds, so its tolerance is tighter.
+conf['tolerance']         = '0.15'
+conf['tolerance_bytes']   = '0.02'
+
+import os
+import sys
+import re
+import glob
+import json
+import time
+import datetime
+import subprocess
+
+## Benchmarks: name, macro, preinit macro, needs PYTHIA file
+benchmarks = [
+  ( 'elastic',   'bench_elastic.mac',   'preinit_nockov_noscint.mac', False ),
+  ( 'sidis',     'bench_sidis.mac',     'preinit_nockov_noscint.mac', False ),
+  ( 'beam_bkgd', 'bench_beam_bkgd.mac', 'preinit_nockov_noscint.mac', False ),
+  ( 'optical',   'bench_optical.mac',   'preinit_ckov_noscint.mac',   False ),
+  ( 'pythia',    'bench_pythia.mac',    'preinit_nockov_noscint.mac', True ),
+]
+
+## Metrics: name, True if larger is better, tolerance key
+metrics = [
+  ( 'events_per_s',    True,  'tolerance' ),
+  ( 'startup_s',       False, 'tolerance' ),
+  ( 'peak_rss_mb',     False, 'tolerance' ),
+  ( 'bytes_per_event', False, 'tolerance_bytes' ),
+]
+
+def myOut(text,newline = False):
+  sys.stdout.write(text)
+  if newline:
+    sys.stdout.write('\n')
+  sys.stdout.flush()
+def myErr(text,newline = False):
+  sys.stderr.write(text)
+  if newline:
+    sys.stderr.write('\n')
+  sys.stderr.flush()
+def myOutJust(text):
+  myOut(text.ljust(70,'.'),False)
+
+## Print out the result of a test using colors for the terminal
+def myOutResult(status):
+  status = status.upper()
+  color = '' ## Default is no color
+  if status == 'DONE':
+    color = '\033[94m'
+  elif status == 'PASSED':
+    color = '\033[92m'
+  elif status == 'FAILED':
+    color = '\033[91m'
+  status = '[' + status + ']'
+  pre = ''
+  if len(status) < 10:
+    pre = pre.rjust(10-len(status),'.')
+  myOut(pre + color + status + '\033[m',True)
+
+## Read in a configuration file (same format as run_buildtests.py)
+def readConfFile(fileName):
+  global conf
+  f = open(fileName,'r')
+  lineCount = 0
+  for line in f:
+    lineCount += 1
+    line = line.lstrip()
+    line = line.partition('#')[0].rstrip()
+    if line:
+      var = line.split('=')
+      if len(var) != 2:
+        myErr('Error reading in configuration %s in line %d: Equal sign missing.'
+          % (fileName, lineCount),True)
+        sys.exit(3)
+      elif var[0] in conf:
+        conf[var[0]] = var[1]
+      else:
+        myErr('Error reading in configuration %s in line %d: Variable %s is unknown.'
+          % (fileName, lineCount, var[0]),True)
+        sys.exit(3)
+
+## Link field maps and the PYTHIA file into the working directory
+def setupWorkDir():
+  if not os.path.isdir(conf['work_dir']):
+    os.makedirs(conf['work_dir'])
+  for filename in glob.glob(conf['fieldmap_dir'] + '/*'):
+    link = os.path.join(conf['work_dir'], os.path.basename(filename))
+    if not os.path.lexists(link):
+      os.symlink(filename,link)
+  if conf['pythia_file']:
+    link = os.path.join(conf['work_dir'], 'pythia_bench.root')
+    if os.path.lexists(link):
+      os.remove(link)
+    os.symlink(conf['pythia_file'],link)
+  ## Macro search path: scripts/ of the repository
+  link = os.path.join(conf['work_dir'], 'scripts')
+  if not os.path.lexists(link):
+    os.symlink(os.path.join(conf['local_repo_path'],'scripts'),link)
+
+## Run one benchmark and return its metrics (None on failure)
+def runBenchmark(name,macro,preinit):
+  bench_dir = os.path.join(conf['local_repo_path'],'integration_tests','benchmarks')
+  cmd = [ os.path.join(conf['local_build_path'],'g4sbs'),
+      '--pre=scripts/' + preinit, '--post=' + os.path.join(bench_dir,macro) ]
+
+  log = open(os.path.join(conf['work_dir'], name + '.log'),'w')
+
+  start = time.time()
+  startup = -1.0
+  rate = -1.0
+  nevents = 0
+  try:
+    proc = subprocess.Popen(cmd, cwd=conf['work_dir'], stdout=subprocess.PIPE,
+        stderr=subprocess.STDOUT, universal_newlines=True)
+  except OSError:
+    myErr('\n\n\nError: ' + cmd[0] + ' not found.',True)
+    return None
+
+  for line in iter(proc.stdout.readline,''):
+    log.write(line)
+    if startup < 0 and line.startswith('### Run'):
+      startup = time.time() - start
+    m = re.match(r'simulation rate = ([0-9.eE+-]+) events/s', line)
+    if m:
+      rate = float(m.group(1))
+    m = re.match(r'number of event = ([0-9]+)', line)
+    if m:
+      nevents = int(m.group(1))
+
+  ## Per-process resource usage, for the peak RSS (kB on Linux):
+  pid, status, rusage = os.wait4(proc.pid, 0)
+  log.close()
+
+  if status != 0 or rate < 0 or nevents == 0:
+    myErr('\n\n\nThere was an error running G4SBS on ' + macro +
+        ', see ' + name + '.log',True)
+    return None
+
+  rootfile = os.path.join(conf['work_dir'], macro.replace('.mac','.root'))
+  nbytes = os.path.getsize(rootfile) if os.path.isfile(rootfile) else 0
+
+  return { 'events_per_s': rate, 'startup_s': startup,
+      'peak_rss_mb': rusage.ru_maxrss/1024.0,
+      'bytes_per_event': float(nbytes)/nevents }
+
+## Compare with the baseline; returns True if within tolerance
+def compare(name,result,baseline):
+  ok = True
+  for metric, larger_is_better, tolkey in metrics:
+    value = result[metric]
+    if name not in baseline or metric not in baseline[name]:
+      myOut('    %-16s %12.4g (no baseline)' % (metric,value),True)
+      continue
+    ref = baseline[name][metric]
+    tol = float(conf[tolkey])
+    if larger_is_better:
+      passed = value >= ref*(1.0-tol)
+    else:
+      passed = value <= ref*(1.0+tol)
+    change = 100.0*(value-ref)/ref if ref != 0 else 0.0
+    myOut('    %-16s %12.4g baseline %12.4g (%+6.1f%%) %s' % (metric,value,ref,change,
+        '' if passed else '<-- REGRESSION'),True)
+    ok = ok and passed
+  return ok
+
+## Main Function (program starts here)
+def main(conf_file,update):
+  if conf_file:
+    readConfFile(conf_file)
+
+  baseline_file = conf['baseline_file']
+  if not os.path.isabs(baseline_file):
+    baseline_file = os.path.join(conf['local_repo_path'],'integration_tests',baseline_file)
+
+  baseline = {}
+  if os.path.isfile(baseline_file):
+    baseline = json.load(open(baseline_file,'r')).get('benchmarks',{})
+  elif not update:
+    myOut('No baseline file ' + baseline_file + ', run with --update to create it',True)
+
+  setupWorkDir()
+
+  results = {}
+  count = 0
+  passed = 0
+  for name, macro, preinit, needs_pythia in benchmarks:
+    if needs_pythia and not conf['pythia_file']:
+      myOutJust('  Benchmark ' + name)
+      myOutResult('skipped')
+      continue
+    count += 1
+    myOutJust('  Benchmark ' + name)
+    result = runBenchmark(name,macro,preinit)
+    if result is None:
+      myOutResult('failed')
+      continue
+    results[name] = result
+    myOutResult('done')
+    if update or compare(name,result,baseline):
+      passed += 1
+
+  if update:
+    out = { 'host': os.uname()[1],
+        'date': datetime.datetime.today().strftime('%Y-%m-%d %H:%M'),
+        'benchmarks': results }
+    json.dump(out, open(baseline_file,'w'), indent=2, sort_keys=True)
+    myOut('\nWrote baselines to ' + baseline_file,True)
+
+  myOut('\n',False)
+  myOutJust('All benchmarks: %3d / %3d passed' % (passed,count))
+  if passed == count:
+    myOutResult('passed')
+    sys.exit(0)
+  else:
+    myOutResult('failed')
+    sys.exit(404)
+
+## Run main() function if this file is run directly in the command line
+## (as opposed to being imported)
+if __name__ == '__main__':
+  args = [ a for a in sys.argv[1:] if a != '--update' ]
+  main(args[0] if args else '', '--update' in sys.argv[1:])
@@ -1,4 +1,5 @@
 #include "G4SBSBeamDiffuserSD.hh"
+#include "G4SBSProfiler.hh"
 //______________________________________________________________________________
 G4SBSBeamDiffuserSD::G4SBSBeamDiffuserSD(
       const G4String& name,
@@ -7,6 +8,7 @@ G4SBSBeamDiffuserSD::G4SBSBeamDiffuserSD(
    fHitsCollection(nullptr)
 {
    collectionName.insert(hitsCollectionName);
+   fProfileID = G4SBSProfiler::GetProfiler()->RegisterSD( name );
 }
 //______________________________________________________________________________
 G4SBSBeamDiffuserSD::~G4SBSBeamDiffuserSD()
@@ -26,6 +28,8 @@ void G4SBSBeamDiffuserSD::Initialize(G4HCofThisEvent* hce)
 //______________________________________________________________________________
 G4bool G4SBSBeamDiffuserSD::ProcessHits(G4Step* step,G4TouchableHistory*)
 {
+   G4SBSProfiler::Scope prof( fProfileID );
+
    // energy deposit
    auto edep = step->GetTotalEnergyDeposit();
 
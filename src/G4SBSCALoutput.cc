@@ -5,6 +5,7 @@ G4SBSCALoutput::G4SBSCALoutput(){
   timewindow = 1000.0*ns;
   threshold = 0.0*eV;
   keeppart = true;
+  pulseshape = 1; //G4SBS::kPulseShapeDense
   Clear();
 }
 
@@ -20,6 +21,9 @@ void G4SBSCALoutput::Clear(){
   Esum = 0.0;
 
   edep_vs_time.clear();
+  ps_idx.clear();
+  ps_bin.clear();
+  ps_val.clear();
   
   row.clear();
   col.clear();
@@ -40,10 +44,12 @@ void G4SBSCALoutput::Clear(){
   trms.clear();
   tmin.clear();
   tmax.clear();
+  weight.clear();
 
   otridx.clear();
   ptridx.clear();
   sdtridx.clear();
+  bkgd.clear();
   
   npart_CAL = 0;
   px.clear();
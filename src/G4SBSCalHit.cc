@@ -13,6 +13,7 @@ G4SBSCalHit::G4SBSCalHit()
 {pos = G4ThreeVector();
   energy = 0;
   edep = 0.0;
+  weight = 1.0;
   mid = -1;
   pid = -1e9;
 }
@@ -31,6 +32,7 @@ G4SBSCalHit::G4SBSCalHit(const G4SBSCalHit &right)
   hittime = right.hittime;
   edep = right.edep;
   energy = right.energy;
+  weight = right.weight;
 
   cell = right.cell;
   row = right.row;
@@ -66,6 +68,7 @@ const G4SBSCalHit& G4SBSCalHit::operator=(const G4SBSCalHit &right)
   hittime = right.hittime;
   edep = right.edep;
   energy = right.energy;
+  weight = right.weight;
 
   cell = right.cell;
   row = right.row;
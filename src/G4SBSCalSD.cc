@@ -1,4 +1,5 @@
 #include "G4SBSCalSD.hh"
+#include "G4SBSProfiler.hh"
 #include "G4SBSCalHit.hh"
 
 #include "G4VPhysicalVolume.hh"
@@ -22,6 +23,8 @@ G4SBSCalSD::G4SBSCalSD( G4String name, G4String colname )
     fEnergyThreshold = 0.0*keV; //"safe" default value for a calorimeter;
     fNTimeBins = 500;
 
+    fProfileID = G4SBSProfiler::GetProfiler()->RegisterSD( name );
+
     SDtracks.Clear();
     SDtracks.SetSDname(name);
 }
@@ -38,6 +41,8 @@ void G4SBSCalSD::Initialize(G4HCofThisEvent*)
 
 G4bool G4SBSCalSD::ProcessHits(G4Step* aStep, G4TouchableHistory*)
 {
+  G4SBSProfiler::Scope prof( fProfileID );
+
   //G4cout << "Processing CAL hits SDname = " << SensitiveDetectorName << G4endl;
 
   G4int pid = aStep->GetTrack()->GetParticleDefinition()->GetPDGEncoding();
@@ -79,6 +84,7 @@ G4bool G4SBSCalSD::ProcessHits(G4Step* aStep, G4TouchableHistory*)
   hit->SetEdep(edep);
   hit->SetEnergy(E);
   hit->SetLstep( aStep->GetStepLength() );
+  hit->SetWeight( aStep->GetTrack()->GetWeight() );
   hit->SetMomentum(mom);
   hit->SetPID(aStep->GetTrack()->GetParticleDefinition()->GetPDGEncoding());
   hit->SetTrID(aStep->GetTrack()->GetTrackID());
@@ -0,0 +1,139 @@
+#include "G4SBSCulling.hh"
+
+#include "G4Step.hh"
+#include "G4StepPoint.hh"
+#include "G4Track.hh"
+#include "G4LogicalVolume.hh"
+#include "G4LogicalVolumeStore.hh"
+#include "G4Region.hh"
+#include "G4ParticleTable.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4ios.hh"
+
+G4SBSCulling *G4SBSCulling::gSingleton = NULL;
+
+G4SBSCulling::G4SBSCulling(){
+  gSingleton = this;
+
+  fEscapeRadius = 0.0;
+  fNescaped = 0;
+  fEescaped = 0.0;
+}
+
+G4SBSCulling::~G4SBSCulling(){
+  ;
+}
+
+G4SBSCulling *G4SBSCulling::GetCulling(){
+  if( gSingleton == NULL ){
+    gSingleton = new G4SBSCulling();
+  }
+  return gSingleton;
+}
+
+void G4SBSCulling::AddRule( G4String volume, G4String particle, G4double Ethresh ){
+  G4SBSCullRule rule;
+  rule.volume = volume;
+  rule.particle = particle;
+  rule.Ethresh = Ethresh;
+  rule.pdef = NULL;
+  rule.nkilled = 0;
+  rule.Ekilled = 0.0;
+  fRules.push_back( rule );
+}
+
+void G4SBSCulling::ClearRules(){
+  fRules.clear();
+  fVolumeRules.clear();
+  fEscapeRadius = 0.0;
+}
+
+void G4SBSCulling::BeginOfRun(){
+  fVolumeRules.clear();
+  fNescaped = 0;
+  fEescaped = 0.0;
+
+  G4LogicalVolumeStore *lvstore = G4LogicalVolumeStore::GetInstance();
+
+  for( size_t irule=0; irule<fRules.size(); irule++ ){
+    G4SBSCullRule &rule = fRules[irule];
+    rule.nkilled = 0;
+    rule.Ekilled = 0.0;
+
+    rule.pdef = NULL;
+    if( rule.particle != "all" ){
+      rule.pdef = G4ParticleTable::GetParticleTable()->FindParticle( rule.particle );
+      if( rule.pdef == NULL ){
+	fprintf(stderr, "%s: %s line %d - Error: unknown particle %s in culling rule\n", __PRETTY_FUNCTION__, __FILE__, __LINE__, rule.particle.data() );
+	exit(-1);
+      }
+    }
+
+    //The name can be a logical volume or a region; a region applies to all of its logical volumes:
+    G4int nvol = 0;
+    for( size_t ilv=0; ilv<lvstore->size(); ilv++ ){
+      G4LogicalVolume *lv = (*lvstore)[ilv];
+      if( lv->GetName() == rule.volume || ( lv->GetRegion() != NULL && lv->GetRegion()->GetName() == rule.volume ) ){
+	fVolumeRules[lv].push_back( irule );
+	nvol++;
+      }
+    }
+
+    if( nvol == 0 ){
+      G4cout << "Warning: culling rule for " << rule.volume << " matches no logical volume or region in this geometry" << G4endl;
+    }
+  }
+}
+
+G4bool G4SBSCulling::ProcessStep( const G4Step *aStep ){
+  G4Track *theTrack = aStep->GetTrack();
+  G4StepPoint *post = aStep->GetPostStepPoint();
+
+  if( post->GetPhysicalVolume() == NULL ) return false; //leaving the world
+
+  G4double Ekin = post->GetKineticEnergy();
+
+  if( !fVolumeRules.empty() ){
+    map<const G4LogicalVolume*, vector<size_t> >::iterator it = fVolumeRules.find( post->GetPhysicalVolume()->GetLogicalVolume() );
+    if( it != fVolumeRules.end() ){
+      const G4ParticleDefinition *pdef = theTrack->GetParticleDefinition();
+      for( size_t i=0; i<it->second.size(); i++ ){
+	G4SBSCullRule &rule = fRules[ it->second[i] ];
+	if( ( rule.pdef == NULL || rule.pdef == pdef ) && Ekin < rule.Ethresh ){
+	  theTrack->SetTrackStatus( fStopAndKill );
+	  rule.nkilled++;
+	  rule.Ekilled += Ekin;
+	  return true;
+	}
+      }
+    }
+  }
+
+  if( fEscapeRadius > 0.0 ){
+    G4ThreeVector x = post->GetPosition();
+    if( x.mag2() > fEscapeRadius*fEscapeRadius && x.dot( post->GetMomentumDirection() ) > 0.0 ){
+      theTrack->SetTrackStatus( fStopAndKill );
+      fNescaped++;
+      fEescaped += Ekin;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void G4SBSCulling::EndOfRun(){
+  if( !IsActive() ) return;
+
+  G4cout << "Track culling summary:" << G4endl;
+  for( size_t irule=0; irule<fRules.size(); irule++ ){
+    G4SBSCullRule &rule = fRules[irule];
+    G4cout << "  " << rule.volume << ", " << rule.particle << ", Ekin < " << rule.Ethresh/MeV << " MeV: "
+	   << rule.nkilled << " tracks killed, " << rule.Ekilled/GeV << " GeV removed" << G4endl;
+  }
+  if( fEscapeRadius > 0.0 ){
+    G4cout << "  escaping R > " << fEscapeRadius/m << " m: "
+	   << fNescaped << " tracks killed, " << fEescaped/GeV << " GeV removed" << G4endl;
+  }
+}
@@ -86,6 +86,10 @@ G4SBSDetectorConstruction::G4SBSDetectorConstruction()
   fSegmentC16 = 0; //default to no segmentation!
   fSegmentThickC16 = 4.0*cm; //default thickness of 4 cm for lead-glass longitudinal segmentation.
   fDoseRateC16 = 0.0; //Default radiation dose rate of ZERO (no rad. damage!)
+
+  //Optical properties of materials are only defined if Cerenkov or scintillation is used (off by default, as in the physics list):
+  fUseCerenkov = false;
+  fUseScintillation = false;
   
   //ConstructMaterials(); //Now we want to construct all materials at the beginning, so that the physics tables can get built properly (do this in "Construct()", not here)!!!
 
@@ -448,7 +452,7 @@ void G4SBSDetectorConstruction::ConstructMaterials(){
   G4MaterialPropertiesTable* MPCO2 = new G4MaterialPropertiesTable();
   MPCO2->AddProperty("RINDEX",PhotonEnergy, CO2_RefractiveIndex, nEntries);
 
-  if( fMaterialsListOpticalPhotonDisabled.find( "CO2" ) == fMaterialsListOpticalPhotonDisabled.end() ){
+  if( OpticalPropertiesEnabled( "CO2" ) ){
     CO2->SetMaterialPropertiesTable(MPCO2);
   }
 
@@ -473,7 +477,7 @@ void G4SBSDetectorConstruction::ConstructMaterials(){
   MPC4F8O->AddProperty("RINDEX",PhotonEnergy, C4F8O_RefractiveIndex, nEntries);
   MPC4F8O->AddProperty("ABSLENGTH",PhotonEnergy, C4F8O_ABSLENGTH, nEntries);
 
-  if( fMaterialsListOpticalPhotonDisabled.find( "C4F8O" ) == fMaterialsListOpticalPhotonDisabled.end() ){
+  if( OpticalPropertiesEnabled( "C4F8O" ) ){
     C4F8O->SetMaterialPropertiesTable(MPC4F8O);
   }
   
@@ -731,7 +735,7 @@ void G4SBSDetectorConstruction::ConstructMaterials(){
   MPT_temp->AddProperty( "ABSLENGTH", Ephoton_lucite, Abslength_lucite, nentries_lucite );
   MPT_temp->AddProperty( "RINDEX", Ephoton_rindex_lucite, Rindex_lucite, 2 );
 
-  if( fMaterialsListOpticalPhotonDisabled.find( "UVT_Lucite" ) == fMaterialsListOpticalPhotonDisabled.end() ){
+  if( OpticalPropertiesEnabled( "UVT_Lucite" ) ){
     UVT_Lucite->SetMaterialPropertiesTable( MPT_temp );
   }
   // G4cout << "Material optical properties for material UVT_Lucite" << G4endl;
@@ -749,7 +753,7 @@ void G4SBSDetectorConstruction::ConstructMaterials(){
   }
   G4MaterialPropertiesTable* MPLucite = new G4MaterialPropertiesTable();
   MPLucite->AddProperty("RINDEX",PhotonEnergy, Lucite_RefractiveIndex, nEntries);
-  if( fMaterialsListOpticalPhotonDisabled.find( "Lucite" ) == fMaterialsListOpticalPhotonDisabled.end() ){
+  if( OpticalPropertiesEnabled( "Lucite" ) ){
     Lucite->SetMaterialPropertiesTable(MPLucite);
   }
   Lucite->SetName("Lucite");
@@ -884,7 +888,7 @@ void G4SBSDetectorConstruction::ConstructMaterials(){
   MPT_temp->AddProperty("RINDEX", Ephoton_quartz, Rindex_quartz, nentries_quartz);
   MPT_temp->AddProperty("ABSLENGTH", Ephoton_abs_quartz, Abslength_quartz, Nabs_quartz);
 
-  if( fMaterialsListOpticalPhotonDisabled.find( "QuartzWindow" ) == fMaterialsListOpticalPhotonDisabled.end() ){
+  if( OpticalPropertiesEnabled( "QuartzWindow" ) ){
     QuartzWindow->SetMaterialPropertiesTable( MPT_temp );
   }
   fMaterialsMap["QuartzWindow"] = QuartzWindow;
@@ -903,7 +907,7 @@ void G4SBSDetectorConstruction::ConstructMaterials(){
   UVglass->AddElement( Si, fractionmass=0.377220 );
   UVglass->AddElement( K,  fractionmass=0.003321 );
 
-  if( fMaterialsListOpticalPhotonDisabled.find( "UVglass" ) == fMaterialsListOpticalPhotonDisabled.end() ){
+  if( OpticalPropertiesEnabled( "UVglass" ) ){
     UVglass->SetMaterialPropertiesTable( MPT_temp );
   }
 
@@ -927,7 +931,7 @@ void G4SBSDetectorConstruction::ConstructMaterials(){
   MPT_temp->AddProperty("RINDEX", Ephoton_C4F10, Rindex_C4F10, nentries_C4F10 );
   MPT_temp->AddProperty("ABSLENGTH", Ephoton_C4F10, Abslength_C4F10, nentries_C4F10 );
 
-  if( fMaterialsListOpticalPhotonDisabled.find( "C4F10_gas" ) == fMaterialsListOpticalPhotonDisabled.end() ){
+  if( OpticalPropertiesEnabled( "C4F10_gas" ) ){
     C4F10_gas->SetMaterialPropertiesTable( MPT_temp );
   }
   
@@ -949,7 +953,7 @@ void G4SBSDetectorConstruction::ConstructMaterials(){
   MPT_temp->AddProperty("RINDEX", Ephoton_C4F8, Rindex_C4F8, nentries_C4F8 );
   MPT_temp->AddProperty("ABSLENGTH", Ephoton_C4F8, Abslength_C4F8, nentries_C4F8 );
 
-  if( fMaterialsListOpticalPhotonDisabled.find( "C4F8_gas" ) == fMaterialsListOpticalPhotonDisabled.end() ){
+  if( OpticalPropertiesEnabled( "C4F8_gas" ) ){
     C4F8_gas->SetMaterialPropertiesTable( MPT_temp );
   }
   fMaterialsMap["C4F8_gas"] = C4F8_gas;
@@ -971,7 +975,7 @@ void G4SBSDetectorConstruction::ConstructMaterials(){
   MPT_temp->AddProperty("RINDEX", Ephoton_CF4, Rindex_CF4, nentries_CF4 );
   MPT_temp->AddProperty("ABSLENGTH", Ephoton_CF4, Abslength_CF4, nentries_CF4 );
 
-  if( fMaterialsListOpticalPhotonDisabled.find( "CF4_gas" ) == fMaterialsListOpticalPhotonDisabled.end() ){
+  if( OpticalPropertiesEnabled( "CF4_gas" ) ){
     CF4_gas->SetMaterialPropertiesTable( MPT_temp );
   }
   fMaterialsMap["CF4_gas"] = CF4_gas;
@@ -995,7 +999,7 @@ void G4SBSDetectorConstruction::ConstructMaterials(){
   MPT_temp->AddProperty("RINDEX", Ephoton_SF6, Rindex_SF6, nentries_SF6 );
   MPT_temp->AddProperty("ABSLENGTH", Ephoton_SF6, Abslength_SF6, nentries_SF6 );
 
-  if( fMaterialsListOpticalPhotonDisabled.find( "SF6_gas" ) == fMaterialsListOpticalPhotonDisabled.end() ){
+  if( OpticalPropertiesEnabled( "SF6_gas" ) ){
     mat_SF6->SetMaterialPropertiesTable( MPT_temp );
   }
   fMaterialsMap["SF6_gas"] = mat_SF6;
@@ -1016,7 +1020,7 @@ void G4SBSDetectorConstruction::ConstructMaterials(){
   RICH_air->AddElement( elO, fractionmass = 0.231781 );
   RICH_air->AddElement( elAr, fractionmass = 0.012827 );
   
-  if( fMaterialsListOpticalPhotonDisabled.find( "RICH_air" ) == fMaterialsListOpticalPhotonDisabled.end() ){
+  if( OpticalPropertiesEnabled( "RICH_air" ) ){
     RICH_air->SetMaterialPropertiesTable( MPT_temp );
   }
 
@@ -1069,7 +1073,7 @@ void G4SBSDetectorConstruction::ConstructMaterials(){
   MPT_temp->AddProperty("ABSLENGTH", Ephoton_abs_quartz, Abslength_quartz, nentries_quartz );
   //MPT_temp->AddProperty("REFLECTIVITY", Ephot_Rcathode, Rcathode, 2 );
 
-  if( fMaterialsListOpticalPhotonDisabled.find( "Photocathode_material_RICH" ) == fMaterialsListOpticalPhotonDisabled.end() ){
+  if( OpticalPropertiesEnabled( "Photocathode_material_RICH" ) ){
     Photocathode_material_RICH->SetMaterialPropertiesTable( MPT_temp );
   }
 
@@ -1111,7 +1115,7 @@ void G4SBSDetectorConstruction::ConstructMaterials(){
   MPT_temp->AddProperty("ABSLENGTH", Ephoton_abs_quartz, Abslength_quartz, nentries_quartz );
   //MPT_temp->AddProperty("REFLECTIVITY", Ephot_Rcathode, Rcathode, 2 );
 
-  if( fMaterialsListOpticalPhotonDisabled.find( "Photocathode_material_GRINCH" ) == fMaterialsListOpticalPhotonDisabled.end() ){
+  if( OpticalPropertiesEnabled( "Photocathode_material_GRINCH" ) ){
     Photocathode_material_GRINCH->SetMaterialPropertiesTable( MPT_temp );
   }
 
@@ -1195,7 +1199,7 @@ void G4SBSDetectorConstruction::ConstructMaterials(){
   MPT_temp->AddProperty("RAYLEIGH", Ephoton_aerogel, Rayleigh_aerogel, nsteps );
   //MPT_temp->AddConstProperty("ABSLENGTH", 10.0*m );
 
-  if( fMaterialsListOpticalPhotonDisabled.find( "Aerogel" ) == fMaterialsListOpticalPhotonDisabled.end() ){
+  if( OpticalPropertiesEnabled( "Aerogel" ) ){
     Aerogel->SetMaterialPropertiesTable( MPT_temp );
   }
   fMaterialsMap["Aerogel"] = Aerogel;
@@ -1219,7 +1223,7 @@ void G4SBSDetectorConstruction::ConstructMaterials(){
   mptQuartz->AddProperty("RINDEX",PhotonEnergy,rindex_Quartz,nEntries);
   mptQuartz->AddProperty("ABSLENGTH",PhotonEnergy,absl_Quartz,nEntries);
 
-  if( fMaterialsListOpticalPhotonDisabled.find( "Quartz" ) == fMaterialsListOpticalPhotonDisabled.end() ){
+  if( OpticalPropertiesEnabled( "Quartz" ) ){
     Quartz->SetMaterialPropertiesTable(mptQuartz);
   }
   fMaterialsMap["Quartz"] = Quartz;
@@ -1521,10 +1525,10 @@ void G4SBSDetectorConstruction::ConstructMaterials(){
   //MPT_temp->AddProperty("ABSLENGTH", Ephoton_ECAL_QE, Abslength_TF1, nentries_ecal_QE );
   MPT_temp->AddProperty("ABSLENGTH", Ephoton_atilde, atilde, nentries_atilde );
 
-  if( fMaterialsListOpticalPhotonDisabled.find( "TF1" ) == fMaterialsListOpticalPhotonDisabled.end() ){
+  if( OpticalPropertiesEnabled( "TF1" ) ){
     TF1->SetMaterialPropertiesTable( MPT_temp );
   }
-  if( fMaterialsListOpticalPhotonDisabled.find( "TF5" ) == fMaterialsListOpticalPhotonDisabled.end() ){
+  if( OpticalPropertiesEnabled( "TF5" ) ){
     TF5->SetMaterialPropertiesTable( MPT_temp );
   }
 
@@ -1537,7 +1541,7 @@ void G4SBSDetectorConstruction::ConstructMaterials(){
   F101->AddMaterial( K2O, 0.07 );
   F101->AddMaterial( Ce, 0.002 );
 
-  if( fMaterialsListOpticalPhotonDisabled.find( "F101" ) == fMaterialsListOpticalPhotonDisabled.end() ){
+  if( OpticalPropertiesEnabled( "F101" ) ){
     F101->SetMaterialPropertiesTable( MPT_temp );
   }
 
@@ -1640,7 +1644,7 @@ void G4SBSDetectorConstruction::ConstructMaterials(){
     MPT_temp->AddProperty("RINDEX", Ephoton_ECAL_QE, Rindex_TF1, nentries_ecal_QE );
     MPT_temp->AddProperty("ABSLENGTH", Ephoton_abslength, abslength_ECAL, Ntemp+1 );
 
-    if( fMaterialsListOpticalPhotonDisabled.find( matname.Data() ) == fMaterialsListOpticalPhotonDisabled.end() ){
+    if( OpticalPropertiesEnabled( matname.Data() ) ){
       mat_temp->SetMaterialPropertiesTable( MPT_temp );
     }
     fMaterialsMap[matname.Data()] = mat_temp;
@@ -1665,7 +1669,7 @@ void G4SBSDetectorConstruction::ConstructMaterials(){
 	
 	MPT_temp->AddProperty("ABSLENGTH", Ephoton_abslength, abslength_temp, Ntemp+1 );
 
-	if( fMaterialsListOpticalPhotonDisabled.find( matname.Data() ) == fMaterialsListOpticalPhotonDisabled.end() ){
+	if( OpticalPropertiesEnabled( matname.Data() ) ){
 	  mat_temp->SetMaterialPropertiesTable( MPT_temp );
 	}
 	fMaterialsMap[matname.Data()] = mat_temp;
@@ -1714,7 +1718,7 @@ void G4SBSDetectorConstruction::ConstructMaterials(){
   MPT_temp->AddProperty("RINDEX", Ephoton_ECAL_QE, Rindex_quartz_ecal, nentries_ecal_QE);
   MPT_temp->AddProperty("ABSLENGTH", Ephoton_ECAL_QE, Abslength_TF1, nentries_ecal_QE); //Do we need this?? 
 
-  if( fMaterialsListOpticalPhotonDisabled.find( "QuartzWindow_ECal" ) == fMaterialsListOpticalPhotonDisabled.end() ){
+  if( OpticalPropertiesEnabled( "QuartzWindow_ECal" ) ){
     QuartzWindow_ECal->SetMaterialPropertiesTable( MPT_temp );
   }
   fMaterialsMap["QuartzWindow_ECal"] = QuartzWindow_ECal;
@@ -1740,7 +1744,7 @@ void G4SBSDetectorConstruction::ConstructMaterials(){
   MPT_temp->AddProperty("EFFICIENCY", Ephoton_ECAL_QE, PMT_ECAL_QE, nentries_ecal_QE ); 
   MPT_temp->AddProperty("RINDEX", Ephoton_ECAL_QE, Rindex_quartz_ecal, nentries_ecal_QE );
 
-  if( fMaterialsListOpticalPhotonDisabled.find( "Photocathode_material_ecal" ) == fMaterialsListOpticalPhotonDisabled.end() ){
+  if( OpticalPropertiesEnabled( "Photocathode_material_ecal" ) ){
     Photocathode_material_ecal->SetMaterialPropertiesTable( MPT_temp );
   }
   fMaterialsMap["Photocathode_material_ecal"] = Photocathode_material_ecal;
@@ -1780,7 +1784,7 @@ void G4SBSDetectorConstruction::ConstructMaterials(){
   MPT_temp->AddProperty("RINDEX", Ephoton_ECAL_QE, Rindex_air, nentries_ecal_QE );
   MPT_temp->AddProperty("ABSLENGTH", Ephoton_ECAL_QE, Abslength_air, nentries_ecal_QE );
 
-  if( fMaterialsListOpticalPhotonDisabled.find( "Special_Air" ) == fMaterialsListOpticalPhotonDisabled.end() ){
+  if( OpticalPropertiesEnabled( "Special_Air" ) ){
     Special_Air->SetMaterialPropertiesTable( MPT_temp );
   }
   fMaterialsMap["Special_Air"] = Special_Air;
@@ -1834,7 +1838,7 @@ void G4SBSDetectorConstruction::ConstructMaterials(){
   MPT_temp->AddProperty("RINDEX", Ephoton_rindex_CDET, Rindex_CDET, 2 );
   MPT_temp->AddProperty("ABSLENGTH", Ephoton_rindex_CDET, AbsLength_CDET, 2 );
 
-  if( fMaterialsListOpticalPhotonDisabled.find( "CDET_BC408" ) == fMaterialsListOpticalPhotonDisabled.end() ){
+  if( OpticalPropertiesEnabled( "CDET_BC408" ) ){
     PLASTIC_SC_VINYLTOLUENE->SetMaterialPropertiesTable(MPT_temp);
   }
     
@@ -1881,7 +1885,7 @@ void G4SBSDetectorConstruction::ConstructMaterials(){
   MPT_temp->AddProperty("EFFICIENCY", EPhoton_CDet, PMT_CDet_QE, nentries_CDet);
   MPT_temp->AddProperty("RINDEX", EPhoton_CDet, Rindex_CDet, nentries_CDet);
 
-  if( fMaterialsListOpticalPhotonDisabled.find( "Photocathode_CDet" ) == fMaterialsListOpticalPhotonDisabled.end() ){
+  if( OpticalPropertiesEnabled( "Photocathode_CDet" ) ){
     Photocathode_CDet->SetMaterialPropertiesTable( MPT_temp );
   }
   fMaterialsMap["Photocathode_CDet"] = Photocathode_CDet;
@@ -1951,7 +1955,7 @@ void G4SBSDetectorConstruction::ConstructMaterials(){
   MPT_temp->AddProperty("WLSABSLENGTH", Ephoton_BCF92_abs, WLSabslength_BCF92, nentries_BCF92_abs );
   MPT_temp->AddProperty("WLSCOMPONENT", Ephoton_BCF92_emission_sorted, BCF92_emission_relative_sorted, nentries_BCF92_emission );
 
-  if( fMaterialsListOpticalPhotonDisabled.find( "BCF_92" ) == fMaterialsListOpticalPhotonDisabled.end() ){
+  if( OpticalPropertiesEnabled( "BCF_92" ) ){
     BCF_92->SetMaterialPropertiesTable( MPT_temp );
   }
     
@@ -1973,7 +1977,7 @@ void G4SBSDetectorConstruction::ConstructMaterials(){
   MPT_temp->AddProperty("RINDEX", ephoton_acrylic, Rindex_acrylic, 2 );
   MPT_temp->AddProperty("ABSLENGTH", ephoton_acrylic, abslength_acrylic, 2 );
 
-  if( fMaterialsListOpticalPhotonDisabled.find( "CDET_Acrylic" ) == fMaterialsListOpticalPhotonDisabled.end() ){
+  if( OpticalPropertiesEnabled( "CDET_Acrylic" ) ){
     CDET_Acrylic->SetMaterialPropertiesTable(MPT_temp);
   }
 
@@ -2040,7 +2044,7 @@ void G4SBSDetectorConstruction::ConstructMaterials(){
   MPT_temp->AddProperty("EFFICIENCY", EPhoton_BB, PMT_BB_QE, nentries_BB ); 
   MPT_temp->AddProperty("RINDEX", EPhoton_BB, Rindex_BB, nentries_BB );
 
-  if( fMaterialsListOpticalPhotonDisabled.find( "Photocathode_BB" ) == fMaterialsListOpticalPhotonDisabled.end() ){
+  if( OpticalPropertiesEnabled( "Photocathode_BB" ) ){
     Photocathode_BB->SetMaterialPropertiesTable( MPT_temp );
   }
   fMaterialsMap["Photocathode_BB"] = Photocathode_BB;
@@ -2116,7 +2120,7 @@ void G4SBSDetectorConstruction::ConstructMaterials(){
   MPT_EJ232->AddConstProperty("SCINTILLATIONTIMECONSTANT1",1.40*ns);
   //MPT_EJ232->AddConstProperty("SLOWTIMECONSTANT",1.40*ns);
   //MPT_EJ232->AddConstProperty("YIELDRATIO",1.0);
-  if( fMaterialsListOpticalPhotonDisabled.find( "EJ232" ) == fMaterialsListOpticalPhotonDisabled.end() ){
+  if( OpticalPropertiesEnabled( "EJ232" ) ){
     EJ232->SetMaterialPropertiesTable(MPT_EJ232);
   }
   fMaterialsMap["EJ232"] = EJ232;
@@ -2166,7 +2170,7 @@ void G4SBSDetectorConstruction::ConstructMaterials(){
   MPT_BC484->AddProperty("WLSABSLENGTH"        , PhotonEnergyBC484 , AbsWLSfiberBC484_sorted     , nEntriesBC484);
   MPT_BC484->AddProperty("WLSCOMPONENT"        , PhotonEnergyBC484 , EmissionFibBC484_sorted     , nEntriesBC484);
   MPT_BC484->AddConstProperty("WLSTIMECONSTANT", 3.0*ns);
-  if( fMaterialsListOpticalPhotonDisabled.find( "BC484" ) == fMaterialsListOpticalPhotonDisabled.end() ){
+  if( OpticalPropertiesEnabled( "BC484" ) ){
     BC484->SetMaterialPropertiesTable(MPT_BC484);
   }
   fMaterialsMap["BC484"] = BC484;
@@ -2212,7 +2216,7 @@ void G4SBSDetectorConstruction::ConstructMaterials(){
   Glass_HC_mt->AddProperty("ABSLENGTH", PhotonEnergyBC484 , Glass_HC_AbsLength , nEntriesEJ232 );
   Glass_HC_mt->AddProperty("RINDEX"   , PhotonEnergyBC484 , Glass_HC_RIND      , nEntriesEJ232 );
 
-  if( fMaterialsListOpticalPhotonDisabled.find( "Glass_HC" ) == fMaterialsListOpticalPhotonDisabled.end() ){
+  if( OpticalPropertiesEnabled( "Glass_HC" ) ){
     Glass_HC->SetMaterialPropertiesTable(Glass_HC_mt);
   }
   fMaterialsMap["Glass_HC"] = Glass_HC; 
@@ -2251,7 +2255,7 @@ void G4SBSDetectorConstruction::ConstructMaterials(){
   Paper_MPT->AddProperty("SPECULARSPIKECONSTANT" , PhotonEnergyBC484 , MilliPoreSS , nEntriesEJ232);
   Paper_MPT->AddProperty("BACKSCATTERCONSTANT"   , PhotonEnergyBC484 , MilliPoreBK , nEntriesEJ232);
 
-  if( fMaterialsListOpticalPhotonDisabled.find( "Paper" ) == fMaterialsListOpticalPhotonDisabled.end() ){
+  if( OpticalPropertiesEnabled( "Paper" ) ){
     Paper->SetMaterialPropertiesTable(Paper_MPT);
   }
   fMaterialsMap["Paper"] = Paper;
@@ -2363,7 +2367,7 @@ void G4SBSDetectorConstruction::ConstructMaterials(){
   MPT_temp->AddProperty("RINDEX", Ephoton_rindex_pyrex, Rindex_pyrex, nentries_rindex_pyrex );
   MPT_temp->AddProperty("ABSLENGTH", Ephoton_abslength_pyrex, abslength_pyrex, nentries_abslength_pyrex );
 
-  if( fMaterialsListOpticalPhotonDisabled.find( "Pyrex_Glass" ) == fMaterialsListOpticalPhotonDisabled.end() ){
+  if( OpticalPropertiesEnabled( "Pyrex_Glass" ) ){
     Pyrex_Glass->SetMaterialPropertiesTable( MPT_temp );
   }
   
@@ -2426,6 +2430,10 @@ void G4SBSDetectorConstruction::ConstructMaterials(){
   G4Material *TargetBeamCollimator = new G4Material("TargetBeamCollimator_Material",tungsten_den,1); 
   TargetBeamCollimator->AddElement(elW,1); 
   fMaterialsMap["TargetBeamCollimator_Material"] = TargetBeamCollimator; 
+
+  if( !fUseCerenkov && !fUseScintillation ){
+    G4cout << "Cerenkov and scintillation are off: optical properties not attached to materials" << G4endl;
+  }
   
 }
 
@@ -2806,6 +2814,29 @@ void G4SBSDetectorConstruction::SetFlipGEM( G4bool b ){
   fGEMflip = b;
 }
 
+void G4SBSDetectorConstruction::SetUsingCerenkov( G4bool b ){
+  if( b && !fUseCerenkov && !fUseScintillation && !fMaterialsMap.empty() ){
+    G4cerr << "WARNING: materials were constructed without optical properties, no Cerenkov light will be produced;"
+	   << " use /g4sbs/useckov in the pre-init macro" << G4endl;
+  }
+  fUseCerenkov = b;
+}
+
+void G4SBSDetectorConstruction::SetUsingScintillation( G4bool b ){
+  if( b && !fUseCerenkov && !fUseScintillation && !fMaterialsMap.empty() ){
+    G4cerr << "WARNING: materials were constructed without optical properties, no scintillation light will be produced;"
+	   << " use /g4sbs/usescint in the pre-init macro" << G4endl;
+  }
+  fUseScintillation = b;
+}
+
+//Optical process tables (Cerenkov, scintillation, Rayleigh, WLS) are built at initialization for every
+//material with a properties table, so only attach them if optical photons can be produced at all:
+G4bool G4SBSDetectorConstruction::OpticalPropertiesEnabled( G4String material ) const {
+  if( !fUseCerenkov && !fUseScintillation ) return false;
+  return fMaterialsListOpticalPhotonDisabled.find( material ) == fMaterialsListOpticalPhotonDisabled.end();
+}
+
 void G4SBSDetectorConstruction::SetThresholdTimeWindowAndNTimeBins( G4String SDname, G4double Edefault, G4double Tdefault, G4int Ntbinsdefault ){
   G4SBSGEMSD *GEMSDptr;
   G4SBSCalSD *CalSDptr;
@@ -1,4 +1,5 @@
 #include "G4SBSECalSD.hh"
+#include "G4SBSProfiler.hh"
 #include "G4SBSECalHit.hh"
 #include "G4Step.hh"
 #include "G4HCofThisEvent.hh"
@@ -7,6 +8,8 @@
 #include "G4Track.hh"
 #include "G4OpticalPhoton.hh"
 #include "G4MaterialPropertiesTable.hh"
+#include "G4SBSOpticalLUT.hh"
+#include "G4SBSPhotonThinning.hh"
 
 G4SBSECalSD::G4SBSECalSD( G4String name, G4String collname ) : G4VSensitiveDetector(name) {
   collectionName.insert( collname );
@@ -19,6 +22,8 @@ G4SBSECalSD::G4SBSECalSD( G4String name, G4String collname ) : G4VSensitiveDetec
   fHitTimeWindow = 250.0*CLHEP::ns; 
   fPEThreshold = 0.0*CLHEP::MeV; //single photo-electron threshold!
   fNTimeBins = 25;
+
+  fProfileID = G4SBSProfiler::GetProfiler()->RegisterSD( name );
   // *****
 
   SDtracks.Clear();
@@ -39,9 +44,12 @@ void G4SBSECalSD::Initialize( G4HCofThisEvent *HC ){
 
   HC->AddHitsCollection( HCID, hitCollection );
   SDtracks.Clear();
+  fLUTphotons.clear();
 }
 
 G4bool G4SBSECalSD::ProcessHits( G4Step *aStep, G4TouchableHistory* ){
+  G4SBSProfiler::Scope prof( fProfileID );
+
   G4double edep = aStep->GetTotalEnergyDeposit();
 
   //For the ECal, we only consider optical photons to be part of the hit
@@ -99,26 +107,16 @@ G4bool G4SBSECalSD::ProcessHits( G4Step *aStep, G4TouchableHistory* ){
   //newHit->SetLogicalVolume( prestep->GetPhysicalVolume()->GetLogicalVolume() );
   //newHit->SetMatName( prestep->GetPhysicalVolume()->GetLogicalVolume()->GetMaterial()->GetName() );
 
-  //Set quantum efficiency: default to 1 in case no material properties table has been defined:
-  newHit->SetQuantumEfficiency( 1.0 );
-
-  G4MaterialPropertiesTable *MPT = prestep->GetPhysicalVolume()->GetLogicalVolume()->GetMaterial()->GetMaterialPropertiesTable();
-
-  if( MPT != NULL ){
-    G4MaterialPropertyVector *QEvect = (G4MaterialPropertyVector*) MPT->GetProperty("EFFICIENCY");
-
-    if( QEvect != NULL ){
-    
-      G4double Ephoton = newHit->Getenergy();
-      
-      G4bool inrange = Ephoton >= QEvect->GetMinEnergy() && Ephoton <= QEvect->GetMaxEnergy();
-      
-      G4double QEtemp = QEvect->Value( Ephoton );
+  //Quantum efficiency of the photocathode (default 1 if no material properties table has been defined),
+  //rescaled if optical photons are thinned at generation:
+  newHit->SetQuantumEfficiency( G4SBSPhotonThinning::GetThinning()->QuantumEfficiency( prestep->GetPhysicalVolume()->GetLogicalVolume()->GetMaterial(), newHit->Getenergy() ) );
 
-      if( !inrange ) QEtemp = 0.0;
-
-      newHit->SetQuantumEfficiency(QEtemp);
-    }
+  //In optical LUT calibration mode, record the first step of each photon in this detector.
+  //The local time of the pre-step point is the delay since the photon was emitted:
+  G4SBSOpticalLUT *LUT = G4SBSOpticalLUT::GetLUT();
+  if( LUT->GetMode() == G4SBSOpticalLUT::kCalibrate && fLUTphotons.insert( track->GetTrackID() ).second ){
+    LUT->RecordDetection( SensitiveDetectorName, track, PMTno, prestep->GetLocalTime(),
+			  newHit->GetQuantumEfficiency(), newHit->GetGlobalCellCoords() );
   }
 
   newHit->SetOTrIdx( SDtracks.InsertOriginalTrackInformation( track ) );
@@ -130,6 +128,36 @@ G4bool G4SBSECalSD::ProcessHits( G4Step *aStep, G4TouchableHistory* ){
   return true;
 }
 
+void G4SBSECalSD::InjectHit( G4Track *track, G4int PMT, G4double time, G4ThreeVector xgpmt ){
+  //The photon is never tracked to the PMT, so the hit is placed at the PMT center.
+  //The detection probability from the table already includes the quantum efficiency:
+  G4SBSECalHit *newHit = new G4SBSECalHit();
+
+  newHit->SetTrackID( track->GetTrackID() );
+  newHit->Setdx( 0.0 );
+  newHit->SetTime( time );
+  newHit->SetEdep( track->GetTotalEnergy() );
+  newHit->Setenergy( track->GetTotalEnergy() );
+
+  newHit->SetPos( xgpmt );
+  newHit->SetLPos( G4ThreeVector(0,0,0) );
+
+  newHit->SetPMTnumber( PMT );
+  newHit->Setrownumber( detmap.Row[PMT] );
+  newHit->Setcolnumber( detmap.Col[PMT] );
+  newHit->Setplanenumber( detmap.Plane[PMT] );
+  newHit->SetCellCoords( detmap.LocalCoord[PMT] );
+  newHit->SetGlobalCellCoords( xgpmt );
+
+  newHit->SetQuantumEfficiency( 1.0 );
+
+  newHit->SetOTrIdx( SDtracks.InsertOriginalTrackInformation( track ) );
+  newHit->SetPTrIdx( SDtracks.InsertPrimaryTrackInformation( track ) );
+  newHit->SetSDTrIdx( SDtracks.InsertSDTrackInformation( track ) );
+
+  hitCollection->insert( newHit );
+}
+
 void G4SBSECalSD::EndOfEvent( G4HCofThisEvent* ){
   ;
 }
@@ -8,6 +8,7 @@ G4SBSECaloutput::G4SBSECaloutput(){
   threshold  = 0.5; //single photo-electron threshold!
 
   ntimebins = 25;
+  pulseshape = 1; //G4SBS::kPulseShapeDense
 
   Clear();
 }
@@ -23,6 +24,9 @@ void G4SBSECaloutput::Clear(){
   SumPhotoelectrons = 0;
   
   NPE_vs_time.clear();
+  ps_idx.clear();
+  ps_bin.clear();
+  ps_val.clear();
   
   PMTnumber.clear();
   row.clear();
@@ -18,6 +18,7 @@
 #include "G4SBSCalSD.hh"
 #include "G4SBSRICHSD.hh"
 #include "G4SBSECalSD.hh"
+#include "G4SBSDetMap.hh"
 
 #include "G4Event.hh"
 #include "G4EventManager.hh"
@@ -32,6 +33,12 @@
 
 
 #include "G4SBSIO.hh"
+#include "G4SBSPileup.hh"
+#include "G4SBSImportance.hh"
+#include "G4SBSRandom.hh"
+#include "G4SBSProfiler.hh"
+#include "G4SBSTrigger.hh"
+#include "G4SBSGEMDigitizer.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4PhysicalConstants.hh"
 
@@ -43,6 +50,7 @@
 //#include <unordered_map>
 #include <vector>
 #include <set>
+#include <algorithm>
 
 using namespace std;
 
@@ -65,6 +73,9 @@ G4SBSEventAction::G4SBSEventAction() : fEventStatusEvery(1000)
   }
   
   SDlist.clear();
+
+  fOpticalFillID = 0;
+  fOpticalPassID = 0;
 }
 
 G4SBSEventAction::~G4SBSEventAction()
@@ -104,11 +115,26 @@ void G4SBSEventAction::BeginOfEventAction(const G4Event*ev) {
      fflush(stdout);
    }
 
+   //Primaries are generated; tracking draws from its own random stream:
+   G4SBSRandom::GetRandom()->BeginTransport();
+
+   G4SBSProfiler::GetProfiler()->Start( G4SBSProfiler::kTracking );
+
     return;
 }
 
 void G4SBSEventAction::EndOfEventAction(const G4Event* evt )
 {
+  G4SBSProfiler *profiler = G4SBSProfiler::GetProfiler();
+  profiler->Stop( G4SBSProfiler::kTracking );
+
+  //With /g4sbs/asyncwrite, the previous event may still be being written from the tree buffers we are about to fill:
+  {
+    G4SBSProfiler::Scope prof( G4SBSProfiler::kWriterWait );
+    fIO->WaitForWriter();
+  }
+
+  profiler->Start( G4SBSProfiler::kEventAction );
 
   G4SDManager * SDman = G4SDManager::GetSDMpointer();
 
@@ -160,6 +186,14 @@ void G4SBSEventAction::EndOfEventAction(const G4Event* evt )
 
   MapTracks(evt);
 
+  //Draw the background events to be superimposed on this event, if pile-up is enabled:
+  G4SBSPileup *pileup = G4SBSPileup::GetPileup();
+  pileup->SampleEvent();
+
+  G4SBSImportance *importance = G4SBSImportance::GetImportance();
+
+  G4SBSTrigger *trigger = G4SBSTrigger::GetTrigger();
+
   bool anyhits = false;
   bool has_earm_track=false;
   bool has_harm_track=false;
@@ -224,6 +258,10 @@ void G4SBSEventAction::EndOfEventAction(const G4Event* evt )
 	  fIO->SetSDtrackData( *d, sd );
 	  
 	  FillGEMData(evt, gemHC, gd, *sdtemp );
+
+	  if( importance->IsActive() ){
+	    for( size_t ihit=0; ihit<gd.weight.size(); ihit++ ) importance->ScoreHit( *d, gd.weight[ihit] );
+	  }
 	  fIO->SetGEMData( *d, gd );
 	  
 	
@@ -237,6 +275,15 @@ void G4SBSEventAction::EndOfEventAction(const G4Event* evt )
 	    
 	  }
 	  fIO->SetTrackData( *d, td );
+
+	  //Background hits are added after the track fit, so that tracks and the trigger flags only see signal hits:
+	  if( pileup->IsEnabled() ){
+	    pileup->MixGEM( *d, gd );
+	    fIO->SetGEMData( *d, gd );
+	  }
+
+	  //Strip digitization of signal and background hits:
+	  G4SBSGEMDigitizer::GetDigitizer()->Digitize( *d, GEMSDptr, gd );
 	}
       }
       break;
@@ -254,6 +301,7 @@ void G4SBSEventAction::EndOfEventAction(const G4Event* evt )
 	  cd.threshold =  CalSDptr->GetEnergyThreshold();
 	  cd.ntimebins =  CalSDptr->GetNTimeBins();
 	  cd.hold_tbins = CalSDptr->hold_tbins;
+	  cd.pulseshape = fIO->GetPulseShapeMode( *d );
 
 	  sd = CalSDptr->SDtracks;
 
@@ -279,6 +327,10 @@ void G4SBSEventAction::EndOfEventAction(const G4Event* evt )
 	  // G4cout << "Hits collection SD name = " << calHC->GetSDname() << G4endl << G4endl;
 	  
 	  FillCalData( evt, calHC, cd, *sdtemp );
+
+	  if( importance->IsActive() ){
+	    for( size_t ihit=0; ihit<cd.weight.size(); ihit++ ) importance->ScoreHit( *d, cd.weight[ihit] );
+	  }
 	  
 	  fIO->SetCalData( *d, cd );
 	  
@@ -288,6 +340,14 @@ void G4SBSEventAction::EndOfEventAction(const G4Event* evt )
 	    if( (*d).contains("Earm") ) has_earm_cal = true;
 	    if( (*d).contains("Harm") ) has_harm_cal = true;
 	  }
+
+	  if( pileup->IsEnabled() ){
+	    pileup->MixCAL( *d, cd );
+	    fIO->SetCalData( *d, cd );
+	  }
+
+	  //The trigger sees the background hits too:
+	  if( trigger->IsEnabled() ) trigger->AddCalHits( *d, cd );
 	}
       }
       break;
@@ -296,6 +356,8 @@ void G4SBSEventAction::EndOfEventAction(const G4Event* evt )
       RICHSDptr = (G4SBSRICHSD*) SDman->FindSensitiveDetector( *d, false );
 
       if( RICHSDptr != NULL ){
+	ReservePMTs( RICHSDptr->detmap );
+
 	RICHHC = (G4SBSRICHHitsCollection*) (HCE->GetHC(SDman->GetCollectionID(colNam=RICHSDptr->GetCollectionName(0))));
 
 	sd = RICHSDptr->SDtracks;
@@ -333,12 +395,15 @@ void G4SBSEventAction::EndOfEventAction(const G4Event* evt )
      
 
       if( ECalSDptr != NULL ){
+	ReservePMTs( ECalSDptr->detmap );
+
 	ECalHC = (G4SBSECalHitsCollection*) (HCE->GetHC(SDman->GetCollectionID(colNam=ECalSDptr->GetCollectionName(0))));
 
 	// *****
 	ed.timewindow = ECalSDptr->GetTimeWindow();
 	ed.threshold =  ECalSDptr->GetPEThreshold();
 	ed.ntimebins =  ECalSDptr->GetNTimeBins();
+	ed.pulseshape = fIO->GetPulseShapeMode( *d );
 	// *****
 	
 	sd = ECalSDptr->SDtracks;
@@ -458,7 +523,14 @@ void G4SBSEventAction::EndOfEventAction(const G4Event* evt )
 
   fIO->SetEventData( evdata );
 
-  if( fTreeFlag == 0 || anyhits ) fIO->FillTree();
+  G4bool triggered = trigger->Evaluate();
+
+  profiler->Stop( G4SBSProfiler::kEventAction );
+
+  if( (fTreeFlag == 0 || anyhits) && triggered ){
+    G4SBSProfiler::Scope prof( G4SBSProfiler::kFillTree );
+    fIO->FillTree();
+  }
 
   return;
 }
@@ -481,6 +553,7 @@ void G4SBSEventAction::FillGEMData( const G4Event *evt, G4SBSGEMHitsCollection *
   map<int,map<int,int> > mid,pid; //don't need one for plane, trid as these are already keys
   map<int,map<int,double> > vx,vy,vz;
   map<int,map<int,double> > p,edep,beta,pmin;//pmin: lowest p reached by the track. Does not make its way to output
+  map<int,map<int,double> > weight; //track weight (importance biasing)
   map<int,map<int,double> > polx,poly,polz;
   map<int,map<int,int> > OTrackIndices;
   map<int,map<int,int> > PTrackIndices;
@@ -489,6 +562,8 @@ void G4SBSEventAction::FillGEMData( const G4Event *evt, G4SBSGEMHitsCollection *
   //G4String sdname = hits->GetSDname();
   //G4int nhit=0;
   //Loop over all "hits" (actually individual tracking steps):
+  G4int sdid = G4SBSSDTrackOutput::InternSDname( hits->GetSDname() );
+
   for( G4int i=0; i < hits->entries(); i++ ){
 
     int trid = (*hits)[i]->GetTrID();
@@ -545,6 +620,7 @@ void G4SBSEventAction::FillGEMData( const G4Event *evt, G4SBSGEMHitsCollection *
       edep[gemID][trid] = (*hits)[i]->GetEdep();
    
       beta[gemID][trid] = (*hits)[i]->GetBeta();
+      weight[gemID][trid] = (*hits)[i]->GetWeight();
 
       // OTrackIndices[gemID][trid] = (*hits)[i]->GetOTrIdx();
       // PTrackIndices[gemID][trid] = (*hits)[i]->GetPTrIdx();
@@ -552,9 +628,9 @@ void G4SBSEventAction::FillGEMData( const G4Event *evt, G4SBSGEMHitsCollection *
 
       
       //In principle there is no need to check for existence of the tracks in the list
-      OTrackIndices[gemID][trid] = sdtracks.otracklist[(*hits)[i]->GetOTrIdx()];
-      PTrackIndices[gemID][trid] = sdtracks.ptracklist[(*hits)[i]->GetPTrIdx()];
-      SDTrackIndices[gemID][trid] = sdtracks.sdtracklist[(*hits)[i]->GetSDTrIdx()][hits->GetSDname()];
+      OTrackIndices[gemID][trid] = sdtracks.OTrackIndex( (*hits)[i]->GetOTrIdx() );
+      PTrackIndices[gemID][trid] = sdtracks.PTrackIndex( (*hits)[i]->GetPTrIdx() );
+      SDTrackIndices[gemID][trid] = sdtracks.SDTrackIndex( (*hits)[i]->GetSDTrIdx(), sdid );
       
     } else { //existing track in this layer, additional step; increment sums and averages:
       int nstep = nsteps_track_layer[gemID][trid];
@@ -606,6 +682,8 @@ void G4SBSEventAction::FillGEMData( const G4Event *evt, G4SBSGEMHitsCollection *
 
   set<int> TIDs_unique; //all unique track IDs involved in GEM hits in this event (for filling particle history tree)
 
+  CLHEP::HepRandomEngine *digiengine = G4SBSRandom::GetRandom()->GetEngine( G4SBSRandom::kDigitization );
+
   for(map<int,set<int> >::iterator hit=tracks_layers.begin(); hit!=tracks_layers.end(); hit++ ){
     set<int> tracklist = hit->second;
     int gemID = hit->first;
@@ -616,8 +694,8 @@ void G4SBSEventAction::FillGEMData( const G4Event *evt, G4SBSGEMHitsCollection *
 	gemoutput.plane.push_back( gemID );
 	gemoutput.strip.push_back( 0 );
 	//Difference between "x" and "tx" is that "x" is smeared by GEM coordinate resolution:
-	gemoutput.x.push_back( (-y[gemID][trackID] + CLHEP::RandGauss::shoot(0.0,fGEMres) )/_L_UNIT );
-	gemoutput.y.push_back( (x[gemID][trackID] + CLHEP::RandGauss::shoot(0.0,fGEMres) )/_L_UNIT );
+	gemoutput.x.push_back( (-y[gemID][trackID] + CLHEP::RandGauss::shoot(digiengine,0.0,fGEMres) )/_L_UNIT );
+	gemoutput.y.push_back( (x[gemID][trackID] + CLHEP::RandGauss::shoot(digiengine,0.0,fGEMres) )/_L_UNIT );
 	gemoutput.z.push_back( z[gemID][trackID]/_L_UNIT );
 	gemoutput.polx.push_back( -poly[gemID][trackID] );
 	gemoutput.poly.push_back(  polx[gemID][trackID] );
@@ -648,6 +726,7 @@ void G4SBSEventAction::FillGEMData( const G4Event *evt, G4SBSGEMHitsCollection *
 	gemoutput.p.push_back( p[gemID][trackID]/_E_UNIT );
 	gemoutput.edep.push_back( edep[gemID][trackID]/_E_UNIT );
 	gemoutput.beta.push_back( beta[gemID][trackID] );
+	gemoutput.weight.push_back( weight[gemID][trackID] );
 
 	gemoutput.otridx.push_back( OTrackIndices[gemID][trackID] );
 	gemoutput.ptridx.push_back( PTrackIndices[gemID][trackID] );
@@ -732,12 +811,14 @@ void G4SBSEventAction::FillCalData( const G4Event *evt, G4SBSCalHitsCollection *
   // ****
 
   caloutput.gatewidth = caloutput.timewindow;
-  map<int,vector<vector<double> > > esum_tbin;
+  //The time-binned energy deposition of the hits of each cell is accumulated in the pooled buffers
+  //fPulseFirst/fPulseBin/fPulseVal (non-empty bins only), and only if the pulse shape is kept
 
   // ****
 
   
   map<int,vector<double> > esum, t, t2, tmin, tmax;
+  map<int,vector<double> > wsum; //energy-deposition-weighted sum of track weights
   map<int,set<int> > OTrackIndices; //key = cell, value = list of all "OTracks" contributing to this hit in this cell
   map<int,set<int> > PTrackIndices; //key = cell, value = list of all "PTracks" contributing to this hit in this cell
   map<int,set<int> > SDTrackIndices; //key = cell, value = list of all "SDTracks" contributing to this hit in this cell
@@ -750,6 +831,8 @@ void G4SBSEventAction::FillCalData( const G4Event *evt, G4SBSCalHitsCollection *
   map<int,map<int,double> > p, px, py, pz, edep; //initial momentum and total energy deposition of unique tracks in each cell:
   
   //Loop over all hits; in this loop, we want to sort tracking steps within individual cells chronologically:
+  G4int sdid = G4SBSSDTrackOutput::InternSDname( hits->GetSDname() );
+
   for( G4int hit=0; hit<hits->entries(); hit++ ){
     std::pair<set<int>::iterator, bool> newcell = CellList.insert( (*hits)[hit]->GetCell() );
     int cell = *(newcell.first);
@@ -831,13 +914,13 @@ void G4SBSEventAction::FillCalData( const G4Event *evt, G4SBSCalHitsCollection *
 	//This is the appropriate place to add this info, since each track in a CALSD
 	//can only have exactly one set of otrack, ptrack, and sdtrack info, regardless of how many
 	//steps
-	OTrackIndices[cell].insert( SDtracks.otracklist[(*hits)[hit]->GetOTrIdx()] );
-	PTrackIndices[cell].insert( SDtracks.ptracklist[(*hits)[hit]->GetPTrIdx()] );
-	SDTrackIndices[cell].insert( SDtracks.sdtracklist[(*hits)[hit]->GetSDTrIdx()][hits->GetSDname()] );
+	OTrackIndices[cell].insert( SDtracks.OTrackIndex( (*hits)[hit]->GetOTrIdx() ) );
+	PTrackIndices[cell].insert( SDtracks.PTrackIndex( (*hits)[hit]->GetPTrIdx() ) );
+	SDTrackIndices[cell].insert( SDtracks.SDTrackIndex( (*hits)[hit]->GetSDTrIdx(), sdid ) );
 
 	// G4cout << "Inserted SD track for SD " << hits->GetSDname() << ", cell ID, TID = " << cell << ", " << (*hits)[hit]->GetTrID()
 	//        << ", SDTID = " << (*hits)[hit]->GetSDTrIdx()
-	//        << ", SDTidx = " << SDtracks.sdtracklist[(*hits)[hit]->GetSDTrIdx()][hits->GetSDname()] << G4endl;
+	//        << ", SDTidx = " << SDtracks.SDTrackIndex( (*hits)[hit]->GetSDTrIdx(), sdid ) << G4endl;
 	
       } else { //additional step in this cell:
 	//double w = double(nsteps_track[cell][track])/(double(nsteps_track[cell][track]+1) );
@@ -886,6 +969,10 @@ void G4SBSEventAction::FillCalData( const G4Event *evt, G4SBSCalHitsCollection *
 
     double tbin = 0.0;
 
+    fPulseFirst.clear();
+    fPulseBin.clear();
+    fPulseVal.clear();
+
     for( int istep=0; istep<steplist.size(); istep++ ){
       int jhit = steplist_cell_timeordered[cell][istep];
       G4double tstep = (*hits)[jhit]->GetTime();
@@ -918,6 +1005,7 @@ void G4SBSEventAction::FillCalData( const G4Event *evt, G4SBSCalHitsCollection *
 	zsum[cell].push_back( zstep*estep );
 
 	esum[cell].push_back( estep );
+	wsum[cell].push_back( estep * (*hits)[jhit]->GetWeight() );
 	t[cell].push_back( tstep*estep );
 	t2[cell].push_back( pow(tstep,2)*estep );
 	//tmin and tmax values are unweighted:
@@ -925,11 +1013,10 @@ void G4SBSEventAction::FillCalData( const G4Event *evt, G4SBSCalHitsCollection *
 	tmax[cell].push_back( tstep );
 
 	// ******
-	vector<double> esum_temp( caloutput.ntimebins );
-	esum_tbin[cell].push_back( esum_temp );
-
-	esum_tbin[cell][nhits_cell[cell] - 1][0] += estep ;
-
+	if( caloutput.pulseshape != G4SBS::kPulseShapeOff ){
+	  fPulseFirst.push_back( fPulseBin.size() );
+	  AddToPulseShape( 0, estep );
+	}
 	// ******
 	
       } else { //Add this step to the current hit:
@@ -942,15 +1029,18 @@ void G4SBSEventAction::FillCalData( const G4Event *evt, G4SBSCalHitsCollection *
 	zsum[cell][hitindex] += estep * zstep;
 
 	esum[cell][hitindex] += estep;
+	wsum[cell][hitindex] += estep * (*hits)[jhit]->GetWeight();
 	t[cell][hitindex] += estep * tstep;
 	t2[cell][hitindex] += estep * pow(tstep,2);
 	tmin[cell][hitindex] = (tstep < tmin[cell][hitindex] ) ? tstep : tmin[cell][hitindex];
 	tmax[cell][hitindex] = (tstep > tmax[cell][hitindex] ) ? tstep : tmax[cell][hitindex];
 
 	// ******
-	double wtbin = ( caloutput.timewindow - 0.0 )/double(caloutput.ntimebins);
-      	int bin_tstep = int( (tstep - tmin[cell][hitindex])/wtbin );
-	if ( bin_tstep >= 0 && bin_tstep < caloutput.ntimebins ) esum_tbin[cell][hitindex][bin_tstep] += estep;
+	if( caloutput.pulseshape != G4SBS::kPulseShapeOff ){
+	  double wtbin = ( caloutput.timewindow - 0.0 )/double(caloutput.ntimebins);
+	  int bin_tstep = int( (tstep - tmin[cell][hitindex])/wtbin );
+	  if ( bin_tstep >= 0 && bin_tstep < caloutput.ntimebins ) AddToPulseShape( bin_tstep, estep );
+	}
 	// ******
 
 	nsteps_hit_cell[cell][hitindex]++;
@@ -989,6 +1079,7 @@ void G4SBSEventAction::FillCalData( const G4Event *evt, G4SBSCalHitsCollection *
 	caloutput.ycellg.push_back( YCellG[cell]/_L_UNIT );
 	caloutput.zcellg.push_back( ZCellG[cell]/_L_UNIT );
 	caloutput.sumedep.push_back( esum[cell][ihit]/_E_UNIT );
+	caloutput.weight.push_back( esum[cell][ihit] > 0.0 ? wsum[cell][ihit]/esum[cell][ihit] : 1.0 );
 
 	caloutput.tavg.push_back( t[cell][ihit]/esum[cell][ihit]/_T_UNIT );
 	caloutput.trms.push_back( sqrt( t2[cell][ihit]/esum[cell][ihit] - pow(t[cell][ihit]/esum[cell][ihit],2) )/_T_UNIT );
@@ -1006,10 +1097,24 @@ void G4SBSEventAction::FillCalData( const G4Event *evt, G4SBSCalHitsCollection *
 	caloutput.tmax.push_back( tmax[cell][ihit]/_T_UNIT );
 
 	// ************* ++++++ ************
-	for ( int itbin=0; itbin<caloutput.ntimebins; itbin++ ){
-	  esum_tbin[cell][ihit][itbin] /= _E_UNIT;
+	if( caloutput.pulseshape != G4SBS::kPulseShapeOff ){
+	  size_t first = fPulseFirst[ihit];
+	  size_t last = ihit+1 < G4int(fPulseFirst.size()) ? fPulseFirst[ihit+1] : fPulseBin.size();
+
+	  if( caloutput.pulseshape == G4SBS::kPulseShapeSparse ){
+	    for( size_t ibin=first; ibin<last; ibin++ ){
+	      caloutput.ps_idx.push_back( caloutput.nhits_CAL );
+	      caloutput.ps_bin.push_back( fPulseBin[ibin] );
+	      caloutput.ps_val.push_back( fPulseVal[ibin]/_E_UNIT );
+	    }
+	  } else {
+	    vector<double> esum_tbin( caloutput.ntimebins );
+	    for( size_t ibin=first; ibin<last; ibin++ ){
+	      esum_tbin[fPulseBin[ibin]] = fPulseVal[ibin]/_E_UNIT;
+	    }
+	    caloutput.edep_vs_time.push_back( esum_tbin );
+	  }
 	}
-	caloutput.edep_vs_time.push_back( esum_tbin[cell][ihit] );
 	// *****
 	
 	//If there are multiple Otracks contributing to this hit, choose the one with the highest total energy:
@@ -1141,55 +1246,113 @@ void G4SBSEventAction::FillCalData( const G4Event *evt, G4SBSCalHitsCollection *
   }
 }
 
+void G4SBSEventAction::AddToPulseShape( G4int ibin, G4double val ){
+  //The steps of a hit are time-ordered, so its bins come in increasing order: a bin is either the last one
+  //stored for the current hit, or a new one:
+  if( fPulseBin.size() > fPulseFirst.back() && fPulseBin.back() == ibin ){
+    fPulseVal.back() += val;
+  } else {
+    fPulseBin.push_back( ibin );
+    fPulseVal.push_back( val );
+  }
+}
+
+void G4SBSEventAction::ReservePMTs( G4int npmt ){
+  if( npmt > G4int(fPMTs.size()) ){
+    G4SBSOpticalPMT blank;
+    blank.fillID = blank.passID = -1;
+    fPMTs.resize( npmt, blank );
+  }
+}
+
+void G4SBSEventAction::ReservePMTs( const G4SBSDetMap &detmap ){
+  //The PMT (copy) numbers of the detector are the keys of the row map:
+  if( !detmap.Row.empty() ) ReservePMTs( detmap.Row.rbegin()->first + 1 );
+}
+
+G4SBSOpticalPMT &G4SBSEventAction::GetPMT( G4int pmt ){
+  G4SBSOpticalPMT &PMT = fPMTs[pmt];
+  if( PMT.fillID != fOpticalFillID ){
+    PMT.fillID = fOpticalFillID;
+    PMT.passID = -1;
+    PMT.otridx.clear();
+    PMT.ptridx.clear();
+    PMT.sdtridx.clear();
+    PMT.steps.clear();
+    PMT.tbinstart.clear();
+    PMT.npe_tbin.clear();
+  }
+  return PMT;
+}
+
+void G4SBSEventAction::SortPhotons(){
+  //The pairs are added in order of increasing step; steps that were left out get no photon (-1):
+  size_t nsteps = fPhotonSteps.empty() ? 0 : fPhotonSteps.back().second + 1;
+
+  //Group the (track ID, step) pairs by photon track, in order of increasing track ID:
+  sort( fPhotonSteps.begin(), fPhotonSteps.end() );
+
+  fPhotons.clear();
+  fStepPhoton.assign( nsteps, -1 );
+
+  for( size_t i=0; i<fPhotonSteps.size(); i++ ){
+    if( i == 0 || fPhotonSteps[i].first != fPhotonSteps[i-1].first ){
+      G4SBSOpticalPhoton photon;
+      photon.tid = fPhotonSteps[i].first;
+      photon.firststep = fPhotonSteps[i].second;
+      fPhotons.push_back( photon );
+    }
+    fStepPhoton[fPhotonSteps[i].second] = fPhotons.size() - 1;
+  }
+}
+
+//Track indices of the photons detected in a PMT: consecutive photons mostly come from the same track
+static void AddTrackIndex( vector<G4int> &indices, G4int idx ){
+  if( indices.empty() || indices.back() != idx ) indices.push_back( idx );
+}
+
+//Track with the highest energy among the indices of a PMT; of several with the same energy, the lowest
+//index is chosen, as when looping over an ordered set:
+static G4int HighestEnergyTrack( const vector<G4int> &indices, const vector<double> &energy, G4bool checkrange ){
+  G4double maxE = 0.0;
+  G4bool firsttrack = true;
+  G4int idx_final = -1;
+  for( size_t i=0; i<indices.size(); i++ ){
+    G4int idx = indices[i];
+    if( checkrange && !(idx >= 0 && idx < G4int(energy.size())) ) continue;
+    G4double E = energy[idx];
+    if( firsttrack || E > maxE || (E == maxE && idx < idx_final) ){
+      idx_final = idx;
+      maxE = E;
+      firsttrack = false;
+    }
+  }
+  return idx_final;
+}
+
 void G4SBSEventAction::FillECalData( G4SBSECalHitsCollection *hits, G4SBSECaloutput &ecaloutput, G4SBSSDTrackOutput &SDtracks )
 {
   
   int nG4hits = hits->entries(); //Loop over nG4hits
+
+  G4int sdid = G4SBSSDTrackOutput::InternSDname( hits->GetSDname() );
   ecaloutput.Clear();
 
   int NPE_total = 0;
-  
-  set<int> TIDs_unique;
-  set<int> PMTs_unique;
-
-  map<int,bool> Photon_used;
-  map<int,bool> Photon_detected;
-  map<int,double> Photon_energy;
-  map<int,double> Photon_hittime;
-  map<int,int> Photon_PMT;
-  map<int,int> Photon_row;
-  map<int,int> Photon_col;
-  map<int,int> Photon_plane;
-  map<int,int> Photon_nsteps;
-  map<int,G4ThreeVector> Photon_xpmt; //"local" xy and "global" (xyz) PMT coordinates
-  map<int,G4ThreeVector> Photon_xgpmt;
-  map<int,int> Photon_otridx;
-  map<int,int> Photon_ptridx;
-  map<int,int> Photon_sdtridx;
-
-  map<int,int> PMT_Numphotoelectrons;
-  map<int,int> PMT_row;
-  map<int,int> PMT_col;
-  map<int,int> PMT_plane;
-  map<int,G4ThreeVector> PMT_x, PMT_xg; //"local" xy and "global" (xyz) PMT coordinates
-  map<int,double> PMT_hittime;
-  map<int,double> PMT_hittime2; //hit time squared.
-  map<int,double> PMT_rmstime;
-  map<int,double> PMT_tmin;
-  map<int,double> PMT_tmax;
-  //Let's handle optical photon detectors like ECAL (and RICH) similarly to CALSD: 
-  map<int,set<int> > OTrackIndices;
-  map<int,set<int> > PTrackIndices;
-  map<int,set<int> > SDTrackIndices;
+  int npulses = 0; //pulses in the sparse pulse shape, as the elements of NPE_vs_time
 
-  
-  // *****
-  map<int,vector<int> > steplist_pmt_timeordered; //key 1 = pmt, key 2 = time ordering index, value = index in hit array
-  set<int> PmtList;
-  map<int,int> nsteps_pmt;
-  map<int,int> nhits_pmt;
-  map<int,vector<double> > tmin_pmt, tmin;
-  map<int,vector<vector<double> > > npe_tbin;
+  //Per-photon and per-PMT state is kept in the scratch buffers fPhotons and fPMTs (see G4SBSEventAction.hh);
+  //PMTs are reset at their first use in this call:
+  fOpticalFillID++;
+
+  //Hits without a valid PMT number are skipped:
+  fPhotonSteps.clear();
+  for( int step = 0; step < nG4hits; step++ ){
+    if( (*hits)[step]->GetPMTnumber() < 0 ) continue;
+    fPhotonSteps.push_back( make_pair( (*hits)[step]->GetTrackID(), step ) );
+    if( (*hits)[step]->GetPMTnumber() >= G4int(fPMTs.size()) ) ReservePMTs( (*hits)[step]->GetPMTnumber() + 1 );
+  }
+  SortPhotons();
 
   ecaloutput.gatewidth = ecaloutput.timewindow;
     
@@ -1198,15 +1361,14 @@ void G4SBSEventAction::FillECalData( G4SBSECalHitsCollection *hits, G4SBSECalout
   //G4cout << " ******** ntimebins ********* " << ecaloutput.ntimebins << endl;
   // *****
   
-  //G4MaterialPropertiesTable *MPT; 
-
   for( int step = 0; step < nG4hits; step++ ){
     //Retrieve all relevant information for this step:
     int pmt = (*hits)[step]->GetPMTnumber();
+    if( pmt < 0 ) continue;
+
     int row = (*hits)[step]->Getrownumber();
     int col = (*hits)[step]->Getcolnumber();
     int plane = (*hits)[step]->Getplanenumber();
-    int tid = (*hits)[step]->GetTrackID();
     double Ephoton = (*hits)[step]->Getenergy();
     double Hittime = (*hits)[step]->GetTime();
 
@@ -1215,87 +1377,62 @@ void G4SBSEventAction::FillECalData( G4SBSECalHitsCollection *hits, G4SBSECalout
 
     G4double QEphoton = (*hits)[step]->GetQuantumEfficiency();
 
-    int otridx = SDtracks.otracklist[(*hits)[step]->GetOTrIdx()];
-    int ptridx = SDtracks.ptracklist[(*hits)[step]->GetPTrIdx()];
-    int sdtridx = SDtracks.sdtracklist[(*hits)[step]->GetSDTrIdx()][hits->GetSDname()];
+    int otridx = SDtracks.OTrackIndex( (*hits)[step]->GetOTrIdx() );
+    int ptridx = SDtracks.PTrackIndex( (*hits)[step]->GetPTrIdx() );
+    int sdtridx = SDtracks.SDTrackIndex( (*hits)[step]->GetSDTrIdx(), sdid );
 
     // *****
 
-    // To get the time ordered list of tracks in a given PMT
-    std::pair<set<int>::iterator, bool> newpmt = PmtList.insert( pmt );
-    int pmt_un = *(newpmt.first);
+    // To get the time ordered list of detected steps in a given PMT
+    G4SBSOpticalPMT &PMT = GetPMT( pmt );
     bool photon_det = G4UniformRand() <= QEphoton;
-      
-    
-    if( newpmt.second ){ //first hit in a new pmt:
-
-
-      if( photon_det ){ // I assume we only care about detected photons in this case
-	nsteps_pmt[pmt_un] = 1;
-	// PmtList.insert( pmt );
-	steplist_pmt_timeordered[pmt_un].push_back(step);
 
+    if( photon_det ){ // I assume we only care about detected photons in this case
+      PMT.steps.push_back( step );
+      // it seems unnecessary to do the time ordering
+      G4int jidx = G4int(PMT.steps.size()) - 2;
+      while( jidx >= 0 && Hittime < (*hits)[PMT.steps[jidx]]->GetTime() ){
+	//a hit at an earlier position in the array came later than this hit:
+	PMT.steps[jidx+1] = PMT.steps[jidx];
+	PMT.steps[jidx] = step;
+	jidx--;
       }
-
-    }else { // additional hits in existing PMT
-
-      if( photon_det ){
-
-	steplist_pmt_timeordered[pmt_un].push_back(step);
-	// it seems unnecessary to do the time ordering
-	G4int jidx = nsteps_pmt[pmt_un]-1;
-	G4int jhit = steplist_pmt_timeordered[pmt_un][jidx];
-	while( jidx >= 0 && Hittime < (*hits)[jhit]->GetTime() ){
-	  //a hit at an earlier position in the array came later than this hit:
-	  steplist_pmt_timeordered[pmt_un][jidx] = step;
-	  steplist_pmt_timeordered[pmt_un][jidx+1] = jhit;
-	  jidx--;
-	  if( jidx < 0 ) break;
-	  jhit =  steplist_pmt_timeordered[pmt_un][jidx];
-	}
-	// tmin_pmt[pmt] = (*hits)[steplist_pmt_timeordered[pmt][0]]->GetTime();
-	nsteps_pmt[pmt_un]++;
-      }     
-     
     }
 
     // *****
-
-
-
     
     //Following the method implemented during the RICH routine
-    std::pair< set<int>::iterator, bool > photontrack = TIDs_unique.insert( tid );
+    G4SBSOpticalPhoton &photon = fPhotons[fStepPhoton[step]];
    
-    if( photontrack.second ){
+    if( step == photon.firststep ){ //New photon track: determine whether this photon is detected:
      
       bool photon_detected = G4UniformRand() <= QEphoton;
 
-      Photon_used[ tid ] = !photon_detected; //If the photon is not detected, then we mark it as used. Otherwise, we mark it as unused, and it will be added to a PMT later.
-      Photon_detected[ tid ] = photon_detected;
-      Photon_energy[ tid ] = Ephoton;
-      Photon_hittime[ tid ] = Hittime;
+      photon.used = !photon_detected; //If the photon is not detected, then we mark it as used. Otherwise, we mark it as unused, and it will be added to a PMT later.
+      photon.detected = photon_detected;
+      photon.energy = Ephoton;
+      photon.hittime = Hittime;
      
-      Photon_PMT[ tid ] = pmt;
-      Photon_row[ tid ] = row;
-      Photon_col[ tid ] = col;
-      Photon_plane[ tid ] = plane;
+      photon.pmt = pmt;
+      photon.row = row;
+      photon.col = col;
+      photon.plane = plane;
 
-      Photon_xpmt[tid] = xpmt;
-      Photon_xgpmt[tid] = xgpmt;
+      photon.xpmt = xpmt;
+      photon.xgpmt = xgpmt;
 
-      Photon_nsteps[ tid ] = 1;
+      photon.nsteps = 1;
 
-      Photon_otridx[ tid ] = otridx;
-      Photon_ptridx[ tid ] = ptridx;
-      Photon_sdtridx[ tid ] = sdtridx;      
+      photon.otridx = otridx;
+      photon.ptridx = ptridx;
+      photon.sdtridx = sdtridx;
 
     } else { //existing photon, additional step. Increment averages of position, direction, time, etc for all steps of a detected photon. Don't bother for 
       //undetected photons...
-      if( Photon_detected[ tid ] ){
-	G4double average_time = (Photon_nsteps[ tid ] * Photon_hittime[ tid ] + Hittime )/double( Photon_nsteps[tid] + 1 );
-	Photon_hittime[tid] = average_time; 
-	Photon_nsteps[tid] += 1;
+      if( photon.detected ){
+	G4double average_time = (photon.nsteps * photon.hittime + Hittime )/double( photon.nsteps + 1 );
+	photon.hittime = average_time; 
+	photon.nsteps += 1;
 
       }
     }
@@ -1310,187 +1447,158 @@ void G4SBSEventAction::FillECalData( G4SBSECalHitsCollection *hits, G4SBSECalout
     
     remaining_hits = false;
     
-    PMTs_unique.clear();
-
-    for( set<int>::iterator it=TIDs_unique.begin(); it != TIDs_unique.end(); it++ ){
-      int tid = *it;
+    fOpticalPassID++;
+    fPassPMTs.clear();
 
+    for( size_t iphoton=0; iphoton<fPhotons.size(); iphoton++ ){
+      G4SBSOpticalPhoton &photon = fPhotons[iphoton];
       
       // Save particle info for all tracks (doesn't matter if they were
       // ultimately not detected)
       if(!saved_track_info) {
         ecaloutput.npart_ECAL++;
-        ecaloutput.part_PMT.push_back( Photon_PMT[tid] );
-        ecaloutput.trid.push_back( tid );
-        ecaloutput.E.push_back( Photon_energy[tid]/CLHEP::eV );
-        ecaloutput.t.push_back( Photon_hittime[tid]/CLHEP::ns );
-        ecaloutput.detected.push_back( Photon_detected[tid] );
+        ecaloutput.part_PMT.push_back( photon.pmt );
+        ecaloutput.trid.push_back( photon.tid );
+        ecaloutput.E.push_back( photon.energy/CLHEP::eV );
+        ecaloutput.t.push_back( photon.hittime/CLHEP::ns );
+        ecaloutput.detected.push_back( photon.detected );
       }
 
-      if( Photon_detected[ tid ] && !(Photon_used[ tid ] ) ){
+      if( photon.detected && !(photon.used) ){
 	
-	std::pair<set<int>::iterator,bool> testpmt = PMTs_unique.insert( Photon_PMT[tid] );
-
-	int pmt = Photon_PMT[tid];
+	int pmt = photon.pmt;
+	G4SBSOpticalPMT &PMT = GetPMT( pmt );
 
-	if( testpmt.second ){ // new PMT;
+	if( PMT.passID != fOpticalPassID ){ // new PMT;
+	  PMT.passID = fOpticalPassID;
+	  fPassPMTs.push_back( pmt );
 	  
 	  //Mark this photon track as used:
-	  Photon_used[ tid ] = true;
+	  photon.used = true;
 	  
-	  PMT_Numphotoelectrons[ pmt ] = 1;
-	  PMT_row[ pmt ] = Photon_row[tid];
-	  PMT_col[ pmt ] = Photon_col[tid];
-	  PMT_plane[ pmt ] = Photon_plane[tid];
-	  PMT_hittime[ pmt ] = Photon_hittime[tid];
-	  PMT_hittime2[ pmt ] = pow(Photon_hittime[tid],2);
-	  PMT_tmin[ pmt ] = Photon_hittime[tid];
-	  PMT_tmax[ pmt ] = Photon_hittime[tid];
-	  PMT_x[ pmt ] = Photon_xpmt[tid];
-	  PMT_xg[ pmt ] = Photon_xgpmt[tid];
-
-	  OTrackIndices[ pmt ].insert( Photon_otridx[ tid ] );
-	  PTrackIndices[ pmt ].insert( Photon_ptridx[ tid ] );
-	  SDTrackIndices[ pmt ].insert( Photon_sdtridx[ tid ] );
-				       
+	  PMT.npe = 1;
+	  PMT.row = photon.row;
+	  PMT.col = photon.col;
+	  PMT.plane = photon.plane;
+	  PMT.hittime = photon.hittime;
+	  PMT.hittime2 = pow(photon.hittime,2);
+	  PMT.tmin = photon.hittime;
+	  PMT.tmax = photon.hittime;
+	  PMT.x = photon.xpmt;
+	  PMT.xg = photon.xgpmt;
+
+	  AddTrackIndex( PMT.otridx, photon.otridx );
+	  AddTrackIndex( PMT.ptridx, photon.ptridx );
+	  AddTrackIndex( PMT.sdtridx, photon.sdtridx );
 	  
-	} else if( fabs( Photon_hittime[tid] - PMT_tmin[pmt] ) <= ecaloutput.timewindow ){ //Existing pmt with multiple photon detections:
-	  G4double average_hittime = (PMT_Numphotoelectrons[pmt] * PMT_hittime[pmt] + Photon_hittime[tid])/double(PMT_Numphotoelectrons[pmt] + 1 );
-	  PMT_hittime[pmt] = average_hittime;
-	  G4double average_hittime2 = (PMT_Numphotoelectrons[pmt] * PMT_hittime2[pmt] + pow(Photon_hittime[tid],2))/double(PMT_Numphotoelectrons[pmt] + 1 );
-	  PMT_hittime2[pmt] = average_hittime2;
+	} else if( fabs( photon.hittime - PMT.tmin ) <= ecaloutput.timewindow ){ //Existing pmt with multiple photon detections:
+	  G4double average_hittime = (PMT.npe * PMT.hittime + photon.hittime)/double(PMT.npe + 1 );
+	  PMT.hittime = average_hittime;
+	  G4double average_hittime2 = (PMT.npe * PMT.hittime2 + pow(photon.hittime,2))/double(PMT.npe + 1 );
+	  PMT.hittime2 = average_hittime2;
 
-	  PMT_Numphotoelectrons[pmt] += 1;
+	  PMT.npe += 1;
 
-	  if( Photon_hittime[tid] > PMT_tmax[pmt] ) PMT_tmax[pmt] = Photon_hittime[tid];
-	  if( Photon_hittime[tid] < PMT_tmin[pmt] ) PMT_tmin[pmt] = Photon_hittime[tid];
+	  if( photon.hittime > PMT.tmax ) PMT.tmax = photon.hittime;
+	  if( photon.hittime < PMT.tmin ) PMT.tmin = photon.hittime;
 	  
-	  Photon_used[tid] = true;
+	  photon.used = true;
 
-	  OTrackIndices[ pmt ].insert( Photon_otridx[ tid ] );
-	  PTrackIndices[ pmt ].insert( Photon_ptridx[ tid ] );
-	  SDTrackIndices[ pmt ].insert( Photon_sdtridx[ tid ] );
+	  AddTrackIndex( PMT.otridx, photon.otridx );
+	  AddTrackIndex( PMT.ptridx, photon.ptridx );
+	  AddTrackIndex( PMT.sdtridx, photon.sdtridx );
 	}
 
 	
 	//If any photon is detected but not used, then remaining hits = true!
-	if( !(Photon_used[tid] ) ) remaining_hits = true;
+	if( !(photon.used) ) remaining_hits = true;
       }
     }
 
+    //PMTs in increasing order of PMT number:
+    sort( fPassPMTs.begin(), fPassPMTs.end() );
 
     //Now add hits to the output following the RICH example..
-    for( set<int>::iterator it=PMTs_unique.begin(); it!=PMTs_unique.end(); it++ ){
+    for( size_t ipmt=0; ipmt<fPassPMTs.size(); ipmt++ ){
            
-      int pmt = *it;
-
+      int pmt = fPassPMTs[ipmt];
+      G4SBSOpticalPMT &PMT = fPMTs[pmt];
 
       // *****
-      // Storing pulse shape information
-      vector<int> steplist = steplist_pmt_timeordered[pmt];	
-      nhits_pmt[pmt] = 0;		
+      // Storing pulse shape information. The hits found for this PMT in an earlier pass are not cleared,
+      // so they are filled again from the first one:
+      int nhits_pmt = 0;
 	
-      for( int istep=0; istep<steplist.size(); istep++ ){
-        int jhit = steplist_pmt_timeordered[pmt][istep];
+      for( size_t istep=0; istep<PMT.steps.size() && ecaloutput.pulseshape != G4SBS::kPulseShapeOff; istep++ ){
+        int jhit = PMT.steps[istep];
         G4double tstep = (*hits)[jhit]->GetTime();
-        G4int hitindex = nhits_pmt[pmt] > 0 ? nhits_pmt[pmt]-1 : 0;
+        G4int hitindex = nhits_pmt > 0 ? nhits_pmt-1 : 0;
 
-        if( istep == 0 || (nhits_pmt[pmt] > 0 && tstep > tmin[pmt][hitindex] + ecaloutput.timewindow ) ){
-          nhits_pmt[pmt]++;
+        if( istep == 0 || (nhits_pmt > 0 && tstep > PMT.tbinstart[hitindex] + ecaloutput.timewindow ) ){
+          nhits_pmt++;
 
+          if( nhits_pmt > G4int(PMT.tbinstart.size()) ){
+            PMT.tbinstart.push_back( tstep );
+            PMT.npe_tbin.push_back( vector<G4double>( ecaloutput.ntimebins ) );
+          }
 
-          tmin[pmt].push_back( tstep );
-
-          vector<double> npe_temp( ecaloutput.ntimebins );
-          npe_tbin[pmt].push_back( npe_temp );
-
-          npe_tbin[pmt][nhits_pmt[pmt] - 1][0] += 1. ;
+          PMT.npe_tbin[nhits_pmt - 1][0] += 1. ;
 
         } else {
 
           double wtbin = ( ecaloutput.timewindow - 0.0 )/double(ecaloutput.ntimebins);
-          int bin_tstep = int( (tstep - tmin[pmt][hitindex])/wtbin );
-          if ( bin_tstep >= 0 && bin_tstep < ecaloutput.ntimebins ) npe_tbin[pmt][hitindex][bin_tstep] += 1.;
+          int bin_tstep = int( (tstep - PMT.tbinstart[hitindex])/wtbin );
+          if ( bin_tstep >= 0 && bin_tstep < ecaloutput.ntimebins ) PMT.npe_tbin[hitindex][bin_tstep] += 1.;
 	  
         }
       } 
 	  
 
       // *****
-      NPE_total += PMT_Numphotoelectrons[pmt];
+      NPE_total += PMT.npe;
       
-      if( PMT_Numphotoelectrons[pmt] >= ecaloutput.threshold ){
+      if( PMT.npe >= ecaloutput.threshold ){
 	
 	(ecaloutput.nhits_ECal)++;
 	
 	ecaloutput.PMTnumber.push_back( pmt );
-	ecaloutput.row.push_back( PMT_row[pmt] );
-	ecaloutput.col.push_back( PMT_col[pmt] );
-	ecaloutput.plane.push_back( PMT_plane[pmt] );
-	ecaloutput.xcell.push_back( PMT_x[pmt].x()/_L_UNIT );
-	ecaloutput.ycell.push_back( PMT_x[pmt].y()/_L_UNIT );
-	ecaloutput.zcell.push_back( PMT_x[pmt].z()/_L_UNIT );
-	ecaloutput.xgcell.push_back( PMT_xg[pmt].x()/_L_UNIT );
-	ecaloutput.ygcell.push_back( PMT_xg[pmt].y()/_L_UNIT );
-	ecaloutput.zgcell.push_back( PMT_xg[pmt].z()/_L_UNIT );
-	ecaloutput.NumPhotoelectrons.push_back( PMT_Numphotoelectrons[pmt] ); //NumPhotoelectrons is vector<int> defined in ECaloutput.hh
-	ecaloutput.Time_avg.push_back( PMT_hittime[pmt]/_T_UNIT );
-	ecaloutput.Time_rms.push_back( sqrt(fabs(PMT_hittime2[pmt] - pow(PMT_hittime[pmt],2) ) )/_T_UNIT );	
-	ecaloutput.Time_min.push_back( PMT_tmin[pmt]/_T_UNIT );
-	ecaloutput.Time_max.push_back( PMT_tmax[pmt]/_T_UNIT );
+	ecaloutput.row.push_back( PMT.row );
+	ecaloutput.col.push_back( PMT.col );
+	ecaloutput.plane.push_back( PMT.plane );
+	ecaloutput.xcell.push_back( PMT.x.x()/_L_UNIT );
+	ecaloutput.ycell.push_back( PMT.x.y()/_L_UNIT );
+	ecaloutput.zcell.push_back( PMT.x.z()/_L_UNIT );
+	ecaloutput.xgcell.push_back( PMT.xg.x()/_L_UNIT );
+	ecaloutput.ygcell.push_back( PMT.xg.y()/_L_UNIT );
+	ecaloutput.zgcell.push_back( PMT.xg.z()/_L_UNIT );
+	ecaloutput.NumPhotoelectrons.push_back( PMT.npe ); //NumPhotoelectrons is vector<int> defined in ECaloutput.hh
+	ecaloutput.Time_avg.push_back( PMT.hittime/_T_UNIT );
+	ecaloutput.Time_rms.push_back( sqrt(fabs(PMT.hittime2 - pow(PMT.hittime,2) ) )/_T_UNIT );	
+	ecaloutput.Time_min.push_back( PMT.tmin/_T_UNIT );
+	ecaloutput.Time_max.push_back( PMT.tmax/_T_UNIT );
 
 	// *****
-	for( int ihit=0; ihit<nhits_pmt[pmt]; ihit++ ){
-	    ecaloutput.NPE_vs_time.push_back( npe_tbin[pmt][ihit] );
-	}
-	// *****
-
-	//If there are multiple Otracks contributing to this hit, choose the one with the highest total energy:
-	G4double maxE = 0.0;
-	G4bool firsttrack=true;
-	int otridx_final=-1;
-	for( set<int>::iterator iotrk=OTrackIndices[pmt].begin(); iotrk!=OTrackIndices[pmt].end(); ++iotrk ){
-	  G4double Eotrack = SDtracks.oenergy[*iotrk];
-	  if( firsttrack || Eotrack > maxE ){
-	    otridx_final = *iotrk;
-	    maxE = Eotrack;
-	    firsttrack = false;
-	  }
-	}
-
-	//Primary tracks:
-	maxE = 0.0;
-	firsttrack = true;
-	int ptridx_final=-1;
-	for( set<int>::iterator iptrk=PTrackIndices[pmt].begin(); iptrk!=PTrackIndices[pmt].end(); ++iptrk ){
-	  G4double Eptrack = SDtracks.penergy[*iptrk];
-	  if( firsttrack || Eptrack > maxE ){
-	    ptridx_final = *iptrk;
-	    maxE = Eptrack;
-	    firsttrack = false;
-	  }
-	}
-
-	//SD boundary crossing tracks:
-	maxE = 0.0;
-	firsttrack = true;
-	int sdtridx_final=-1;
-	for( set<int>::iterator isdtrk=SDTrackIndices[pmt].begin(); isdtrk!=SDTrackIndices[pmt].end(); ++isdtrk ){
-	  int sdidxtemp = *isdtrk;
-
-	  if( sdidxtemp >= 0 && sdidxtemp <SDtracks.sdenergy.size() ){
-	    G4double Esdtrack = SDtracks.sdenergy[sdidxtemp];
-	    if( firsttrack || Esdtrack > maxE ){
-	      sdtridx_final = *isdtrk;
-	      maxE = Esdtrack;
-	      firsttrack = false;
+	for( int ihit=0; ihit<nhits_pmt; ihit++ ){
+	  if( ecaloutput.pulseshape == G4SBS::kPulseShapeSparse ){
+	    for( int ibin=0; ibin<ecaloutput.ntimebins; ibin++ ){
+	      if( PMT.npe_tbin[ihit][ibin] != 0.0 ){
+		ecaloutput.ps_idx.push_back( npulses );
+		ecaloutput.ps_bin.push_back( ibin );
+		ecaloutput.ps_val.push_back( PMT.npe_tbin[ihit][ibin] );
+	      }
 	    }
+	    npulses++;
+	  } else {
+	    ecaloutput.NPE_vs_time.push_back( PMT.npe_tbin[ihit] );
 	  }
 	}
+	// *****
 
-	ecaloutput.otridx.push_back( otridx_final );
-	ecaloutput.ptridx.push_back( ptridx_final );
-	ecaloutput.sdtridx.push_back( sdtridx_final );
+	//If there are multiple Otracks, primary tracks or SD boundary crossing tracks contributing to this hit,
+	//choose the one with the highest total energy:
+	ecaloutput.otridx.push_back( HighestEnergyTrack( PMT.otridx, SDtracks.oenergy, false ) );
+	ecaloutput.ptridx.push_back( HighestEnergyTrack( PMT.ptridx, SDtracks.penergy, false ) );
+	ecaloutput.sdtridx.push_back( HighestEnergyTrack( PMT.sdtridx, SDtracks.sdenergy, true ) );
 	
       }
     } //for    
@@ -1502,131 +1610,78 @@ void G4SBSEventAction::FillECalData( G4SBSECalHitsCollection *hits, G4SBSECalout
 void G4SBSEventAction::FillRICHData( const G4Event *evt, G4SBSRICHHitsCollection *hits, G4SBSRICHoutput &richoutput, G4SBSSDTrackOutput &SDtracks ){
   //Here is where we traverse the hit collection of the RICH and extract useful output data. 
   
-  // set<int> TIDs; //list of all unique track IDs  
   //This is the total number of tracking steps in our sensitive volume!
   int nG4hits = hits->entries();
 
+  G4int sdid = G4SBSSDTrackOutput::InternSDname( hits->GetSDname() );
+
   //cout << "Filling RICH data, nhits = " << nG4hits << endl;
 
   richoutput.Clear();
 
-  set<int> TIDs_unique;  //set of all unique photon tracks involved in RICH hits.
-  set<int> PMTs_unique;  //set of all unique PMTs with detected photons.
   set<int> mTIDs_unique; //set of all unique mother track IDs associated with RICH detected photons
   map<int,int> Nphe_mTID; // count the number of photoelectrons generated by a given mother track (compromise?)
   
-  map<int,bool> Photon_used;
-  map<int,bool> Photon_detected;
-  map<int,double> Photon_energy;
-  map<int,double> Photon_hittime;
-  map<int,G4ThreeVector> Photon_position; // position at hit
-  map<int,G4ThreeVector> Photon_direction; // direction at hit
-  map<int,G4ThreeVector> Photon_vertex;  //emission vertex
-  map<int,G4ThreeVector> Photon_vdirection;  //emission direction
-  map<int,G4ThreeVector> Photon_xpmt; //Local coordinates
-  map<int,G4ThreeVector> Photon_xgpmt; //Global coordinates
-  map<int,int> Photon_PMT;
-  map<int,int> Photon_row;
-  map<int,int> Photon_col;
-  map<int,int> Photon_mTID;
-  map<int,int> Photon_origvol;
-  map<int,int> Photon_nsteps;
-  map<int,int> Photon_otridx;
-  map<int,int> Photon_ptridx;
-  map<int,int> Photon_sdtridx;
-
-  map<int,int> PMT_Numphotoelectrons;
-  map<int,int> PMT_row;
-  map<int,int> PMT_col;
-  map<int,double> PMT_hittime;
-  map<int,double> PMT_hittime2; //hit time squared.
-  map<int,double> PMT_rmstime;
-  map<int,double> PMT_tmin; //earliest time
-  map<int,double> PMT_tmax; //latest time:
-  map<int,int> PMT_mTID;
-  map<int,G4ThreeVector> PMT_pos;
-  map<int,G4ThreeVector> PMT_dir;
-  map<int,G4ThreeVector> PMT_vpos;
-  map<int,G4ThreeVector> PMT_vdir;
-  map<int,G4ThreeVector> PMT_x; //local coordinates
-  map<int,G4ThreeVector> PMT_xg; //global coordinates
-  map<int,int> PMT_origvol;
-
-  //Let's handle optical photon detectors like ECAL (and RICH) similarly to CALSD: 
-  map<int,set<int> > OTrackIndices;
-  map<int,set<int> > PTrackIndices;
-  map<int,set<int> > SDTrackIndices;
-  
-  //G4MaterialPropertiesTable *MPT;
+  //Per-photon and per-PMT state is kept in the scratch buffers fPhotons and fPMTs (see G4SBSEventAction.hh);
+  //PMTs are reset at their first use in this call:
+  fOpticalFillID++;
 
-  //G4SBSRICHoutput allhits; //"Unfiltered" data (later we will filter hits according to photoelectron threshold)
-  //allhits.nhits_RICH = 0;
-  //allhits.ntracks_RICH = 0;
+  //Hits without a valid PMT number are skipped:
+  fPhotonSteps.clear();
+  for( int step = 0; step < nG4hits; step++ ){
+    if( (*hits)[step]->GetPMTnumber() < 0 ) continue;
+    fPhotonSteps.push_back( make_pair( (*hits)[step]->GetTrackID(), step ) );
+    if( (*hits)[step]->GetPMTnumber() >= G4int(fPMTs.size()) ) ReservePMTs( (*hits)[step]->GetPMTnumber() + 1 );
+  }
+  SortPhotons();
 
-  //int num_photons = 0;
   //Loop over all steps in the hits collection of the RICH:
 
   for( int step = 0; step < nG4hits; step++ ){
-    //Retrieve all relevant information for this step:
-    int pmt = (*hits)[step]->GetPMTnumber();
-    int row = (*hits)[step]->Getrownumber();
-    int col = (*hits)[step]->Getcolnumber();
-    int tid = (*hits)[step]->GetTrackID();
-    int mid = (*hits)[step]->GetMotherID();
-    double Ephoton = (*hits)[step]->GetEnergy();
-    double Hittime = (*hits)[step]->GetTime();
-    int origin_volume = (*hits)[step]->GetOriginVol();
-    G4ThreeVector vertex = (*hits)[step]->GetVertex();
-    G4ThreeVector vertexdirection = (*hits)[step]->GetVertexDirection();
-    G4ThreeVector position = (*hits)[step]->GetPos();
-    G4ThreeVector direction = (*hits)[step]->GetDirection();
-    G4ThreeVector Lposition = (*hits)[step]->GetLPos();
-    G4ThreeVector Ldirection = (*hits)[step]->GetLDirection();
-    G4ThreeVector xpmt = (*hits)[step]->GetCellCoord(); //"local" PMT coordinate (to e.g., detector mother volume)
-    G4ThreeVector xgpmt = (*hits)[step]->GetGlobalCellCoord(); //global PMT coordinate
-
-    G4double QEphoton = (*hits)[step]->GetQuantumEfficiency();
-    
     //First, we must ask: Is this a "new" photon track? It **should be** theoretically impossible for the same photon to 
     //be detected in two different PMTs, since the photocathodes don't have the necessary properties defined for the 
     //propagation of optical photons (RINDEX). On the other hand, it IS possible, and even likely, for two or more photons
     //to be detected by the same PMT. Therefore, we should consider photon tracks at the top level of the sorting logic:
       
-    std::pair< set<int>::iterator, bool > testphotontrack = TIDs_unique.insert( tid );
+    if( (*hits)[step]->GetPMTnumber() < 0 ) continue;
+
+    G4SBSOpticalPhoton &photon = fPhotons[fStepPhoton[step]];
     
-    if( testphotontrack.second ){ //New photon track: determine whether this photon is detected:
+    if( step == photon.firststep ){ //New photon track: determine whether this photon is detected:
       
+      G4double QEphoton = (*hits)[step]->GetQuantumEfficiency();
+
       bool photon_detected = G4UniformRand() <= QEphoton;
       
-      Photon_used[ tid ] = !photon_detected; //If the photon is not detected, then we mark it as used. Otherwise, we mark it as unused, and it will be added to a PMT later.
-      Photon_detected[ tid ] = photon_detected;
-      Photon_energy[ tid ] = Ephoton;
-      Photon_hittime[ tid ] = Hittime;
-      Photon_position[ tid ] = position;
-      Photon_direction[ tid ] = direction;
-      Photon_vertex[ tid ] = vertex;
-      Photon_vdirection[ tid ] = vertexdirection;
-      Photon_xpmt[ tid ] = xpmt;
-      Photon_xgpmt[ tid ] = xgpmt;
-      Photon_PMT[ tid ] = pmt;
-      Photon_row[ tid ] = row;
-      Photon_col[ tid ] = col;
-      Photon_mTID[ tid ] = mid; 
-      Photon_origvol[ tid ] = origin_volume;
-      Photon_nsteps[ tid ] = 1;
-
-      Photon_otridx[ tid ] = SDtracks.otracklist[(*hits)[step]->GetOTrIdx()];
-      Photon_ptridx[ tid ] = SDtracks.ptracklist[(*hits)[step]->GetPTrIdx()];
-      Photon_sdtridx[ tid ] = SDtracks.sdtracklist[(*hits)[step]->GetSDTrIdx()][hits->GetSDname()];
+      photon.used = !photon_detected; //If the photon is not detected, then we mark it as used. Otherwise, we mark it as unused, and it will be added to a PMT later.
+      photon.detected = photon_detected;
+      photon.energy = (*hits)[step]->GetEnergy();
+      photon.hittime = (*hits)[step]->GetTime();
+      photon.pos = (*hits)[step]->GetPos(); // position at hit
+      photon.dir = (*hits)[step]->GetDirection(); // direction at hit
+      photon.vertex = (*hits)[step]->GetVertex();  //emission vertex
+      photon.vdir = (*hits)[step]->GetVertexDirection();  //emission direction
+      photon.xpmt = (*hits)[step]->GetCellCoord(); //"local" PMT coordinate (to e.g., detector mother volume)
+      photon.xgpmt = (*hits)[step]->GetGlobalCellCoord(); //global PMT coordinate
+      photon.pmt = (*hits)[step]->GetPMTnumber();
+      photon.row = (*hits)[step]->Getrownumber();
+      photon.col = (*hits)[step]->Getcolnumber();
+      photon.mtid = (*hits)[step]->GetMotherID(); 
+      photon.origvol = (*hits)[step]->GetOriginVol();
+      photon.nsteps = 1;
+
+      photon.otridx = SDtracks.OTrackIndex( (*hits)[step]->GetOTrIdx() );
+      photon.ptridx = SDtracks.PTrackIndex( (*hits)[step]->GetPTrIdx() );
+      photon.sdtridx = SDtracks.SDTrackIndex( (*hits)[step]->GetSDTrIdx(), sdid );
       
     } else { //existing photon, additional step. Increment averages of position, direction, time, etc for all steps of a detected photon. Don't bother for 
       //undetected photons...
-      if( Photon_detected[ tid ] ){
-	G4ThreeVector average_pos = (Photon_nsteps[ tid ] * Photon_position[ tid ] + position )/double( Photon_nsteps[tid] + 1 );
-	Photon_position[tid] = average_pos;
-	G4double average_time = (Photon_nsteps[ tid ] * Photon_hittime[ tid ] + Hittime )/double( Photon_nsteps[tid] + 1 );
-	Photon_hittime[tid] = average_time; 
-	Photon_nsteps[tid] += 1;
+      if( photon.detected ){
+	G4ThreeVector average_pos = (photon.nsteps * photon.pos + (*hits)[step]->GetPos() )/double( photon.nsteps + 1 );
+	photon.pos = average_pos;
+	G4double average_time = (photon.nsteps * photon.hittime + (*hits)[step]->GetTime() )/double( photon.nsteps + 1 );
+	photon.hittime = average_time; 
+	photon.nsteps += 1;
       }
     }
   }
@@ -1639,182 +1694,145 @@ void G4SBSEventAction::FillRICHData( const G4Event *evt, G4SBSRICHHitsCollection
     
     remaining_hits = false;
     
-    PMTs_unique.clear();
-
-    for( set<int>::iterator it=TIDs_unique.begin(); it != TIDs_unique.end(); it++ ){
-      int tid = *it;
-      if( Photon_detected[ tid ] && !(Photon_used[ tid ] ) ){
-	std::pair<set<int>::iterator,bool> testpmt = PMTs_unique.insert( Photon_PMT[tid] );
-
-	int pmt = Photon_PMT[tid];
-
-	if( testpmt.second ){ // new PMT;
+    fOpticalPassID++;
+    fPassPMTs.clear();
+
+    for( size_t iphoton=0; iphoton<fPhotons.size(); iphoton++ ){
+      G4SBSOpticalPhoton &photon = fPhotons[iphoton];
+      if( photon.detected && !(photon.used) ){
+	int pmt = photon.pmt;
+	G4SBSOpticalPMT &PMT = GetPMT( pmt );
+
+	if( PMT.passID != fOpticalPassID ){ // new PMT;
+	  PMT.passID = fOpticalPassID;
+	  fPassPMTs.push_back( pmt );
 	  
 	  //Mark this photon track as used:
-	  Photon_used[ tid ] = true;
+	  photon.used = true;
 	  
-	  PMT_Numphotoelectrons[ pmt ] = 1;
-	  PMT_row[ pmt ] = Photon_row[tid];
-	  PMT_col[ pmt ] = Photon_col[tid];
-	  PMT_hittime[ pmt ] = Photon_hittime[tid];
-	  PMT_hittime2[ pmt ] = pow(Photon_hittime[tid],2);
-	  PMT_tmin[ pmt ] = PMT_hittime[ pmt ];
-	  PMT_tmax[ pmt ] = PMT_hittime[ pmt ];
-	  PMT_mTID[ pmt ] = Photon_mTID[tid];
-	  PMT_pos[ pmt ] = Photon_position[tid];
-	  PMT_dir[ pmt ] = Photon_direction[tid];
-	  PMT_vpos[ pmt ] = Photon_vertex[tid];
-	  PMT_vdir[ pmt ] = Photon_vdirection[tid];
-	  PMT_origvol[ pmt ] = Photon_origvol[tid];
-	  PMT_x[ pmt ] = Photon_xpmt[tid];
-	  PMT_xg[ pmt ] = Photon_xgpmt[tid];
-
-	  OTrackIndices[ pmt ].insert( Photon_otridx[ tid ] );
-	  PTrackIndices[ pmt ].insert( Photon_ptridx[ tid ] );
-	  SDTrackIndices[ pmt ].insert( Photon_sdtridx[ tid ] );
+	  PMT.npe = 1;
+	  PMT.row = photon.row;
+	  PMT.col = photon.col;
+	  PMT.hittime = photon.hittime;
+	  PMT.hittime2 = pow(photon.hittime,2);
+	  PMT.tmin = PMT.hittime;
+	  PMT.tmax = PMT.hittime;
+	  PMT.mtid = photon.mtid;
+	  PMT.pos = photon.pos;
+	  PMT.dir = photon.dir;
+	  PMT.vpos = photon.vertex;
+	  PMT.vdir = photon.vdir;
+	  PMT.origvol = photon.origvol;
+	  PMT.x = photon.xpmt;
+	  PMT.xg = photon.xgpmt;
+
+	  AddTrackIndex( PMT.otridx, photon.otridx );
+	  AddTrackIndex( PMT.ptridx, photon.ptridx );
+	  AddTrackIndex( PMT.sdtridx, photon.sdtridx );
 	  
-	  std::pair<set<int>::iterator,bool> newmother = mTIDs_unique.insert( Photon_mTID[tid] );
+	  std::pair<set<int>::iterator,bool> newmother = mTIDs_unique.insert( photon.mtid );
 
 	  if( newmother.second ){
-	    Nphe_mTID[ Photon_mTID[tid] ] = 1;
+	    Nphe_mTID[ photon.mtid ] = 1;
 	  } else {
-	    Nphe_mTID[ Photon_mTID[tid] ] += 1;
+	    Nphe_mTID[ photon.mtid ] += 1;
 	  }
-	} else if( fabs( Photon_hittime[tid] - PMT_hittime[pmt] ) <= richoutput.timewindow ){ //Existing pmt with multiple photon detections:
-	  G4ThreeVector average_pos = (PMT_Numphotoelectrons[pmt] * PMT_pos[pmt] + Photon_position[tid])/double(PMT_Numphotoelectrons[pmt] + 1);
-	  PMT_pos[pmt] = average_pos;
-	  G4ThreeVector average_dir = (PMT_Numphotoelectrons[pmt] * PMT_dir[pmt] + Photon_direction[tid])/double(PMT_Numphotoelectrons[pmt] + 1);
-	  PMT_dir[pmt] = average_dir;
-	  G4ThreeVector average_vpos = (PMT_Numphotoelectrons[pmt] * PMT_vpos[pmt] + Photon_vertex[tid])/double(PMT_Numphotoelectrons[pmt] + 1);
-	  PMT_vpos[pmt] = average_vpos;
-	  G4ThreeVector average_vdir = (PMT_Numphotoelectrons[pmt] * PMT_vdir[pmt] + Photon_vdirection[tid])/double(PMT_Numphotoelectrons[pmt] + 1);
-	  PMT_vdir[pmt] = average_vdir;
-	  G4double average_hittime = (PMT_Numphotoelectrons[pmt] * PMT_hittime[pmt] + Photon_hittime[tid])/double(PMT_Numphotoelectrons[pmt] + 1 );
-	  PMT_hittime[pmt] = average_hittime;
-	  G4double average_hittime2 = (PMT_Numphotoelectrons[pmt] * PMT_hittime2[pmt] + pow(Photon_hittime[tid],2))/double(PMT_Numphotoelectrons[pmt] + 1 );
-	  PMT_hittime2[pmt] = average_hittime2;
-
-	  if( Photon_hittime[tid] < PMT_tmin[pmt] ) PMT_tmin[pmt] = Photon_hittime[tid];
-	  if( Photon_hittime[tid] > PMT_tmax[pmt] ) PMT_tmax[pmt] = Photon_hittime[tid];
-
-	  PMT_Numphotoelectrons[pmt] += 1;
+	} else if( fabs( photon.hittime - PMT.hittime ) <= richoutput.timewindow ){ //Existing pmt with multiple photon detections:
+	  G4ThreeVector average_pos = (PMT.npe * PMT.pos + photon.pos)/double(PMT.npe + 1);
+	  PMT.pos = average_pos;
+	  G4ThreeVector average_dir = (PMT.npe * PMT.dir + photon.dir)/double(PMT.npe + 1);
+	  PMT.dir = average_dir;
+	  G4ThreeVector average_vpos = (PMT.npe * PMT.vpos + photon.vertex)/double(PMT.npe + 1);
+	  PMT.vpos = average_vpos;
+	  G4ThreeVector average_vdir = (PMT.npe * PMT.vdir + photon.vdir)/double(PMT.npe + 1);
+	  PMT.vdir = average_vdir;
+	  G4double average_hittime = (PMT.npe * PMT.hittime + photon.hittime)/double(PMT.npe + 1 );
+	  PMT.hittime = average_hittime;
+	  G4double average_hittime2 = (PMT.npe * PMT.hittime2 + pow(photon.hittime,2))/double(PMT.npe + 1 );
+	  PMT.hittime2 = average_hittime2;
+
+	  if( photon.hittime < PMT.tmin ) PMT.tmin = photon.hittime;
+	  if( photon.hittime > PMT.tmax ) PMT.tmax = photon.hittime;
+
+	  PMT.npe += 1;
 	  
-	  Photon_used[tid] = true;
+	  photon.used = true;
 
-	  OTrackIndices[ pmt ].insert( Photon_otridx[ tid ] );
-	  PTrackIndices[ pmt ].insert( Photon_ptridx[ tid ] );
-	  SDTrackIndices[ pmt ].insert( Photon_sdtridx[ tid ] );
+	  AddTrackIndex( PMT.otridx, photon.otridx );
+	  AddTrackIndex( PMT.ptridx, photon.ptridx );
+	  AddTrackIndex( PMT.sdtridx, photon.sdtridx );
 	  
-	  std::pair<set<int>::iterator,bool> newmother = mTIDs_unique.insert( Photon_mTID[tid] );
+	  std::pair<set<int>::iterator,bool> newmother = mTIDs_unique.insert( photon.mtid );
 
 	  if( newmother.second ){
-	    Nphe_mTID[ Photon_mTID[tid] ] = 1;
+	    Nphe_mTID[ photon.mtid ] = 1;
 	  } else {
-	    Nphe_mTID[ Photon_mTID[tid] ] += 1;
+	    Nphe_mTID[ photon.mtid ] += 1;
 	  }
 	}
 	
 	//If any photon is detected but not used, then remaining hits = true!
-	if( !(Photon_used[tid] ) ) remaining_hits = true;
+	if( !(photon.used) ) remaining_hits = true;
       }
     }
     
+    //PMTs in increasing order of PMT number:
+    sort( fPassPMTs.begin(), fPassPMTs.end() );
+
     //Now add hits to the output. PMTs are not required to be unique here, but the probability of multiple hits on the same PMT separated by more than richoutput.timewindow is very small. 
-    for( set<int>::iterator it=PMTs_unique.begin(); it!=PMTs_unique.end(); it++ ){
+    for( size_t ipmt=0; ipmt<fPassPMTs.size(); ipmt++ ){
       
-      int pmt = *it;
+      int pmt = fPassPMTs[ipmt];
+      const G4SBSOpticalPMT &PMT = fPMTs[pmt];
       
-      if( PMT_Numphotoelectrons[pmt] >= richoutput.threshold ){
+      if( PMT.npe >= richoutput.threshold ){
 	
 	(richoutput.nhits_RICH)++;
 	
 	richoutput.PMTnumber.push_back( pmt );
-	richoutput.row.push_back( PMT_row[pmt] );
-	richoutput.col.push_back( PMT_col[pmt] );
-	richoutput.NumPhotoelectrons.push_back( PMT_Numphotoelectrons[pmt] );
-	richoutput.Time_avg.push_back( PMT_hittime[pmt]/_T_UNIT );
-	richoutput.Time_rms.push_back( sqrt(fabs(PMT_hittime2[pmt] - pow(PMT_hittime[pmt],2) ) )/_T_UNIT );
-	richoutput.Time_min.push_back( PMT_tmin[pmt]/_T_UNIT );
-	richoutput.Time_max.push_back( PMT_tmax[pmt]/_T_UNIT );
-	richoutput.mTrackNo.push_back( PMT_mTID[pmt] ); 
+	richoutput.row.push_back( PMT.row );
+	richoutput.col.push_back( PMT.col );
+	richoutput.NumPhotoelectrons.push_back( PMT.npe );
+	richoutput.Time_avg.push_back( PMT.hittime/_T_UNIT );
+	richoutput.Time_rms.push_back( sqrt(fabs(PMT.hittime2 - pow(PMT.hittime,2) ) )/_T_UNIT );
+	richoutput.Time_min.push_back( PMT.tmin/_T_UNIT );
+	richoutput.Time_max.push_back( PMT.tmax/_T_UNIT );
+	richoutput.mTrackNo.push_back( PMT.mtid ); 
 	//For now, this is the mother track of the first photon detected by this PMT. This does not account for the possibility of the same PMT detecting photons produced by different tracks in the same event.
 	//Hopefully, the probability of this occurrence is quite low?
-	richoutput.xhit.push_back( PMT_pos[pmt].x()/_L_UNIT ); //Later we will go back to the hit definition and make sure this is the LOCAL position of the hit
-	richoutput.yhit.push_back( PMT_pos[pmt].y()/_L_UNIT );
-	richoutput.zhit.push_back( PMT_pos[pmt].z()/_L_UNIT );
+	richoutput.xhit.push_back( PMT.pos.x()/_L_UNIT ); //Later we will go back to the hit definition and make sure this is the LOCAL position of the hit
+	richoutput.yhit.push_back( PMT.pos.y()/_L_UNIT );
+	richoutput.zhit.push_back( PMT.pos.z()/_L_UNIT );
 	
-	richoutput.pxhit.push_back( PMT_dir[pmt].x() ); //Later we will go back to the hit definition and make sure this is the LOCAL position of the hit
-	richoutput.pyhit.push_back( PMT_dir[pmt].y() );
-	richoutput.pzhit.push_back( PMT_dir[pmt].z() );
+	richoutput.pxhit.push_back( PMT.dir.x() ); //Later we will go back to the hit definition and make sure this is the LOCAL position of the hit
+	richoutput.pyhit.push_back( PMT.dir.y() );
+	richoutput.pzhit.push_back( PMT.dir.z() );
 	
-	richoutput.pvx.push_back( PMT_vpos[pmt].x()/_L_UNIT );
-	richoutput.pvy.push_back( PMT_vpos[pmt].y()/_L_UNIT );
-	richoutput.pvz.push_back( PMT_vpos[pmt].z()/_L_UNIT );
+	richoutput.pvx.push_back( PMT.vpos.x()/_L_UNIT );
+	richoutput.pvy.push_back( PMT.vpos.y()/_L_UNIT );
+	richoutput.pvz.push_back( PMT.vpos.z()/_L_UNIT );
 	
-	richoutput.ppx.push_back( PMT_vdir[pmt].x() );
-	richoutput.ppy.push_back( PMT_vdir[pmt].y() );
-	richoutput.ppz.push_back( PMT_vdir[pmt].z() );
+	richoutput.ppx.push_back( PMT.vdir.x() );
+	richoutput.ppy.push_back( PMT.vdir.y() );
+	richoutput.ppz.push_back( PMT.vdir.z() );
 	
-	richoutput.volume_flag.push_back( PMT_origvol[pmt] ); //Again, considering only the first photon detected by this PMT.
-
-	richoutput.xpmt.push_back( PMT_x[pmt].x()/_L_UNIT );
-	richoutput.ypmt.push_back( PMT_x[pmt].y()/_L_UNIT );
-	richoutput.zpmt.push_back( PMT_x[pmt].z()/_L_UNIT );
-	richoutput.xgpmt.push_back( PMT_xg[pmt].x()/_L_UNIT );
-	richoutput.ygpmt.push_back( PMT_xg[pmt].y()/_L_UNIT );
-	richoutput.zgpmt.push_back( PMT_xg[pmt].z()/_L_UNIT );
-
-	//If there are multiple Otracks contributing to this hit, choose the one with the highest total energy:
-	G4double maxE = 0.0;
-	G4bool firsttrack=true;
-	int otridx_final=-1;
-	for( set<int>::iterator iotrk=OTrackIndices[pmt].begin(); iotrk!=OTrackIndices[pmt].end(); ++iotrk ){
-	  G4double Eotrack = SDtracks.oenergy[*iotrk];
-	  if( firsttrack || Eotrack > maxE ){
-	    otridx_final = *iotrk;
-	    maxE = Eotrack;
-	    firsttrack = false;
-	  }
-	}
-
-	//Primary tracks:
-	maxE = 0.0;
-	firsttrack = true;
-	int ptridx_final=-1;
-	for( set<int>::iterator iptrk=PTrackIndices[pmt].begin(); iptrk!=PTrackIndices[pmt].end(); ++iptrk ){
-	  G4double Eptrack = SDtracks.penergy[*iptrk];
-	  if( firsttrack || Eptrack > maxE ){
-	    ptridx_final = *iptrk;
-	    maxE = Eptrack;
-	    firsttrack = false;
-	  }
-	}
-
-	//SD boundary crossing tracks:
-	maxE = 0.0;
-	firsttrack = true;
-	int sdtridx_final=-1;
-	for( set<int>::iterator isdtrk=SDTrackIndices[pmt].begin(); isdtrk!=SDTrackIndices[pmt].end(); ++isdtrk ){
-
-	  int sdidxtemp = *isdtrk;
-
-	  if( sdidxtemp >= 0 && sdidxtemp <SDtracks.sdenergy.size() ){
-	    G4double Esdtrack = SDtracks.sdenergy[sdidxtemp];
-	    if( firsttrack || Esdtrack > maxE ){
-	      sdtridx_final = *isdtrk;
-	      maxE = Esdtrack;
-	      firsttrack = false;
-	    }
-	  }
-	}
-
-	richoutput.otridx.push_back( otridx_final );
-	richoutput.ptridx.push_back( ptridx_final );
-	richoutput.sdtridx.push_back( sdtridx_final );
+	richoutput.volume_flag.push_back( PMT.origvol ); //Again, considering only the first photon detected by this PMT.
+
+	richoutput.xpmt.push_back( PMT.x.x()/_L_UNIT );
+	richoutput.ypmt.push_back( PMT.x.y()/_L_UNIT );
+	richoutput.zpmt.push_back( PMT.x.z()/_L_UNIT );
+	richoutput.xgpmt.push_back( PMT.xg.x()/_L_UNIT );
+	richoutput.ygpmt.push_back( PMT.xg.y()/_L_UNIT );
+	richoutput.zgpmt.push_back( PMT.xg.z()/_L_UNIT );
+
+	//If there are multiple Otracks, primary tracks or SD boundary crossing tracks contributing to this hit,
+	//choose the one with the highest total energy:
+	richoutput.otridx.push_back( HighestEnergyTrack( PMT.otridx, SDtracks.oenergy, false ) );
+	richoutput.ptridx.push_back( HighestEnergyTrack( PMT.ptridx, SDtracks.penergy, false ) );
+	richoutput.sdtridx.push_back( HighestEnergyTrack( PMT.sdtridx, SDtracks.sdenergy, true ) );
 	
       }
     }
-    //PMTs_unique.clear();
   }
   
   G4TrajectoryContainer *tracklist = evt->GetTrajectoryContainer();
@@ -1918,190 +1936,175 @@ void G4SBSEventAction::MapTracks( const G4Event *evt ){
   }
 }
 
-void G4SBSEventAction::FillTrackData( G4SBSGEMoutput gemdata, G4SBSTrackerOutput &Toutput ){
+void G4SBSEventAction::FillTrackData( const G4SBSGEMoutput &gemdata, G4SBSTrackerOutput &Toutput ){
   //Note: gemdata have already been normalized to the correct units (meters, ns, GeV) and are already expressed in TRANSPORT coordinates:
   //Also note that gemdata.x and gemdata.y have already been smeared by coordinate resolution!
 
-  set<int> TrackTIDs_unique; //Track numbers of unique tracks causing GEM hits in this event:
-  
-  map<int, vector<int> > HitList; //list of indices in the hit array of hits associated with a given track:
+  //Fit procedure: minimize chi^2 defined as sum_i=1,N (xi - (x0 + xp*z))^2/sigmax^2 + (yi - (y0+yp*z))^2/sigmay^2:
+  //The x and y fits are decoupled, and with a common coordinate resolution for all hits each one is a
+  //2x2 linear problem in (x0,xp) or (y0,yp), which we solve in closed form for all track candidates at once.
+  //The "true" track is the same fit applied to the unsmeared coordinates (tx, ty).
 
   G4int nhits = gemdata.nhits_GEM;
 
-  //First, map all hits to track IDs:
+  //Gather the hits with energy deposition, ordered by track ID and then by hit index:
+  vector<std::pair<int,int> > order;
+  order.reserve( nhits );
   for(int i=0; i<nhits; i++){
-    int tid = gemdata.trid[i];   
-   
-    double edep = gemdata.edep[i];
+    if( gemdata.edep[i] > 0.0 ) order.push_back( std::make_pair( gemdata.trid[i], i ) );
+  }
+  std::sort( order.begin(), order.end() );
+
+  G4int nsel = order.size();
+
+  //Structure-of-arrays copy of the hit data in track order:
+  vector<double> zs(nsel), xs(nsel), ys(nsel), xt(nsel), yt(nsel), ts(nsel), betas(nsel);
+  for(int k=0; k<nsel; k++){
+    int hit = order[k].second;
+    zs[k] = gemdata.z[hit];
+    xs[k] = gemdata.x[hit];
+    ys[k] = gemdata.y[hit];
+    xt[k] = gemdata.tx[hit];
+    yt[k] = gemdata.ty[hit];
+    ts[k] = gemdata.t[hit];
+    betas[k] = gemdata.beta[hit];
+  }
 
-    if( edep > 0.0 ){
-      TrackTIDs_unique.insert( tid );
-      
-      HitList[tid].push_back( i );
+  //Boundaries of the hit range of each track candidate:
+  vector<int> first;
+  for(int k=0; k<nsel; k++){
+    if( k == 0 || order[k].first != order[k-1].first ) first.push_back( k );
+  }
+  int ncand = first.size();
+  first.push_back( nsel );
+
+  //Sums for the normal equations of each candidate (uniform weights; the resolution cancels out):
+  vector<double> S(ncand,0.0), Sz(ncand,0.0), Szz(ncand,0.0);
+  vector<double> Sx(ncand,0.0), Szx(ncand,0.0), Sy(ncand,0.0), Szy(ncand,0.0);
+  vector<double> Sxt(ncand,0.0), Szxt(ncand,0.0), Syt(ncand,0.0), Szyt(ncand,0.0);
+
+  for(int c=0; c<ncand; c++){
+    double s=0.0, sz=0.0, szz=0.0, sx=0.0, szx=0.0, sy=0.0, szy=0.0, sxt=0.0, szxt=0.0, syt=0.0, szyt=0.0;
+    for(int k=first[c]; k<first[c+1]; k++){
+      double z = zs[k];
+      s += 1.0;
+      sz += z;
+      szz += z*z;
+      sx += xs[k];
+      szx += z*xs[k];
+      sy += ys[k];
+      szy += z*ys[k];
+      sxt += xt[k];
+      szxt += z*xt[k];
+      syt += yt[k];
+      szyt += z*yt[k];
     }
+    S[c] = s; Sz[c] = sz; Szz[c] = szz;
+    Sx[c] = sx; Szx[c] = szx; Sy[c] = sy; Szy[c] = szy;
+    Sxt[c] = sxt; Szxt[c] = szxt; Syt[c] = syt; Szyt[c] = szyt;
   }
 
   int nplanes_min = 3; //Minimum number of valid hits to define a track:
 
-  //For the "true" track, we simply take the average of all points for x, y, xp, yp 
-  //Fit procedure: minimize chi^2 defined as sum_i=1,N (xi - (x0 + xp*z))^2/sigmax^2 + (yi - (y0+yp*z))^2/sigmay^2:
+  double sigma = fGEMres/_L_UNIT;
 
-  for(set<int>::iterator trk=TrackTIDs_unique.begin(); trk != TrackTIDs_unique.end(); trk++ ){
-    int track   = *trk;
-    //Define sums to keep track of: 
-    int nhittrk = 0;
-    int nplanetrk = 0;
-      
-    set<int> GEMIDs_unique; //List of unique GEM plane ids on this track:
+  vector<int> planes;
 
-    double x0avg = 0.0, y0avg = 0.0, xpavg = 0.0, ypavg = 0.0;
-    double x0avg2 = 0.0, y0avg2 = 0.0, xpavg2 = 0.0, ypavg2 = 0.0;
-    double tavg = 0.0, tavg2 = 0.0;
-    double pavg = 0.0;
-
-    double polx_avg = 0.0, poly_avg = 0.0, polz_avg = 0.0; //compute average track polarization for each track.
-    
-    TMatrixD M(4,4);
-    TVectorD b(4);
-    TVectorD btrue(4);
-    
-    //Initialize linear fitting matrices to zero:
-    for(int i=0; i<4; i++){
-      for(int j=0; j<4; j++){
-	M(i,i) = 0.0;
-      }
-      b(i) = 0.0;
-      btrue(i) = 0.0;
-    }
-      
-    nhittrk = HitList[track].size();
+  for(int c=0; c<ncand; c++){
+    int nhittrk = first[c+1]-first[c];
 
-    if( nhittrk >= nplanes_min ){
-	
-      vector<double> xsmear,ysmear,xtrue,ytrue,ztrue,hittime,beta;
-      
-      int PID = 0, MID = -1;
-      
-      double sigma = fGEMres/_L_UNIT;
+    if( nhittrk < nplanes_min ) continue;
 
-      for(int idx = 0; idx<nhittrk; idx++ ){ //First pass: determine number of unique GEM planes and compute average slopes of "true track". Also compute the sums for the linear fit:
-	int hit = HitList[track][idx];
-	
-	if( idx == 0 ) {
-	  PID = gemdata.pid[hit];
-	  MID = gemdata.mid[hit];
-	}
-	
-	GEMIDs_unique.insert( gemdata.plane[hit] );
-	
-	pavg += gemdata.p[hit]/double(nhittrk);
+    //Number of unique GEM planes on this track:
+    planes.clear();
+    for(int k=first[c]; k<first[c+1]; k++) planes.push_back( gemdata.plane[order[k].second] );
+    std::sort( planes.begin(), planes.end() );
+    int nplanetrk = std::unique( planes.begin(), planes.end() ) - planes.begin();
 
-	polx_avg += gemdata.polx[hit]/double(nhittrk);
-	poly_avg += gemdata.poly[hit]/double(nhittrk);
-	polz_avg += gemdata.polz[hit]/double(nhittrk);
-	
-	xtrue.push_back( gemdata.tx[hit] );
-	ytrue.push_back( gemdata.ty[hit] );
+    if( nplanetrk < nplanes_min ) continue;
 
-	xsmear.push_back( gemdata.x[hit] );
-	ysmear.push_back( gemdata.y[hit] );
-	  
-	ztrue.push_back( gemdata.z[hit] );
-	 
-	hittime.push_back( gemdata.t[hit] );
-	beta.push_back( gemdata.beta[hit] );
-	  
-	//Indices of fit parameters in matrix are: 0 = x0, 1 = xp, 2 = y0, 3 = yp:
-	M(0,0) += pow(1.0/sigma,2); 
-	M(0,1) += pow(1.0/sigma,2) * ztrue[idx];
-	M(0,2) += 0.0; //No cross term between x0 and y0
-	M(0,3) += 0.0; //No cross term between x0 and yp
-	M(1,0) += pow(1.0/sigma,2) * ztrue[idx];
-	M(1,1) += pow(ztrue[idx]/sigma,2);
-	M(1,2) += 0.0;
-	M(1,3) += 0.0;
-	M(2,0) += 0.0;
-	M(2,1) += 0.0;
-	M(2,2) += pow(1.0/sigma,2);
-	M(2,3) += pow(1.0/sigma,2) * ztrue[idx];
-	M(3,0) += 0.0;
-	M(3,1) += 0.0;
-	M(3,2) += pow(1.0/sigma,2) * ztrue[idx];
-	M(3,3) += pow(ztrue[idx]/sigma,2);
-	  
-	b(0) += xsmear[idx] / pow(sigma,2);
-	b(1) += ztrue[idx] * xsmear[idx] / pow(sigma,2);
-	b(2) += ysmear[idx] / pow(sigma,2);
-	b(3) += ztrue[idx] * ysmear[idx] / pow(sigma,2);
-	  
-	btrue(0) += xtrue[idx] / pow(sigma,2);
-	btrue(1) += ztrue[idx] * xtrue[idx] / pow(sigma,2);
-	btrue(2) += ytrue[idx] / pow(sigma,2);
-	btrue(3) += ztrue[idx] * ytrue[idx] / pow(sigma,2);
+    double D = S[c]*Szz[c] - Sz[c]*Sz[c];
+    if( D <= 0.0 ) continue; //all hits at the same z; can't happen with three or more planes
 
-      }
-	
-      if( GEMIDs_unique.size() >= nplanes_min ){
+    //Fit parameters: 0 = x0, 1 = xp, 2 = y0, 3 = yp:
+    double FitTrack[4], TrueTrack[4];
+    FitTrack[0] = (Szz[c]*Sx[c] - Sz[c]*Szx[c])/D;
+    FitTrack[1] = (S[c]*Szx[c] - Sz[c]*Sx[c])/D;
+    FitTrack[2] = (Szz[c]*Sy[c] - Sz[c]*Szy[c])/D;
+    FitTrack[3] = (S[c]*Szy[c] - Sz[c]*Sy[c])/D;
+    TrueTrack[0] = (Szz[c]*Sxt[c] - Sz[c]*Szxt[c])/D;
+    TrueTrack[1] = (S[c]*Szxt[c] - Sz[c]*Sxt[c])/D;
+    TrueTrack[2] = (Szz[c]*Syt[c] - Sz[c]*Szyt[c])/D;
+    TrueTrack[3] = (S[c]*Szyt[c] - Sz[c]*Syt[c])/D;
 
-	TMatrixD Minv = M.Invert();
-	TVectorD FitTrack = Minv * b;
-	TVectorD TrueTrack = Minv * btrue;
+    int hit0 = order[first[c]].second; //first hit of the track
 
-	Toutput.ntracks++;
-	
-	Toutput.TrackTID.push_back(track);
-	Toutput.TrackPID.push_back( PID );
-	Toutput.TrackMID.push_back( MID );
-	Toutput.NumHits.push_back( nhittrk );
-	Toutput.NumPlanes.push_back( GEMIDs_unique.size() );
-	  
-	//Everything should already be expressed in the desired units in gemdata:
-	Toutput.TrackX.push_back( TrueTrack(0) );
-	Toutput.TrackXp.push_back( TrueTrack(1) );
-	Toutput.TrackY.push_back( TrueTrack(2) );
-	Toutput.TrackYp.push_back( TrueTrack(3) );
-
-	Toutput.TrackXfit.push_back( FitTrack(0) );
-	Toutput.TrackXpfit.push_back( FitTrack(1) );
-	Toutput.TrackYfit.push_back( FitTrack(2) );
-	Toutput.TrackYpfit.push_back( FitTrack(3) );
-
-	int ndf = 0;
-	double chi2 = 0.0, chi2_true = 0.0;
-	//Compute chi^2 and focal plane times projected to local origin:
-	for(int idx = 0; idx<nhittrk; idx++){
-
-	  //tfp is hit time corrected for time of flight: ztrue has units of meters, while hittime has units of ns
-	  //convert z to meters, then the tof correction term will have units of seconds, so we need to divide by _T_UNIT to get ns!
-	  double tfp = hittime[idx] - ztrue[idx]*sqrt( 1.0 + pow(TrueTrack(1),2)+pow(TrueTrack(3),2) ) / (beta[idx]*c_light)*(_L_UNIT/_T_UNIT);
-	    
-	  chi2 += pow( (xsmear[idx] - (FitTrack(0) + FitTrack(1)*ztrue[idx] ) )/sigma, 2 );
-	  chi2 += pow( (ysmear[idx] - (FitTrack(2) + FitTrack(3)*ztrue[idx] ) )/sigma, 2 );
+    double pavg = 0.0;
+    double polx_avg = 0.0, poly_avg = 0.0, polz_avg = 0.0; //compute average track polarization for each track.
+    double tavg = 0.0;
+    double chi2 = 0.0, chi2_true = 0.0;
 
-	  chi2_true += pow( (xtrue[idx] - (TrueTrack(0) + TrueTrack(1)*ztrue[idx] ) )/sigma, 2 );
-	  chi2_true += pow( (ytrue[idx] - (TrueTrack(2) + TrueTrack(3)*ztrue[idx] ) )/sigma, 2 );
+    //path length per unit z, for the time of flight correction:
+    double dsdz = sqrt( 1.0 + pow(TrueTrack[1],2)+pow(TrueTrack[3],2) );
 
-	  tavg += tfp/double(nhittrk);
+    for(int k=first[c]; k<first[c+1]; k++){
+      int hit = order[k].second;
 
-	  ndf += 2;
-	}
+      pavg += gemdata.p[hit];
+      polx_avg += gemdata.polx[hit];
+      poly_avg += gemdata.poly[hit];
+      polz_avg += gemdata.polz[hit];
 
-	Toutput.TrackSx.push_back( polx_avg );
-	Toutput.TrackSy.push_back( poly_avg );
-	Toutput.TrackSz.push_back( polz_avg );
-	
-	Toutput.Chi2fit.push_back( chi2 );
-	Toutput.Chi2true.push_back( chi2_true );
-	Toutput.NDF.push_back( ndf - 4 );
-	Toutput.TrackT.push_back( tavg ); //tavg already in ns!
+      //tfp is hit time corrected for time of flight: z has units of meters, while hittime has units of ns
+      //convert z to meters, then the tof correction term will have units of seconds, so we need to divide by _T_UNIT to get ns!
+      tavg += ts[k] - zs[k]*dsdz / (betas[k]*c_light)*(_L_UNIT/_T_UNIT);
 
-	Toutput.TrackP.push_back( pavg ); //pavg already in GeV!
+      chi2 += pow( (xs[k] - (FitTrack[0] + FitTrack[1]*zs[k] ) )/sigma, 2 );
+      chi2 += pow( (ys[k] - (FitTrack[2] + FitTrack[3]*zs[k] ) )/sigma, 2 );
 
-	Toutput.otridx.push_back( gemdata.otridx[HitList[track][0]] );
-	Toutput.ptridx.push_back( gemdata.ptridx[HitList[track][0]] );
-	Toutput.sdtridx.push_back( gemdata.sdtridx[HitList[track][0]] );
-      }
+      chi2_true += pow( (xt[k] - (TrueTrack[0] + TrueTrack[1]*zs[k] ) )/sigma, 2 );
+      chi2_true += pow( (yt[k] - (TrueTrack[2] + TrueTrack[3]*zs[k] ) )/sigma, 2 );
     }
+
+    pavg /= double(nhittrk);
+    polx_avg /= double(nhittrk);
+    poly_avg /= double(nhittrk);
+    polz_avg /= double(nhittrk);
+    tavg /= double(nhittrk);
+
+    Toutput.ntracks++;
+
+    Toutput.TrackTID.push_back( order[first[c]].first );
+    Toutput.TrackPID.push_back( gemdata.pid[hit0] );
+    Toutput.TrackMID.push_back( gemdata.mid[hit0] );
+    Toutput.NumHits.push_back( nhittrk );
+    Toutput.NumPlanes.push_back( nplanetrk );
+
+    //Everything should already be expressed in the desired units in gemdata:
+    Toutput.TrackX.push_back( TrueTrack[0] );
+    Toutput.TrackXp.push_back( TrueTrack[1] );
+    Toutput.TrackY.push_back( TrueTrack[2] );
+    Toutput.TrackYp.push_back( TrueTrack[3] );
+
+    Toutput.TrackXfit.push_back( FitTrack[0] );
+    Toutput.TrackXpfit.push_back( FitTrack[1] );
+    Toutput.TrackYfit.push_back( FitTrack[2] );
+    Toutput.TrackYpfit.push_back( FitTrack[3] );
+
+    Toutput.TrackSx.push_back( polx_avg );
+    Toutput.TrackSy.push_back( poly_avg );
+    Toutput.TrackSz.push_back( polz_avg );
+
+    Toutput.Chi2fit.push_back( chi2 );
+    Toutput.Chi2true.push_back( chi2_true );
+    Toutput.NDF.push_back( 2*nhittrk - 4 );
+    Toutput.TrackT.push_back( tavg ); //tavg already in ns!
+
+    Toutput.TrackP.push_back( pavg ); //pavg already in GeV!
+
+    Toutput.otridx.push_back( gemdata.otridx[hit0] );
+    Toutput.ptridx.push_back( gemdata.ptridx[hit0] );
+    Toutput.sdtridx.push_back( gemdata.sdtridx[hit0] );
   }
 }
 
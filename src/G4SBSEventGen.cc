@@ -11,6 +11,7 @@
 #include "G4RotationMatrix.hh"
 #include "G4SBSInelastic.hh"
 #include "G4SBSDIS.hh"
+#include "G4SBSRunCache.hh"
 #include "G4PionPlus.hh"
 #include "G4PionMinus.hh"
 #include "G4KaonPlus.hh"
@@ -301,6 +302,10 @@ void G4SBSEventGen::Initialize(){
     fGenVol = 1.0;
   }
   
+  if( fKineType == G4SBS::kPhaseSpace ){ //Replay of a phase space file: read it now (only if not already loaded):
+    G4SBSPhaseSpace::GetPhaseSpace()->LoadReplayFile();
+  }
+  
   if( fRejectionSamplingFlag ){
     InitializeRejectionSampling();
   }
@@ -534,6 +539,9 @@ bool G4SBSEventGen::GenerateEvent(){
   case G4SBS::kPionPhoto:
     success = GeneratePionPhotoproduction( thisnucl, ei, ni );
     break;
+  case G4SBS::kPhaseSpace:
+    success = GeneratePhaseSpace();
+    break;
   default:
     success = GenerateElastic( thisnucl, ei, ni );
     break;
@@ -2624,6 +2632,11 @@ ev_t G4SBSEventGen::GetEventData(){
   //AJRP: moved genvol calculation to Initialize()
   double thisrate = fSigma*fLumi*fGenVol/fNevt;
 
+  if( fKineType == G4SBS::kPhaseSpace ){
+    //Each replayed event stands for 1/(fraction of stage-1 events with recorded particles) beam electrons:
+    thisrate = fBeamCur/(e_SI*ampere*second) * G4SBSPhaseSpace::GetPhaseSpace()->GetReplayFraction()/fNevt;
+  }
+
   //Again: moved genvol calculation to Initialize()
   // if( fKineType == kSIDIS ){ //Then fSigma is dsig/dOmega_e dE'_e dOmega_h dE'_h
   //   genvol *= (fPhMax_had - fPhMin_had)*( cos(fThMin_had) - cos(fThMax_had) );
@@ -2773,6 +2786,12 @@ void G4SBSEventGen::InitializeRejectionSampling(){
   if( fRejectionSamplingFlag ){
   
     fInitialized = true;
+
+    //Max. weight of a previous job with the same configuration (/g4sbs/cachedir):
+    if( G4SBSRunCache::GetCache()->GetMaxWeight( fMaxWeight ) ){
+      G4cout << "Initialized Rejection sampling from run cache" << G4endl;
+      return;
+    }
   
     G4cout << "Initializing rejection sampling..." << G4endl;
   
@@ -2801,6 +2820,8 @@ void G4SBSEventGen::InitializeRejectionSampling(){
       G4cout << "Initialized Rejection sampling, max. weight = " << fMaxWeight/(nanobarn/steradian) << " nb/sr" << G4endl;
     }
     fRejectionSamplingFlag = true;
+
+    G4SBSRunCache::GetCache()->StoreMaxWeight( fMaxWeight );
   }
 }
 
@@ -2820,6 +2841,25 @@ void G4SBSEventGen::UpdateCosmicsCeilingRadius(){
   fCosmicsCeilingRadius = min(50.0*m-fabs(fCosmPointer.x())-fPointerZoneRadiusMax,50.0*m-fabs(fCosmPointer.z())-fPointerZoneRadiusMax);
 }
 
+bool G4SBSEventGen::GeneratePhaseSpace(){
+  G4SBSPhaseSpace::GetPhaseSpace()->NextEvent( fPhaseSpaceEvent );
+
+  fQ2 = 0.0;
+  fW2 = 0.0;
+  fxbj = 0.0;
+  fElectronP = G4ThreeVector();
+  fElectronE = 0.0;
+  fNucleonP = G4ThreeVector();
+  fNucleonE = 0.0;
+  fVert = G4ThreeVector();
+
+  fSigma = 1.0;
+  fApar = 0.0;
+  fAperp = 0.0;
+  
+  return true;
+}
+
 bool G4SBSEventGen::GenerateCosmics(){
   //G4cout << "Cosmics generated !" << endl;
   
@@ -0,0 +1,193 @@
+#include "G4SBSGEMDigitizer.hh"
+#include "G4SBSGEMSD.hh"
+#include "G4SBSRandom.hh"
+
+#include "TTree.h"
+#include "TString.h"
+
+#include "Randomize.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4ios.hh"
+
+#include <cmath>
+#include <algorithm>
+
+G4SBSGEMDigitizer *G4SBSGEMDigitizer::gSingleton = NULL;
+
+void G4SBSGEMdigioutput::Clear(){
+  nstrips = 0;
+  module.clear();
+  axis.clear();
+  strip.clear();
+  for( G4int isamp=0; isamp<G4SBSGEMDigitizer::kNsamples; isamp++ ) adc[isamp].clear();
+}
+
+G4SBSGEMDigitizer::G4SBSGEMDigitizer(){
+  gSingleton = this;
+
+  fEnabled = false;
+  fKeepHits = true;
+
+  //Defaults: SBS GEMs with 0.4 mm strip pitch read out by APV25 cards:
+  fPitch = 0.4*mm;
+  fSpread = 0.3*mm;
+  fADCperkeV = 4000.0;
+  fNoise = 20.0;
+  fThreshold = 100.0;
+  fTimeOffset = 0.0*ns;
+  fTau = 56.0*ns;
+  fSampleTime = 25.0*ns;
+  fADCmax = 4095;
+
+  fNevents = fNhits = fNstrips = 0;
+}
+
+G4SBSGEMDigitizer::~G4SBSGEMDigitizer(){
+  ;
+}
+
+G4SBSGEMDigitizer *G4SBSGEMDigitizer::GetDigitizer(){
+  if( gSingleton == NULL ){
+    gSingleton = new G4SBSGEMDigitizer();
+  }
+  return gSingleton;
+}
+
+void G4SBSGEMDigitizer::BeginOfRun(){
+  fNevents = fNhits = fNstrips = 0;
+
+  if( !fEnabled ) return;
+
+  G4cout << "GEM digitization: pitch = " << fPitch/mm << " mm, charge spread = " << fSpread/mm << " mm, "
+	 << fADCperkeV << " ADC/keV, noise = " << fNoise << " ADC, zero suppression at " << fThreshold << " ADC" << G4endl;
+  if( !fKeepHits ){
+    G4cout << "GEM digitization: writing only the truth variables of the GEM hits" << G4endl;
+  }
+}
+
+void G4SBSGEMDigitizer::EndOfRun(){
+  if( !fEnabled ) return;
+
+  G4cout << "GEM digitization: " << fNhits << " hits in " << fNevents << " events fired " << fNstrips
+	 << " strips above the zero-suppression threshold" << G4endl;
+}
+
+void G4SBSGEMDigitizer::Branch( TTree *tree, G4String SDname ){
+  if( !fEnabled ) return;
+
+  TString branch_prefix = SDname.data();
+  TString branch_name;
+
+  branch_prefix.ReplaceAll("/",".");
+
+  G4SBSGEMdigioutput &digi = fDigiData[SDname];
+  digi.Clear();
+
+  tree->Branch( branch_name.Format( "%s.dighit.nstrips", branch_prefix.Data() ), &(digi.nstrips) );
+  tree->Branch( branch_name.Format( "%s.dighit.module", branch_prefix.Data() ), &(digi.module) );
+  tree->Branch( branch_name.Format( "%s.dighit.axis", branch_prefix.Data() ), &(digi.axis) );
+  tree->Branch( branch_name.Format( "%s.dighit.strip", branch_prefix.Data() ), &(digi.strip) );
+  for( G4int isamp=0; isamp<kNsamples; isamp++ ){
+    tree->Branch( branch_name.Format( "%s.dighit.adc_%d", branch_prefix.Data(), isamp ), &(digi.adc[isamp]) );
+  }
+}
+
+void G4SBSGEMDigitizer::AddCharge( G4int plane, G4int axis, G4int nstrips, G4double u, G4double q, G4double t ){
+  //Strips within 3 sigma of the charge centroid u, measured from the edge of the plane:
+  G4int first = std::max( 0, G4int( floor( (u - 3.0*fSpread)/fPitch ) ) );
+  G4int last = std::min( nstrips-1, G4int( floor( (u + 3.0*fSpread)/fPitch ) ) );
+
+  for( G4int istrip=first; istrip<=last; istrip++ ){
+    G4double frac = 0.5*( erf( ((istrip+1)*fPitch - u)/(sqrt(2.0)*fSpread) ) - erf( (istrip*fPitch - u)/(sqrt(2.0)*fSpread) ) );
+    if( frac <= 0.0 ) continue;
+
+    G4long key = ( G4long(2*plane + axis) << 20 ) + istrip;
+
+    std::pair<map<G4long,G4int>::iterator, bool> newstrip = fStripIndex.insert( std::make_pair( key, G4int(fStripKey.size()) ) );
+    if( newstrip.second ){
+      fStripKey.push_back( key );
+      fStripSamples.resize( fStripSamples.size() + kNsamples, 0.0 );
+    }
+
+    G4double *samples = &(fStripSamples[kNsamples*newstrip.first->second]);
+
+    //APV25 CR-RC response, normalized to 1 at its peak (dt = fTau):
+    for( G4int isamp=0; isamp<kNsamples; isamp++ ){
+      G4double dt = fTimeOffset + isamp*fSampleTime - t;
+      if( dt > 0.0 ) samples[isamp] += q*frac*(dt/fTau)*exp(1.0 - dt/fTau);
+    }
+  }
+}
+
+void G4SBSGEMDigitizer::Digitize( G4String SDname, const G4SBSGEMSD *sd, const G4SBSGEMoutput &gd ){
+  if( !fEnabled ) return;
+
+  G4SBSGEMdigioutput &digi = fDigiData[SDname];
+  digi.Clear();
+
+  fStripIndex.clear();
+  fStripKey.clear();
+  fStripSamples.clear();
+
+  fNevents++;
+
+  for( size_t ihit=0; ihit<gd.edep.size(); ihit++ ){
+    G4int plane = gd.plane[ihit];
+
+    G4ThreeVector center;
+    G4double width, height;
+    if( !sd->GetPlaneGeometry( plane, center, width, height ) ) continue;
+
+    fNhits++;
+
+    G4int nx = G4int( height/fPitch ); //X strips measure the vertical coordinate
+    G4int ny = G4int( width/fPitch );
+
+    //Hit coordinates are in "TRANSPORT" convention (x = -local y, y = local x), in meters; convert
+    //them to distances from the edges of the plane:
+    G4double uin = gd.xin[ihit]*m + center.y() + height/2.0;
+    G4double vin = gd.yin[ihit]*m - center.x() + width/2.0;
+    G4double uout = gd.xout[ihit]*m + center.y() + height/2.0;
+    G4double vout = gd.yout[ihit]*m - center.x() + width/2.0;
+
+    //Charge of each axis, spread uniformly along the track segment in the drift gap:
+    G4double q = 0.5*fADCperkeV*gd.edep[ihit]*GeV/keV;
+    G4double t = gd.t[ihit]*ns;
+
+    G4double length = sqrt( pow(uout-uin,2) + pow(vout-vin,2) );
+    G4int nsub = std::min( 20, G4int( length/fPitch ) + 1 );
+
+    for( G4int isub=0; isub<nsub; isub++ ){
+      G4double f = (isub + 0.5)/G4double(nsub);
+      AddCharge( plane, 0, nx, uin + f*(uout-uin), q/nsub, t );
+      AddCharge( plane, 1, ny, vin + f*(vout-vin), q/nsub, t );
+    }
+  }
+
+  CLHEP::HepRandomEngine *engine = G4SBSRandom::GetRandom()->GetEngine( G4SBSRandom::kDigitization );
+
+  //Strips in order of plane, axis and strip number:
+  for( map<G4long,G4int>::iterator it=fStripIndex.begin(); it!=fStripIndex.end(); ++it ){
+    G4double *samples = &(fStripSamples[kNsamples*it->second]);
+
+    G4int adc[kNsamples];
+    G4int adcmax = 0;
+    for( G4int isamp=0; isamp<kNsamples; isamp++ ){
+      G4double sample = samples[isamp];
+      if( fNoise > 0.0 ) sample += CLHEP::RandGauss::shoot( engine, 0.0, fNoise );
+      adc[isamp] = std::min( fADCmax, G4int( floor( sample + 0.5 ) ) );
+      adcmax = std::max( adcmax, adc[isamp] );
+    }
+
+    if( adcmax < fThreshold ) continue;
+
+    G4long key = it->first;
+    digi.module.push_back( G4int( (key >> 20)/2 ) );
+    digi.axis.push_back( G4int( (key >> 20)%2 ) );
+    digi.strip.push_back( G4int( key & 0xFFFFF ) );
+    for( G4int isamp=0; isamp<kNsamples; isamp++ ) digi.adc[isamp].push_back( adc[isamp] );
+    digi.nstrips++;
+  }
+
+  fNstrips += digi.nstrips;
+}
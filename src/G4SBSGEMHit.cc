@@ -19,6 +19,7 @@ G4SBSGEMHit::G4SBSGEMHit()
   outpos = G4ThreeVector(); 
   globalpos = G4ThreeVector(); 
   GEMID = -1; xp = -1e9; yp = -1e9;
+  weight = 1.0;
 }
 
 G4SBSGEMHit::~G4SBSGEMHit()
@@ -42,6 +43,7 @@ G4SBSGEMHit::G4SBSGEMHit(const G4SBSGEMHit &right)
   edep = right.edep;
   hittime = right.hittime;
   beta = right.beta;
+  weight = right.weight;
   otridx = right.otridx;
   ptridx = right.ptridx;
   sdtridx = right.sdtridx;
@@ -64,6 +66,7 @@ const G4SBSGEMHit& G4SBSGEMHit::operator=(const G4SBSGEMHit &right)
   edep = right.edep;
   hittime = right.hittime;
   beta = right.beta;
+  weight = right.weight;
 
   otridx = right.otridx;
   ptridx = right.ptridx;
@@ -1,4 +1,5 @@
 #include "G4SBSGEMSD.hh"
+#include "G4SBSProfiler.hh"
 #include "G4SBSGEMHit.hh"
 
 #include "G4VPhysicalVolume.hh"
@@ -26,6 +27,8 @@ G4SBSGEMSD::G4SBSGEMSD( G4String name, G4String colname )
 
     SDtracks.Clear();
     SDtracks.SetSDname(name);
+
+    fProfileID = G4SBSProfiler::GetProfiler()->RegisterSD( name );
 }
 
 G4SBSGEMSD::~G4SBSGEMSD()
@@ -40,6 +43,7 @@ void G4SBSGEMSD::Initialize(G4HCofThisEvent*)
 
 G4bool G4SBSGEMSD::ProcessHits(G4Step* aStep, G4TouchableHistory*)
 {
+  G4SBSProfiler::Scope prof( fProfileID );
 
   // G4cout << "Transporation magnetic moment enabled = "
   // 	 << G4Transportation::EnableUseMagneticMoment(true) << G4endl;
@@ -122,6 +126,7 @@ G4bool G4SBSGEMSD::ProcessHits(G4Step* aStep, G4TouchableHistory*)
   hit->SetGEMID(copyID);
   hit->SetBeta( aStep->GetPreStepPoint()->GetBeta() ); //v/c of particle prior to the step
   hit->SetHittime( aStep->GetPreStepPoint()->GetGlobalTime() );
+  hit->SetWeight( aStep->GetTrack()->GetWeight() );
 
   G4Track *aTrack = aStep->GetTrack();
 
@@ -154,3 +159,20 @@ void G4SBSGEMSD::DrawAll()
 void G4SBSGEMSD::PrintAll()
 {
 } 
+
+void G4SBSGEMSD::SetPlaneGeometry( G4int plane, G4ThreeVector center, double width, double height )
+{
+  fPlaneCenter[plane] = center;
+  fPlaneSize[plane] = make_pair( width, height );
+}
+
+G4bool G4SBSGEMSD::GetPlaneGeometry( G4int plane, G4ThreeVector &center, double &width, double &height ) const
+{
+  map<G4int, G4ThreeVector>::const_iterator it = fPlaneCenter.find( plane );
+  if( it == fPlaneCenter.end() ) return false;
+
+  center = it->second;
+  width = fPlaneSize.find( plane )->second.first;
+  height = fPlaneSize.find( plane )->second.second;
+  return true;
+}
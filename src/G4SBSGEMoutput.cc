@@ -53,9 +53,11 @@ void G4SBSGEMoutput::Clear(){
   p.clear();
   edep.clear();
   beta.clear();
+  weight.clear();
   otridx.clear();
   ptridx.clear();
   sdtridx.clear();
+  bkgd.clear();
 
   ParticleHistory.Clear();
 }
@@ -15,6 +15,7 @@
 
 #include "G4SBSToscaField.hh"
 #include "G4SBSRun.hh"
+#include "G4SBSProfiler.hh"
 #include <sys/stat.h>
 #include <fstream>
 
@@ -33,6 +34,7 @@ G4SBSGlobalField::~G4SBSGlobalField() {
 }
 
 void G4SBSGlobalField::GetFieldValue(const double Point[3],double *Bfield) const {
+  G4SBSProfiler::Scope prof( G4SBSProfiler::kField );
 
   unsigned int i;
   double Bfield_onemap[3];
@@ -6,9 +6,15 @@
 #include <TH1F.h>
 #include <TH2F.h>
 #include <TClonesArray.h>
+#include <TList.h>
 
 #include "G4SBSGlobalField.hh"
 #include "G4SBSRun.hh"
+#include "G4SBSPileup.hh"
+#include "G4SBSTrigger.hh"
+#include "G4SBSGEMDigitizer.hh"
+#include "G4SBSImportance.hh"
+#include "G4SBSProfiler.hh"
 #include "G4SBSIO.hh"
 #include "G4SBSCalSD.hh"
 #include "G4SBSECalSD.hh"
@@ -18,6 +24,19 @@
 #include <assert.h>
 #include "sbstypes.hh"
 
+#include <cmath>
+
+//Compact output (/g4sbs/compactoutput): schema version, and rounding steps of positions (m) and times (ns).
+//The steps are powers of 2, so rounded positions below 256 m and times below 262 us are exact in float32,
+//with their low mantissa bits zero, which compresses well:
+static const int kCompactVersion = 1;
+static const double kCompactPosStep = 1.0/65536.0; //15 micron, well below the GEM resolution
+static const double kCompactTimeStep = 1.0/64.0; //16 ps
+
+static void RoundToStep( vector<double> &v, double step ){
+  for( size_t i=0; i<v.size(); i++ ) v[i] = floor( v[i]/step + 0.5 )*step;
+}
+
 G4SBSIO::G4SBSIO(){
   fTree = NULL;
   //InitializeTree(); //We want experiment-dependent ROOT tree! Don't invoke until after fdetcon->ConstructAll() has been invoked!
@@ -68,6 +87,7 @@ G4SBSIO::G4SBSIO(){
 
   //Set SD track data recording to OFF by default:
   fKeepAllPulseShape = false;
+  fSparsePulseShape = false;
   fKeepPulseShape.clear();
   
   Esum_histograms = NULL;
@@ -85,9 +105,25 @@ G4SBSIO::G4SBSIO(){
   fUsingCerenkov = false;
 
   fWritePortableFieldMaps = false;
+
+  fSparseOutput = false;
+  fCompactOutput = false;
+  fSDTrees.clear();
+
+  fStaged.TargPol = fStaged.TargThetaSpin = fStaged.TargPhiSpin = 0.0;
+  fStaged.BeamPol = fStaged.BeamThetaSpin = fStaged.BeamPhiSpin = 0.0;
+  fStaged.AUT_Collins = fStaged.AUT_Sivers = 0.0;
+  fStaged.AUT_Collins_min = fStaged.AUT_Sivers_min = 0.0;
+  fStaged.AUT_Collins_max = fStaged.AUT_Sivers_max = 0.0;
+
+  fAsyncWrite = false;
+  fFillPending = false;
+  fWriterStop = false;
 }
 
 G4SBSIO::~G4SBSIO(){
+  StopWriter();
+
   if( fTree ){delete fTree;}
   fTree = NULL;
 
@@ -100,6 +136,7 @@ G4SBSIO::~G4SBSIO(){
 
 void G4SBSIO::SetGEMData( G4String SDname, G4SBSGEMoutput gd ){
   GEMdata[SDname] = gd;
+  if( fCompactOutput ) QuantizeGEM( GEMdata[SDname] );
 }
 
 void G4SBSIO::SetTrackData( G4String SDname, G4SBSTrackerOutput td ){
@@ -108,6 +145,7 @@ void G4SBSIO::SetTrackData( G4String SDname, G4SBSTrackerOutput td ){
 
 void G4SBSIO::SetCalData( G4String SDname, G4SBSCALoutput cd ){
   CALdata[SDname] = cd;
+  if( fCompactOutput ) QuantizeCAL( CALdata[SDname] );
 }
 
 void G4SBSIO::SetRICHData( G4String SDname, G4SBSRICHoutput rd ){
@@ -122,6 +160,11 @@ void G4SBSIO::SetSDtrackData( G4String SDname, G4SBSSDTrackOutput td ){
   sdtrackdata[SDname] = td;
 }
 
+void G4SBSIO::SetAllSDtrackData( G4SBSSDTrackOutput sd ){
+  allsdtrackdata = sd;
+  if( fCompactOutput ) QuantizeSDtracks( allsdtrackdata );
+}
+
 void G4SBSIO::SetBDData(G4String SDname,G4SBSBDoutput data){
    BDdata[SDname] = data;
 }
@@ -147,6 +190,8 @@ void G4SBSIO::SetGEnTargetData_3He(G4String SDname,G4SBSTargetoutput data){
 }
 
 void G4SBSIO::InitializeTree(){
+  StopWriter(); //the previous tree must be completely filled before its file is closed
+
   if( fFile ){
     fFile->Close();
     delete fFile;
@@ -163,6 +208,21 @@ void G4SBSIO::InitializeTree(){
     
   fTree = new TTree("T", "Geant4 SBS Simulation");
 
+  //Sparse output mode: the main tree only holds a per-event index of the sensitive detectors with hits, and
+  //the hit data of each SD go to a separate payload tree, filled only for events in which that SD has hits:
+  fSDTrees.clear(); //any leftover payload trees were owned by (and deleted with) the previous file
+  fSparseSDnames.clear();
+
+  fCompactAddr.clear(); //the branches using them were deleted with the previous tree
+  G4SBSRun::GetRun()->GetData()->SetCompactOutput( fCompactOutput ? kCompactVersion : 0,
+						   fCompactOutput ? kCompactPosStep : 0.0, fCompactOutput ? kCompactTimeStep : 0.0 );
+  
+  if( fSparseOutput ){
+    fTree->Branch( "sparse.nsd", &fSparseNSD, "sparse.nsd/I" );
+    fTree->Branch( "sparse.sd", &fSparseSDindex );
+    fTree->Branch( "sparse.entry", &fSparseEntry );
+  }
+
   // Let's stop changing the ev_t data structure, because it screws up reading of the tree in the future. If we want to store any other event-specific information,
   // then let's add dedicated tree branches to hold said information:
   fTree->Branch("ev", &evdata, "count/D:rate/D:solang/D:sigma/D:W2/D:xbj/D:Q2/D:th/D:ph/D:Aperp/D:Apar/D:Pt/D:Pl/D:vx/D:vy/D:vz/D:ep/D:np/D:epx/D:epy/D:epz/D:npx/D:npy/D:npz/D:nth/D:nph/D:pmperp/D:pmpar/D:pmparsm/D:z/D:phperp/D:phih/D:phiS/D:thetaS/D:MX2/D:Sx/D:Sy/D:Sz/D:s/D:t/D:u/D:costhetaCM/D:Egamma/D:nucl/I:fnucl/I:hadr/I:earmaccept/I:harmaccept/I");
@@ -178,6 +238,9 @@ void G4SBSIO::InitializeTree(){
   fTree->Branch( "BeamThetaSpin", &fBeamThetaSpin, "BeamThetaSpin/D" );
   fTree->Branch( "BeamPhiSpin", &fBeamPhiSpin, "BeamPhiSpin/D" );
 
+  //Emulated trigger decision (only if /g4sbs/trigger true):
+  G4SBSTrigger::GetTrigger()->Branch( fTree );
+
   if( fKineType == G4SBS::kSIDIS ){ //Create branches for Collins and Sivers asymmetries (eventually others, like quark flavor contributions to cross sections/asymmetries/etc)
     fTree->Branch("AUT_Collins", &fAUT_Collins, "AUT_Collins/D");
     fTree->Branch("AUT_Sivers", &fAUT_Sivers, "AUT_Sivers/D" );
@@ -287,6 +350,8 @@ void G4SBSIO::InitializeTree(){
   if( fUseSIMC ){
     BranchSIMC();
   }
+
+  if( fAsyncWrite ) StartWriter();
   
   return;
 }
@@ -297,10 +362,158 @@ void G4SBSIO::FillTree(){
     return; 
   }
 
+  //The writer is normally done already (see G4SBSEventAction::EndOfEventAction), as the SD data of this event
+  //have been set since:
+  WaitForWriter();
+
+  //Publish the generator data of this event to the tree buffers:
+  evdata = fStaged.evdata;
+  Primaries = fStaged.Primaries;
+  SIMCprimaries = fStaged.SIMCprimaries;
+  fTargPol = fStaged.TargPol;
+  fTargThetaSpin = fStaged.TargThetaSpin;
+  fTargPhiSpin = fStaged.TargPhiSpin;
+  fBeamPol = fStaged.BeamPol;
+  fBeamThetaSpin = fStaged.BeamThetaSpin;
+  fBeamPhiSpin = fStaged.BeamPhiSpin;
+  fAUT_Collins = fStaged.AUT_Collins;
+  fAUT_Sivers = fStaged.AUT_Sivers;
+  fAUT_Collins_min = fStaged.AUT_Collins_min;
+  fAUT_Sivers_min = fStaged.AUT_Sivers_min;
+  fAUT_Collins_max = fStaged.AUT_Collins_max;
+  fAUT_Sivers_max = fStaged.AUT_Sivers_max;
+
+  if( fWriter.joinable() ){
+    std::lock_guard<std::mutex> lock( fWriterMutex );
+    fFillPending = true;
+    fWriterCV.notify_all();
+    return;
+  }
+
+  FillTreeNow();
+}
+
+void G4SBSIO::FillTreeNow(){
+  if( fSparseOutput ){
+    fSparseSDindex.clear();
+    fSparseEntry.clear();
+
+    for( G4int isd=0; isd<G4int(fSparseSDnames.size()); isd++ ){
+      G4String SDname = fSparseSDnames[isd];
+      if( GetNhitsSD( SDname ) > 0 ){
+	TTree *tree = fSDTrees[SDname];
+	fSparseSDindex.push_back( isd );
+	fSparseEntry.push_back( tree->GetEntries() );
+	tree->Fill();
+      }
+    }
+    fSparseNSD = fSparseSDindex.size();
+  }
+  
   fTree->Fill();
 }
 
+//Asynchronous output (/g4sbs/asyncwrite): a single writer thread fills the tree(s) from the tree buffers of
+//G4SBSIO, which are not touched by the tracking thread until WaitForWriter() returns. One event can thus be
+//written while the next is tracked; if writing is slower than tracking, the tracking thread waits at the end
+//of the next event.
+void G4SBSIO::WaitForWriter(){
+  if( !fWriter.joinable() ) return;
+
+  std::unique_lock<std::mutex> lock( fWriterMutex );
+  fWriterCV.wait( lock, [this]{ return !fFillPending; } );
+}
+
+void G4SBSIO::StartWriter(){
+  if( fWriter.joinable() ) return;
+
+  //Make ROOT's global state (type and streamer info, gDirectory) safe for use from more than one thread:
+  ROOT::EnableThreadSafety();
+
+  fFillPending = false;
+  fWriterStop = false;
+  fWriter = std::thread( &G4SBSIO::WriterLoop, this );
+
+  G4cout << "Asynchronous output: ROOT tree filled in a writer thread" << G4endl;
+}
+
+void G4SBSIO::StopWriter(){
+  if( !fWriter.joinable() ) return;
+
+  {
+    std::lock_guard<std::mutex> lock( fWriterMutex );
+    fWriterStop = true;
+  }
+  fWriterCV.notify_all();
+  fWriter.join(); //the writer fills a pending event before it stops
+}
+
+void G4SBSIO::WriterLoop(){
+  std::unique_lock<std::mutex> lock( fWriterMutex );
+
+  while( true ){
+    fWriterCV.wait( lock, [this]{ return fFillPending || fWriterStop; } );
+
+    if( !fFillPending ) break;
+
+    lock.unlock();
+    FillTreeNow();
+    lock.lock();
+
+    fFillPending = false;
+    fWriterCV.notify_all();
+  }
+}
+
+TTree *G4SBSIO::GetSDTree( G4String SDname ){
+  //In the default mode, all SD branches go to the main tree:
+  if( !fSparseOutput ) return fTree;
+
+  map<G4String,TTree*>::iterator it = fSDTrees.find( SDname );
+  if( it != fSDTrees.end() ) return it->second;
+
+  //Payload tree name is "T_" + the branch prefix, with dots replaced by underscores (e.g., T_Earm_BBGEM):
+  TString treename = SDname.data();
+  treename.ReplaceAll("/","_");
+  treename.Prepend("T_");
+  
+  TTree *tree = new TTree( treename.Data(), SDname.data() );
+  fSDTrees[SDname] = tree;
+  fSparseSDnames.push_back( SDname );
+  
+  return tree;
+}
+
+G4int G4SBSIO::GetNhitsSD( G4String SDname ){
+  switch( (fdetcon->SDtype)[SDname] ){
+  case G4SBS::kGEM:
+    return GEMdata[SDname].nhits_GEM;
+  case G4SBS::kCAL:
+    return CALdata[SDname].nhits_CAL;
+  case G4SBS::kRICH:
+    return richdata[SDname].nhits_RICH;
+  case G4SBS::kECAL:
+    return ecaldata[SDname].nhits_ECal;
+  case G4SBS::kBD:
+    return BDdata[SDname].nhits_BD;
+  case G4SBS::kIC:
+    return ICdata[SDname].nhits_IC;
+  case G4SBS::kTarget_GEn_Glass:
+    return genTgtGCdata[SDname].nhits_Target;
+  case G4SBS::kTarget_GEn_Cu:
+    return genTgtCUdata[SDname].nhits_Target;
+  case G4SBS::kTarget_GEn_Al:
+    return genTgtALdata[SDname].nhits_Target;
+  case G4SBS::kTarget_GEn_3He:
+    return genTgt3HEdata[SDname].nhits_Target;
+  default:
+    return 0;
+  }
+}
+
 void G4SBSIO::WriteTree(){
+  StopWriter();
+
   assert( fFile );
   assert( fTree );
   if( !fFile->IsOpen() ){
@@ -311,6 +524,18 @@ void G4SBSIO::WriteTree(){
   fFile->cd();
   fTree->Write("T", TObject::kOverwrite);
 
+  if( fSparseOutput ){
+    //List of SD names in the order of the sparse.sd index, for the reader (see root_macros/g4sbs_sparse_to_dense.C):
+    TList sparse_sdlist;
+    sparse_sdlist.SetOwner(kTRUE);
+    for( G4int isd=0; isd<G4int(fSparseSDnames.size()); isd++ ){
+      G4String SDname = fSparseSDnames[isd];
+      fSDTrees[SDname]->Write( fSDTrees[SDname]->GetName(), TObject::kOverwrite );
+      sparse_sdlist.Add( new TObjString( fSDTrees[SDname]->GetName() ) );
+    }
+    sparse_sdlist.Write( "sparse_sdlist", TObject::kSingleKey | TObject::kOverwrite );
+  }
+
   Esum_histograms->Compress();
   Esum_histograms->Write();
   PulseShape_histograms->Compress();
@@ -318,6 +543,8 @@ void G4SBSIO::WriteTree(){
     
   G4SBSRun::GetRun()->GetData()->Write("run_data", TObject::kOverwrite);
 
+  G4SBSProfiler::GetProfiler()->Write();
+
   // Produce and write out field map graphics
   fGlobalField->DebugField( gendata.thbb, gendata.thsbs );
 
@@ -377,6 +604,12 @@ void G4SBSIO::WriteTree(){
   delete fTree;
   fTree = NULL;
 
+  for( map<G4String,TTree*>::iterator it = fSDTrees.begin(); it != fSDTrees.end(); ++it ){
+    it->second->ResetBranchAddresses();
+    delete it->second;
+  }
+  fSDTrees.clear();
+
   fFile->Close();
   delete fFile;
   fFile = NULL;
@@ -385,6 +618,8 @@ void G4SBSIO::WriteTree(){
 }
 
 void G4SBSIO::BranchGEM(G4String SDname="GEM"){
+  TTree *tree = GetSDTree( SDname );
+
   TString branch_prefix = SDname.data();
   TString branch_name;
   
@@ -392,108 +627,124 @@ void G4SBSIO::BranchGEM(G4String SDname="GEM"){
  
   //Branches with raw GEM data:
   
-  fTree->Branch( branch_name.Format( "%s.hit.nhits", branch_prefix.Data() ), &(GEMdata[SDname].nhits_GEM) );
-  fTree->Branch( branch_name.Format( "%s.hit.plane", branch_prefix.Data() ), &(GEMdata[SDname].plane) );
-  fTree->Branch( branch_name.Format( "%s.hit.strip", branch_prefix.Data() ), &(GEMdata[SDname].strip) );
-  fTree->Branch( branch_name.Format( "%s.hit.x", branch_prefix.Data() ), &(GEMdata[SDname].x) );
-  fTree->Branch( branch_name.Format( "%s.hit.y", branch_prefix.Data() ), &(GEMdata[SDname].y) );
-  fTree->Branch( branch_name.Format( "%s.hit.z", branch_prefix.Data() ), &(GEMdata[SDname].z) );
-  fTree->Branch( branch_name.Format( "%s.hit.polx", branch_prefix.Data() ), &(GEMdata[SDname].polx) );
-  fTree->Branch( branch_name.Format( "%s.hit.poly", branch_prefix.Data() ), &(GEMdata[SDname].poly) );
-  fTree->Branch( branch_name.Format( "%s.hit.polz", branch_prefix.Data() ), &(GEMdata[SDname].polz) );
-  fTree->Branch( branch_name.Format( "%s.hit.t", branch_prefix.Data() ), &(GEMdata[SDname].t) );
-  fTree->Branch( branch_name.Format( "%s.hit.trms", branch_prefix.Data() ), &(GEMdata[SDname].trms) );
-  fTree->Branch( branch_name.Format( "%s.hit.tmin", branch_prefix.Data() ), &(GEMdata[SDname].tmin) );
-  fTree->Branch( branch_name.Format( "%s.hit.tmax", branch_prefix.Data() ), &(GEMdata[SDname].tmax) );
-  // fTree->Branch( branch_name.Format( "%s.hit.dx", branch_prefix.Data() ), &(GEMdata[SDname].dx) );
-  // fTree->Branch( branch_name.Format( "%s.hit.dy", branch_prefix.Data() ), &(GEMdata[SDname].dy) );
-  fTree->Branch( branch_name.Format( "%s.hit.tx", branch_prefix.Data() ), &(GEMdata[SDname].tx) );
-  fTree->Branch( branch_name.Format( "%s.hit.ty", branch_prefix.Data() ), &(GEMdata[SDname].ty) );
-  fTree->Branch( branch_name.Format( "%s.hit.xin", branch_prefix.Data() ), &(GEMdata[SDname].xin) );
-  fTree->Branch( branch_name.Format( "%s.hit.yin", branch_prefix.Data() ), &(GEMdata[SDname].yin) );
-  fTree->Branch( branch_name.Format( "%s.hit.zin", branch_prefix.Data() ), &(GEMdata[SDname].zin) );
-  fTree->Branch( branch_name.Format( "%s.hit.xout", branch_prefix.Data() ), &(GEMdata[SDname].xout) );
-  fTree->Branch( branch_name.Format( "%s.hit.yout", branch_prefix.Data() ), &(GEMdata[SDname].yout) );
-  fTree->Branch( branch_name.Format( "%s.hit.zout", branch_prefix.Data() ), &(GEMdata[SDname].zout) );
-  fTree->Branch( branch_name.Format( "%s.hit.txp", branch_prefix.Data() ), &(GEMdata[SDname].txp) );
-  fTree->Branch( branch_name.Format( "%s.hit.typ", branch_prefix.Data() ), &(GEMdata[SDname].typ) );
-  fTree->Branch( branch_name.Format( "%s.hit.xg", branch_prefix.Data() ), &(GEMdata[SDname].xg) );
-  fTree->Branch( branch_name.Format( "%s.hit.yg", branch_prefix.Data() ), &(GEMdata[SDname].yg) );
-  fTree->Branch( branch_name.Format( "%s.hit.zg", branch_prefix.Data() ), &(GEMdata[SDname].zg) );
-  fTree->Branch( branch_name.Format( "%s.hit.trid", branch_prefix.Data() ), &(GEMdata[SDname].trid) );
-  fTree->Branch( branch_name.Format( "%s.hit.mid", branch_prefix.Data() ), &(GEMdata[SDname].mid) );
-  fTree->Branch( branch_name.Format( "%s.hit.pid", branch_prefix.Data() ), &(GEMdata[SDname].pid) );
-  fTree->Branch( branch_name.Format( "%s.hit.vx", branch_prefix.Data() ), &(GEMdata[SDname].vx) );
-  fTree->Branch( branch_name.Format( "%s.hit.vy", branch_prefix.Data() ), &(GEMdata[SDname].vy) );
-  fTree->Branch( branch_name.Format( "%s.hit.vz", branch_prefix.Data() ), &(GEMdata[SDname].vz) );
-  fTree->Branch( branch_name.Format( "%s.hit.p", branch_prefix.Data() ), &(GEMdata[SDname].p) );
-  fTree->Branch( branch_name.Format( "%s.hit.edep", branch_prefix.Data() ), &(GEMdata[SDname].edep) );
-  fTree->Branch( branch_name.Format( "%s.hit.beta", branch_prefix.Data() ), &(GEMdata[SDname].beta) );
+  tree->Branch( branch_name.Format( "%s.hit.nhits", branch_prefix.Data() ), &(GEMdata[SDname].nhits_GEM) );
+  tree->Branch( branch_name.Format( "%s.hit.plane", branch_prefix.Data() ), &(GEMdata[SDname].plane) );
+  BranchHits( tree, branch_name.Format( "%s.hit.x", branch_prefix.Data() ), &(GEMdata[SDname].x) );
+  BranchHits( tree, branch_name.Format( "%s.hit.y", branch_prefix.Data() ), &(GEMdata[SDname].y) );
+  BranchHits( tree, branch_name.Format( "%s.hit.t", branch_prefix.Data() ), &(GEMdata[SDname].t) );
+  tree->Branch( branch_name.Format( "%s.hit.trid", branch_prefix.Data() ), &(GEMdata[SDname].trid) );
+  tree->Branch( branch_name.Format( "%s.hit.pid", branch_prefix.Data() ), &(GEMdata[SDname].pid) );
+  BranchHits( tree, branch_name.Format( "%s.hit.edep", branch_prefix.Data() ), &(GEMdata[SDname].edep) );
+
+  //With the strip digitization, the remaining hit variables can be dropped (/g4sbs/gemdigitizekeephits false):
+  if( G4SBSGEMDigitizer::GetDigitizer()->KeepHits() ){
+    tree->Branch( branch_name.Format( "%s.hit.strip", branch_prefix.Data() ), &(GEMdata[SDname].strip) );
+    BranchHits( tree, branch_name.Format( "%s.hit.z", branch_prefix.Data() ), &(GEMdata[SDname].z) );
+    BranchHits( tree, branch_name.Format( "%s.hit.polx", branch_prefix.Data() ), &(GEMdata[SDname].polx) );
+    BranchHits( tree, branch_name.Format( "%s.hit.poly", branch_prefix.Data() ), &(GEMdata[SDname].poly) );
+    BranchHits( tree, branch_name.Format( "%s.hit.polz", branch_prefix.Data() ), &(GEMdata[SDname].polz) );
+    BranchHits( tree, branch_name.Format( "%s.hit.trms", branch_prefix.Data() ), &(GEMdata[SDname].trms) );
+    BranchHits( tree, branch_name.Format( "%s.hit.tmin", branch_prefix.Data() ), &(GEMdata[SDname].tmin) );
+    BranchHits( tree, branch_name.Format( "%s.hit.tmax", branch_prefix.Data() ), &(GEMdata[SDname].tmax) );
+    // fTree->Branch( branch_name.Format( "%s.hit.dx", branch_prefix.Data() ), &(GEMdata[SDname].dx) );
+    // fTree->Branch( branch_name.Format( "%s.hit.dy", branch_prefix.Data() ), &(GEMdata[SDname].dy) );
+    BranchHits( tree, branch_name.Format( "%s.hit.tx", branch_prefix.Data() ), &(GEMdata[SDname].tx) );
+    BranchHits( tree, branch_name.Format( "%s.hit.ty", branch_prefix.Data() ), &(GEMdata[SDname].ty) );
+    BranchHits( tree, branch_name.Format( "%s.hit.xin", branch_prefix.Data() ), &(GEMdata[SDname].xin) );
+    BranchHits( tree, branch_name.Format( "%s.hit.yin", branch_prefix.Data() ), &(GEMdata[SDname].yin) );
+    BranchHits( tree, branch_name.Format( "%s.hit.zin", branch_prefix.Data() ), &(GEMdata[SDname].zin) );
+    BranchHits( tree, branch_name.Format( "%s.hit.xout", branch_prefix.Data() ), &(GEMdata[SDname].xout) );
+    BranchHits( tree, branch_name.Format( "%s.hit.yout", branch_prefix.Data() ), &(GEMdata[SDname].yout) );
+    BranchHits( tree, branch_name.Format( "%s.hit.zout", branch_prefix.Data() ), &(GEMdata[SDname].zout) );
+    BranchHits( tree, branch_name.Format( "%s.hit.txp", branch_prefix.Data() ), &(GEMdata[SDname].txp) );
+    BranchHits( tree, branch_name.Format( "%s.hit.typ", branch_prefix.Data() ), &(GEMdata[SDname].typ) );
+    BranchHits( tree, branch_name.Format( "%s.hit.xg", branch_prefix.Data() ), &(GEMdata[SDname].xg) );
+    BranchHits( tree, branch_name.Format( "%s.hit.yg", branch_prefix.Data() ), &(GEMdata[SDname].yg) );
+    BranchHits( tree, branch_name.Format( "%s.hit.zg", branch_prefix.Data() ), &(GEMdata[SDname].zg) );
+    tree->Branch( branch_name.Format( "%s.hit.mid", branch_prefix.Data() ), &(GEMdata[SDname].mid) );
+    BranchHits( tree, branch_name.Format( "%s.hit.vx", branch_prefix.Data() ), &(GEMdata[SDname].vx) );
+    BranchHits( tree, branch_name.Format( "%s.hit.vy", branch_prefix.Data() ), &(GEMdata[SDname].vy) );
+    BranchHits( tree, branch_name.Format( "%s.hit.vz", branch_prefix.Data() ), &(GEMdata[SDname].vz) );
+    BranchHits( tree, branch_name.Format( "%s.hit.p", branch_prefix.Data() ), &(GEMdata[SDname].p) );
+    BranchHits( tree, branch_name.Format( "%s.hit.beta", branch_prefix.Data() ), &(GEMdata[SDname].beta) );
+  }
+
+  if( G4SBSImportance::GetImportance()->IsActive() ){
+    BranchHits( tree, branch_name.Format( "%s.hit.weight", branch_prefix.Data() ), &(GEMdata[SDname].weight) );
+  }
 
   map<G4String,G4bool>::iterator keepsdflag = fKeepSDtracks.find( SDname );
     
   if( fKeepAllSDtracks || (keepsdflag != fKeepSDtracks.end() && keepsdflag->second ) ){
     //Add "SD track" indices:
-    fTree->Branch( branch_name.Format( "%s.hit.otridx", branch_prefix.Data() ), &(GEMdata[SDname].otridx) );
-    fTree->Branch( branch_name.Format( "%s.hit.ptridx", branch_prefix.Data() ), &(GEMdata[SDname].ptridx) );
-    fTree->Branch( branch_name.Format( "%s.hit.sdtridx", branch_prefix.Data() ), &(GEMdata[SDname].sdtridx) );
+    tree->Branch( branch_name.Format( "%s.hit.otridx", branch_prefix.Data() ), &(GEMdata[SDname].otridx) );
+    tree->Branch( branch_name.Format( "%s.hit.ptridx", branch_prefix.Data() ), &(GEMdata[SDname].ptridx) );
+    tree->Branch( branch_name.Format( "%s.hit.sdtridx", branch_prefix.Data() ), &(GEMdata[SDname].sdtridx) );
+  }
+
+  if( G4SBSPileup::GetPileup()->IsEnabled() ){
+    tree->Branch( branch_name.Format( "%s.hit.bkgd", branch_prefix.Data() ), &(GEMdata[SDname].bkgd) );
   }
   
+  G4SBSGEMDigitizer::GetDigitizer()->Branch( tree, SDname );
+  
   //Branches with "Tracker output" data:
-  fTree->Branch( branch_name.Format("%s.Track.ntracks",branch_prefix.Data() ), &(trackdata[SDname].ntracks) );
-  fTree->Branch( branch_name.Format("%s.Track.TID",branch_prefix.Data() ), &(trackdata[SDname].TrackTID) );
-  fTree->Branch( branch_name.Format("%s.Track.PID",branch_prefix.Data() ), &(trackdata[SDname].TrackPID) );
-  fTree->Branch( branch_name.Format("%s.Track.MID",branch_prefix.Data() ), &(trackdata[SDname].TrackMID) );
-  fTree->Branch( branch_name.Format("%s.Track.NumHits",branch_prefix.Data() ), &(trackdata[SDname].NumHits) );
-  fTree->Branch( branch_name.Format("%s.Track.NumPlanes",branch_prefix.Data() ), &(trackdata[SDname].NumPlanes) );
-  fTree->Branch( branch_name.Format("%s.Track.NDF",branch_prefix.Data() ), &(trackdata[SDname].NDF) );
-  fTree->Branch( branch_name.Format("%s.Track.Chi2fit",branch_prefix.Data() ), &(trackdata[SDname].Chi2fit) );
-  fTree->Branch( branch_name.Format("%s.Track.Chi2true",branch_prefix.Data() ), &(trackdata[SDname].Chi2true) );
-  fTree->Branch( branch_name.Format("%s.Track.X",branch_prefix.Data() ), &(trackdata[SDname].TrackX) );
-  fTree->Branch( branch_name.Format("%s.Track.Y",branch_prefix.Data() ), &(trackdata[SDname].TrackY) );
-  fTree->Branch( branch_name.Format("%s.Track.Xp",branch_prefix.Data() ), &(trackdata[SDname].TrackXp) );
-  fTree->Branch( branch_name.Format("%s.Track.Yp",branch_prefix.Data() ), &(trackdata[SDname].TrackYp) );
-  fTree->Branch( branch_name.Format("%s.Track.T",branch_prefix.Data() ), &(trackdata[SDname].TrackT) );
-  fTree->Branch( branch_name.Format("%s.Track.P",branch_prefix.Data() ), &(trackdata[SDname].TrackP) );
-  fTree->Branch( branch_name.Format("%s.Track.Sx",branch_prefix.Data() ), &(trackdata[SDname].TrackSx) );
-  fTree->Branch( branch_name.Format("%s.Track.Sy",branch_prefix.Data() ), &(trackdata[SDname].TrackSy) );
-  fTree->Branch( branch_name.Format("%s.Track.Sz",branch_prefix.Data() ), &(trackdata[SDname].TrackSz) );
-  fTree->Branch( branch_name.Format("%s.Track.Xfit",branch_prefix.Data() ), &(trackdata[SDname].TrackXfit) );
-  fTree->Branch( branch_name.Format("%s.Track.Yfit",branch_prefix.Data() ), &(trackdata[SDname].TrackYfit) );
-  fTree->Branch( branch_name.Format("%s.Track.Xpfit",branch_prefix.Data() ), &(trackdata[SDname].TrackXpfit) );
-  fTree->Branch( branch_name.Format("%s.Track.Ypfit",branch_prefix.Data() ), &(trackdata[SDname].TrackYpfit) );
+  tree->Branch( branch_name.Format("%s.Track.ntracks",branch_prefix.Data() ), &(trackdata[SDname].ntracks) );
+  tree->Branch( branch_name.Format("%s.Track.TID",branch_prefix.Data() ), &(trackdata[SDname].TrackTID) );
+  tree->Branch( branch_name.Format("%s.Track.PID",branch_prefix.Data() ), &(trackdata[SDname].TrackPID) );
+  tree->Branch( branch_name.Format("%s.Track.MID",branch_prefix.Data() ), &(trackdata[SDname].TrackMID) );
+  tree->Branch( branch_name.Format("%s.Track.NumHits",branch_prefix.Data() ), &(trackdata[SDname].NumHits) );
+  tree->Branch( branch_name.Format("%s.Track.NumPlanes",branch_prefix.Data() ), &(trackdata[SDname].NumPlanes) );
+  tree->Branch( branch_name.Format("%s.Track.NDF",branch_prefix.Data() ), &(trackdata[SDname].NDF) );
+  tree->Branch( branch_name.Format("%s.Track.Chi2fit",branch_prefix.Data() ), &(trackdata[SDname].Chi2fit) );
+  tree->Branch( branch_name.Format("%s.Track.Chi2true",branch_prefix.Data() ), &(trackdata[SDname].Chi2true) );
+  tree->Branch( branch_name.Format("%s.Track.X",branch_prefix.Data() ), &(trackdata[SDname].TrackX) );
+  tree->Branch( branch_name.Format("%s.Track.Y",branch_prefix.Data() ), &(trackdata[SDname].TrackY) );
+  tree->Branch( branch_name.Format("%s.Track.Xp",branch_prefix.Data() ), &(trackdata[SDname].TrackXp) );
+  tree->Branch( branch_name.Format("%s.Track.Yp",branch_prefix.Data() ), &(trackdata[SDname].TrackYp) );
+  tree->Branch( branch_name.Format("%s.Track.T",branch_prefix.Data() ), &(trackdata[SDname].TrackT) );
+  tree->Branch( branch_name.Format("%s.Track.P",branch_prefix.Data() ), &(trackdata[SDname].TrackP) );
+  tree->Branch( branch_name.Format("%s.Track.Sx",branch_prefix.Data() ), &(trackdata[SDname].TrackSx) );
+  tree->Branch( branch_name.Format("%s.Track.Sy",branch_prefix.Data() ), &(trackdata[SDname].TrackSy) );
+  tree->Branch( branch_name.Format("%s.Track.Sz",branch_prefix.Data() ), &(trackdata[SDname].TrackSz) );
+  tree->Branch( branch_name.Format("%s.Track.Xfit",branch_prefix.Data() ), &(trackdata[SDname].TrackXfit) );
+  tree->Branch( branch_name.Format("%s.Track.Yfit",branch_prefix.Data() ), &(trackdata[SDname].TrackYfit) );
+  tree->Branch( branch_name.Format("%s.Track.Xpfit",branch_prefix.Data() ), &(trackdata[SDname].TrackXpfit) );
+  tree->Branch( branch_name.Format("%s.Track.Ypfit",branch_prefix.Data() ), &(trackdata[SDname].TrackYpfit) );
 
   //map<G4String,G4bool>::iterator keepsdflag = fKeepSDtracks.find( SDname );
     
   if( fKeepAllSDtracks || (keepsdflag != fKeepSDtracks.end() && keepsdflag->second ) ){
     //Add "SD track" indices:
-    fTree->Branch( branch_name.Format( "%s.Track.otridx", branch_prefix.Data() ), &(trackdata[SDname].otridx) );
-    fTree->Branch( branch_name.Format( "%s.Track.ptridx", branch_prefix.Data() ), &(trackdata[SDname].ptridx) );
-    fTree->Branch( branch_name.Format( "%s.Track.sdtridx", branch_prefix.Data() ), &(trackdata[SDname].sdtridx) );
+    tree->Branch( branch_name.Format( "%s.Track.otridx", branch_prefix.Data() ), &(trackdata[SDname].otridx) );
+    tree->Branch( branch_name.Format( "%s.Track.ptridx", branch_prefix.Data() ), &(trackdata[SDname].ptridx) );
+    tree->Branch( branch_name.Format( "%s.Track.sdtridx", branch_prefix.Data() ), &(trackdata[SDname].sdtridx) );
   }
   
   map<G4String,G4bool>::iterator it = KeepHistoryflags.find( SDname );
 
   if( it != KeepHistoryflags.end() && it->second ){
     //Branches with "Particle History" data:
-    fTree->Branch( branch_name.Format("%s.part.npart", branch_prefix.Data() ), &(GEMdata[SDname].ParticleHistory.npart) );
-    fTree->Branch( branch_name.Format("%s.part.PID", branch_prefix.Data() ), &(GEMdata[SDname].ParticleHistory.PID) );
-    fTree->Branch( branch_name.Format("%s.part.MID", branch_prefix.Data() ), &(GEMdata[SDname].ParticleHistory.MID) );
-    fTree->Branch( branch_name.Format("%s.part.TID", branch_prefix.Data() ), &(GEMdata[SDname].ParticleHistory.TID) );
-    fTree->Branch( branch_name.Format("%s.part.nbounce", branch_prefix.Data() ), &(GEMdata[SDname].ParticleHistory.nbounce) );
-    fTree->Branch( branch_name.Format("%s.part.hitindex", branch_prefix.Data() ), &(GEMdata[SDname].ParticleHistory.hitindex) );
-    fTree->Branch( branch_name.Format("%s.part.vx", branch_prefix.Data() ), &(GEMdata[SDname].ParticleHistory.vx) );
-    fTree->Branch( branch_name.Format("%s.part.vy", branch_prefix.Data() ), &(GEMdata[SDname].ParticleHistory.vy) );
-    fTree->Branch( branch_name.Format("%s.part.vz", branch_prefix.Data() ), &(GEMdata[SDname].ParticleHistory.vz) );
-    fTree->Branch( branch_name.Format("%s.part.px", branch_prefix.Data() ), &(GEMdata[SDname].ParticleHistory.px) );
-    fTree->Branch( branch_name.Format("%s.part.py", branch_prefix.Data() ), &(GEMdata[SDname].ParticleHistory.py) );
-    fTree->Branch( branch_name.Format("%s.part.pz", branch_prefix.Data() ), &(GEMdata[SDname].ParticleHistory.pz) );
+    tree->Branch( branch_name.Format("%s.part.npart", branch_prefix.Data() ), &(GEMdata[SDname].ParticleHistory.npart) );
+    tree->Branch( branch_name.Format("%s.part.PID", branch_prefix.Data() ), &(GEMdata[SDname].ParticleHistory.PID) );
+    tree->Branch( branch_name.Format("%s.part.MID", branch_prefix.Data() ), &(GEMdata[SDname].ParticleHistory.MID) );
+    tree->Branch( branch_name.Format("%s.part.TID", branch_prefix.Data() ), &(GEMdata[SDname].ParticleHistory.TID) );
+    tree->Branch( branch_name.Format("%s.part.nbounce", branch_prefix.Data() ), &(GEMdata[SDname].ParticleHistory.nbounce) );
+    tree->Branch( branch_name.Format("%s.part.hitindex", branch_prefix.Data() ), &(GEMdata[SDname].ParticleHistory.hitindex) );
+    tree->Branch( branch_name.Format("%s.part.vx", branch_prefix.Data() ), &(GEMdata[SDname].ParticleHistory.vx) );
+    tree->Branch( branch_name.Format("%s.part.vy", branch_prefix.Data() ), &(GEMdata[SDname].ParticleHistory.vy) );
+    tree->Branch( branch_name.Format("%s.part.vz", branch_prefix.Data() ), &(GEMdata[SDname].ParticleHistory.vz) );
+    tree->Branch( branch_name.Format("%s.part.px", branch_prefix.Data() ), &(GEMdata[SDname].ParticleHistory.px) );
+    tree->Branch( branch_name.Format("%s.part.py", branch_prefix.Data() ), &(GEMdata[SDname].ParticleHistory.py) );
+    tree->Branch( branch_name.Format("%s.part.pz", branch_prefix.Data() ), &(GEMdata[SDname].ParticleHistory.pz) );
   }
 
   return;
 }
 
 void G4SBSIO::BranchCAL( G4String SDname="CAL" ){
+  TTree *tree = GetSDTree( SDname );
+
   TString branch_prefix = SDname.data();
   TString branch_name;
   
@@ -520,138 +771,153 @@ void G4SBSIO::BranchCAL( G4String SDname="CAL" ){
   fNhistograms++;
 			  
   //Define "hit" branches:
-  fTree->Branch( branch_name.Format( "%s.det.esum", branch_prefix.Data() ), &(CALdata[SDname].Esum) );
-  fTree->Branch( branch_name.Format( "%s.hit.nhits", branch_prefix.Data() ), &(CALdata[SDname].nhits_CAL) );
-  fTree->Branch( branch_name.Format( "%s.hit.row", branch_prefix.Data() ), &(CALdata[SDname].row) );
-  fTree->Branch( branch_name.Format( "%s.hit.col", branch_prefix.Data() ), &(CALdata[SDname].col) );
-  fTree->Branch( branch_name.Format( "%s.hit.cell", branch_prefix.Data() ), &(CALdata[SDname].cell) );
-  fTree->Branch( branch_name.Format( "%s.hit.plane", branch_prefix.Data() ), &(CALdata[SDname].plane) );
-  fTree->Branch( branch_name.Format( "%s.hit.wire", branch_prefix.Data() ), &(CALdata[SDname].wire) );
-  fTree->Branch( branch_name.Format( "%s.hit.xcell", branch_prefix.Data() ), &(CALdata[SDname].xcell) );
-  fTree->Branch( branch_name.Format( "%s.hit.ycell", branch_prefix.Data() ), &(CALdata[SDname].ycell) );
-  fTree->Branch( branch_name.Format( "%s.hit.zcell", branch_prefix.Data() ), &(CALdata[SDname].zcell) );
-  fTree->Branch( branch_name.Format( "%s.hit.xcellg", branch_prefix.Data() ), &(CALdata[SDname].xcellg) );
-  fTree->Branch( branch_name.Format( "%s.hit.ycellg", branch_prefix.Data() ), &(CALdata[SDname].ycellg) );
-  fTree->Branch( branch_name.Format( "%s.hit.zcellg", branch_prefix.Data() ), &(CALdata[SDname].zcellg) );
-  fTree->Branch( branch_name.Format( "%s.hit.xhit", branch_prefix.Data() ), &(CALdata[SDname].xhit) );
-  fTree->Branch( branch_name.Format( "%s.hit.yhit", branch_prefix.Data() ), &(CALdata[SDname].yhit) );
-  fTree->Branch( branch_name.Format( "%s.hit.zhit", branch_prefix.Data() ), &(CALdata[SDname].zhit) );
-  fTree->Branch( branch_name.Format( "%s.hit.xhitg", branch_prefix.Data() ), &(CALdata[SDname].xhitg) );
-  fTree->Branch( branch_name.Format( "%s.hit.yhitg", branch_prefix.Data() ), &(CALdata[SDname].yhitg) );
-  fTree->Branch( branch_name.Format( "%s.hit.zhitg", branch_prefix.Data() ), &(CALdata[SDname].zhitg) );
-  fTree->Branch( branch_name.Format( "%s.hit.sumedep", branch_prefix.Data() ), &(CALdata[SDname].sumedep) );
-  fTree->Branch( branch_name.Format( "%s.hit.tavg", branch_prefix.Data() ), &(CALdata[SDname].tavg) );
-  fTree->Branch( branch_name.Format( "%s.hit.trms", branch_prefix.Data() ), &(CALdata[SDname].trms) );
-  fTree->Branch( branch_name.Format( "%s.hit.tmin", branch_prefix.Data() ), &(CALdata[SDname].tmin) );
-  fTree->Branch( branch_name.Format( "%s.hit.tmax", branch_prefix.Data() ), &(CALdata[SDname].tmax) );
+  tree->Branch( branch_name.Format( "%s.det.esum", branch_prefix.Data() ), &(CALdata[SDname].Esum) );
+  tree->Branch( branch_name.Format( "%s.hit.nhits", branch_prefix.Data() ), &(CALdata[SDname].nhits_CAL) );
+  tree->Branch( branch_name.Format( "%s.hit.row", branch_prefix.Data() ), &(CALdata[SDname].row) );
+  tree->Branch( branch_name.Format( "%s.hit.col", branch_prefix.Data() ), &(CALdata[SDname].col) );
+  tree->Branch( branch_name.Format( "%s.hit.cell", branch_prefix.Data() ), &(CALdata[SDname].cell) );
+  tree->Branch( branch_name.Format( "%s.hit.plane", branch_prefix.Data() ), &(CALdata[SDname].plane) );
+  tree->Branch( branch_name.Format( "%s.hit.wire", branch_prefix.Data() ), &(CALdata[SDname].wire) );
+  BranchHits( tree, branch_name.Format( "%s.hit.xcell", branch_prefix.Data() ), &(CALdata[SDname].xcell) );
+  BranchHits( tree, branch_name.Format( "%s.hit.ycell", branch_prefix.Data() ), &(CALdata[SDname].ycell) );
+  BranchHits( tree, branch_name.Format( "%s.hit.zcell", branch_prefix.Data() ), &(CALdata[SDname].zcell) );
+  BranchHits( tree, branch_name.Format( "%s.hit.xcellg", branch_prefix.Data() ), &(CALdata[SDname].xcellg) );
+  BranchHits( tree, branch_name.Format( "%s.hit.ycellg", branch_prefix.Data() ), &(CALdata[SDname].ycellg) );
+  BranchHits( tree, branch_name.Format( "%s.hit.zcellg", branch_prefix.Data() ), &(CALdata[SDname].zcellg) );
+  BranchHits( tree, branch_name.Format( "%s.hit.xhit", branch_prefix.Data() ), &(CALdata[SDname].xhit) );
+  BranchHits( tree, branch_name.Format( "%s.hit.yhit", branch_prefix.Data() ), &(CALdata[SDname].yhit) );
+  BranchHits( tree, branch_name.Format( "%s.hit.zhit", branch_prefix.Data() ), &(CALdata[SDname].zhit) );
+  BranchHits( tree, branch_name.Format( "%s.hit.xhitg", branch_prefix.Data() ), &(CALdata[SDname].xhitg) );
+  BranchHits( tree, branch_name.Format( "%s.hit.yhitg", branch_prefix.Data() ), &(CALdata[SDname].yhitg) );
+  BranchHits( tree, branch_name.Format( "%s.hit.zhitg", branch_prefix.Data() ), &(CALdata[SDname].zhitg) );
+  BranchHits( tree, branch_name.Format( "%s.hit.sumedep", branch_prefix.Data() ), &(CALdata[SDname].sumedep) );
+  BranchHits( tree, branch_name.Format( "%s.hit.tavg", branch_prefix.Data() ), &(CALdata[SDname].tavg) );
+  BranchHits( tree, branch_name.Format( "%s.hit.trms", branch_prefix.Data() ), &(CALdata[SDname].trms) );
+  BranchHits( tree, branch_name.Format( "%s.hit.tmin", branch_prefix.Data() ), &(CALdata[SDname].tmin) );
+  BranchHits( tree, branch_name.Format( "%s.hit.tmax", branch_prefix.Data() ), &(CALdata[SDname].tmax) );
+  if( G4SBSImportance::GetImportance()->IsActive() ){
+    BranchHits( tree, branch_name.Format( "%s.hit.weight", branch_prefix.Data() ), &(CALdata[SDname].weight) );
+  }
 
   // Fill in ROOT tree branch to hold Pulse Shape info 
-  map<G4String,G4bool>::iterator keeppsflag = fKeepPulseShape.find( SDname );    
-  if( fKeepAllPulseShape || (keeppsflag != fKeepPulseShape.end() && keeppsflag->second ) ){
-    fTree->Branch( branch_name.Format( "%s.gatewidth", branch_prefix.Data() ), &(CALdata[SDname].gatewidth) );
-    fTree->Branch( branch_name.Format( "%s.hit.edep_vs_time", branch_prefix.Data() ), &(CALdata[SDname].edep_vs_time) );
+  if( KeepPulseShape( SDname ) ){
+    tree->Branch( branch_name.Format( "%s.gatewidth", branch_prefix.Data() ), &(CALdata[SDname].gatewidth) );
+    if( fSparsePulseShape ){ //Expand with root_macros/ExpandPulseShape.C
+      tree->Branch( branch_name.Format( "%s.ntimebins", branch_prefix.Data() ), &(CALdata[SDname].ntimebins) );
+      tree->Branch( branch_name.Format( "%s.hit.ps_idx", branch_prefix.Data() ), &(CALdata[SDname].ps_idx) );
+      tree->Branch( branch_name.Format( "%s.hit.ps_bin", branch_prefix.Data() ), &(CALdata[SDname].ps_bin) );
+      BranchHits( tree, branch_name.Format( "%s.hit.ps_val", branch_prefix.Data() ), &(CALdata[SDname].ps_val) );
+    } else {
+      tree->Branch( branch_name.Format( "%s.hit.edep_vs_time", branch_prefix.Data() ), &(CALdata[SDname].edep_vs_time) );
+    }
   }
 
   map<G4String,G4bool>::iterator keepsdflag = fKeepSDtracks.find( SDname );
     
   if( fKeepAllSDtracks || (keepsdflag != fKeepSDtracks.end() && keepsdflag->second ) ){
     //Add "SD track" indices:
-    fTree->Branch( branch_name.Format( "%s.hit.otridx", branch_prefix.Data() ), &(CALdata[SDname].otridx) );
-    fTree->Branch( branch_name.Format( "%s.hit.ptridx", branch_prefix.Data() ), &(CALdata[SDname].ptridx) );
-    fTree->Branch( branch_name.Format( "%s.hit.sdtridx", branch_prefix.Data() ), &(CALdata[SDname].sdtridx) );
+    tree->Branch( branch_name.Format( "%s.hit.otridx", branch_prefix.Data() ), &(CALdata[SDname].otridx) );
+    tree->Branch( branch_name.Format( "%s.hit.ptridx", branch_prefix.Data() ), &(CALdata[SDname].ptridx) );
+    tree->Branch( branch_name.Format( "%s.hit.sdtridx", branch_prefix.Data() ), &(CALdata[SDname].sdtridx) );
+  }
+
+  if( G4SBSPileup::GetPileup()->IsEnabled() ){
+    tree->Branch( branch_name.Format( "%s.hit.bkgd", branch_prefix.Data() ), &(CALdata[SDname].bkgd) );
   }
   
   map<G4String,G4bool>::iterator it = KeepPartCALflags.find( SDname );
 
   if( it != KeepPartCALflags.end() && it->second ){
     //Define "particle" branches:
-    fTree->Branch( branch_name.Format( "%s.npart_CAL", branch_prefix.Data() ), &(CALdata[SDname].npart_CAL) );
-    fTree->Branch( branch_name.Format( "%s.ihit", branch_prefix.Data() ), &(CALdata[SDname].ihit) );
-    fTree->Branch( branch_name.Format( "%s.x", branch_prefix.Data() ), &(CALdata[SDname].x) );
-    fTree->Branch( branch_name.Format( "%s.y", branch_prefix.Data() ), &(CALdata[SDname].y) );
-    fTree->Branch( branch_name.Format( "%s.z", branch_prefix.Data() ), &(CALdata[SDname].z) );
-    fTree->Branch( branch_name.Format( "%s.t", branch_prefix.Data() ), &(CALdata[SDname].t) );
-    fTree->Branch( branch_name.Format( "%s.E", branch_prefix.Data() ), &(CALdata[SDname].E) );
-    fTree->Branch( branch_name.Format( "%s.dt", branch_prefix.Data() ), &(CALdata[SDname].dt) );
-    fTree->Branch( branch_name.Format( "%s.L", branch_prefix.Data() ), &(CALdata[SDname].L) );
-    fTree->Branch( branch_name.Format( "%s.vx", branch_prefix.Data() ), &(CALdata[SDname].vx) );
-    fTree->Branch( branch_name.Format( "%s.vy", branch_prefix.Data() ), &(CALdata[SDname].vy) );
-    fTree->Branch( branch_name.Format( "%s.vz", branch_prefix.Data() ), &(CALdata[SDname].vz) );
-    fTree->Branch( branch_name.Format( "%s.trid", branch_prefix.Data() ),  &(CALdata[SDname].trid) );
-    fTree->Branch( branch_name.Format( "%s.mid", branch_prefix.Data() ), &(CALdata[SDname].mid) );
-    fTree->Branch( branch_name.Format( "%s.pid", branch_prefix.Data() ), &(CALdata[SDname].pid) );
-    fTree->Branch( branch_name.Format( "%s.p", branch_prefix.Data() ), &(CALdata[SDname].p) );
-    fTree->Branch( branch_name.Format( "%s.px", branch_prefix.Data() ), &(CALdata[SDname].px) );
-    fTree->Branch( branch_name.Format( "%s.py", branch_prefix.Data() ), &(CALdata[SDname].py) );
-    fTree->Branch( branch_name.Format( "%s.pz", branch_prefix.Data() ), &(CALdata[SDname].pz) );
-    fTree->Branch( branch_name.Format( "%s.edep", branch_prefix.Data() ), &(CALdata[SDname].edep) );
+    tree->Branch( branch_name.Format( "%s.npart_CAL", branch_prefix.Data() ), &(CALdata[SDname].npart_CAL) );
+    tree->Branch( branch_name.Format( "%s.ihit", branch_prefix.Data() ), &(CALdata[SDname].ihit) );
+    BranchHits( tree, branch_name.Format( "%s.x", branch_prefix.Data() ), &(CALdata[SDname].x) );
+    BranchHits( tree, branch_name.Format( "%s.y", branch_prefix.Data() ), &(CALdata[SDname].y) );
+    BranchHits( tree, branch_name.Format( "%s.z", branch_prefix.Data() ), &(CALdata[SDname].z) );
+    BranchHits( tree, branch_name.Format( "%s.t", branch_prefix.Data() ), &(CALdata[SDname].t) );
+    BranchHits( tree, branch_name.Format( "%s.E", branch_prefix.Data() ), &(CALdata[SDname].E) );
+    BranchHits( tree, branch_name.Format( "%s.dt", branch_prefix.Data() ), &(CALdata[SDname].dt) );
+    BranchHits( tree, branch_name.Format( "%s.L", branch_prefix.Data() ), &(CALdata[SDname].L) );
+    BranchHits( tree, branch_name.Format( "%s.vx", branch_prefix.Data() ), &(CALdata[SDname].vx) );
+    BranchHits( tree, branch_name.Format( "%s.vy", branch_prefix.Data() ), &(CALdata[SDname].vy) );
+    BranchHits( tree, branch_name.Format( "%s.vz", branch_prefix.Data() ), &(CALdata[SDname].vz) );
+    tree->Branch( branch_name.Format( "%s.trid", branch_prefix.Data() ),  &(CALdata[SDname].trid) );
+    tree->Branch( branch_name.Format( "%s.mid", branch_prefix.Data() ), &(CALdata[SDname].mid) );
+    tree->Branch( branch_name.Format( "%s.pid", branch_prefix.Data() ), &(CALdata[SDname].pid) );
+    BranchHits( tree, branch_name.Format( "%s.p", branch_prefix.Data() ), &(CALdata[SDname].p) );
+    BranchHits( tree, branch_name.Format( "%s.px", branch_prefix.Data() ), &(CALdata[SDname].px) );
+    BranchHits( tree, branch_name.Format( "%s.py", branch_prefix.Data() ), &(CALdata[SDname].py) );
+    BranchHits( tree, branch_name.Format( "%s.pz", branch_prefix.Data() ), &(CALdata[SDname].pz) );
+    BranchHits( tree, branch_name.Format( "%s.edep", branch_prefix.Data() ), &(CALdata[SDname].edep) );
   }
 
   it = KeepHistoryflags.find( SDname );
 
   if( it != KeepHistoryflags.end() && it->second ){
     //Branches with "Particle History" data:
-    fTree->Branch( branch_name.Format("%s.part.npart", branch_prefix.Data() ), &(CALdata[SDname].ParticleHistory.npart) );
-    fTree->Branch( branch_name.Format("%s.part.PID", branch_prefix.Data() ), &(CALdata[SDname].ParticleHistory.PID) );
-    fTree->Branch( branch_name.Format("%s.part.MID", branch_prefix.Data() ), &(CALdata[SDname].ParticleHistory.MID) );
-    fTree->Branch( branch_name.Format("%s.part.TID", branch_prefix.Data() ), &(CALdata[SDname].ParticleHistory.TID) );
-    fTree->Branch( branch_name.Format("%s.part.nbounce", branch_prefix.Data() ), &(CALdata[SDname].ParticleHistory.nbounce) );
-    fTree->Branch( branch_name.Format("%s.part.hitindex", branch_prefix.Data() ), &(CALdata[SDname].ParticleHistory.hitindex) );
-    fTree->Branch( branch_name.Format("%s.part.vx", branch_prefix.Data() ), &(CALdata[SDname].ParticleHistory.vx) );
-    fTree->Branch( branch_name.Format("%s.part.vy", branch_prefix.Data() ), &(CALdata[SDname].ParticleHistory.vy) );
-    fTree->Branch( branch_name.Format("%s.part.vz", branch_prefix.Data() ), &(CALdata[SDname].ParticleHistory.vz) );
-    fTree->Branch( branch_name.Format("%s.part.px", branch_prefix.Data() ), &(CALdata[SDname].ParticleHistory.px) );
-    fTree->Branch( branch_name.Format("%s.part.py", branch_prefix.Data() ), &(CALdata[SDname].ParticleHistory.py) );
-    fTree->Branch( branch_name.Format("%s.part.pz", branch_prefix.Data() ), &(CALdata[SDname].ParticleHistory.pz) );
+    tree->Branch( branch_name.Format("%s.part.npart", branch_prefix.Data() ), &(CALdata[SDname].ParticleHistory.npart) );
+    tree->Branch( branch_name.Format("%s.part.PID", branch_prefix.Data() ), &(CALdata[SDname].ParticleHistory.PID) );
+    tree->Branch( branch_name.Format("%s.part.MID", branch_prefix.Data() ), &(CALdata[SDname].ParticleHistory.MID) );
+    tree->Branch( branch_name.Format("%s.part.TID", branch_prefix.Data() ), &(CALdata[SDname].ParticleHistory.TID) );
+    tree->Branch( branch_name.Format("%s.part.nbounce", branch_prefix.Data() ), &(CALdata[SDname].ParticleHistory.nbounce) );
+    tree->Branch( branch_name.Format("%s.part.hitindex", branch_prefix.Data() ), &(CALdata[SDname].ParticleHistory.hitindex) );
+    tree->Branch( branch_name.Format("%s.part.vx", branch_prefix.Data() ), &(CALdata[SDname].ParticleHistory.vx) );
+    tree->Branch( branch_name.Format("%s.part.vy", branch_prefix.Data() ), &(CALdata[SDname].ParticleHistory.vy) );
+    tree->Branch( branch_name.Format("%s.part.vz", branch_prefix.Data() ), &(CALdata[SDname].ParticleHistory.vz) );
+    tree->Branch( branch_name.Format("%s.part.px", branch_prefix.Data() ), &(CALdata[SDname].ParticleHistory.px) );
+    tree->Branch( branch_name.Format("%s.part.py", branch_prefix.Data() ), &(CALdata[SDname].ParticleHistory.py) );
+    tree->Branch( branch_name.Format("%s.part.pz", branch_prefix.Data() ), &(CALdata[SDname].ParticleHistory.pz) );
   }
 
   return;
 }
 
 void G4SBSIO::BranchRICH(G4String SDname="RICH"){
+  TTree *tree = GetSDTree( SDname );
+
   TString branch_prefix = SDname.data();
   TString branch_name;
   branch_prefix.ReplaceAll("/",".");
   
   //Branches for "hits": 
   
-  fTree->Branch( branch_name.Format("%s.hit.nhits", branch_prefix.Data() ), &(richdata[SDname].nhits_RICH) );
-  fTree->Branch( branch_name.Format("%s.hit.PMT", branch_prefix.Data() ), &(richdata[SDname].PMTnumber) );
-  fTree->Branch( branch_name.Format("%s.hit.row", branch_prefix.Data() ), &(richdata[SDname].row) );
-  fTree->Branch( branch_name.Format("%s.hit.col", branch_prefix.Data() ), &(richdata[SDname].col) );
-  fTree->Branch( branch_name.Format("%s.hit.xpmt", branch_prefix.Data() ), &(richdata[SDname].xpmt) );
-  fTree->Branch( branch_name.Format("%s.hit.ypmt", branch_prefix.Data() ), &(richdata[SDname].ypmt) );
-  fTree->Branch( branch_name.Format("%s.hit.zpmt", branch_prefix.Data() ), &(richdata[SDname].zpmt) );
-  fTree->Branch( branch_name.Format( "%s.hit.xgpmt", branch_prefix.Data() ), &(richdata[SDname].xgpmt) );
-  fTree->Branch( branch_name.Format( "%s.hit.ygpmt", branch_prefix.Data() ), &(richdata[SDname].ygpmt) );
-  fTree->Branch( branch_name.Format( "%s.hit.zgpmt", branch_prefix.Data() ), &(richdata[SDname].zgpmt) );
-  fTree->Branch( branch_name.Format("%s.hit.NumPhotoelectrons", branch_prefix.Data() ), &(richdata[SDname].NumPhotoelectrons) );
-  fTree->Branch( branch_name.Format("%s.hit.Time_avg", branch_prefix.Data() ), &(richdata[SDname].Time_avg) );
-  fTree->Branch( branch_name.Format("%s.hit.Time_rms", branch_prefix.Data() ), &(richdata[SDname].Time_rms) );
-  fTree->Branch( branch_name.Format("%s.hit.Time_min", branch_prefix.Data() ), &(richdata[SDname].Time_min) );
-  fTree->Branch( branch_name.Format("%s.hit.Time_max", branch_prefix.Data() ), &(richdata[SDname].Time_max) );
-  fTree->Branch( branch_name.Format("%s.hit.mTrackNo", branch_prefix.Data() ), &(richdata[SDname].mTrackNo) );
-  fTree->Branch( branch_name.Format("%s.hit.xhit", branch_prefix.Data() ), &(richdata[SDname].xhit) );
-  fTree->Branch( branch_name.Format("%s.hit.yhit", branch_prefix.Data() ), &(richdata[SDname].yhit) );
-  fTree->Branch( branch_name.Format("%s.hit.zhit", branch_prefix.Data() ), &(richdata[SDname].zhit) );
-  fTree->Branch( branch_name.Format("%s.hit.pxhit", branch_prefix.Data() ), &(richdata[SDname].pxhit) );
-  fTree->Branch( branch_name.Format("%s.hit.pyhit", branch_prefix.Data() ), &(richdata[SDname].pyhit) );
-  fTree->Branch( branch_name.Format("%s.hit.pzhit", branch_prefix.Data() ), &(richdata[SDname].pzhit) );
-  fTree->Branch( branch_name.Format("%s.hit.pvx", branch_prefix.Data() ), &(richdata[SDname].pvx) );
-  fTree->Branch( branch_name.Format("%s.hit.pvy", branch_prefix.Data() ), &(richdata[SDname].pvy) );
-  fTree->Branch( branch_name.Format("%s.hit.pvz", branch_prefix.Data() ), &(richdata[SDname].pvz) );
-  fTree->Branch( branch_name.Format("%s.hit.ppx", branch_prefix.Data() ), &(richdata[SDname].ppx) );
-  fTree->Branch( branch_name.Format("%s.hit.ppy", branch_prefix.Data() ), &(richdata[SDname].ppy) );
-  fTree->Branch( branch_name.Format("%s.hit.ppz", branch_prefix.Data() ), &(richdata[SDname].ppz) );
-  fTree->Branch( branch_name.Format("%s.hit.volume_flag", branch_prefix.Data() ), &(richdata[SDname].volume_flag) );
+  tree->Branch( branch_name.Format("%s.hit.nhits", branch_prefix.Data() ), &(richdata[SDname].nhits_RICH) );
+  tree->Branch( branch_name.Format("%s.hit.PMT", branch_prefix.Data() ), &(richdata[SDname].PMTnumber) );
+  tree->Branch( branch_name.Format("%s.hit.row", branch_prefix.Data() ), &(richdata[SDname].row) );
+  tree->Branch( branch_name.Format("%s.hit.col", branch_prefix.Data() ), &(richdata[SDname].col) );
+  tree->Branch( branch_name.Format("%s.hit.xpmt", branch_prefix.Data() ), &(richdata[SDname].xpmt) );
+  tree->Branch( branch_name.Format("%s.hit.ypmt", branch_prefix.Data() ), &(richdata[SDname].ypmt) );
+  tree->Branch( branch_name.Format("%s.hit.zpmt", branch_prefix.Data() ), &(richdata[SDname].zpmt) );
+  tree->Branch( branch_name.Format( "%s.hit.xgpmt", branch_prefix.Data() ), &(richdata[SDname].xgpmt) );
+  tree->Branch( branch_name.Format( "%s.hit.ygpmt", branch_prefix.Data() ), &(richdata[SDname].ygpmt) );
+  tree->Branch( branch_name.Format( "%s.hit.zgpmt", branch_prefix.Data() ), &(richdata[SDname].zgpmt) );
+  tree->Branch( branch_name.Format("%s.hit.NumPhotoelectrons", branch_prefix.Data() ), &(richdata[SDname].NumPhotoelectrons) );
+  tree->Branch( branch_name.Format("%s.hit.Time_avg", branch_prefix.Data() ), &(richdata[SDname].Time_avg) );
+  tree->Branch( branch_name.Format("%s.hit.Time_rms", branch_prefix.Data() ), &(richdata[SDname].Time_rms) );
+  tree->Branch( branch_name.Format("%s.hit.Time_min", branch_prefix.Data() ), &(richdata[SDname].Time_min) );
+  tree->Branch( branch_name.Format("%s.hit.Time_max", branch_prefix.Data() ), &(richdata[SDname].Time_max) );
+  tree->Branch( branch_name.Format("%s.hit.mTrackNo", branch_prefix.Data() ), &(richdata[SDname].mTrackNo) );
+  tree->Branch( branch_name.Format("%s.hit.xhit", branch_prefix.Data() ), &(richdata[SDname].xhit) );
+  tree->Branch( branch_name.Format("%s.hit.yhit", branch_prefix.Data() ), &(richdata[SDname].yhit) );
+  tree->Branch( branch_name.Format("%s.hit.zhit", branch_prefix.Data() ), &(richdata[SDname].zhit) );
+  tree->Branch( branch_name.Format("%s.hit.pxhit", branch_prefix.Data() ), &(richdata[SDname].pxhit) );
+  tree->Branch( branch_name.Format("%s.hit.pyhit", branch_prefix.Data() ), &(richdata[SDname].pyhit) );
+  tree->Branch( branch_name.Format("%s.hit.pzhit", branch_prefix.Data() ), &(richdata[SDname].pzhit) );
+  tree->Branch( branch_name.Format("%s.hit.pvx", branch_prefix.Data() ), &(richdata[SDname].pvx) );
+  tree->Branch( branch_name.Format("%s.hit.pvy", branch_prefix.Data() ), &(richdata[SDname].pvy) );
+  tree->Branch( branch_name.Format("%s.hit.pvz", branch_prefix.Data() ), &(richdata[SDname].pvz) );
+  tree->Branch( branch_name.Format("%s.hit.ppx", branch_prefix.Data() ), &(richdata[SDname].ppx) );
+  tree->Branch( branch_name.Format("%s.hit.ppy", branch_prefix.Data() ), &(richdata[SDname].ppy) );
+  tree->Branch( branch_name.Format("%s.hit.ppz", branch_prefix.Data() ), &(richdata[SDname].ppz) );
+  tree->Branch( branch_name.Format("%s.hit.volume_flag", branch_prefix.Data() ), &(richdata[SDname].volume_flag) );
 
   map<G4String,G4bool>::iterator keepsdflag = fKeepSDtracks.find( SDname );
     
   if( fKeepAllSDtracks || (keepsdflag != fKeepSDtracks.end() && keepsdflag->second ) ){
     //Add "SD track" indices:
-    fTree->Branch( branch_name.Format( "%s.hit.otridx", branch_prefix.Data() ), &(richdata[SDname].otridx) );
-    fTree->Branch( branch_name.Format( "%s.hit.ptridx", branch_prefix.Data() ), &(richdata[SDname].ptridx) );
-    fTree->Branch( branch_name.Format( "%s.hit.sdtridx", branch_prefix.Data() ), &(richdata[SDname].sdtridx) );
+    tree->Branch( branch_name.Format( "%s.hit.otridx", branch_prefix.Data() ), &(richdata[SDname].otridx) );
+    tree->Branch( branch_name.Format( "%s.hit.ptridx", branch_prefix.Data() ), &(richdata[SDname].ptridx) );
+    tree->Branch( branch_name.Format( "%s.hit.sdtridx", branch_prefix.Data() ), &(richdata[SDname].sdtridx) );
   }
   //Branches for "tracks": This might be reorganized later:
   // branch_name.Format( "%s.ntracks_RICH", branch_prefix.Data() );
@@ -679,24 +945,26 @@ void G4SBSIO::BranchRICH(G4String SDname="RICH"){
 
   if( it != KeepHistoryflags.end() && it->second ){
     //Branches with "Particle History" data:
-    fTree->Branch( branch_name.Format("%s.part.npart", branch_prefix.Data() ), &(richdata[SDname].ParticleHistory.npart) );
-    fTree->Branch( branch_name.Format("%s.part.PID", branch_prefix.Data() ), &(richdata[SDname].ParticleHistory.PID) );
-    fTree->Branch( branch_name.Format("%s.part.MID", branch_prefix.Data() ), &(richdata[SDname].ParticleHistory.MID) );
-    fTree->Branch( branch_name.Format("%s.part.TID", branch_prefix.Data() ), &(richdata[SDname].ParticleHistory.TID) );
-    fTree->Branch( branch_name.Format("%s.part.nbounce", branch_prefix.Data() ), &(richdata[SDname].ParticleHistory.nbounce) );
-    fTree->Branch( branch_name.Format("%s.part.hitindex", branch_prefix.Data() ), &(richdata[SDname].ParticleHistory.hitindex) );
-    fTree->Branch( branch_name.Format("%s.part.vx", branch_prefix.Data() ), &(richdata[SDname].ParticleHistory.vx) );
-    fTree->Branch( branch_name.Format("%s.part.vy", branch_prefix.Data() ), &(richdata[SDname].ParticleHistory.vy) );
-    fTree->Branch( branch_name.Format("%s.part.vz", branch_prefix.Data() ), &(richdata[SDname].ParticleHistory.vz) );
-    fTree->Branch( branch_name.Format("%s.part.px", branch_prefix.Data() ), &(richdata[SDname].ParticleHistory.px) );
-    fTree->Branch( branch_name.Format("%s.part.py", branch_prefix.Data() ), &(richdata[SDname].ParticleHistory.py) );
-    fTree->Branch( branch_name.Format("%s.part.pz", branch_prefix.Data() ), &(richdata[SDname].ParticleHistory.pz) );
-    fTree->Branch( branch_name.Format("%s.part.Nphe_part", branch_prefix.Data() ), &(richdata[SDname].Nphe_part) );
+    tree->Branch( branch_name.Format("%s.part.npart", branch_prefix.Data() ), &(richdata[SDname].ParticleHistory.npart) );
+    tree->Branch( branch_name.Format("%s.part.PID", branch_prefix.Data() ), &(richdata[SDname].ParticleHistory.PID) );
+    tree->Branch( branch_name.Format("%s.part.MID", branch_prefix.Data() ), &(richdata[SDname].ParticleHistory.MID) );
+    tree->Branch( branch_name.Format("%s.part.TID", branch_prefix.Data() ), &(richdata[SDname].ParticleHistory.TID) );
+    tree->Branch( branch_name.Format("%s.part.nbounce", branch_prefix.Data() ), &(richdata[SDname].ParticleHistory.nbounce) );
+    tree->Branch( branch_name.Format("%s.part.hitindex", branch_prefix.Data() ), &(richdata[SDname].ParticleHistory.hitindex) );
+    tree->Branch( branch_name.Format("%s.part.vx", branch_prefix.Data() ), &(richdata[SDname].ParticleHistory.vx) );
+    tree->Branch( branch_name.Format("%s.part.vy", branch_prefix.Data() ), &(richdata[SDname].ParticleHistory.vy) );
+    tree->Branch( branch_name.Format("%s.part.vz", branch_prefix.Data() ), &(richdata[SDname].ParticleHistory.vz) );
+    tree->Branch( branch_name.Format("%s.part.px", branch_prefix.Data() ), &(richdata[SDname].ParticleHistory.px) );
+    tree->Branch( branch_name.Format("%s.part.py", branch_prefix.Data() ), &(richdata[SDname].ParticleHistory.py) );
+    tree->Branch( branch_name.Format("%s.part.pz", branch_prefix.Data() ), &(richdata[SDname].ParticleHistory.pz) );
+    tree->Branch( branch_name.Format("%s.part.Nphe_part", branch_prefix.Data() ), &(richdata[SDname].Nphe_part) );
   }
   return;
 }
 
 void G4SBSIO::BranchECAL(G4String SDname="ECAL"){
+  TTree *tree = GetSDTree( SDname );
+
   TString branch_prefix = SDname.data();
   TString branch_name;
   branch_prefix.ReplaceAll("/",".");
@@ -709,30 +977,36 @@ void G4SBSIO::BranchECAL(G4String SDname="ECAL"){
   G4int ntimebinstemp = SDtemp->GetNTimeBins();
   // *****
 
-  fTree->Branch( branch_name.Format("%s.det.SumPhotoelectrons", branch_prefix.Data() ), &(ecaldata[SDname].SumPhotoelectrons) );
-  fTree->Branch( branch_name.Format("%s.hit.nhits", branch_prefix.Data() ), &(ecaldata[SDname].nhits_ECal) );
-  fTree->Branch( branch_name.Format("%s.hit.PMT", branch_prefix.Data() ), &(ecaldata[SDname].PMTnumber) );
-  fTree->Branch( branch_name.Format("%s.hit.row", branch_prefix.Data() ), &(ecaldata[SDname].row) );
-  fTree->Branch( branch_name.Format("%s.hit.col", branch_prefix.Data() ), &(ecaldata[SDname].col) );
-  fTree->Branch( branch_name.Format("%s.hit.plane", branch_prefix.Data() ), &(ecaldata[SDname].plane) );
-  fTree->Branch( branch_name.Format("%s.hit.xcell", branch_prefix.Data() ), &(ecaldata[SDname].xcell) );
-  fTree->Branch( branch_name.Format("%s.hit.ycell", branch_prefix.Data() ), &(ecaldata[SDname].ycell) );
-  fTree->Branch( branch_name.Format("%s.hit.zcell", branch_prefix.Data() ), &(ecaldata[SDname].zcell) );
-  fTree->Branch( branch_name.Format("%s.hit.xgcell", branch_prefix.Data() ), &(ecaldata[SDname].xgcell) );
-  fTree->Branch( branch_name.Format("%s.hit.ygcell", branch_prefix.Data() ), &(ecaldata[SDname].ygcell) );
-  fTree->Branch( branch_name.Format("%s.hit.zgcell", branch_prefix.Data() ), &(ecaldata[SDname].zgcell) );
-  fTree->Branch( branch_name.Format("%s.hit.NumPhotoelectrons", branch_prefix.Data() ), &(ecaldata[SDname].NumPhotoelectrons) );
-  fTree->Branch( branch_name.Format("%s.hit.Time_avg", branch_prefix.Data() ), &(ecaldata[SDname].Time_avg) );
-  fTree->Branch( branch_name.Format("%s.hit.Time_rms", branch_prefix.Data() ), &(ecaldata[SDname].Time_rms) );
-  fTree->Branch( branch_name.Format("%s.hit.Time_min", branch_prefix.Data() ), &(ecaldata[SDname].Time_min) );
-  fTree->Branch( branch_name.Format("%s.hit.Time_max", branch_prefix.Data() ), &(ecaldata[SDname].Time_max) );
+  tree->Branch( branch_name.Format("%s.det.SumPhotoelectrons", branch_prefix.Data() ), &(ecaldata[SDname].SumPhotoelectrons) );
+  tree->Branch( branch_name.Format("%s.hit.nhits", branch_prefix.Data() ), &(ecaldata[SDname].nhits_ECal) );
+  tree->Branch( branch_name.Format("%s.hit.PMT", branch_prefix.Data() ), &(ecaldata[SDname].PMTnumber) );
+  tree->Branch( branch_name.Format("%s.hit.row", branch_prefix.Data() ), &(ecaldata[SDname].row) );
+  tree->Branch( branch_name.Format("%s.hit.col", branch_prefix.Data() ), &(ecaldata[SDname].col) );
+  tree->Branch( branch_name.Format("%s.hit.plane", branch_prefix.Data() ), &(ecaldata[SDname].plane) );
+  tree->Branch( branch_name.Format("%s.hit.xcell", branch_prefix.Data() ), &(ecaldata[SDname].xcell) );
+  tree->Branch( branch_name.Format("%s.hit.ycell", branch_prefix.Data() ), &(ecaldata[SDname].ycell) );
+  tree->Branch( branch_name.Format("%s.hit.zcell", branch_prefix.Data() ), &(ecaldata[SDname].zcell) );
+  tree->Branch( branch_name.Format("%s.hit.xgcell", branch_prefix.Data() ), &(ecaldata[SDname].xgcell) );
+  tree->Branch( branch_name.Format("%s.hit.ygcell", branch_prefix.Data() ), &(ecaldata[SDname].ygcell) );
+  tree->Branch( branch_name.Format("%s.hit.zgcell", branch_prefix.Data() ), &(ecaldata[SDname].zgcell) );
+  tree->Branch( branch_name.Format("%s.hit.NumPhotoelectrons", branch_prefix.Data() ), &(ecaldata[SDname].NumPhotoelectrons) );
+  tree->Branch( branch_name.Format("%s.hit.Time_avg", branch_prefix.Data() ), &(ecaldata[SDname].Time_avg) );
+  tree->Branch( branch_name.Format("%s.hit.Time_rms", branch_prefix.Data() ), &(ecaldata[SDname].Time_rms) );
+  tree->Branch( branch_name.Format("%s.hit.Time_min", branch_prefix.Data() ), &(ecaldata[SDname].Time_min) );
+  tree->Branch( branch_name.Format("%s.hit.Time_max", branch_prefix.Data() ), &(ecaldata[SDname].Time_max) );
 
   // *****
   // Fill in ROOT tree branch to hold Pulse Shape info 
-  map<G4String,G4bool>::iterator keeppsflag = fKeepPulseShape.find( SDname );    
-  if( fKeepAllPulseShape || (keeppsflag != fKeepPulseShape.end() && keeppsflag->second ) ){
-    fTree->Branch( branch_name.Format( "%s.gatewidth", branch_prefix.Data() ), &(ecaldata[SDname].gatewidth) );
-    fTree->Branch( branch_name.Format( "%s.hit.NPE_vs_time", branch_prefix.Data() ), &(ecaldata[SDname].NPE_vs_time) );
+  if( KeepPulseShape( SDname ) ){
+    tree->Branch( branch_name.Format( "%s.gatewidth", branch_prefix.Data() ), &(ecaldata[SDname].gatewidth) );
+    if( fSparsePulseShape ){ //Expand with root_macros/ExpandPulseShape.C
+      tree->Branch( branch_name.Format( "%s.ntimebins", branch_prefix.Data() ), &(ecaldata[SDname].ntimebins) );
+      tree->Branch( branch_name.Format( "%s.hit.ps_idx", branch_prefix.Data() ), &(ecaldata[SDname].ps_idx) );
+      tree->Branch( branch_name.Format( "%s.hit.ps_bin", branch_prefix.Data() ), &(ecaldata[SDname].ps_bin) );
+      tree->Branch( branch_name.Format( "%s.hit.ps_val", branch_prefix.Data() ), &(ecaldata[SDname].ps_val) );
+    } else {
+      tree->Branch( branch_name.Format( "%s.hit.NPE_vs_time", branch_prefix.Data() ), &(ecaldata[SDname].NPE_vs_time) );
+    }
   }
   // *****
   
@@ -740,22 +1014,22 @@ void G4SBSIO::BranchECAL(G4String SDname="ECAL"){
     
   if( fKeepAllSDtracks || (keepsdflag != fKeepSDtracks.end() && keepsdflag->second ) ){
     //Add "SD track" indices:
-    fTree->Branch( branch_name.Format( "%s.hit.otridx", branch_prefix.Data() ), &(ecaldata[SDname].otridx) );
-    fTree->Branch( branch_name.Format( "%s.hit.ptridx", branch_prefix.Data() ), &(ecaldata[SDname].ptridx) );
-    fTree->Branch( branch_name.Format( "%s.hit.sdtridx", branch_prefix.Data() ), &(ecaldata[SDname].sdtridx) );
+    tree->Branch( branch_name.Format( "%s.hit.otridx", branch_prefix.Data() ), &(ecaldata[SDname].otridx) );
+    tree->Branch( branch_name.Format( "%s.hit.ptridx", branch_prefix.Data() ), &(ecaldata[SDname].ptridx) );
+    tree->Branch( branch_name.Format( "%s.hit.sdtridx", branch_prefix.Data() ), &(ecaldata[SDname].sdtridx) );
   }
   
   map<G4String,G4bool>::iterator it = KeepPartCALflags.find( SDname );
 
   if( it != KeepPartCALflags.end() && it->second ){
     //Define "particle" branches:
-    fTree->Branch( branch_name.Format( "%s.npart_ECAL", branch_prefix.Data() ), &(ecaldata[SDname].npart_ECAL) );
-    fTree->Branch( branch_name.Format( "%s.part_PMT", branch_prefix.Data() ), &(ecaldata[SDname].part_PMT) );
+    tree->Branch( branch_name.Format( "%s.npart_ECAL", branch_prefix.Data() ), &(ecaldata[SDname].npart_ECAL) );
+    tree->Branch( branch_name.Format( "%s.part_PMT", branch_prefix.Data() ), &(ecaldata[SDname].part_PMT) );
     //fTree->Branch( branch_name.Format( "%s.ihit", branch_prefix.Data() ), &(ecaldata[SDname].ihit) );
-    fTree->Branch( branch_name.Format( "%s.E", branch_prefix.Data() ), &(ecaldata[SDname].E) );
-    fTree->Branch( branch_name.Format( "%s.t", branch_prefix.Data() ), &(ecaldata[SDname].t) );
-    fTree->Branch( branch_name.Format( "%s.trid", branch_prefix.Data() ), &(ecaldata[SDname].trid) );
-    fTree->Branch( branch_name.Format( "%s.detected", branch_prefix.Data() ), &(ecaldata[SDname].detected) );
+    tree->Branch( branch_name.Format( "%s.E", branch_prefix.Data() ), &(ecaldata[SDname].E) );
+    tree->Branch( branch_name.Format( "%s.t", branch_prefix.Data() ), &(ecaldata[SDname].t) );
+    tree->Branch( branch_name.Format( "%s.trid", branch_prefix.Data() ), &(ecaldata[SDname].trid) );
+    tree->Branch( branch_name.Format( "%s.detected", branch_prefix.Data() ), &(ecaldata[SDname].detected) );
   }
 }
 
@@ -853,6 +1127,45 @@ void G4SBSIO::UpdateGenDataFromDetCon(){ //Go with whatever is in fdetcon as of
   gendata.sbstrkrpitch = fdetcon->fHArmBuilder->fSBS_tracker_pitch; //radians
 }
 
+void G4SBSIO::BranchHits( TTree *tree, const char *name, vector<double> *v ){
+  if( fCompactOutput ){
+    //Same memory layout as vector<double>; written to disk as float32 and read back as double.
+    //This branch constructor takes the address of a pointer to the object, which must stay valid:
+    fCompactAddr.push_back( v );
+    tree->Branch( name, "vector<Double32_t>", (void*) &(fCompactAddr.back()) );
+  } else {
+    tree->Branch( name, v );
+  }
+}
+
+void G4SBSIO::QuantizeGEM( G4SBSGEMoutput &gd ){
+  vector<double> *pos[] = { &gd.x, &gd.y, &gd.z, &gd.tx, &gd.ty, &gd.xin, &gd.yin, &gd.zin, &gd.xout, &gd.yout, &gd.zout,
+			    &gd.xg, &gd.yg, &gd.zg, &gd.vx, &gd.vy, &gd.vz };
+  vector<double> *times[] = { &gd.t, &gd.trms, &gd.tmin, &gd.tmax };
+
+  for( size_t i=0; i<sizeof(pos)/sizeof(pos[0]); i++ ) RoundToStep( *(pos[i]), kCompactPosStep );
+  for( size_t i=0; i<sizeof(times)/sizeof(times[0]); i++ ) RoundToStep( *(times[i]), kCompactTimeStep );
+}
+
+void G4SBSIO::QuantizeCAL( G4SBSCALoutput &cd ){
+  vector<double> *pos[] = { &cd.xcell, &cd.ycell, &cd.zcell, &cd.xcellg, &cd.ycellg, &cd.zcellg,
+			    &cd.xhit, &cd.yhit, &cd.zhit, &cd.xhitg, &cd.yhitg, &cd.zhitg,
+			    &cd.x, &cd.y, &cd.z, &cd.L, &cd.vx, &cd.vy, &cd.vz };
+  vector<double> *times[] = { &cd.tavg, &cd.trms, &cd.tmin, &cd.tmax, &cd.t, &cd.dt };
+
+  for( size_t i=0; i<sizeof(pos)/sizeof(pos[0]); i++ ) RoundToStep( *(pos[i]), kCompactPosStep );
+  for( size_t i=0; i<sizeof(times)/sizeof(times[0]); i++ ) RoundToStep( *(times[i]), kCompactTimeStep );
+}
+
+void G4SBSIO::QuantizeSDtracks( G4SBSSDTrackOutput &sd ){
+  vector<double> *pos[] = { &sd.oposx, &sd.oposy, &sd.oposz, &sd.pposx, &sd.pposy, &sd.pposz,
+			    &sd.sdposx, &sd.sdposy, &sd.sdposz, &sd.sdvx, &sd.sdvy, &sd.sdvz };
+  vector<double> *times[] = { &sd.otime, &sd.ptime, &sd.sdtime };
+
+  for( size_t i=0; i<sizeof(pos)/sizeof(pos[0]); i++ ) RoundToStep( *(pos[i]), kCompactPosStep );
+  for( size_t i=0; i<sizeof(times)/sizeof(times[0]); i++ ) RoundToStep( *(times[i]), kCompactTimeStep );
+}
+
 void G4SBSIO::BranchSDTracks(){
   //TString branch_prefix = "AllSD";
   //TString branch_name;
@@ -867,119 +1180,126 @@ void G4SBSIO::BranchSDTracks(){
   fTree->Branch(  "OTrack.MID", &(allsdtrackdata.omid) );
   fTree->Branch(  "OTrack.PID", &(allsdtrackdata.opid) );
   fTree->Branch(  "OTrack.MPID", &(allsdtrackdata.ompid) );
-  fTree->Branch(  "OTrack.posx", &(allsdtrackdata.oposx) );
-  fTree->Branch(  "OTrack.posy", &(allsdtrackdata.oposy) );
-  fTree->Branch(  "OTrack.posz", &(allsdtrackdata.oposz) );
-  fTree->Branch(  "OTrack.momx", &(allsdtrackdata.omomx) );
-  fTree->Branch(  "OTrack.momy", &(allsdtrackdata.omomy) );
-  fTree->Branch(  "OTrack.momz", &(allsdtrackdata.omomz) );
-  fTree->Branch(  "OTrack.polx", &(allsdtrackdata.opolx) );
-  fTree->Branch(  "OTrack.poly", &(allsdtrackdata.opoly) );
-  fTree->Branch(  "OTrack.polz", &(allsdtrackdata.opolz) );
-  fTree->Branch(  "OTrack.Etot", &(allsdtrackdata.oenergy) );
-  fTree->Branch(  "OTrack.T", &(allsdtrackdata.otime) );
+  BranchHits( fTree, "OTrack.posx", &(allsdtrackdata.oposx) );
+  BranchHits( fTree, "OTrack.posy", &(allsdtrackdata.oposy) );
+  BranchHits( fTree, "OTrack.posz", &(allsdtrackdata.oposz) );
+  BranchHits( fTree, "OTrack.momx", &(allsdtrackdata.omomx) );
+  BranchHits( fTree, "OTrack.momy", &(allsdtrackdata.omomy) );
+  BranchHits( fTree, "OTrack.momz", &(allsdtrackdata.omomz) );
+  BranchHits( fTree, "OTrack.polx", &(allsdtrackdata.opolx) );
+  BranchHits( fTree, "OTrack.poly", &(allsdtrackdata.opoly) );
+  BranchHits( fTree, "OTrack.polz", &(allsdtrackdata.opolz) );
+  BranchHits( fTree, "OTrack.Etot", &(allsdtrackdata.oenergy) );
+  BranchHits( fTree, "OTrack.T", &(allsdtrackdata.otime) );
 
   //"Primary track" info:
   fTree->Branch(  "PTrack.ntracks", &(allsdtrackdata.nptracks) );
   fTree->Branch(  "PTrack.TID", &(allsdtrackdata.ptrid) );
   //fTree->Branch(  "PTrack.MID", &(allsdtrackdata.pmid) );
   fTree->Branch(  "PTrack.PID", &(allsdtrackdata.ppid) );
-  fTree->Branch(  "PTrack.posx", &(allsdtrackdata.pposx) );
-  fTree->Branch(  "PTrack.posy", &(allsdtrackdata.pposy) );
-  fTree->Branch(  "PTrack.posz", &(allsdtrackdata.pposz) );
-  fTree->Branch(  "PTrack.momx", &(allsdtrackdata.pmomx) );
-  fTree->Branch(  "PTrack.momy", &(allsdtrackdata.pmomy) );
-  fTree->Branch(  "PTrack.momz", &(allsdtrackdata.pmomz) );
-  fTree->Branch(  "PTrack.polx", &(allsdtrackdata.ppolx) );
-  fTree->Branch(  "PTrack.poly", &(allsdtrackdata.ppoly) );
-  fTree->Branch(  "PTrack.polz", &(allsdtrackdata.ppolz) );
-  fTree->Branch(  "PTrack.Etot", &(allsdtrackdata.penergy) );
-  fTree->Branch(  "PTrack.T", &(allsdtrackdata.ptime) );
+  BranchHits( fTree, "PTrack.posx", &(allsdtrackdata.pposx) );
+  BranchHits( fTree, "PTrack.posy", &(allsdtrackdata.pposy) );
+  BranchHits( fTree, "PTrack.posz", &(allsdtrackdata.pposz) );
+  BranchHits( fTree, "PTrack.momx", &(allsdtrackdata.pmomx) );
+  BranchHits( fTree, "PTrack.momy", &(allsdtrackdata.pmomy) );
+  BranchHits( fTree, "PTrack.momz", &(allsdtrackdata.pmomz) );
+  BranchHits( fTree, "PTrack.polx", &(allsdtrackdata.ppolx) );
+  BranchHits( fTree, "PTrack.poly", &(allsdtrackdata.ppoly) );
+  BranchHits( fTree, "PTrack.polz", &(allsdtrackdata.ppolz) );
+  BranchHits( fTree, "PTrack.Etot", &(allsdtrackdata.penergy) );
+  BranchHits( fTree, "PTrack.T", &(allsdtrackdata.ptime) );
   //"SD boundary crossing track" info:
   fTree->Branch(  "SDTrack.ntracks", &(allsdtrackdata.nsdtracks) );
   fTree->Branch(  "SDTrack.TID", &(allsdtrackdata.sdtrid) );
   fTree->Branch(  "SDTrack.MID", &(allsdtrackdata.sdmid) );
   fTree->Branch(  "SDTrack.PID", &(allsdtrackdata.sdpid) );
   fTree->Branch(  "SDTrack.MPID", &(allsdtrackdata.sdmpid) );
-  fTree->Branch(  "SDTrack.posx", &(allsdtrackdata.sdposx) );
-  fTree->Branch(  "SDTrack.posy", &(allsdtrackdata.sdposy) );
-  fTree->Branch(  "SDTrack.posz", &(allsdtrackdata.sdposz) );
-  fTree->Branch(  "SDTrack.momx", &(allsdtrackdata.sdmomx) );
-  fTree->Branch(  "SDTrack.momy", &(allsdtrackdata.sdmomy) );
-  fTree->Branch(  "SDTrack.momz", &(allsdtrackdata.sdmomz) );
-  fTree->Branch(  "SDTrack.polx", &(allsdtrackdata.sdpolx) );
-  fTree->Branch(  "SDTrack.poly", &(allsdtrackdata.sdpoly) );
-  fTree->Branch(  "SDTrack.polz", &(allsdtrackdata.sdpolz) );
-  fTree->Branch(  "SDTrack.Etot", &(allsdtrackdata.sdenergy) );
-  fTree->Branch(  "SDTrack.T", &(allsdtrackdata.sdtime) );
+  BranchHits( fTree, "SDTrack.posx", &(allsdtrackdata.sdposx) );
+  BranchHits( fTree, "SDTrack.posy", &(allsdtrackdata.sdposy) );
+  BranchHits( fTree, "SDTrack.posz", &(allsdtrackdata.sdposz) );
+  BranchHits( fTree, "SDTrack.momx", &(allsdtrackdata.sdmomx) );
+  BranchHits( fTree, "SDTrack.momy", &(allsdtrackdata.sdmomy) );
+  BranchHits( fTree, "SDTrack.momz", &(allsdtrackdata.sdmomz) );
+  BranchHits( fTree, "SDTrack.polx", &(allsdtrackdata.sdpolx) );
+  BranchHits( fTree, "SDTrack.poly", &(allsdtrackdata.sdpoly) );
+  BranchHits( fTree, "SDTrack.polz", &(allsdtrackdata.sdpolz) );
+  BranchHits( fTree, "SDTrack.Etot", &(allsdtrackdata.sdenergy) );
+  BranchHits( fTree, "SDTrack.T", &(allsdtrackdata.sdtime) );
+  if( G4SBSImportance::GetImportance()->IsActive() ){
+    BranchHits( fTree, "SDTrack.weight", &(allsdtrackdata.sdweight) );
+  }
   //Add new vertex info:
-  fTree->Branch(  "SDTrack.vx", &(allsdtrackdata.sdvx) );
-  fTree->Branch(  "SDTrack.vy", &(allsdtrackdata.sdvy) );
-  fTree->Branch(  "SDTrack.vz", &(allsdtrackdata.sdvz) );
-  fTree->Branch(  "SDTrack.vnx", &(allsdtrackdata.sdvnx) );
-  fTree->Branch(  "SDTrack.vny", &(allsdtrackdata.sdvny) );
-  fTree->Branch(  "SDTrack.vnz", &(allsdtrackdata.sdvnz) );
-  fTree->Branch(  "SDTrack.vEkin", &(allsdtrackdata.sdEkin) );
+  BranchHits( fTree, "SDTrack.vx", &(allsdtrackdata.sdvx) );
+  BranchHits( fTree, "SDTrack.vy", &(allsdtrackdata.sdvy) );
+  BranchHits( fTree, "SDTrack.vz", &(allsdtrackdata.sdvz) );
+  BranchHits( fTree, "SDTrack.vnx", &(allsdtrackdata.sdvnx) );
+  BranchHits( fTree, "SDTrack.vny", &(allsdtrackdata.sdvny) );
+  BranchHits( fTree, "SDTrack.vnz", &(allsdtrackdata.sdvnz) );
+  BranchHits( fTree, "SDTrack.vEkin", &(allsdtrackdata.sdEkin) );
   //}
 }
 
 void G4SBSIO::BranchBD(G4String SDname){
+   TTree *tree = GetSDTree( SDname );
+
    // create the branches for the Beam Diffuser (BD) 
    TString branch_name;
    TString branch_prefix = SDname.data();
    branch_prefix.ReplaceAll("/",".");
    // define branches
-   fTree->Branch( branch_name.Format("%s.hit.nhits", branch_prefix.Data() ), &(BDdata[SDname].nhits_BD) );
-   fTree->Branch( branch_name.Format("%s.hit.plane", branch_prefix.Data() ), &(BDdata[SDname].plane)    );
-   fTree->Branch( branch_name.Format("%s.hit.trid" , branch_prefix.Data() ), &(BDdata[SDname].trid )    );
-   fTree->Branch( branch_name.Format("%s.hit.mid"  , branch_prefix.Data() ), &(BDdata[SDname].mid  )    );
-   fTree->Branch( branch_name.Format("%s.hit.pid"  , branch_prefix.Data() ), &(BDdata[SDname].pid  )    );
-   fTree->Branch( branch_name.Format("%s.hit.x"    , branch_prefix.Data() ), &(BDdata[SDname].x    )    );
-   fTree->Branch( branch_name.Format("%s.hit.y"    , branch_prefix.Data() ), &(BDdata[SDname].y    )    );
-   fTree->Branch( branch_name.Format("%s.hit.z"    , branch_prefix.Data() ), &(BDdata[SDname].z    )    );
-   fTree->Branch( branch_name.Format("%s.hit.t"    , branch_prefix.Data() ), &(BDdata[SDname].t    )    );
-   fTree->Branch( branch_name.Format("%s.hit.xg"   , branch_prefix.Data() ), &(BDdata[SDname].xg   )    );
-   fTree->Branch( branch_name.Format("%s.hit.yg"   , branch_prefix.Data() ), &(BDdata[SDname].yg   )    );
-   fTree->Branch( branch_name.Format("%s.hit.zg"   , branch_prefix.Data() ), &(BDdata[SDname].zg   )    );
-   fTree->Branch( branch_name.Format("%s.hit.p"    , branch_prefix.Data() ), &(BDdata[SDname].p    )    );
-   fTree->Branch( branch_name.Format("%s.hit.edep" , branch_prefix.Data() ), &(BDdata[SDname].edep )    );
-   fTree->Branch( branch_name.Format("%s.hit.beta" , branch_prefix.Data() ), &(BDdata[SDname].beta )    );
+   tree->Branch( branch_name.Format("%s.hit.nhits", branch_prefix.Data() ), &(BDdata[SDname].nhits_BD) );
+   tree->Branch( branch_name.Format("%s.hit.plane", branch_prefix.Data() ), &(BDdata[SDname].plane)    );
+   tree->Branch( branch_name.Format("%s.hit.trid" , branch_prefix.Data() ), &(BDdata[SDname].trid )    );
+   tree->Branch( branch_name.Format("%s.hit.mid"  , branch_prefix.Data() ), &(BDdata[SDname].mid  )    );
+   tree->Branch( branch_name.Format("%s.hit.pid"  , branch_prefix.Data() ), &(BDdata[SDname].pid  )    );
+   tree->Branch( branch_name.Format("%s.hit.x"    , branch_prefix.Data() ), &(BDdata[SDname].x    )    );
+   tree->Branch( branch_name.Format("%s.hit.y"    , branch_prefix.Data() ), &(BDdata[SDname].y    )    );
+   tree->Branch( branch_name.Format("%s.hit.z"    , branch_prefix.Data() ), &(BDdata[SDname].z    )    );
+   tree->Branch( branch_name.Format("%s.hit.t"    , branch_prefix.Data() ), &(BDdata[SDname].t    )    );
+   tree->Branch( branch_name.Format("%s.hit.xg"   , branch_prefix.Data() ), &(BDdata[SDname].xg   )    );
+   tree->Branch( branch_name.Format("%s.hit.yg"   , branch_prefix.Data() ), &(BDdata[SDname].yg   )    );
+   tree->Branch( branch_name.Format("%s.hit.zg"   , branch_prefix.Data() ), &(BDdata[SDname].zg   )    );
+   tree->Branch( branch_name.Format("%s.hit.p"    , branch_prefix.Data() ), &(BDdata[SDname].p    )    );
+   tree->Branch( branch_name.Format("%s.hit.edep" , branch_prefix.Data() ), &(BDdata[SDname].edep )    );
+   tree->Branch( branch_name.Format("%s.hit.beta" , branch_prefix.Data() ), &(BDdata[SDname].beta )    );
 }
 
 void G4SBSIO::BranchIC(G4String SDname){
+   TTree *tree = GetSDTree( SDname );
+
    // create the branches for the Ion Chamber (IC)  
    TString branch_name;
    TString branch_prefix = SDname.data();
    branch_prefix.ReplaceAll("/",".");
    // define branches
-   fTree->Branch( branch_name.Format("%s.hit.nhits", branch_prefix.Data() ), &(ICdata[SDname].nhits_IC) );
-   fTree->Branch( branch_name.Format("%s.hit.trid" , branch_prefix.Data() ), &(ICdata[SDname].trid )    );
-   fTree->Branch( branch_name.Format("%s.hit.mid"  , branch_prefix.Data() ), &(ICdata[SDname].mid  )    );
-   fTree->Branch( branch_name.Format("%s.hit.pid"  , branch_prefix.Data() ), &(ICdata[SDname].pid  )    );
-   fTree->Branch( branch_name.Format("%s.hit.x"    , branch_prefix.Data() ), &(ICdata[SDname].x    )    );
-   fTree->Branch( branch_name.Format("%s.hit.y"    , branch_prefix.Data() ), &(ICdata[SDname].y    )    );
-   fTree->Branch( branch_name.Format("%s.hit.z"    , branch_prefix.Data() ), &(ICdata[SDname].z    )    );
-   fTree->Branch( branch_name.Format("%s.hit.t"    , branch_prefix.Data() ), &(ICdata[SDname].t    )    );
-   fTree->Branch( branch_name.Format("%s.hit.xg"   , branch_prefix.Data() ), &(ICdata[SDname].xg   )    );
-   fTree->Branch( branch_name.Format("%s.hit.yg"   , branch_prefix.Data() ), &(ICdata[SDname].yg   )    );
-   fTree->Branch( branch_name.Format("%s.hit.zg"   , branch_prefix.Data() ), &(ICdata[SDname].zg   )    );
-   fTree->Branch( branch_name.Format("%s.hit.p"    , branch_prefix.Data() ), &(ICdata[SDname].p    )    );
-   fTree->Branch( branch_name.Format("%s.hit.edep" , branch_prefix.Data() ), &(ICdata[SDname].edep )    );
-   fTree->Branch( branch_name.Format("%s.hit.beta" , branch_prefix.Data() ), &(ICdata[SDname].beta )    );
+   tree->Branch( branch_name.Format("%s.hit.nhits", branch_prefix.Data() ), &(ICdata[SDname].nhits_IC) );
+   tree->Branch( branch_name.Format("%s.hit.trid" , branch_prefix.Data() ), &(ICdata[SDname].trid )    );
+   tree->Branch( branch_name.Format("%s.hit.mid"  , branch_prefix.Data() ), &(ICdata[SDname].mid  )    );
+   tree->Branch( branch_name.Format("%s.hit.pid"  , branch_prefix.Data() ), &(ICdata[SDname].pid  )    );
+   tree->Branch( branch_name.Format("%s.hit.x"    , branch_prefix.Data() ), &(ICdata[SDname].x    )    );
+   tree->Branch( branch_name.Format("%s.hit.y"    , branch_prefix.Data() ), &(ICdata[SDname].y    )    );
+   tree->Branch( branch_name.Format("%s.hit.z"    , branch_prefix.Data() ), &(ICdata[SDname].z    )    );
+   tree->Branch( branch_name.Format("%s.hit.t"    , branch_prefix.Data() ), &(ICdata[SDname].t    )    );
+   tree->Branch( branch_name.Format("%s.hit.xg"   , branch_prefix.Data() ), &(ICdata[SDname].xg   )    );
+   tree->Branch( branch_name.Format("%s.hit.yg"   , branch_prefix.Data() ), &(ICdata[SDname].yg   )    );
+   tree->Branch( branch_name.Format("%s.hit.zg"   , branch_prefix.Data() ), &(ICdata[SDname].zg   )    );
+   tree->Branch( branch_name.Format("%s.hit.p"    , branch_prefix.Data() ), &(ICdata[SDname].p    )    );
+   tree->Branch( branch_name.Format("%s.hit.edep" , branch_prefix.Data() ), &(ICdata[SDname].edep )    );
+   tree->Branch( branch_name.Format("%s.hit.beta" , branch_prefix.Data() ), &(ICdata[SDname].beta )    );
 
    map<G4String,G4bool>::iterator it = KeepHistoryflags.find( SDname );
    if( it != KeepHistoryflags.end() && it->second ){
       //Branches with "Particle History" data:
-      fTree->Branch( branch_name.Format("%s.part.npart", branch_prefix.Data() ), &(ICdata[SDname].ParticleHistory.npart) );
-      fTree->Branch( branch_name.Format("%s.part.PID"  , branch_prefix.Data() ), &(ICdata[SDname].ParticleHistory.PID) );
-      fTree->Branch( branch_name.Format("%s.part.MID"  , branch_prefix.Data() ), &(ICdata[SDname].ParticleHistory.MID) );
-      fTree->Branch( branch_name.Format("%s.part.TID"  , branch_prefix.Data() ), &(ICdata[SDname].ParticleHistory.TID) );
-      fTree->Branch( branch_name.Format("%s.part.vx"   , branch_prefix.Data() ), &(ICdata[SDname].ParticleHistory.vx) );
-      fTree->Branch( branch_name.Format("%s.part.vy"   , branch_prefix.Data() ), &(ICdata[SDname].ParticleHistory.vy) );
-      fTree->Branch( branch_name.Format("%s.part.vz"   , branch_prefix.Data() ), &(ICdata[SDname].ParticleHistory.vz) );
-      fTree->Branch( branch_name.Format("%s.part.px"   , branch_prefix.Data() ), &(ICdata[SDname].ParticleHistory.px) );
-      fTree->Branch( branch_name.Format("%s.part.py"   , branch_prefix.Data() ), &(ICdata[SDname].ParticleHistory.py) );
-      fTree->Branch( branch_name.Format("%s.part.pz"   , branch_prefix.Data() ), &(ICdata[SDname].ParticleHistory.pz) );
+      tree->Branch( branch_name.Format("%s.part.npart", branch_prefix.Data() ), &(ICdata[SDname].ParticleHistory.npart) );
+      tree->Branch( branch_name.Format("%s.part.PID"  , branch_prefix.Data() ), &(ICdata[SDname].ParticleHistory.PID) );
+      tree->Branch( branch_name.Format("%s.part.MID"  , branch_prefix.Data() ), &(ICdata[SDname].ParticleHistory.MID) );
+      tree->Branch( branch_name.Format("%s.part.TID"  , branch_prefix.Data() ), &(ICdata[SDname].ParticleHistory.TID) );
+      tree->Branch( branch_name.Format("%s.part.vx"   , branch_prefix.Data() ), &(ICdata[SDname].ParticleHistory.vx) );
+      tree->Branch( branch_name.Format("%s.part.vy"   , branch_prefix.Data() ), &(ICdata[SDname].ParticleHistory.vy) );
+      tree->Branch( branch_name.Format("%s.part.vz"   , branch_prefix.Data() ), &(ICdata[SDname].ParticleHistory.vz) );
+      tree->Branch( branch_name.Format("%s.part.px"   , branch_prefix.Data() ), &(ICdata[SDname].ParticleHistory.px) );
+      tree->Branch( branch_name.Format("%s.part.py"   , branch_prefix.Data() ), &(ICdata[SDname].ParticleHistory.py) );
+      tree->Branch( branch_name.Format("%s.part.pz"   , branch_prefix.Data() ), &(ICdata[SDname].ParticleHistory.pz) );
       // fTree->Branch( branch_name.Format("%s.part.nbounce", branch_prefix.Data() ), &(ICdata[SDname].ParticleHistory.nbounce) );
       // fTree->Branch( branch_name.Format("%s.part.hitindex", branch_prefix.Data() ), &(ICdata[SDname].ParticleHistory.hitindex) );
       // fTree->Branch( branch_name.Format("%s.part.Nphe_part", branch_prefix.Data() ), &(ICdata[SDname].Nphe_part) );
@@ -987,15 +1307,17 @@ void G4SBSIO::BranchIC(G4String SDname){
 }
 
 void G4SBSIO::BranchGEnTarget_Glass(G4String SDname){
+   TTree *tree = GetSDTree( SDname );
+
    // create the branches for the GEn target glass cell 
    TString branch_name;
    TString branch_prefix = SDname.data();
    branch_prefix.ReplaceAll("/",".");
    // define branches
-   fTree->Branch( branch_name.Format("%s.hit.nhits", branch_prefix.Data() ), &(genTgtGCdata[SDname].nhits_Target) );
-   fTree->Branch( branch_name.Format("%s.hit.trid" , branch_prefix.Data() ), &(genTgtGCdata[SDname].trid )    );
-   fTree->Branch( branch_name.Format("%s.hit.mid"  , branch_prefix.Data() ), &(genTgtGCdata[SDname].mid  )    );
-   fTree->Branch( branch_name.Format("%s.hit.pid"  , branch_prefix.Data() ), &(genTgtGCdata[SDname].pid  )    );
+   tree->Branch( branch_name.Format("%s.hit.nhits", branch_prefix.Data() ), &(genTgtGCdata[SDname].nhits_Target) );
+   tree->Branch( branch_name.Format("%s.hit.trid" , branch_prefix.Data() ), &(genTgtGCdata[SDname].trid )    );
+   tree->Branch( branch_name.Format("%s.hit.mid"  , branch_prefix.Data() ), &(genTgtGCdata[SDname].mid  )    );
+   tree->Branch( branch_name.Format("%s.hit.pid"  , branch_prefix.Data() ), &(genTgtGCdata[SDname].pid  )    );
    // fTree->Branch( branch_name.Format("%s.hit.x"    , branch_prefix.Data() ), &(genTgtGCdata[SDname].x    )    );
    // fTree->Branch( branch_name.Format("%s.hit.y"    , branch_prefix.Data() ), &(genTgtGCdata[SDname].y    )    );
    // fTree->Branch( branch_name.Format("%s.hit.z"    , branch_prefix.Data() ), &(genTgtGCdata[SDname].z    )    );
@@ -1003,37 +1325,39 @@ void G4SBSIO::BranchGEnTarget_Glass(G4String SDname){
    // fTree->Branch( branch_name.Format("%s.hit.xg"   , branch_prefix.Data() ), &(genTgtGCdata[SDname].xg   )    );
    // fTree->Branch( branch_name.Format("%s.hit.yg"   , branch_prefix.Data() ), &(genTgtGCdata[SDname].yg   )    );
    // fTree->Branch( branch_name.Format("%s.hit.zg"   , branch_prefix.Data() ), &(genTgtGCdata[SDname].zg   )    );
-   fTree->Branch( branch_name.Format("%s.hit.p"    , branch_prefix.Data() ), &(genTgtGCdata[SDname].p    )    );
-   fTree->Branch( branch_name.Format("%s.hit.edep" , branch_prefix.Data() ), &(genTgtGCdata[SDname].edep )    );
-   fTree->Branch( branch_name.Format("%s.hit.beta" , branch_prefix.Data() ), &(genTgtGCdata[SDname].beta )    );
-   fTree->Branch( branch_name.Format("%s.hit.trackLength" , branch_prefix.Data() ), &(genTgtGCdata[SDname].beta )    );
+   tree->Branch( branch_name.Format("%s.hit.p"    , branch_prefix.Data() ), &(genTgtGCdata[SDname].p    )    );
+   tree->Branch( branch_name.Format("%s.hit.edep" , branch_prefix.Data() ), &(genTgtGCdata[SDname].edep )    );
+   tree->Branch( branch_name.Format("%s.hit.beta" , branch_prefix.Data() ), &(genTgtGCdata[SDname].beta )    );
+   tree->Branch( branch_name.Format("%s.hit.trackLength" , branch_prefix.Data() ), &(genTgtGCdata[SDname].beta )    );
 
    map<G4String,G4bool>::iterator it = KeepHistoryflags.find( SDname );
    if( it != KeepHistoryflags.end() && it->second ){
       //Branches with "Particle History" data:
-      fTree->Branch( branch_name.Format("%s.part.npart", branch_prefix.Data() ), &(genTgtGCdata[SDname].ParticleHistory.npart) );
-      fTree->Branch( branch_name.Format("%s.part.PID"  , branch_prefix.Data() ), &(genTgtGCdata[SDname].ParticleHistory.PID) );
-      fTree->Branch( branch_name.Format("%s.part.MID"  , branch_prefix.Data() ), &(genTgtGCdata[SDname].ParticleHistory.MID) );
-      fTree->Branch( branch_name.Format("%s.part.TID"  , branch_prefix.Data() ), &(genTgtGCdata[SDname].ParticleHistory.TID) );
+      tree->Branch( branch_name.Format("%s.part.npart", branch_prefix.Data() ), &(genTgtGCdata[SDname].ParticleHistory.npart) );
+      tree->Branch( branch_name.Format("%s.part.PID"  , branch_prefix.Data() ), &(genTgtGCdata[SDname].ParticleHistory.PID) );
+      tree->Branch( branch_name.Format("%s.part.MID"  , branch_prefix.Data() ), &(genTgtGCdata[SDname].ParticleHistory.MID) );
+      tree->Branch( branch_name.Format("%s.part.TID"  , branch_prefix.Data() ), &(genTgtGCdata[SDname].ParticleHistory.TID) );
       // fTree->Branch( branch_name.Format("%s.part.vx"   , branch_prefix.Data() ), &(genTgtGCdata[SDname].ParticleHistory.vx) );
       // fTree->Branch( branch_name.Format("%s.part.vy"   , branch_prefix.Data() ), &(genTgtGCdata[SDname].ParticleHistory.vy) );
       // fTree->Branch( branch_name.Format("%s.part.vz"   , branch_prefix.Data() ), &(genTgtGCdata[SDname].ParticleHistory.vz) );
-      fTree->Branch( branch_name.Format("%s.part.px"   , branch_prefix.Data() ), &(genTgtGCdata[SDname].ParticleHistory.px) );
-      fTree->Branch( branch_name.Format("%s.part.py"   , branch_prefix.Data() ), &(genTgtGCdata[SDname].ParticleHistory.py) );
-      fTree->Branch( branch_name.Format("%s.part.pz"   , branch_prefix.Data() ), &(genTgtGCdata[SDname].ParticleHistory.pz) );
+      tree->Branch( branch_name.Format("%s.part.px"   , branch_prefix.Data() ), &(genTgtGCdata[SDname].ParticleHistory.px) );
+      tree->Branch( branch_name.Format("%s.part.py"   , branch_prefix.Data() ), &(genTgtGCdata[SDname].ParticleHistory.py) );
+      tree->Branch( branch_name.Format("%s.part.pz"   , branch_prefix.Data() ), &(genTgtGCdata[SDname].ParticleHistory.pz) );
    }
 }
 
 void G4SBSIO::BranchGEnTarget_Al(G4String SDname){
+   TTree *tree = GetSDTree( SDname );
+
    // create the branches for the GEn target glass cell, endcap (Al or Cu) 
    TString branch_name;
    TString branch_prefix = SDname.data();
    branch_prefix.ReplaceAll("/",".");
    // define branches
-   fTree->Branch( branch_name.Format("%s.hit.nhits", branch_prefix.Data() ), &(genTgtALdata[SDname].nhits_Target) );
-   fTree->Branch( branch_name.Format("%s.hit.trid" , branch_prefix.Data() ), &(genTgtALdata[SDname].trid )    );
-   fTree->Branch( branch_name.Format("%s.hit.mid"  , branch_prefix.Data() ), &(genTgtALdata[SDname].mid  )    );
-   fTree->Branch( branch_name.Format("%s.hit.pid"  , branch_prefix.Data() ), &(genTgtALdata[SDname].pid  )    );
+   tree->Branch( branch_name.Format("%s.hit.nhits", branch_prefix.Data() ), &(genTgtALdata[SDname].nhits_Target) );
+   tree->Branch( branch_name.Format("%s.hit.trid" , branch_prefix.Data() ), &(genTgtALdata[SDname].trid )    );
+   tree->Branch( branch_name.Format("%s.hit.mid"  , branch_prefix.Data() ), &(genTgtALdata[SDname].mid  )    );
+   tree->Branch( branch_name.Format("%s.hit.pid"  , branch_prefix.Data() ), &(genTgtALdata[SDname].pid  )    );
    // fTree->Branch( branch_name.Format("%s.hit.x"    , branch_prefix.Data() ), &(genTgtALdata[SDname].x    )    );
    // fTree->Branch( branch_name.Format("%s.hit.y"    , branch_prefix.Data() ), &(genTgtALdata[SDname].y    )    );
    // fTree->Branch( branch_name.Format("%s.hit.z"    , branch_prefix.Data() ), &(genTgtALdata[SDname].z    )    );
@@ -1041,37 +1365,39 @@ void G4SBSIO::BranchGEnTarget_Al(G4String SDname){
    // fTree->Branch( branch_name.Format("%s.hit.xg"   , branch_prefix.Data() ), &(genTgtALdata[SDname].xg   )    );
    // fTree->Branch( branch_name.Format("%s.hit.yg"   , branch_prefix.Data() ), &(genTgtALdata[SDname].yg   )    );
    // fTree->Branch( branch_name.Format("%s.hit.zg"   , branch_prefix.Data() ), &(genTgtALdata[SDname].zg   )    );
-   fTree->Branch( branch_name.Format("%s.hit.p"    , branch_prefix.Data() ), &(genTgtALdata[SDname].p    )    );
-   fTree->Branch( branch_name.Format("%s.hit.edep" , branch_prefix.Data() ), &(genTgtALdata[SDname].edep )    );
-   fTree->Branch( branch_name.Format("%s.hit.beta" , branch_prefix.Data() ), &(genTgtALdata[SDname].beta )    );
-   fTree->Branch( branch_name.Format("%s.hit.trackLength" , branch_prefix.Data() ), &(genTgtALdata[SDname].trackLength )    );
+   tree->Branch( branch_name.Format("%s.hit.p"    , branch_prefix.Data() ), &(genTgtALdata[SDname].p    )    );
+   tree->Branch( branch_name.Format("%s.hit.edep" , branch_prefix.Data() ), &(genTgtALdata[SDname].edep )    );
+   tree->Branch( branch_name.Format("%s.hit.beta" , branch_prefix.Data() ), &(genTgtALdata[SDname].beta )    );
+   tree->Branch( branch_name.Format("%s.hit.trackLength" , branch_prefix.Data() ), &(genTgtALdata[SDname].trackLength )    );
 
    map<G4String,G4bool>::iterator it = KeepHistoryflags.find( SDname );
    if( it != KeepHistoryflags.end() && it->second ){
       //Branches with "Particle History" data:
-      fTree->Branch( branch_name.Format("%s.part.npart", branch_prefix.Data() ), &(genTgtALdata[SDname].ParticleHistory.npart) );
-      fTree->Branch( branch_name.Format("%s.part.PID"  , branch_prefix.Data() ), &(genTgtALdata[SDname].ParticleHistory.PID) );
-      fTree->Branch( branch_name.Format("%s.part.MID"  , branch_prefix.Data() ), &(genTgtALdata[SDname].ParticleHistory.MID) );
-      fTree->Branch( branch_name.Format("%s.part.TID"  , branch_prefix.Data() ), &(genTgtALdata[SDname].ParticleHistory.TID) );
+      tree->Branch( branch_name.Format("%s.part.npart", branch_prefix.Data() ), &(genTgtALdata[SDname].ParticleHistory.npart) );
+      tree->Branch( branch_name.Format("%s.part.PID"  , branch_prefix.Data() ), &(genTgtALdata[SDname].ParticleHistory.PID) );
+      tree->Branch( branch_name.Format("%s.part.MID"  , branch_prefix.Data() ), &(genTgtALdata[SDname].ParticleHistory.MID) );
+      tree->Branch( branch_name.Format("%s.part.TID"  , branch_prefix.Data() ), &(genTgtALdata[SDname].ParticleHistory.TID) );
       // fTree->Branch( branch_name.Format("%s.part.vx"   , branch_prefix.Data() ), &(genTgtALdata[SDname].ParticleHistory.vx) );
       // fTree->Branch( branch_name.Format("%s.part.vy"   , branch_prefix.Data() ), &(genTgtALdata[SDname].ParticleHistory.vy) );
       // fTree->Branch( branch_name.Format("%s.part.vz"   , branch_prefix.Data() ), &(genTgtALdata[SDname].ParticleHistory.vz) );
-      fTree->Branch( branch_name.Format("%s.part.px"   , branch_prefix.Data() ), &(genTgtALdata[SDname].ParticleHistory.px) );
-      fTree->Branch( branch_name.Format("%s.part.py"   , branch_prefix.Data() ), &(genTgtALdata[SDname].ParticleHistory.py) );
-      fTree->Branch( branch_name.Format("%s.part.pz"   , branch_prefix.Data() ), &(genTgtALdata[SDname].ParticleHistory.pz) );
+      tree->Branch( branch_name.Format("%s.part.px"   , branch_prefix.Data() ), &(genTgtALdata[SDname].ParticleHistory.px) );
+      tree->Branch( branch_name.Format("%s.part.py"   , branch_prefix.Data() ), &(genTgtALdata[SDname].ParticleHistory.py) );
+      tree->Branch( branch_name.Format("%s.part.pz"   , branch_prefix.Data() ), &(genTgtALdata[SDname].ParticleHistory.pz) );
    }
 }
 
 void G4SBSIO::BranchGEnTarget_Cu(G4String SDname){
+   TTree *tree = GetSDTree( SDname );
+
    // create the branches for the GEn target glass cell, endcap (Al or Cu) 
    TString branch_name;
    TString branch_prefix = SDname.data();
    branch_prefix.ReplaceAll("/",".");
    // define branches
-   fTree->Branch( branch_name.Format("%s.hit.nhits", branch_prefix.Data() ), &(genTgtCUdata[SDname].nhits_Target) );
-   fTree->Branch( branch_name.Format("%s.hit.trid" , branch_prefix.Data() ), &(genTgtCUdata[SDname].trid )    );
-   fTree->Branch( branch_name.Format("%s.hit.mid"  , branch_prefix.Data() ), &(genTgtCUdata[SDname].mid  )    );
-   fTree->Branch( branch_name.Format("%s.hit.pid"  , branch_prefix.Data() ), &(genTgtCUdata[SDname].pid  )    );
+   tree->Branch( branch_name.Format("%s.hit.nhits", branch_prefix.Data() ), &(genTgtCUdata[SDname].nhits_Target) );
+   tree->Branch( branch_name.Format("%s.hit.trid" , branch_prefix.Data() ), &(genTgtCUdata[SDname].trid )    );
+   tree->Branch( branch_name.Format("%s.hit.mid"  , branch_prefix.Data() ), &(genTgtCUdata[SDname].mid  )    );
+   tree->Branch( branch_name.Format("%s.hit.pid"  , branch_prefix.Data() ), &(genTgtCUdata[SDname].pid  )    );
    // fTree->Branch( branch_name.Format("%s.hit.x"    , branch_prefix.Data() ), &(genTgtCUdata[SDname].x    )    );
    // fTree->Branch( branch_name.Format("%s.hit.y"    , branch_prefix.Data() ), &(genTgtCUdata[SDname].y    )    );
    // fTree->Branch( branch_name.Format("%s.hit.z"    , branch_prefix.Data() ), &(genTgtCUdata[SDname].z    )    );
@@ -1079,37 +1405,39 @@ void G4SBSIO::BranchGEnTarget_Cu(G4String SDname){
    // fTree->Branch( branch_name.Format("%s.hit.xg"   , branch_prefix.Data() ), &(genTgtCUdata[SDname].xg   )    );
    // fTree->Branch( branch_name.Format("%s.hit.yg"   , branch_prefix.Data() ), &(genTgtCUdata[SDname].yg   )    );
    // fTree->Branch( branch_name.Format("%s.hit.zg"   , branch_prefix.Data() ), &(genTgtCUdata[SDname].zg   )    );
-   fTree->Branch( branch_name.Format("%s.hit.p"    , branch_prefix.Data() ), &(genTgtCUdata[SDname].p    )    );
-   fTree->Branch( branch_name.Format("%s.hit.edep" , branch_prefix.Data() ), &(genTgtCUdata[SDname].edep )    );
-   fTree->Branch( branch_name.Format("%s.hit.beta" , branch_prefix.Data() ), &(genTgtCUdata[SDname].beta )    );
-   fTree->Branch( branch_name.Format("%s.hit.trackLength" , branch_prefix.Data() ), &(genTgtCUdata[SDname].trackLength )    );
+   tree->Branch( branch_name.Format("%s.hit.p"    , branch_prefix.Data() ), &(genTgtCUdata[SDname].p    )    );
+   tree->Branch( branch_name.Format("%s.hit.edep" , branch_prefix.Data() ), &(genTgtCUdata[SDname].edep )    );
+   tree->Branch( branch_name.Format("%s.hit.beta" , branch_prefix.Data() ), &(genTgtCUdata[SDname].beta )    );
+   tree->Branch( branch_name.Format("%s.hit.trackLength" , branch_prefix.Data() ), &(genTgtCUdata[SDname].trackLength )    );
 
    map<G4String,G4bool>::iterator it = KeepHistoryflags.find( SDname );
    if( it != KeepHistoryflags.end() && it->second ){
       //Branches with "Particle History" data:
-      fTree->Branch( branch_name.Format("%s.part.npart", branch_prefix.Data() ), &(genTgtCUdata[SDname].ParticleHistory.npart) );
-      fTree->Branch( branch_name.Format("%s.part.PID"  , branch_prefix.Data() ), &(genTgtCUdata[SDname].ParticleHistory.PID) );
-      fTree->Branch( branch_name.Format("%s.part.MID"  , branch_prefix.Data() ), &(genTgtCUdata[SDname].ParticleHistory.MID) );
-      fTree->Branch( branch_name.Format("%s.part.TID"  , branch_prefix.Data() ), &(genTgtCUdata[SDname].ParticleHistory.TID) );
+      tree->Branch( branch_name.Format("%s.part.npart", branch_prefix.Data() ), &(genTgtCUdata[SDname].ParticleHistory.npart) );
+      tree->Branch( branch_name.Format("%s.part.PID"  , branch_prefix.Data() ), &(genTgtCUdata[SDname].ParticleHistory.PID) );
+      tree->Branch( branch_name.Format("%s.part.MID"  , branch_prefix.Data() ), &(genTgtCUdata[SDname].ParticleHistory.MID) );
+      tree->Branch( branch_name.Format("%s.part.TID"  , branch_prefix.Data() ), &(genTgtCUdata[SDname].ParticleHistory.TID) );
       // fTree->Branch( branch_name.Format("%s.part.vx"   , branch_prefix.Data() ), &(genTgtCUdata[SDname].ParticleHistory.vx) );
       // fTree->Branch( branch_name.Format("%s.part.vy"   , branch_prefix.Data() ), &(genTgtCUdata[SDname].ParticleHistory.vy) );
       // fTree->Branch( branch_name.Format("%s.part.vz"   , branch_prefix.Data() ), &(genTgtCUdata[SDname].ParticleHistory.vz) );
-      fTree->Branch( branch_name.Format("%s.part.px"   , branch_prefix.Data() ), &(genTgtCUdata[SDname].ParticleHistory.px) );
-      fTree->Branch( branch_name.Format("%s.part.py"   , branch_prefix.Data() ), &(genTgtCUdata[SDname].ParticleHistory.py) );
-      fTree->Branch( branch_name.Format("%s.part.pz"   , branch_prefix.Data() ), &(genTgtCUdata[SDname].ParticleHistory.pz) );
+      tree->Branch( branch_name.Format("%s.part.px"   , branch_prefix.Data() ), &(genTgtCUdata[SDname].ParticleHistory.px) );
+      tree->Branch( branch_name.Format("%s.part.py"   , branch_prefix.Data() ), &(genTgtCUdata[SDname].ParticleHistory.py) );
+      tree->Branch( branch_name.Format("%s.part.pz"   , branch_prefix.Data() ), &(genTgtCUdata[SDname].ParticleHistory.pz) );
    }
 }
 
 void G4SBSIO::BranchGEnTarget_3He(G4String SDname){
+   TTree *tree = GetSDTree( SDname );
+
    // create the branches for the GEn target glass cell, endcap (Al or Cu) 
    TString branch_name;
    TString branch_prefix = SDname.data();
    branch_prefix.ReplaceAll("/",".");
    // define branches
-   fTree->Branch( branch_name.Format("%s.hit.nhits", branch_prefix.Data() ), &(genTgt3HEdata[SDname].nhits_Target) );
-   fTree->Branch( branch_name.Format("%s.hit.trid" , branch_prefix.Data() ), &(genTgt3HEdata[SDname].trid )    );
-   fTree->Branch( branch_name.Format("%s.hit.mid"  , branch_prefix.Data() ), &(genTgt3HEdata[SDname].mid  )    );
-   fTree->Branch( branch_name.Format("%s.hit.pid"  , branch_prefix.Data() ), &(genTgt3HEdata[SDname].pid  )    );
+   tree->Branch( branch_name.Format("%s.hit.nhits", branch_prefix.Data() ), &(genTgt3HEdata[SDname].nhits_Target) );
+   tree->Branch( branch_name.Format("%s.hit.trid" , branch_prefix.Data() ), &(genTgt3HEdata[SDname].trid )    );
+   tree->Branch( branch_name.Format("%s.hit.mid"  , branch_prefix.Data() ), &(genTgt3HEdata[SDname].mid  )    );
+   tree->Branch( branch_name.Format("%s.hit.pid"  , branch_prefix.Data() ), &(genTgt3HEdata[SDname].pid  )    );
    // fTree->Branch( branch_name.Format("%s.hit.x"    , branch_prefix.Data() ), &(genTgt3HEdata[SDname].x    )    );
    // fTree->Branch( branch_name.Format("%s.hit.y"    , branch_prefix.Data() ), &(genTgt3HEdata[SDname].y    )    );
    // fTree->Branch( branch_name.Format("%s.hit.z"    , branch_prefix.Data() ), &(genTgt3HEdata[SDname].z    )    );
@@ -1117,24 +1445,24 @@ void G4SBSIO::BranchGEnTarget_3He(G4String SDname){
    // fTree->Branch( branch_name.Format("%s.hit.xg"   , branch_prefix.Data() ), &(genTgt3HEdata[SDname].xg   )    );
    // fTree->Branch( branch_name.Format("%s.hit.yg"   , branch_prefix.Data() ), &(genTgt3HEdata[SDname].yg   )    );
    // fTree->Branch( branch_name.Format("%s.hit.zg"   , branch_prefix.Data() ), &(genTgt3HEdata[SDname].zg   )    );
-   fTree->Branch( branch_name.Format("%s.hit.p"    , branch_prefix.Data() ), &(genTgt3HEdata[SDname].p    )    );
-   fTree->Branch( branch_name.Format("%s.hit.edep" , branch_prefix.Data() ), &(genTgt3HEdata[SDname].edep )    );
-   fTree->Branch( branch_name.Format("%s.hit.beta" , branch_prefix.Data() ), &(genTgt3HEdata[SDname].beta )    );
-   fTree->Branch( branch_name.Format("%s.hit.trackLength" , branch_prefix.Data() ), &(genTgt3HEdata[SDname].trackLength )    );
+   tree->Branch( branch_name.Format("%s.hit.p"    , branch_prefix.Data() ), &(genTgt3HEdata[SDname].p    )    );
+   tree->Branch( branch_name.Format("%s.hit.edep" , branch_prefix.Data() ), &(genTgt3HEdata[SDname].edep )    );
+   tree->Branch( branch_name.Format("%s.hit.beta" , branch_prefix.Data() ), &(genTgt3HEdata[SDname].beta )    );
+   tree->Branch( branch_name.Format("%s.hit.trackLength" , branch_prefix.Data() ), &(genTgt3HEdata[SDname].trackLength )    );
 
    map<G4String,G4bool>::iterator it = KeepHistoryflags.find( SDname );
    if( it != KeepHistoryflags.end() && it->second ){
       //Branches with "Particle History" data:
-      fTree->Branch( branch_name.Format("%s.part.npart", branch_prefix.Data() ), &(genTgt3HEdata[SDname].ParticleHistory.npart) );
-      fTree->Branch( branch_name.Format("%s.part.PID"  , branch_prefix.Data() ), &(genTgt3HEdata[SDname].ParticleHistory.PID) );
-      fTree->Branch( branch_name.Format("%s.part.MID"  , branch_prefix.Data() ), &(genTgt3HEdata[SDname].ParticleHistory.MID) );
-      fTree->Branch( branch_name.Format("%s.part.TID"  , branch_prefix.Data() ), &(genTgt3HEdata[SDname].ParticleHistory.TID) );
+      tree->Branch( branch_name.Format("%s.part.npart", branch_prefix.Data() ), &(genTgt3HEdata[SDname].ParticleHistory.npart) );
+      tree->Branch( branch_name.Format("%s.part.PID"  , branch_prefix.Data() ), &(genTgt3HEdata[SDname].ParticleHistory.PID) );
+      tree->Branch( branch_name.Format("%s.part.MID"  , branch_prefix.Data() ), &(genTgt3HEdata[SDname].ParticleHistory.MID) );
+      tree->Branch( branch_name.Format("%s.part.TID"  , branch_prefix.Data() ), &(genTgt3HEdata[SDname].ParticleHistory.TID) );
       // fTree->Branch( branch_name.Format("%s.part.vx"   , branch_prefix.Data() ), &(genTgt3HEdata[SDname].ParticleHistory.vx) );
       // fTree->Branch( branch_name.Format("%s.part.vy"   , branch_prefix.Data() ), &(genTgt3HEdata[SDname].ParticleHistory.vy) );
       // fTree->Branch( branch_name.Format("%s.part.vz"   , branch_prefix.Data() ), &(genTgt3HEdata[SDname].ParticleHistory.vz) );
-      fTree->Branch( branch_name.Format("%s.part.px"   , branch_prefix.Data() ), &(genTgt3HEdata[SDname].ParticleHistory.px) );
-      fTree->Branch( branch_name.Format("%s.part.py"   , branch_prefix.Data() ), &(genTgt3HEdata[SDname].ParticleHistory.py) );
-      fTree->Branch( branch_name.Format("%s.part.pz"   , branch_prefix.Data() ), &(genTgt3HEdata[SDname].ParticleHistory.pz) );
+      tree->Branch( branch_name.Format("%s.part.px"   , branch_prefix.Data() ), &(genTgt3HEdata[SDname].ParticleHistory.px) );
+      tree->Branch( branch_name.Format("%s.part.py"   , branch_prefix.Data() ), &(genTgt3HEdata[SDname].ParticleHistory.py) );
+      tree->Branch( branch_name.Format("%s.part.pz"   , branch_prefix.Data() ), &(genTgt3HEdata[SDname].ParticleHistory.pz) );
    }
 }
 
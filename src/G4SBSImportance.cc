@@ -0,0 +1,188 @@
+#include "G4SBSImportance.hh"
+#include "G4SBSTrackInformation.hh"
+
+#include "G4Step.hh"
+#include "G4StepPoint.hh"
+#include "G4Track.hh"
+#include "G4DynamicParticle.hh"
+#include "G4LogicalVolume.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4Region.hh"
+#include "G4TransportationManager.hh"
+#include "G4Navigator.hh"
+#include "G4ParticleTable.hh"
+#include "G4OpticalPhoton.hh"
+#include "Randomize.hh"
+#include "G4ios.hh"
+
+G4SBSImportance *G4SBSImportance::gSingleton = NULL;
+
+G4SBSImportance::G4SBSImportance(){
+  gSingleton = this;
+
+  fNsplit = fNclones = fNroulette = fNkilled = 0;
+}
+
+G4SBSImportance::~G4SBSImportance(){
+  ;
+}
+
+G4SBSImportance *G4SBSImportance::GetImportance(){
+  if( gSingleton == NULL ){
+    gSingleton = new G4SBSImportance();
+  }
+  return gSingleton;
+}
+
+void G4SBSImportance::Clear(){
+  fImportanceByName.clear();
+  fParticleNames.clear();
+  fImportance.clear();
+  fParticles.clear();
+}
+
+void G4SBSImportance::AssignImportance( G4LogicalVolume *lv, G4double mother_importance ){
+  //Logical volumes placed many times are only visited once; the first mother found wins:
+  if( fImportance.find( lv ) != fImportance.end() ) return;
+
+  G4double importance = mother_importance;
+
+  map<G4String,G4double>::iterator it = fImportanceByName.find( lv->GetName() );
+  if( it != fImportanceByName.end() ){
+    importance = it->second;
+  } else if( lv->GetRegion() != NULL ){
+    it = fImportanceByName.find( lv->GetRegion()->GetName() );
+    if( it != fImportanceByName.end() ) importance = it->second;
+  }
+
+  fImportance[lv] = importance;
+
+  for( G4int i=0; i<lv->GetNoDaughters(); i++ ){
+    AssignImportance( lv->GetDaughter(i)->GetLogicalVolume(), importance );
+  }
+}
+
+void G4SBSImportance::BeginOfRun(){
+  fNsplit = fNclones = fNroulette = fNkilled = 0;
+  fSumW.clear();
+  fSumW2.clear();
+  fNhits.clear();
+
+  fImportance.clear();
+  fParticles.clear();
+
+  if( !IsActive() ) return;
+
+  for( map<G4String,G4double>::iterator it = fImportanceByName.begin(); it != fImportanceByName.end(); ++it ){
+    if( it->second <= 0.0 ){
+      fprintf(stderr, "%s: %s line %d - Error: importance of %s must be positive\n", __PRETTY_FUNCTION__, __FILE__, __LINE__, it->first.data() );
+      exit(-1);
+    }
+  }
+
+  for( set<G4String>::iterator it = fParticleNames.begin(); it != fParticleNames.end(); ++it ){
+    G4ParticleDefinition *pdef = G4ParticleTable::GetParticleTable()->FindParticle( *it );
+    if( pdef == NULL ){
+      fprintf(stderr, "%s: %s line %d - Error: unknown particle %s for importance biasing\n", __PRETTY_FUNCTION__, __FILE__, __LINE__, it->data() );
+      exit(-1);
+    }
+    fParticles.insert( pdef );
+  }
+
+  G4VPhysicalVolume *world = G4TransportationManager::GetTransportationManager()->GetNavigatorForTracking()->GetWorldVolume();
+  AssignImportance( world->GetLogicalVolume(), 1.0 );
+
+  G4cout << "Importance biasing active in " << fImportanceByName.size() << " volumes/regions" << G4endl;
+}
+
+void G4SBSImportance::UpdateSDWeight( const G4Track *aTrack, G4SBSTrackInformation *info ){
+  //SD boundaries crossed in this same step were recorded by the stepping action with the weight before
+  //splitting or roulette:
+  if( info == NULL ) return;
+  for( map<G4String,G4int>::iterator it = info->fSDTrackID.begin(); it != info->fSDTrackID.end(); ++it ){
+    if( it->second == aTrack->GetTrackID() && info->fSDTime[it->first] == aTrack->GetGlobalTime() ){
+      info->fSDWeight[it->first] = aTrack->GetWeight();
+    }
+  }
+}
+
+void G4SBSImportance::ProcessStep( const G4Step *aStep, G4TrackVector *secondaries ){
+  G4StepPoint *pre = aStep->GetPreStepPoint();
+  G4StepPoint *post = aStep->GetPostStepPoint();
+
+  if( post->GetStepStatus() != fGeomBoundary || post->GetPhysicalVolume() == NULL ) return;
+
+  G4Track *theTrack = aStep->GetTrack();
+  const G4ParticleDefinition *pdef = theTrack->GetParticleDefinition();
+
+  if( fParticles.empty() ){
+    if( pdef == G4OpticalPhoton::OpticalPhotonDefinition() ) return;
+  } else if( fParticles.find( pdef ) == fParticles.end() ){
+    return;
+  }
+
+  G4double I1 = fImportance[ pre->GetPhysicalVolume()->GetLogicalVolume() ];
+  G4double I2 = fImportance[ post->GetPhysicalVolume()->GetLogicalVolume() ];
+
+  if( I1 == I2 || I1 <= 0.0 || I2 <= 0.0 ) return;
+
+  G4double r = I2/I1;
+  G4double w = theTrack->GetWeight();
+
+  G4SBSTrackInformation *info = (G4SBSTrackInformation*) theTrack->GetUserInformation();
+
+  if( r > 1.0 ){ //splitting:
+    G4int ncopies = G4int(r);
+    if( CLHEP::RandFlat::shoot() < r - ncopies ) ncopies++;
+
+    theTrack->SetWeight( w/r );
+    UpdateSDWeight( theTrack, info );
+
+    for( G4int i=1; i<ncopies; i++ ){
+      G4Track *clone = new G4Track( new G4DynamicParticle( *(theTrack->GetDynamicParticle()) ),
+				    post->GetGlobalTime(), post->GetPosition() );
+      clone->SetWeight( w/r );
+      clone->SetParentID( theTrack->GetTrackID() );
+      clone->SetTouchableHandle( post->GetTouchableHandle() );
+      clone->SetCreatorProcess( theTrack->GetCreatorProcess() );
+      //The clone carries its own copy of the track information; see G4SBSTrackingAction:
+      if( info ) clone->SetUserInformation( new G4SBSTrackInformation( info ) );
+      secondaries->push_back( clone );
+      fNclones++;
+    }
+    fNsplit++;
+  } else { //Russian roulette:
+    fNroulette++;
+    if( CLHEP::RandFlat::shoot() < r ){
+      theTrack->SetWeight( w/r );
+      UpdateSDWeight( theTrack, info );
+    } else {
+      theTrack->SetTrackStatus( fStopAndKill );
+      fNkilled++;
+    }
+  }
+}
+
+void G4SBSImportance::ScoreHit( G4String SDname, G4double weight ){
+  fSumW[SDname] += weight;
+  fSumW2[SDname] += weight*weight;
+  fNhits[SDname]++;
+}
+
+void G4SBSImportance::EndOfRun( G4double cputime ){
+  if( !IsActive() ) return;
+
+  G4cout << "Importance biasing summary: " << fNsplit << " splittings (" << fNclones << " copies created), "
+	 << fNroulette << " roulette games (" << fNkilled << " tracks killed)" << G4endl;
+
+  G4double hours = cputime/3600.0;
+
+  for( map<G4String,G4long>::iterator it = fNhits.begin(); it != fNhits.end(); ++it ){
+    G4String SDname = it->first;
+    G4double Neff = fSumW2[SDname] > 0.0 ? pow( fSumW[SDname], 2 )/fSumW2[SDname] : 0.0;
+    G4cout << "  " << SDname << ": " << it->second << " hits, sum of weights = " << fSumW[SDname]
+	   << ", effective hits = " << Neff;
+    if( hours > 0.0 ) G4cout << ", effective hits per CPU hour = " << Neff/hours;
+    G4cout << G4endl;
+  }
+}
@@ -1,4 +1,5 @@
 #include "G4SBSIonChamberSD.hh"
+#include "G4SBSProfiler.hh"
 
 //______________________________________________________________________________
 G4SBSIonChamberSD::G4SBSIonChamberSD(
@@ -9,6 +10,7 @@ G4SBSIonChamberSD::G4SBSIonChamberSD(
 //   fNofCells(nofCells)
 {
   collectionName.insert(hitsCollectionName);
+  fProfileID = G4SBSProfiler::GetProfiler()->RegisterSD( name );
 }
 //______________________________________________________________________________
 G4SBSIonChamberSD::~G4SBSIonChamberSD()
@@ -37,6 +39,7 @@ void G4SBSIonChamberSD::Initialize(G4HCofThisEvent* hce)
 //______________________________________________________________________________
 G4bool G4SBSIonChamberSD::ProcessHits(G4Step* step,G4TouchableHistory*)
 {
+  G4SBSProfiler::Scope prof( fProfileID );
 
   // energy deposit
   auto edep = step->GetTotalEnergyDeposit();
@@ -11,6 +11,7 @@
 #include "G4UIcmdWithADouble.hh"
 #include "G4UIcmdWithABool.hh"
 #include "G4UIcmdWith3Vector.hh"
+#include "G4UIcmdWithoutParameter.hh"
 
 #include "G4SBSDetectorConstruction.hh"
 #include "G4SBSIO.hh"
@@ -34,6 +35,17 @@
 
 #include "G4SBSSteppingAction.hh"
 #include "G4SBSTrackingAction.hh"
+#include "G4SBSOpticalLUT.hh"
+#include "G4SBSPhaseSpace.hh"
+#include "G4SBSPileup.hh"
+#include "G4SBSTrigger.hh"
+#include "G4SBSPhotonThinning.hh"
+#include "G4SBSGEMDigitizer.hh"
+#include "G4SBSCulling.hh"
+#include "G4SBSImportance.hh"
+#include "G4SBSRandom.hh"
+#include "G4SBSProfiler.hh"
+#include "G4SBSRunCache.hh"
 
 #include "G4SolidStore.hh"
 #include "G4LogicalVolumeStore.hh"
@@ -50,15 +62,45 @@
 #include <unistd.h>
 #endif
 
+#include <fstream>
+
 using namespace CLHEP;
 
 G4SBSMessenger::G4SBSMessenger(){
   fExpType = G4SBS::kGMN; //default to GMN
 
+  fGeometryModified = true; //The first /g4sbs/run always builds the geometry
+
+  fShardIndex = 0;
+  fNshards = 1;
+
   runCmd = new G4UIcmdWithAnInteger("/g4sbs/run",this);
   runCmd->SetGuidance("Run simulation with x events");
   runCmd->SetParameterName("nevt", false);
 
+  scanCmd = new G4UIcommand("/g4sbs/scan",this);
+  scanCmd->SetGuidance("Run a scan over a table of parameter points in one process, one output file per point");
+  scanCmd->SetGuidance("Usage: /g4sbs/scan tablefile nevt");
+  scanCmd->SetGuidance("First non-comment line of the table: list of UI commands, with optional unit as command:unit");
+  scanCmd->SetGuidance("   e.g.: /g4sbs/beamE:GeV /g4sbs/thmin:deg /g4sbs/thmax:deg /g4sbs/scalesbsfield");
+  scanCmd->SetGuidance("Each following line is one point: output ROOT file name followed by one value per command");
+  scanCmd->SetGuidance("Lines starting with # are ignored");
+  scanCmd->SetGuidance("Geometry is only rebuilt for points that change a geometry-related setting");
+  scanCmd->SetParameter( new G4UIparameter("tablefile", 's', false ) );
+  scanCmd->SetParameter( new G4UIparameter("nevt", 'i', false ) );
+
+  shardCmd = new G4UIcommand("/g4sbs/shard",this);
+  shardCmd->SetGuidance("Process only slice i of N of the events of the following /g4sbs/run commands");
+  shardCmd->SetGuidance("Usage: /g4sbs/shard i N (0 <= i < N; default 0 1 = no sharding)");
+  shardCmd->SetGuidance("/g4sbs/run nevt then simulates events [i*nevt/N, (i+1)*nevt/N) of the full run; for PYTHIA6/SIMC,");
+  shardCmd->SetGuidance("the corresponding slice of the input chain. ev.rate is normalized to the full run, and with");
+  shardCmd->SetGuidance("/g4sbs/rngstreams true the shards reproduce the events of the single job exactly");
+  shardCmd->SetGuidance("With rejection sampling, all shards must find the same max. event weight: this requires");
+  shardCmd->SetGuidance("/g4sbs/rngstreams true and a common /g4sbs/rngseed, so that the warm-up is identical in every shard");
+  shardCmd->SetGuidance("Combine the output files with root_macros/g4sbs_merge_shards.C");
+  shardCmd->SetParameter( new G4UIparameter("ishard", 'i', false ) );
+  shardCmd->SetParameter( new G4UIparameter("nshards", 'i', false ) );
+
   printCmd = new G4UIcmdWithAnInteger("/g4sbs/print",this); 
   printCmd->SetGuidance("Print the line number (arg = number)"); 
   printCmd->SetParameterName("print",false); 
@@ -761,6 +803,26 @@ G4SBSMessenger::G4SBSMessenger(){
   TreeFlagCmd->SetGuidance("G4SBS ROOT tree filling: 0=keep all, 1=keep only evts w/hits in sensitive volumes");
   TreeFlagCmd->SetParameterName("treeflag",false);
 
+  SparseOutputCmd = new G4UIcmdWithABool("/g4sbs/sparseoutput",this);
+  SparseOutputCmd->SetGuidance("Sparse output: store hit data of each sensitive detector in its own tree (T_<SDname>),");
+  SparseOutputCmd->SetGuidance("filled only for events with hits in that SD, with a per-event index (sparse.*) in the main tree");
+  SparseOutputCmd->SetGuidance("Use root_macros/g4sbs_sparse_to_dense.C to convert to the standard tree layout");
+  SparseOutputCmd->SetParameterName("sparseoutput",true);
+  SparseOutputCmd->SetDefaultValue(true);
+
+  CompactOutputCmd = new G4UIcmdWithABool("/g4sbs/compactoutput",this);
+  CompactOutputCmd->SetGuidance("Compact output: write the floating-point hit data of GEM, CAL and SD track branches as float32,");
+  CompactOutputCmd->SetGuidance("with positions rounded to 2^-16 m (15 micron) and times to 2^-6 ns (16 ps); energies and momenta keep float32 precision");
+  CompactOutputCmd->SetGuidance("Branch names are unchanged; the schema version and rounding steps are stored in run_data");
+  CompactOutputCmd->SetParameterName("compactoutput",true);
+  CompactOutputCmd->SetDefaultValue(true);
+
+  AsyncWriteCmd = new G4UIcmdWithABool("/g4sbs/asyncwrite",this);
+  AsyncWriteCmd->SetGuidance("Asynchronous output: fill the ROOT tree(s) of each event (including basket compression and disk writes)");
+  AsyncWriteCmd->SetGuidance("in a separate writer thread while the next event is tracked. The output is identical to the default mode");
+  AsyncWriteCmd->SetParameterName("asyncwrite",true);
+  AsyncWriteCmd->SetDefaultValue(true);
+
   SBS_FT_absorberCmd = new G4UIcmdWithABool("/g4sbs/FTabsorberflag",this);
   SBS_FT_absorberCmd->SetGuidance("Turn on sheet of absorber material in front of SBS FT (only applicable to GEP)");
   SBS_FT_absorberCmd->SetParameterName("FTabsflag",false);
@@ -845,6 +907,13 @@ G4SBSMessenger::G4SBSMessenger(){
   KeepPulseShapeCmd->SetParameter( new G4UIparameter("sdname", 's', false ) );
   KeepPulseShapeCmd->SetParameter( new G4UIparameter("flag", 'b', false) );
   KeepPulseShapeCmd->GetParameter(1)->SetDefaultValue(false);    
+
+  SparsePulseShapeCmd = new G4UIcmdWithABool("/g4sbs/sparsepulseshape",this);
+  SparsePulseShapeCmd->SetGuidance("Write the pulse shapes kept with /g4sbs/keeppulseshapeinfo as a list of the non-empty time bins");
+  SparsePulseShapeCmd->SetGuidance("(branches hit.ps_idx, hit.ps_bin, hit.ps_val) instead of hit.edep_vs_time / hit.NPE_vs_time");
+  SparsePulseShapeCmd->SetGuidance("Use root_macros/ExpandPulseShape.C to expand them");
+  SparsePulseShapeCmd->SetParameterName("sparsepulseshape",true);
+  SparsePulseShapeCmd->SetDefaultValue(true);
   // **********
 
   KeepSDtrackcmd = new G4UIcommand("/g4sbs/keepsdtrackinfo",this);
@@ -855,6 +924,278 @@ G4SBSMessenger::G4SBSMessenger(){
   KeepSDtrackcmd->SetParameter( new G4UIparameter("sdname", 's', false ) );
   KeepSDtrackcmd->SetParameter( new G4UIparameter("flag", 'b', true) );
   KeepSDtrackcmd->GetParameter(1)->SetDefaultValue(true);
+
+  OpticalLUTModeCmd = new G4UIcmdWithAnInteger("/g4sbs/opticalLUTmode",this);
+  OpticalLUTModeCmd->SetGuidance("Optical photon lookup table mode for RICH/GRINCH/ECAL-type detectors:");
+  OpticalLUTModeCmd->SetGuidance("0 = off (default): full optical photon tracking");
+  OpticalLUTModeCmd->SetGuidance("1 = calibrate: full optical photon tracking, tabulate photon collection by emission bin and write the table at end of run");
+  OpticalLUTModeCmd->SetGuidance("2 = production: read the table, sample PMT hits from it and do not track photons emitted in tabulated bins");
+  OpticalLUTModeCmd->SetParameterName("lutmode",false);
+  OpticalLUTModeCmd->SetRange("lutmode>=0 && lutmode<=2");
+
+  OpticalLUTFileCmd = new G4UIcmdWithAString("/g4sbs/opticalLUTfile",this);
+  OpticalLUTFileCmd->SetGuidance("Name of optical photon lookup table file (written in calibration mode, read in production mode)");
+  OpticalLUTFileCmd->SetParameterName("lutfile",false);
+
+  OpticalLUTRegionCmd = new G4UIcommand("/g4sbs/opticalLUTregion",this);
+  OpticalLUTRegionCmd->SetGuidance("Define the optical photon emission region (global coordinates) tabulated for a sensitive detector");
+  OpticalLUTRegionCmd->SetGuidance("Usage: /g4sbs/opticalLUTregion SDname xmin xmax ymin ymax zmin zmax unit");
+  OpticalLUTRegionCmd->SetGuidance("Regions of different detectors should not overlap");
+  OpticalLUTRegionCmd->SetParameter( new G4UIparameter("sdname", 's', false ) );
+  OpticalLUTRegionCmd->SetParameter( new G4UIparameter("xmin", 'd', false ) );
+  OpticalLUTRegionCmd->SetParameter( new G4UIparameter("xmax", 'd', false ) );
+  OpticalLUTRegionCmd->SetParameter( new G4UIparameter("ymin", 'd', false ) );
+  OpticalLUTRegionCmd->SetParameter( new G4UIparameter("ymax", 'd', false ) );
+  OpticalLUTRegionCmd->SetParameter( new G4UIparameter("zmin", 'd', false ) );
+  OpticalLUTRegionCmd->SetParameter( new G4UIparameter("zmax", 'd', false ) );
+  OpticalLUTRegionCmd->SetParameter( new G4UIparameter("unit", 's', false ) );
+
+  OpticalLUTBinsCmd = new G4UIcommand("/g4sbs/opticalLUTbins",this);
+  OpticalLUTBinsCmd->SetGuidance("Set optical photon lookup table binning in emission position and direction");
+  OpticalLUTBinsCmd->SetGuidance("Usage: /g4sbs/opticalLUTbins nx ny nz ncostheta nphi (default = 10 10 10 10 12)");
+  OpticalLUTBinsCmd->SetParameter( new G4UIparameter("nx", 'i', false ) );
+  OpticalLUTBinsCmd->SetParameter( new G4UIparameter("ny", 'i', false ) );
+  OpticalLUTBinsCmd->SetParameter( new G4UIparameter("nz", 'i', false ) );
+  OpticalLUTBinsCmd->SetParameter( new G4UIparameter("ncostheta", 'i', false ) );
+  OpticalLUTBinsCmd->SetParameter( new G4UIparameter("nphi", 'i', false ) );
+
+  OpticalLUTMinEntriesCmd = new G4UIcmdWithADouble("/g4sbs/opticalLUTminentries",this);
+  OpticalLUTMinEntriesCmd->SetGuidance("Minimum number of calibration photons in a bin to use the lookup table in production mode (default = 100)");
+  OpticalLUTMinEntriesCmd->SetGuidance("Photons emitted in bins with fewer entries are tracked normally");
+  OpticalLUTMinEntriesCmd->SetParameterName("nmin",false);
+
+  PhaseSpaceRecordCmd = new G4UIcmdWithAString("/g4sbs/phasespacerecord",this);
+  PhaseSpaceRecordCmd->SetGuidance("Record all particles crossing the phase space surface (outward) to a binary file");
+  PhaseSpaceRecordCmd->SetGuidance("The file can be replayed later with /g4sbs/kine phasespace and /g4sbs/phasespacefile");
+  PhaseSpaceRecordCmd->SetGuidance("Argument = output file name, or none to turn off recording (default)");
+  PhaseSpaceRecordCmd->SetParameterName("psrecordfile",false);
+
+  PhaseSpaceSurfaceCmd = new G4UIcommand("/g4sbs/phasespacesurface",this);
+  PhaseSpaceSurfaceCmd->SetGuidance("Define the phase space recording surface");
+  PhaseSpaceSurfaceCmd->SetGuidance("Usage: /g4sbs/phasespacesurface type value unit");
+  PhaseSpaceSurfaceCmd->SetGuidance("type = sphere (value = radius, centered at the origin) or zplane (value = z position)");
+  PhaseSpaceSurfaceCmd->SetGuidance("Default = sphere of radius 1 m");
+  PhaseSpaceSurfaceCmd->SetParameter( new G4UIparameter("type", 's', false ) );
+  PhaseSpaceSurfaceCmd->SetParameter( new G4UIparameter("value", 'd', false ) );
+  PhaseSpaceSurfaceCmd->SetParameter( new G4UIparameter("unit", 's', false ) );
+
+  PhaseSpaceKillCmd = new G4UIcmdWithABool("/g4sbs/phasespacekill",this);
+  PhaseSpaceKillCmd->SetGuidance("Kill particles after recording them on the phase space surface (default = true)");
+  PhaseSpaceKillCmd->SetParameterName("pskill",true);
+  PhaseSpaceKillCmd->SetDefaultValue(true);
+
+  PhaseSpaceFileCmd = new G4UIcmdWithAString("/g4sbs/phasespacefile",this);
+  PhaseSpaceFileCmd->SetGuidance("Phase space file to replay with /g4sbs/kine phasespace");
+  PhaseSpaceFileCmd->SetParameterName("psfile",false);
+
+  PhaseSpaceResampleCmd = new G4UIcmdWithAnInteger("/g4sbs/phasespaceresample",this);
+  PhaseSpaceResampleCmd->SetGuidance("Number of times each recorded event is replayed (default = 1)");
+  PhaseSpaceResampleCmd->SetGuidance("Each reuse after the first is randomly rotated about the beam axis");
+  PhaseSpaceResampleCmd->SetParameterName("psresample",false);
+  PhaseSpaceResampleCmd->SetRange("psresample>=1");
+
+  PileupCmd = new G4UIcmdWithABool("/g4sbs/pileup",this);
+  PileupCmd->SetGuidance("Superimpose beam background events from a library of g4sbs output files on each event (default = false)");
+  PileupCmd->SetGuidance("Mixed GEM and calorimeter hits are flagged in the new hit.bkgd branches");
+  PileupCmd->SetParameterName("pileup",true);
+  PileupCmd->SetDefaultValue(true);
+
+  PileupFileCmd = new G4UIcmdWithAString("/g4sbs/pileupfile",this);
+  PileupFileCmd->SetGuidance("Add a g4sbs output file (beam background run, standard tree layout) to the pile-up library");
+  PileupFileCmd->SetGuidance("Wildcards are allowed, as in TChain::Add");
+  PileupFileCmd->SetParameterName("pileupfile",false);
+
+  PileupMeanCmd = new G4UIcmdWithADouble("/g4sbs/pileupmean",this);
+  PileupMeanCmd->SetGuidance("Override the mean number of library events superimposed per event");
+  PileupMeanCmd->SetGuidance("Default (negative value) = computed from the beam current, the library normalization and the largest detector time window");
+  PileupMeanCmd->SetParameterName("pileupmean",false);
+
+  CullCmd = new G4UIcommand("/g4sbs/cull",this);
+  CullCmd->SetGuidance("Kill tracks below a kinetic energy threshold in a logical volume, or in all logical volumes of a region");
+  CullCmd->SetGuidance("Usage: /g4sbs/cull volume particle Ethresh unit");
+  CullCmd->SetGuidance("particle = Geant4 particle name, or all");
+  CullCmd->SetGuidance("Can be repeated; the number of tracks killed by each rule is printed at the end of the run");
+  CullCmd->SetParameter( new G4UIparameter("volume", 's', false ) );
+  CullCmd->SetParameter( new G4UIparameter("particle", 's', false ) );
+  CullCmd->SetParameter( new G4UIparameter("Ethresh", 'd', false ) );
+  CullCmd->SetParameter( new G4UIparameter("unit", 's', false ) );
+
+  CullEscapeCmd = new G4UIcmdWithADoubleAndUnit("/g4sbs/cullescape",this);
+  CullEscapeCmd->SetGuidance("Kill tracks outside a sphere of this radius around the target and moving away from it");
+  CullEscapeCmd->SetGuidance("0 = off (default)");
+  CullEscapeCmd->SetParameterName("cullradius",false);
+  CullEscapeCmd->SetDefaultUnit("m");
+
+  CullClearCmd = new G4UIcmdWithoutParameter("/g4sbs/cullclear",this);
+  CullClearCmd->SetGuidance("Remove all culling rules, including /g4sbs/cullescape");
+
+  ImportanceCmd = new G4UIcommand("/g4sbs/importance",this);
+  ImportanceCmd->SetGuidance("Assign an importance to a logical volume, or to all logical volumes of a region");
+  ImportanceCmd->SetGuidance("Usage: /g4sbs/importance volume value");
+  ImportanceCmd->SetGuidance("Daughter volumes inherit the importance of their mother; the world has importance 1");
+  ImportanceCmd->SetGuidance("Tracks are split or played Russian roulette when crossing into a volume of different importance");
+  ImportanceCmd->SetGuidance("Track weights are written to the hit.weight and SDTrack.weight branches");
+  ImportanceCmd->SetParameter( new G4UIparameter("volume", 's', false ) );
+  ImportanceCmd->SetParameter( new G4UIparameter("value", 'd', false ) );
+
+  ImportanceParticleCmd = new G4UIcmdWithAString("/g4sbs/importanceparticle",this);
+  ImportanceParticleCmd->SetGuidance("Restrict importance biasing to this particle type; can be repeated");
+  ImportanceParticleCmd->SetGuidance("Default = all particles except optical photons");
+  ImportanceParticleCmd->SetParameterName("impparticle",false);
+
+  ImportanceClearCmd = new G4UIcmdWithoutParameter("/g4sbs/importanceclear",this);
+  ImportanceClearCmd->SetGuidance("Remove all importance assignments and particle selections");
+
+  RngStreamsCmd = new G4UIcmdWithABool("/g4sbs/rngstreams",this);
+  RngStreamsCmd->SetGuidance("Use reproducible per-event random streams (counter-based Philox4x32-10 engine, default = false)");
+  RngStreamsCmd->SetGuidance("Each event draws from streams keyed on (seed, run, event + offset); generation, tracking, digitization and pile-up use separate streams");
+  RngStreamsCmd->SetGuidance("Any single event or sub-range of events can then be regenerated with identical results");
+  RngStreamsCmd->SetParameterName("rngstreams",true);
+  RngStreamsCmd->SetDefaultValue(true);
+
+  RngSeedCmd = new G4UIcmdWithAnInteger("/g4sbs/rngseed",this);
+  RngSeedCmd->SetGuidance("Seed for the per-event random streams (default = run_data seed)");
+  RngSeedCmd->SetParameterName("rngseed",false);
+  RngSeedCmd->SetRange("rngseed>=0");
+
+  EventOffsetCmd = new G4UIcmdWithAnInteger("/g4sbs/eventoffset",this);
+  EventOffsetCmd->SetGuidance("Offset added to the event number of the per-event random streams (default = 0)");
+  EventOffsetCmd->SetGuidance("Event N of a job with offset K is identical to event N+K of a job with offset 0 and the same seed");
+  EventOffsetCmd->SetParameterName("eventoffset",false);
+  EventOffsetCmd->SetRange("eventoffset>=0");
+
+  ProfileCmd = new G4UIcmdWithABool("/g4sbs/profile",this);
+  ProfileCmd->SetGuidance("Time event generation, tracking, field queries, SD ProcessHits, end-of-event processing and tree fill (default = false)");
+  ProfileCmd->SetGuidance("The report is printed at the end of the run and written to the output file as the TTree \"profile\"");
+  ProfileCmd->SetParameterName("profile",true);
+  ProfileCmd->SetDefaultValue(true);
+
+  CacheDirCmd = new G4UIcmdWithAString("/g4sbs/cachedir",this);
+  CacheDirCmd->SetGuidance("Directory of the run cache, shared by jobs: physics tables and the rejection sampling max. weight are stored");
+  CacheDirCmd->SetGuidance("per configuration (hash of the /g4sbs commands issued before /g4sbs/run), parsed TOSCA field maps per map file");
+  CacheDirCmd->SetGuidance("Jobs with the same configuration restore them instead of recomputing them. Default: no cache");
+  CacheDirCmd->SetParameterName("cachedir",false);
+
+  AcceptanceFilterCmd = new G4UIcmdWithAnInteger("/g4sbs/acceptancefilter",this);
+  AcceptanceFilterCmd->SetGuidance("Skip generated events outside an angular window around the spectrometer central angles, before tracking");
+  AcceptanceFilterCmd->SetGuidance("0 = off (default), 1 = require electron in E arm, 2 = require hadron/nucleon in H arm, 3 = require both");
+  AcceptanceFilterCmd->SetGuidance("Skipped events are processed as events without primaries: of the N events of /g4sbs/run, N_filtered (run data) are not tracked");
+  AcceptanceFilterCmd->SetGuidance("They count in Nthrown and Ntries as if they had missed the detectors, so ev.rate and the run normalization need no correction");
+  AcceptanceFilterCmd->SetGuidance("Not applied to PYTHIA6, SIMC, beam and cosmics generators");
+  AcceptanceFilterCmd->SetGuidance("Modes 2 and 3 are rejected for the dis and gun generators, which produce no hadron/nucleon");
+  AcceptanceFilterCmd->SetParameterName("filtermode",false);
+  AcceptanceFilterCmd->SetRange("filtermode>=0 && filtermode<=3");
+
+  AcceptanceFilterEarmCmd = new G4UIcommand("/g4sbs/acceptancefilter_earm",this);
+  AcceptanceFilterEarmCmd->SetGuidance("Set half-widths of the E arm acceptance filter window around the central angle");
+  AcceptanceFilterEarmCmd->SetGuidance("Usage: /g4sbs/acceptancefilter_earm dx dy unit (horizontal and vertical projected angles, default = 15 25 deg)");
+  AcceptanceFilterEarmCmd->SetParameter( new G4UIparameter("dx", 'd', false ) );
+  AcceptanceFilterEarmCmd->SetParameter( new G4UIparameter("dy", 'd', false ) );
+  AcceptanceFilterEarmCmd->SetParameter( new G4UIparameter("unit", 's', false ) );
+
+  AcceptanceFilterHarmCmd = new G4UIcommand("/g4sbs/acceptancefilter_harm",this);
+  AcceptanceFilterHarmCmd->SetGuidance("Set half-widths of the H arm acceptance filter window around the central angle");
+  AcceptanceFilterHarmCmd->SetGuidance("Usage: /g4sbs/acceptancefilter_harm dx dy unit (horizontal and vertical projected angles, default = 10 15 deg)");
+  AcceptanceFilterHarmCmd->SetGuidance("The window should include the bend of the SBS dipole");
+  AcceptanceFilterHarmCmd->SetParameter( new G4UIparameter("dx", 'd', false ) );
+  AcceptanceFilterHarmCmd->SetParameter( new G4UIparameter("dy", 'd', false ) );
+  AcceptanceFilterHarmCmd->SetParameter( new G4UIparameter("unit", 's', false ) );
+
+  PhotonThinningCmd = new G4UIcmdWithABool("/g4sbs/photonthinning",this);
+  PhotonThinningCmd->SetGuidance("Track only a fraction f of the Cerenkov and scintillation photons (not WLS re-emission) and divide the photocathode quantum efficiency by f (default = false)");
+  PhotonThinningCmd->SetGuidance("Photoelectron statistics are unchanged; not applied in optical LUT mode");
+  PhotonThinningCmd->SetParameterName("thinning",true);
+  PhotonThinningCmd->SetDefaultValue(true);
+
+  PhotonThinningFactorCmd = new G4UIcmdWithADouble("/g4sbs/photonthinningfactor",this);
+  PhotonThinningFactorCmd->SetGuidance("Fraction f of optical photons tracked with /g4sbs/photonthinning");
+  PhotonThinningFactorCmd->SetGuidance("Default (0) = largest quantum efficiency of all photocathode materials; smaller values are raised to it");
+  PhotonThinningFactorCmd->SetParameterName("factor",false);
+  PhotonThinningFactorCmd->SetRange("factor>=0.0 && factor<=1.0");
+
+  TriggerCmd = new G4UIcmdWithABool("/g4sbs/trigger",this);
+  TriggerCmd->SetGuidance("Emulate the ECAL/HCAL (or BigBite/HCAL) cluster-sum and L2 coincidence trigger at the end of each event (default = false)");
+  TriggerCmd->SetGuidance("Decision bits are written to trig.bits: 1 = earm, 2 = harm, 4 = L2 coincidence");
+  TriggerCmd->SetParameterName("trigger",true);
+  TriggerCmd->SetDefaultValue(true);
+
+  TriggerArmCmd = new G4UIcommand("/g4sbs/triggerarm",this);
+  TriggerArmCmd->SetGuidance("Define a trigger arm: /g4sbs/triggerarm arm SDname sumtable thresholdtable");
+  TriggerArmCmd->SetGuidance("arm = earm or harm; SDname = CAL sensitive detector; sumtable = logic sums (cells of each sum);");
+  TriggerArmCmd->SetGuidance("thresholdtable = elastic peak position (GeV) of each sum");
+  TriggerArmCmd->SetGuidance("Default: earm Earm/ECalTF1 database/GEP_ECAL_L2sums.txt database/ecal_trigger_thresholds_12GeV2.txt");
+  TriggerArmCmd->SetGuidance("         harm Harm/HCalScint database/hcal_L2sums_4x4.txt database/hcal_trigger_thresholds_12GeV2.txt");
+  TriggerArmCmd->SetParameter( new G4UIparameter("arm", 's', false ) );
+  TriggerArmCmd->SetParameter( new G4UIparameter("SDname", 's', false ) );
+  TriggerArmCmd->SetParameter( new G4UIparameter("sumtable", 's', false ) );
+  TriggerArmCmd->SetParameter( new G4UIparameter("thresholdtable", 's', false ) );
+
+  TriggerThresholdCmd = new G4UIcommand("/g4sbs/triggerthreshold",this);
+  TriggerThresholdCmd->SetGuidance("Threshold of a trigger arm, as a fraction of the elastic peak position: /g4sbs/triggerthreshold arm fraction");
+  TriggerThresholdCmd->SetGuidance("Default: earm 0.8, harm 0.5");
+  TriggerThresholdCmd->SetParameter( new G4UIparameter("arm", 's', false ) );
+  TriggerThresholdCmd->SetParameter( new G4UIparameter("fraction", 'd', false ) );
+
+  TriggerPheCmd = new G4UIcommand("/g4sbs/triggerphe",this);
+  TriggerPheCmd->SetGuidance("Photoelectrons per GeV of deposited energy for the smearing of a trigger arm: /g4sbs/triggerphe arm npe");
+  TriggerPheCmd->SetGuidance("Default: earm 528, harm 2981; 0 = no smearing");
+  TriggerPheCmd->SetParameter( new G4UIparameter("arm", 's', false ) );
+  TriggerPheCmd->SetParameter( new G4UIparameter("npe", 'd', false ) );
+
+  TriggerL2FileCmd = new G4UIcmdWithAString("/g4sbs/triggerL2file",this);
+  TriggerL2FileCmd->SetGuidance("Table of the earm logic sums associated with each harm logic sum in the L2 coincidence");
+  TriggerL2FileCmd->SetGuidance("Default: database/ECAL_HCAL_L2_default.txt");
+  TriggerL2FileCmd->SetParameterName("L2file",false);
+
+  TriggerFilterCmd = new G4UIcmdWithAString("/g4sbs/triggerfilter",this);
+  TriggerFilterCmd->SetGuidance("Write only events passing the emulated trigger (requires /g4sbs/trigger true)");
+  TriggerFilterCmd->SetGuidance("none = write all events (default), earm, harm, any = earm or harm, L2 = ECAL-HCAL coincidence");
+  TriggerFilterCmd->SetGuidance("The run normalization is unchanged");
+  TriggerFilterCmd->SetParameterName("filter",false);
+  TriggerFilterCmd->SetCandidates("none earm harm any L2");
+
+  GEMDigitizeCmd = new G4UIcmdWithABool("/g4sbs/gemdigitize",this);
+  GEMDigitizeCmd->SetGuidance("Digitize the GEM hits to X/Y strips and APV25 samples at the end of each event (default = false)");
+  GEMDigitizeCmd->SetGuidance("Zero-suppressed strips are written to <SD>.dighit.nstrips, module, axis, strip, adc_0 ... adc_5");
+  GEMDigitizeCmd->SetParameterName("gemdigitize",true);
+  GEMDigitizeCmd->SetDefaultValue(true);
+
+  GEMDigitizeKeepHitsCmd = new G4UIcmdWithABool("/g4sbs/gemdigitizekeephits",this);
+  GEMDigitizeKeepHitsCmd->SetGuidance("With /g4sbs/gemdigitize, also write all variables of the GEM hits (default = true)");
+  GEMDigitizeKeepHitsCmd->SetGuidance("If false, only hit.nhits, plane, x, y, t, trid, pid and edep are written");
+  GEMDigitizeKeepHitsCmd->SetParameterName("keephits",true);
+  GEMDigitizeKeepHitsCmd->SetDefaultValue(true);
+
+  GEMStripPitchCmd = new G4UIcmdWithADoubleAndUnit("/g4sbs/gemstrippitch",this);
+  GEMStripPitchCmd->SetGuidance("Strip pitch of the GEM digitization (default = 0.4 mm)");
+  GEMStripPitchCmd->SetParameterName("pitch",false);
+  GEMStripPitchCmd->SetRange("pitch>0.0");
+  GEMStripPitchCmd->SetDefaultUnit("mm");
+
+  GEMChargeSpreadCmd = new G4UIcmdWithADoubleAndUnit("/g4sbs/gemchargespread",this);
+  GEMChargeSpreadCmd->SetGuidance("rms of the avalanche charge spread on the GEM readout plane (default = 0.3 mm)");
+  GEMChargeSpreadCmd->SetParameterName("spread",false);
+  GEMChargeSpreadCmd->SetRange("spread>0.0");
+  GEMChargeSpreadCmd->SetDefaultUnit("mm");
+
+  GEMADCperkeVCmd = new G4UIcmdWithADouble("/g4sbs/gemadcperkev",this);
+  GEMADCperkeVCmd->SetGuidance("Peak ADC amplitude per keV of energy deposited in the GEM drift gap, summed over X and Y strips (default = 4000)");
+  GEMADCperkeVCmd->SetParameterName("adcperkev",false);
+  GEMADCperkeVCmd->SetRange("adcperkev>0.0");
+
+  GEMNoiseCmd = new G4UIcmdWithADouble("/g4sbs/gemnoise",this);
+  GEMNoiseCmd->SetGuidance("rms noise of each APV25 sample of the GEM digitization, in ADC counts (default = 20)");
+  GEMNoiseCmd->SetParameterName("noise",false);
+  GEMNoiseCmd->SetRange("noise>=0.0");
+
+  GEMZSThresholdCmd = new G4UIcmdWithADouble("/g4sbs/gemzsthreshold",this);
+  GEMZSThresholdCmd->SetGuidance("Zero-suppression threshold of the GEM digitization on the largest of the 6 samples of a strip, in ADC counts (default = 100)");
+  GEMZSThresholdCmd->SetParameterName("threshold",false);
+
+  GEMSampleOffsetCmd = new G4UIcmdWithADoubleAndUnit("/g4sbs/gemsampleoffset",this);
+  GEMSampleOffsetCmd->SetGuidance("Time of the first APV25 sample relative to the start of the event (default = 0 ns); samples are 25 ns apart");
+  GEMSampleOffsetCmd->SetParameterName("toffset",false);
+  GEMSampleOffsetCmd->SetDefaultUnit("ns");
   
   // DisableOpticalPhysicsCmd = new G4UIcmdWithABool("/g4sbs/useopticalphysics", this );
   // DisableOpticalPhysicsCmd->SetGuidance("toggle optical physics on/off");
@@ -1000,7 +1341,132 @@ G4SBSMessenger::G4SBSMessenger(){
   SetBigBitePlateMaterialCmd->SetGuidance( "set bigbite plate material, default CH2" );
   SetBigBitePlateMaterialCmd->SetParameterName( "bigbiteplatematerial", false );
   SetBigBitePlateMaterialCmd->SetDefaultValue( "CH2" );
-  
+
+  //Commands that do not require the geometry to be rebuilt at the next /g4sbs/run
+  //(event generator, output and physics-only settings). Anything not listed here is assumed to modify the geometry:
+  fGeometryNeutralCmds.insert( runCmd );
+  fGeometryNeutralCmds.insert( scanCmd );
+  fGeometryNeutralCmds.insert( shardCmd );
+  fGeometryNeutralCmds.insert( printCmd );
+  fGeometryNeutralCmds.insert( fileCmd );
+  fGeometryNeutralCmds.insert( sigfileCmd );
+  fGeometryNeutralCmds.insert( kineCmd );
+  fGeometryNeutralCmds.insert( PYTHIAfileCmd );
+  fGeometryNeutralCmds.insert( SIMCfileCmd );
+  fGeometryNeutralCmds.insert( FirstEventCmd );
+  fGeometryNeutralCmds.insert( GunParticleCmd );
+  fGeometryNeutralCmds.insert( HadrCmd );
+  fGeometryNeutralCmds.insert( RejectionSamplingCmd );
+  fGeometryNeutralCmds.insert( beamOffsetXcmd );
+  fGeometryNeutralCmds.insert( beamOffsetYcmd );
+  fGeometryNeutralCmds.insert( beamAngleXcmd );
+  fGeometryNeutralCmds.insert( beamAngleYcmd );
+  fGeometryNeutralCmds.insert( beamAngleZcmd );
+  fGeometryNeutralCmds.insert( eventStatusEveryCmd );
+  fGeometryNeutralCmds.insert( beamcurCmd );
+  fGeometryNeutralCmds.insert( runtimeCmd );
+  fGeometryNeutralCmds.insert( rasterxCmd );
+  fGeometryNeutralCmds.insert( rasteryCmd );
+  fGeometryNeutralCmds.insert( rasterrCmd );
+  fGeometryNeutralCmds.insert( beamspotsizeCmd );
+  fGeometryNeutralCmds.insert( beamECmd );
+  fGeometryNeutralCmds.insert( thminCmd );
+  fGeometryNeutralCmds.insert( thmaxCmd );
+  fGeometryNeutralCmds.insert( phminCmd );
+  fGeometryNeutralCmds.insert( phmaxCmd );
+  fGeometryNeutralCmds.insert( HthminCmd );
+  fGeometryNeutralCmds.insert( HthmaxCmd );
+  fGeometryNeutralCmds.insert( HphminCmd );
+  fGeometryNeutralCmds.insert( HphmaxCmd );
+  fGeometryNeutralCmds.insert( EhminCmd );
+  fGeometryNeutralCmds.insert( EhmaxCmd );
+  fGeometryNeutralCmds.insert( EeminCmd );
+  fGeometryNeutralCmds.insert( EemaxCmd );
+  fGeometryNeutralCmds.insert( PionPhoto_tminCmd );
+  fGeometryNeutralCmds.insert( PionPhoto_tmaxCmd );
+  fGeometryNeutralCmds.insert( gemresCmd );
+  fGeometryNeutralCmds.insert( TreeFlagCmd );
+  fGeometryNeutralCmds.insert( SparseOutputCmd );
+  fGeometryNeutralCmds.insert( CompactOutputCmd );
+  fGeometryNeutralCmds.insert( AsyncWriteCmd );
+  fGeometryNeutralCmds.insert( KeepPartCALcmd );
+  fGeometryNeutralCmds.insert( KeepHistorycmd );
+  fGeometryNeutralCmds.insert( KeepPulseShapeCmd );
+  fGeometryNeutralCmds.insert( SparsePulseShapeCmd );
+  fGeometryNeutralCmds.insert( KeepSDtrackcmd );
+  fGeometryNeutralCmds.insert( OpticalLUTModeCmd );
+  fGeometryNeutralCmds.insert( OpticalLUTFileCmd );
+  fGeometryNeutralCmds.insert( OpticalLUTRegionCmd );
+  fGeometryNeutralCmds.insert( OpticalLUTBinsCmd );
+  fGeometryNeutralCmds.insert( OpticalLUTMinEntriesCmd );
+  fGeometryNeutralCmds.insert( RandomizeTargetSpinCmd );
+  fGeometryNeutralCmds.insert( NumSpinStatesTargCmd );
+  fGeometryNeutralCmds.insert( TargThetaSpinCmd );
+  fGeometryNeutralCmds.insert( TargPhiSpinCmd );
+  fGeometryNeutralCmds.insert( UseCerenkovCmd );
+  fGeometryNeutralCmds.insert( UseScintCmd );
+  fGeometryNeutralCmds.insert( GunPolarizationCommand );
+  fGeometryNeutralCmds.insert( CosmicsPointerCommand );
+  fGeometryNeutralCmds.insert( CosmicsPointerRadiusCommand );
+  fGeometryNeutralCmds.insert( CosmicsMaxAngleCommand );
+  fGeometryNeutralCmds.insert( WriteFieldMapCmd );
+  //The field scale factors are applied directly to the existing field objects:
+  fGeometryNeutralCmds.insert( EARM_ScaleFieldCmd );
+  fGeometryNeutralCmds.insert( HARM_ScaleFieldCmd );
+  fGeometryNeutralCmds.insert( AcceptanceFilterCmd );
+  fGeometryNeutralCmds.insert( PhaseSpaceRecordCmd );
+  fGeometryNeutralCmds.insert( PhaseSpaceSurfaceCmd );
+  fGeometryNeutralCmds.insert( PhaseSpaceKillCmd );
+  fGeometryNeutralCmds.insert( PhaseSpaceFileCmd );
+  fGeometryNeutralCmds.insert( PhaseSpaceResampleCmd );
+  fGeometryNeutralCmds.insert( PileupCmd );
+  fGeometryNeutralCmds.insert( PileupFileCmd );
+  fGeometryNeutralCmds.insert( PileupMeanCmd );
+  fGeometryNeutralCmds.insert( CullCmd );
+  fGeometryNeutralCmds.insert( CullEscapeCmd );
+  fGeometryNeutralCmds.insert( CullClearCmd );
+  fGeometryNeutralCmds.insert( ImportanceCmd );
+  fGeometryNeutralCmds.insert( ImportanceParticleCmd );
+  fGeometryNeutralCmds.insert( ImportanceClearCmd );
+  fGeometryNeutralCmds.insert( RngStreamsCmd );
+  fGeometryNeutralCmds.insert( RngSeedCmd );
+  fGeometryNeutralCmds.insert( EventOffsetCmd );
+  fGeometryNeutralCmds.insert( ProfileCmd );
+  fGeometryNeutralCmds.insert( AcceptanceFilterEarmCmd );
+  fGeometryNeutralCmds.insert( AcceptanceFilterHarmCmd );
+  fGeometryNeutralCmds.insert( PhotonThinningCmd );
+  fGeometryNeutralCmds.insert( PhotonThinningFactorCmd );
+  fGeometryNeutralCmds.insert( TriggerCmd );
+  fGeometryNeutralCmds.insert( TriggerArmCmd );
+  fGeometryNeutralCmds.insert( TriggerThresholdCmd );
+  fGeometryNeutralCmds.insert( TriggerPheCmd );
+  fGeometryNeutralCmds.insert( TriggerL2FileCmd );
+  fGeometryNeutralCmds.insert( TriggerFilterCmd );
+  fGeometryNeutralCmds.insert( GEMDigitizeCmd );
+  fGeometryNeutralCmds.insert( GEMDigitizeKeepHitsCmd );
+  fGeometryNeutralCmds.insert( GEMStripPitchCmd );
+  fGeometryNeutralCmds.insert( GEMChargeSpreadCmd );
+  fGeometryNeutralCmds.insert( GEMADCperkeVCmd );
+  fGeometryNeutralCmds.insert( GEMNoiseCmd );
+  fGeometryNeutralCmds.insert( GEMZSThresholdCmd );
+  fGeometryNeutralCmds.insert( GEMSampleOffsetCmd );
+  fGeometryNeutralCmds.insert( CacheDirCmd );
+
+  //Run control, output file, random seed and profiling commands don't change the cached run state:
+  fCacheNeutralCmds.insert( runCmd );
+  fCacheNeutralCmds.insert( scanCmd );
+  fCacheNeutralCmds.insert( shardCmd );
+  fCacheNeutralCmds.insert( printCmd );
+  fCacheNeutralCmds.insert( fileCmd );
+  fCacheNeutralCmds.insert( eventStatusEveryCmd );
+  fCacheNeutralCmds.insert( RngSeedCmd );
+  fCacheNeutralCmds.insert( EventOffsetCmd );
+  fCacheNeutralCmds.insert( ProfileCmd );
+  fCacheNeutralCmds.insert( CacheDirCmd );
+
+  for( std::set<G4UIcommand*>::iterator it=fCacheNeutralCmds.begin(); it!=fCacheNeutralCmds.end(); ++it ){
+    G4SBSRunCache::GetCache()->AddNeutralCommand( (*it)->GetCommandPath() );
+  }
 }
 
 G4SBSMessenger::~G4SBSMessenger(){
@@ -1010,6 +1476,8 @@ G4SBSMessenger::~G4SBSMessenger(){
 void G4SBSMessenger::SetNewValue(G4UIcommand* cmd, G4String newValue){
   char cmdstr[255];
 
+  if( fGeometryNeutralCmds.find( cmd ) == fGeometryNeutralCmds.end() ) fGeometryModified = true;
+
   if(cmd==printCmd){
      G4int lineNo = printCmd->GetNewIntValue(newValue); 
      std::cout << "*************************** The line number is " << lineNo << std::endl;
@@ -1017,10 +1485,13 @@ void G4SBSMessenger::SetNewValue(G4UIcommand* cmd, G4String newValue){
 
   if( cmd == runCmd ){
 	
-    G4VPhysicalVolume* pWorld;
+    G4VPhysicalVolume* pWorld = NULL;
 
     G4int nevt = runCmd->GetNewIntValue(newValue);
 
+    //The kinematics may have been changed after /g4sbs/acceptancefilter, so check the combination here:
+    fprigen->CheckAcceptanceFilter();
+
     //If the generator is PYTHIA, don't try to generate more events than we have available:
     if( fevgen->GetKine() == G4SBS::kPYTHIA6 ){
       // At this point all parameters of event generation should be set: 
@@ -1081,7 +1552,41 @@ void G4SBSMessenger::SetNewValue(G4UIcommand* cmd, G4String newValue){
     }
     fevgen->SetTargDen(TargNumberDensity);
     
+    //Sharding: events are normalized to the full run of nevt events, of which this job
+    //only simulates the slice [firstshard, firstshard + nevt_shard):
     fevgen->SetNevents(nevt);
+    G4int nevt_shard = nevt;
+    if( fNshards > 1 ){
+      long firstshard = long(nevt)*fShardIndex/fNshards;
+      nevt_shard = long(nevt)*(fShardIndex+1)/fNshards - firstshard;
+
+      if( fevgen->GetKine() == G4SBS::kPYTHIA6 || fevgen->GetKine() == G4SBS::kSIMC ){
+	fevgen->SetChainEntry( fevgen->GetFirstEvent() + firstshard );
+      }
+      G4SBSRandom::GetRandom()->SetShardOffset( firstshard );
+
+      //The events of every shard must be weighted against the same max. weight, so the rejection sampling
+      //warm-up has to draw the same random numbers in every shard:
+      G4SBS::Kine_t kine = fevgen->GetKine();
+      G4bool rejsampling = fevgen->GetRejectionSamplingFlag() &&
+	( kine == G4SBS::kElastic || kine == G4SBS::kInelastic || kine == G4SBS::kDIS ||
+	  kine == G4SBS::kSIDIS || kine == G4SBS::kWiser );
+      if( rejsampling && !( G4SBSRandom::GetRandom()->IsEnabled() && G4SBSRandom::GetRandom()->IsSeedSet() ) ){
+	fprintf(stderr, "%s: %s line %d - Error: sharding with rejection sampling requires /g4sbs/rngstreams true and the same /g4sbs/rngseed in all shards, so that every shard uses the same max. event weight\n", __PRETTY_FUNCTION__, __FILE__, __LINE__);
+	exit(-1);
+      }
+
+      G4cout << "/g4sbs/run: shard " << fShardIndex << " of " << fNshards << ", events "
+	     << firstshard << " to " << firstshard + nevt_shard - 1 << " of " << nevt << G4endl;
+    }
+    G4SBSRun::GetRun()->GetData()->SetShard( fShardIndex, fNshards, nevt );
+
+    //Restores cached physics tables and sets the cache key of the max. event weight:
+    G4SBSRunCache::GetCache()->BeginRun();
+
+    //The rejection sampling warm-up must draw from a seeded stream too (/g4sbs/rngstreams):
+    G4SBSRandom::GetRandom()->BeginInitialization();
+    
     fevgen->Initialize();
 
     //For optics target, copy target foil information from targetbuilder to evgen:
@@ -1113,14 +1618,20 @@ void G4SBSMessenger::SetNewValue(G4UIcommand* cmd, G4String newValue){
     G4SBSRun::GetRun()->GetData()->SetLuminosity( fevgen->GetLumi()*cm2*s );
     //G4SBSRun::GetRun()->GetData()->SetMaxWeight( fevgen->GetMaxWeight() );
     
-    //Clean out and rebuild the detector geometry from scratch: 
-
-    G4SolidStore::GetInstance()->Clean();
-    G4LogicalVolumeStore::GetInstance()->Clean();
-    G4PhysicalVolumeStore::GetInstance()->Clean();
+    //Clean out and rebuild the detector geometry from scratch, unless no geometry-related command
+    //was issued since the last run. In that case, keep the existing world and its navigation voxels:
+    if( fGeometryModified ){
+      G4SolidStore::GetInstance()->Clean();
+      G4LogicalVolumeStore::GetInstance()->Clean();
+      G4PhysicalVolumeStore::GetInstance()->Clean();
 	
-    G4RunManager::GetRunManager()->DefineWorldVolume(pWorld = fdetcon->ConstructAll());
-    G4RunManager::GetRunManager()->GeometryHasBeenModified();
+      G4RunManager::GetRunManager()->DefineWorldVolume(pWorld = fdetcon->ConstructAll());
+      G4RunManager::GetRunManager()->GeometryHasBeenModified();
+
+      fGeometryModified = false;
+    } else {
+      G4cout << "/g4sbs/run: geometry unchanged since last run, reusing existing world volume" << G4endl;
+    }
 
     //Copy sensitive detector list and type codes to event action:
     fevact->SDlist = fdetcon->SDlist;
@@ -1142,14 +1653,103 @@ void G4SBSMessenger::SetNewValue(G4UIcommand* cmd, G4String newValue){
     // present geometry
     // Save geometry to GDML file
 #ifdef G4SBS_USE_GDML
-    G4GDMLParser parser;
-    unlink("g4sbs.gdml");
-    parser.Write("g4sbs.gdml", pWorld);
+    if( pWorld != NULL ){
+      G4GDMLParser parser;
+      unlink("g4sbs.gdml");
+      parser.Write("g4sbs.gdml", pWorld);
+    }
 #endif
     // Run the simulation
     G4UImanager * UImanager = G4UImanager::GetUIpointer();
-    sprintf(cmdstr, "/run/beamOn %d", nevt);
+    sprintf(cmdstr, "/run/beamOn %d", nevt_shard);
     UImanager->ApplyCommand(cmdstr);
+
+    G4SBSRunCache::GetCache()->EndRun();
+  }
+
+  if( cmd == shardCmd ){
+    std::istringstream is(newValue);
+
+    G4int ishard, nshards;
+    is >> ishard >> nshards;
+
+    if( nshards < 1 || ishard < 0 || ishard >= nshards ){
+      fprintf(stderr, "%s: %s line %d - Error: invalid shard %d of %d\n", __PRETTY_FUNCTION__, __FILE__, __LINE__, ishard, nshards);
+      exit(-1);
+    }
+
+    fShardIndex = ishard;
+    fNshards = nshards;
+  }
+
+  if( cmd == scanCmd ){
+    std::istringstream is(newValue);
+
+    G4String tablefile;
+    G4int nevt;
+
+    is >> tablefile >> nevt;
+
+    std::ifstream tablestream( tablefile.data() );
+    if( !tablestream.good() ){
+      fprintf(stderr, "%s: %s line %d - Error: could not open scan table file %s\n", __PRETTY_FUNCTION__, __FILE__, __LINE__, tablefile.data());
+      exit(-1);
+    }
+
+    std::vector<G4String> scancommands, scanunits;
+    std::vector<std::vector<G4String> > scanpoints;
+    std::vector<G4String> scanfiles;
+
+    std::string line;
+    while( std::getline( tablestream, line ) ){
+      std::istringstream ls(line);
+      std::string token;
+      if( !(ls >> token) || token[0] == '#' ) continue;
+
+      if( scancommands.empty() ){ //header line: list of commands
+	do {
+	  std::string::size_type colon = token.find(':');
+	  scancommands.push_back( G4String(token.substr(0,colon)) );
+	  scanunits.push_back( colon == std::string::npos ? G4String("") : G4String(token.substr(colon+1)) );
+	} while( ls >> token );
+	continue;
+      }
+
+      scanfiles.push_back( G4String(token) );
+      std::vector<G4String> values;
+      while( ls >> token ) values.push_back( G4String(token) );
+
+      if( values.size() != scancommands.size() ){
+	fprintf(stderr, "%s: %s line %d - Error: scan point %s has %d values, expected %d\n", __PRETTY_FUNCTION__, __FILE__, __LINE__,
+		scanfiles.back().data(), int(values.size()), int(scancommands.size()) );
+	exit(-1);
+      }
+      scanpoints.push_back( values );
+    }
+
+    G4UImanager * UImanager = G4UImanager::GetUIpointer();
+
+    //Each point goes through the regular /g4sbs/filename and /g4sbs/run commands, so that generator
+    //initialization and run normalization are done exactly as for a single run. Invariant
+    //initialization (materials, physics tables, and the geometry unless a geometry-related
+    //command is in the table) is done only once:
+    for( size_t ipt=0; ipt<scanpoints.size(); ipt++ ){
+      G4cout << "/g4sbs/scan: point " << ipt+1 << " of " << scanpoints.size() << ", output file " << scanfiles[ipt] << G4endl;
+
+      for( size_t icmd=0; icmd<scancommands.size(); icmd++ ){
+	G4String command = scancommands[icmd] + " " + scanpoints[ipt][icmd];
+	if( scanunits[icmd] != "" ) command += " " + scanunits[icmd];
+
+	if( UImanager->ApplyCommand( command ) != 0 ){
+	  fprintf(stderr, "%s: %s line %d - Error: scan command \"%s\" failed\n", __PRETTY_FUNCTION__, __FILE__, __LINE__, command.data());
+	  exit(-1);
+	}
+      }
+
+      UImanager->ApplyCommand( "/g4sbs/filename " + scanfiles[ipt] );
+      sprintf(cmdstr, "/g4sbs/run %d", nevt);
+      UImanager->ApplyCommand(cmdstr);
+    }
   }
 
   if( cmd == fileCmd ){
@@ -1287,6 +1887,12 @@ void G4SBSMessenger::SetNewValue(G4UIcommand* cmd, G4String newValue){
       validcmd = true;
     }
 
+    if( newValue.compareTo("phasespace") == 0 ){ //replay of a phase space file, see /g4sbs/phasespacefile
+      kinetemp = G4SBS::kPhaseSpace;
+      fevgen->SetRejectionSamplingFlag(false);
+      validcmd = true;
+    }
+
     if( newValue.compareTo("wapp") == 0 ){ //wide angle pion photoproduction
       kinetemp = G4SBS::kPionPhoto;
       //fevgen->SetKine(G4SBS::kPionPhoto);
@@ -2390,6 +2996,21 @@ void G4SBSMessenger::SetNewValue(G4UIcommand* cmd, G4String newValue){
     fevact->SetTreeFlag( flag );
   }
 
+  if( cmd == SparseOutputCmd ){
+    G4bool b = SparseOutputCmd->GetNewBoolValue(newValue);
+    fIO->SetSparseOutput( b );
+  }
+
+  if( cmd == CompactOutputCmd ){
+    G4bool b = CompactOutputCmd->GetNewBoolValue(newValue);
+    fIO->SetCompactOutput( b );
+  }
+
+  if( cmd == AsyncWriteCmd ){
+    G4bool b = AsyncWriteCmd->GetNewBoolValue(newValue);
+    fIO->SetAsyncWrite( b );
+  }
+
   if( cmd == SBS_FT_absorberCmd ){
     G4bool flag = SBS_FT_absorberCmd->GetNewBoolValue(newValue);
 
@@ -2542,6 +3163,11 @@ void G4SBSMessenger::SetNewValue(G4UIcommand* cmd, G4String newValue){
     if( SDname == "all" ) fIO->SetKeepAllPulseShape(flag);
    
   }
+
+  if( cmd == SparsePulseShapeCmd ){
+    G4bool b = SparsePulseShapeCmd->GetNewBoolValue(newValue);
+    fIO->SetSparsePulseShape( b );
+  }
   // ******
 
   if( cmd == KeepSDtrackcmd ){ //
@@ -2566,6 +3192,263 @@ void G4SBSMessenger::SetNewValue(G4UIcommand* cmd, G4String newValue){
     if( SDname == "all" ) fIO->SetKeepAllSDtracks(flag);
     
   }
+  if( cmd == PhaseSpaceRecordCmd ){
+    G4SBSPhaseSpace::GetPhaseSpace()->SetRecordFileName( newValue == "none" ? G4String("") : newValue );
+  }
+
+  if( cmd == PhaseSpaceSurfaceCmd ){
+    std::istringstream is(newValue);
+
+    G4String type, unit;
+    G4double value;
+
+    is >> type >> value >> unit;
+
+    G4int itype;
+    if( type == "sphere" ){
+      itype = G4SBSPhaseSpace::kSphere;
+    } else if( type == "zplane" ){
+      itype = G4SBSPhaseSpace::kPlaneZ;
+    } else {
+      fprintf(stderr, "%s: %s line %d - Error: phase space surface type %s not valid\n", __PRETTY_FUNCTION__, __FILE__, __LINE__, type.data());
+      exit(-1);
+    }
+
+    G4SBSPhaseSpace::GetPhaseSpace()->SetSurface( itype, value*cmd->ValueOf(unit) );
+  }
+
+  if( cmd == PhaseSpaceKillCmd ){
+    G4SBSPhaseSpace::GetPhaseSpace()->SetKillAtSurface( PhaseSpaceKillCmd->GetNewBoolValue(newValue) );
+  }
+
+  if( cmd == PhaseSpaceFileCmd ){
+    G4SBSPhaseSpace::GetPhaseSpace()->SetReplayFileName( newValue );
+  }
+
+  if( cmd == PhaseSpaceResampleCmd ){
+    G4SBSPhaseSpace::GetPhaseSpace()->SetResample( PhaseSpaceResampleCmd->GetNewIntValue(newValue) );
+  }
+
+  if( cmd == PileupCmd ){
+    G4SBSPileup::GetPileup()->SetEnabled( PileupCmd->GetNewBoolValue(newValue) );
+  }
+
+  if( cmd == PileupFileCmd ){
+    G4SBSPileup::GetPileup()->AddLibraryFile( newValue );
+  }
+
+  if( cmd == PileupMeanCmd ){
+    G4SBSPileup::GetPileup()->SetMeanEvents( PileupMeanCmd->GetNewDoubleValue(newValue) );
+  }
+
+  if( cmd == CullCmd ){
+    std::istringstream is(newValue);
+
+    G4String volume, particle, unit;
+    G4double Ethresh;
+
+    is >> volume >> particle >> Ethresh >> unit;
+
+    G4SBSCulling::GetCulling()->AddRule( volume, particle, Ethresh*cmd->ValueOf(unit) );
+  }
+
+  if( cmd == CullEscapeCmd ){
+    G4SBSCulling::GetCulling()->SetEscapeRadius( CullEscapeCmd->GetNewDoubleValue(newValue) );
+  }
+
+  if( cmd == CullClearCmd ){
+    G4SBSCulling::GetCulling()->ClearRules();
+  }
+
+  if( cmd == ImportanceCmd ){
+    std::istringstream is(newValue);
+
+    G4String volume;
+    G4double value;
+
+    is >> volume >> value;
+
+    G4SBSImportance::GetImportance()->SetImportance( volume, value );
+  }
+
+  if( cmd == ImportanceParticleCmd ){
+    G4SBSImportance::GetImportance()->AddParticle( newValue );
+  }
+
+  if( cmd == ImportanceClearCmd ){
+    G4SBSImportance::GetImportance()->Clear();
+  }
+
+  if( cmd == RngStreamsCmd ){
+    G4SBSRandom::GetRandom()->SetEnabled( RngStreamsCmd->GetNewBoolValue(newValue) );
+  }
+
+  if( cmd == RngSeedCmd ){
+    G4SBSRandom::GetRandom()->SetSeed( RngSeedCmd->GetNewIntValue(newValue) );
+  }
+
+  if( cmd == EventOffsetCmd ){
+    G4SBSRandom::GetRandom()->SetEventOffset( EventOffsetCmd->GetNewIntValue(newValue) );
+  }
+
+  if( cmd == ProfileCmd ){
+    G4SBSProfiler::GetProfiler()->SetEnabled( ProfileCmd->GetNewBoolValue(newValue) );
+  }
+
+  if( cmd == CacheDirCmd ){
+    G4SBSRunCache::GetCache()->SetDirectory( newValue );
+  }
+
+  if( cmd == AcceptanceFilterCmd ){
+    G4int mode = AcceptanceFilterCmd->GetNewIntValue(newValue);
+    fprigen->SetAcceptanceFilter( mode );
+  }
+
+  if( cmd == AcceptanceFilterEarmCmd || cmd == AcceptanceFilterHarmCmd ){
+    std::istringstream is(newValue);
+
+    G4double dx, dy;
+    G4String unit;
+
+    is >> dx >> dy >> unit;
+
+    G4double ucon = cmd->ValueOf(unit);
+
+    if( cmd == AcceptanceFilterEarmCmd ){
+      fprigen->SetEarmFilterWindow( dx*ucon, dy*ucon );
+    } else {
+      fprigen->SetHarmFilterWindow( dx*ucon, dy*ucon );
+    }
+  }
+
+  if( cmd == PhotonThinningCmd ){
+    G4SBSPhotonThinning::GetThinning()->SetEnabled( PhotonThinningCmd->GetNewBoolValue(newValue) );
+  }
+
+  if( cmd == PhotonThinningFactorCmd ){
+    G4SBSPhotonThinning::GetThinning()->SetFactor( PhotonThinningFactorCmd->GetNewDoubleValue(newValue) );
+  }
+
+  if( cmd == TriggerCmd ){
+    G4SBSTrigger::GetTrigger()->SetEnabled( TriggerCmd->GetNewBoolValue(newValue) );
+  }
+
+  if( cmd == TriggerArmCmd || cmd == TriggerThresholdCmd || cmd == TriggerPheCmd ){
+    std::istringstream is(newValue);
+
+    G4String armname;
+    is >> armname;
+
+    G4int arm;
+    if( armname == "earm" ){
+      arm = G4SBSTrigger::kEarm;
+    } else if( armname == "harm" ){
+      arm = G4SBSTrigger::kHarm;
+    } else {
+      fprintf(stderr, "%s: %s line %d - Error: unknown trigger arm %s (earm or harm)\n", __PRETTY_FUNCTION__, __FILE__, __LINE__, armname.data());
+      exit(-1);
+    }
+
+    if( cmd == TriggerArmCmd ){
+      G4String SDname, sumfile, thresholdfile;
+      is >> SDname >> sumfile >> thresholdfile;
+      G4SBSTrigger::GetTrigger()->SetArm( arm, SDname, sumfile, thresholdfile );
+    } else {
+      G4double value;
+      is >> value;
+      if( cmd == TriggerThresholdCmd ){
+	G4SBSTrigger::GetTrigger()->SetThreshold( arm, value );
+      } else {
+	G4SBSTrigger::GetTrigger()->SetPhePerGeV( arm, value );
+      }
+    }
+  }
+
+  if( cmd == TriggerL2FileCmd ){
+    G4SBSTrigger::GetTrigger()->SetL2File( newValue );
+  }
+
+  if( cmd == TriggerFilterCmd ){
+    G4int mask = 0;
+    if( newValue == "earm" ) mask = G4SBSTrigger::kEarmBit;
+    if( newValue == "harm" ) mask = G4SBSTrigger::kHarmBit;
+    if( newValue == "any" ) mask = G4SBSTrigger::kEarmBit | G4SBSTrigger::kHarmBit;
+    if( newValue == "L2" ) mask = G4SBSTrigger::kL2Bit;
+    G4SBSTrigger::GetTrigger()->SetFilter( mask );
+  }
+
+  if( cmd == GEMDigitizeCmd ){
+    G4SBSGEMDigitizer::GetDigitizer()->SetEnabled( GEMDigitizeCmd->GetNewBoolValue(newValue) );
+  }
+
+  if( cmd == GEMDigitizeKeepHitsCmd ){
+    G4SBSGEMDigitizer::GetDigitizer()->SetKeepHits( GEMDigitizeKeepHitsCmd->GetNewBoolValue(newValue) );
+  }
+
+  if( cmd == GEMStripPitchCmd ){
+    G4SBSGEMDigitizer::GetDigitizer()->SetPitch( GEMStripPitchCmd->GetNewDoubleValue(newValue) );
+  }
+
+  if( cmd == GEMChargeSpreadCmd ){
+    G4SBSGEMDigitizer::GetDigitizer()->SetSpread( GEMChargeSpreadCmd->GetNewDoubleValue(newValue) );
+  }
+
+  if( cmd == GEMADCperkeVCmd ){
+    G4SBSGEMDigitizer::GetDigitizer()->SetADCperkeV( GEMADCperkeVCmd->GetNewDoubleValue(newValue) );
+  }
+
+  if( cmd == GEMNoiseCmd ){
+    G4SBSGEMDigitizer::GetDigitizer()->SetNoise( GEMNoiseCmd->GetNewDoubleValue(newValue) );
+  }
+
+  if( cmd == GEMZSThresholdCmd ){
+    G4SBSGEMDigitizer::GetDigitizer()->SetThreshold( GEMZSThresholdCmd->GetNewDoubleValue(newValue) );
+  }
+
+  if( cmd == GEMSampleOffsetCmd ){
+    G4SBSGEMDigitizer::GetDigitizer()->SetTimeOffset( GEMSampleOffsetCmd->GetNewDoubleValue(newValue) );
+  }
+
+  if( cmd == OpticalLUTModeCmd ){
+    G4int mode = OpticalLUTModeCmd->GetNewIntValue(newValue);
+    G4SBSOpticalLUT::GetLUT()->SetMode( mode );
+  }
+
+  if( cmd == OpticalLUTFileCmd ){
+    G4SBSOpticalLUT::GetLUT()->SetFileName( newValue );
+  }
+
+  if( cmd == OpticalLUTRegionCmd ){
+    std::istringstream is(newValue);
+
+    G4String SDname;
+    G4double xmin, xmax, ymin, ymax, zmin, zmax;
+    G4String unit;
+
+    is >> SDname >> xmin >> xmax >> ymin >> ymax >> zmin >> zmax >> unit;
+
+    G4double ucon = cmd->ValueOf(unit);
+
+    G4SBSOpticalLUT::GetLUT()->SetRegion( SDname, G4ThreeVector( xmin, ymin, zmin )*ucon, G4ThreeVector( xmax, ymax, zmax )*ucon );
+
+    G4cout << "Set optical LUT region for SD name = " << SDname << G4endl;
+  }
+
+  if( cmd == OpticalLUTBinsCmd ){
+    std::istringstream is(newValue);
+
+    G4int nx, ny, nz, ncostheta, nphi;
+
+    is >> nx >> ny >> nz >> ncostheta >> nphi;
+
+    G4SBSOpticalLUT::GetLUT()->SetBinning( nx, ny, nz, ncostheta, nphi );
+  }
+
+  if( cmd == OpticalLUTMinEntriesCmd ){
+    G4double nmin = OpticalLUTMinEntriesCmd->GetNewDoubleValue(newValue);
+    G4SBSOpticalLUT::GetLUT()->SetMinEntries( nmin );
+  }
+  
   // if( cmd == DisableOpticalPhysicsCmd ){
   //   G4bool b = DisableOpticalPhysicsCmd->GetNewBoolValue(newValue);
   //   if( b ){ 
@@ -2684,12 +3567,14 @@ void G4SBSMessenger::SetNewValue(G4UIcommand* cmd, G4String newValue){
     G4bool b = UseCerenkovCmd->GetNewBoolValue(newValue);
     fphyslist->ToggleCerenkov(b);
     fIO->SetUsingCerenkov(b);
+    fdetcon->SetUsingCerenkov(b);
   }
 
   if( cmd == UseScintCmd ){
     G4bool b = UseScintCmd->GetNewBoolValue(newValue);
     fphyslist->ToggleScintillation(b);
     fIO->SetUsingScintillation(b);
+    fdetcon->SetUsingScintillation(b);
   }
 
   if( cmd == DisableOpticalPhotonProductionByMaterialCmd ){
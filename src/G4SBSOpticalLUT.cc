@@ -0,0 +1,315 @@
+#include "G4SBSOpticalLUT.hh"
+#include "G4SBSRICHSD.hh"
+#include "G4SBSECalSD.hh"
+
+#include "G4Track.hh"
+#include "G4SDManager.hh"
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+#include "G4ios.hh"
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+G4SBSOpticalLUT *G4SBSOpticalLUT::gSingleton = NULL;
+
+G4SBSOpticalLUT::G4SBSOpticalLUT(){
+  gSingleton = this;
+
+  fMode = kOff;
+  fFileName = "opticalLUT.txt";
+  fLoadedFile = "";
+  fMinEntries = 100.0;
+
+  fNbinsX = 10;
+  fNbinsY = 10;
+  fNbinsZ = 10;
+  fNbinsCosTheta = 10;
+  fNbinsPhi = 12;
+}
+
+G4SBSOpticalLUT::~G4SBSOpticalLUT(){
+}
+
+G4SBSOpticalLUT *G4SBSOpticalLUT::GetLUT(){
+  if( gSingleton == NULL ){
+    gSingleton = new G4SBSOpticalLUT();
+  }
+  return gSingleton;
+}
+
+void G4SBSOpticalLUT::SetRegion( G4String SDname, G4ThreeVector xmin, G4ThreeVector xmax ){
+  //FindBin divides by the extent of the region along each axis:
+  if( xmin.x() == xmax.x() || xmin.y() == xmax.y() || xmin.z() == xmax.z() ){
+    fprintf(stderr, "%s: %s line %d - Error: optical LUT region of %s has zero extent along at least one axis (xmin = (%g, %g, %g) mm, xmax = (%g, %g, %g) mm)\n", __PRETTY_FUNCTION__, __FILE__, __LINE__, SDname.data(),
+	    xmin.x()/mm, xmin.y()/mm, xmin.z()/mm, xmax.x()/mm, xmax.y()/mm, xmax.z()/mm );
+    exit(-1);
+  }
+
+  G4SBSOpticalLUTTable &table = fTables[SDname];
+  table.xmin = G4ThreeVector( std::min( xmin.x(), xmax.x() ), std::min( xmin.y(), xmax.y() ), std::min( xmin.z(), xmax.z() ) );
+  table.xmax = G4ThreeVector( std::max( xmin.x(), xmax.x() ), std::max( xmin.y(), xmax.y() ), std::max( xmin.z(), xmax.z() ) );
+  //Changing the region invalidates whatever was accumulated so far:
+  table.bins.clear();
+}
+
+void G4SBSOpticalLUT::SetBinning( G4int nx, G4int ny, G4int nz, G4int ncostheta, G4int nphi ){
+  fNbinsX = std::max(1,nx);
+  fNbinsY = std::max(1,ny);
+  fNbinsZ = std::max(1,nz);
+  fNbinsCosTheta = std::max(1,ncostheta);
+  fNbinsPhi = std::max(1,nphi);
+
+  for( map<G4String,G4SBSOpticalLUTTable>::iterator it=fTables.begin(); it!=fTables.end(); ++it ){
+    it->second.bins.clear();
+  }
+}
+
+void G4SBSOpticalLUT::BeginOfRun(){
+  if( fMode == kCalibrate && fTables.empty() ){
+    fprintf(stderr, "%s: %s line %d - Error: optical LUT calibration requested but no region defined. Use /g4sbs/opticalLUTregion.\n", __PRETTY_FUNCTION__, __FILE__, __LINE__);
+    exit(-1);
+  }
+
+  if( fMode == kProduction && fLoadedFile != fFileName ){
+    if( !Read( fFileName ) ){
+      fprintf(stderr, "%s: %s line %d - Error: could not read optical LUT file %s\n", __PRETTY_FUNCTION__, __FILE__, __LINE__, fFileName.data() );
+      exit(-1);
+    }
+  }
+}
+
+void G4SBSOpticalLUT::EndOfRun(){
+  if( fMode == kCalibrate ){
+    Finalize();
+    Write( fFileName );
+  }
+}
+
+G4long G4SBSOpticalLUT::FindBin( const G4SBSOpticalLUTTable &table, G4ThreeVector vertex, G4ThreeVector direction ) const {
+  G4ThreeVector dx = table.xmax - table.xmin;
+
+  G4int ix = G4int( fNbinsX * (vertex.x() - table.xmin.x())/dx.x() );
+  G4int iy = G4int( fNbinsY * (vertex.y() - table.xmin.y())/dx.y() );
+  G4int iz = G4int( fNbinsZ * (vertex.z() - table.xmin.z())/dx.z() );
+
+  if( ix < 0 || ix >= fNbinsX || iy < 0 || iy >= fNbinsY || iz < 0 || iz >= fNbinsZ ) return -1;
+
+  G4int ict = std::min( fNbinsCosTheta-1, G4int( fNbinsCosTheta * 0.5*(direction.cosTheta() + 1.0) ) );
+  G4int iph = std::min( fNbinsPhi-1, G4int( fNbinsPhi * (direction.phi() + CLHEP::pi)/CLHEP::twopi ) );
+
+  return ix + G4long(fNbinsX)*( iy + G4long(fNbinsY)*( iz + G4long(fNbinsZ)*( ict + G4long(fNbinsCosTheta)*iph ) ) );
+}
+
+map<G4String,G4SBSOpticalLUTTable>::iterator G4SBSOpticalLUT::FindTable( G4ThreeVector vertex ){
+  for( map<G4String,G4SBSOpticalLUTTable>::iterator it=fTables.begin(); it!=fTables.end(); ++it ){
+    const G4SBSOpticalLUTTable &table = it->second;
+    if( vertex.x() >= table.xmin.x() && vertex.x() < table.xmax.x() &&
+	vertex.y() >= table.xmin.y() && vertex.y() < table.xmax.y() &&
+	vertex.z() >= table.xmin.z() && vertex.z() < table.xmax.z() ){
+      return it;
+    }
+  }
+  return fTables.end();
+}
+
+void G4SBSOpticalLUT::RecordEmission( const G4Track *aTrack ){
+  G4ThreeVector vertex = aTrack->GetVertexPosition();
+
+  map<G4String,G4SBSOpticalLUTTable>::iterator itable = FindTable( vertex );
+  if( itable == fTables.end() ) return;
+
+  G4long ibin = FindBin( itable->second, vertex, aTrack->GetVertexMomentumDirection() );
+  if( ibin < 0 ) return;
+
+  G4SBSOpticalLUTBin &bin = itable->second.bins[ibin]; //value-initialized on first use
+  bin.nemitted += 1.0;
+}
+
+void G4SBSOpticalLUT::RecordDetection( G4String SDname, const G4Track *aTrack, G4int PMT, G4double delay, G4double QE, G4ThreeVector xgpmt ){
+  G4ThreeVector vertex = aTrack->GetVertexPosition();
+
+  //Only count photons that were attributed to this detector at emission:
+  map<G4String,G4SBSOpticalLUTTable>::iterator itable = FindTable( vertex );
+  if( itable == fTables.end() || itable->first != SDname ) return;
+
+  G4long ibin = FindBin( itable->second, vertex, aTrack->GetVertexMomentumDirection() );
+  if( ibin < 0 ) return;
+
+  G4SBSOpticalLUTChannel &chan = itable->second.bins[ibin].channels[PMT];
+  chan.sumw += QE;
+  chan.sumt += QE*delay;
+  chan.sumt2 += QE*delay*delay;
+
+  itable->second.pmtcoord[PMT] = xgpmt;
+}
+
+void G4SBSOpticalLUT::Finalize(){
+  for( map<G4String,G4SBSOpticalLUTTable>::iterator itable=fTables.begin(); itable!=fTables.end(); ++itable ){
+    for( map<G4long,G4SBSOpticalLUTBin>::iterator ibin=itable->second.bins.begin(); ibin!=itable->second.bins.end(); ++ibin ){
+      G4SBSOpticalLUTBin &bin = ibin->second;
+
+      bin.pmt.clear();
+      bin.cumprob.clear();
+      bin.tmean.clear();
+      bin.trms.clear();
+
+      if( bin.nemitted <= 0.0 ) continue;
+
+      G4double cumprob = 0.0;
+      for( map<G4int,G4SBSOpticalLUTChannel>::iterator ichan=bin.channels.begin(); ichan!=bin.channels.end(); ++ichan ){
+	const G4SBSOpticalLUTChannel &chan = ichan->second;
+	if( chan.sumw <= 0.0 ) continue;
+
+	G4double tmean = chan.sumt/chan.sumw;
+
+	cumprob += chan.sumw/bin.nemitted;
+
+	bin.pmt.push_back( ichan->first );
+	bin.cumprob.push_back( cumprob );
+	bin.tmean.push_back( tmean );
+	bin.trms.push_back( sqrt( std::max( 0.0, chan.sumt2/chan.sumw - tmean*tmean ) ) );
+      }
+    }
+  }
+}
+
+G4bool G4SBSOpticalLUT::ProcessPhoton( G4Track *aTrack ){
+  G4ThreeVector vertex = aTrack->GetVertexPosition();
+
+  map<G4String,G4SBSOpticalLUTTable>::iterator itable = FindTable( vertex );
+  if( itable == fTables.end() ) return false;
+
+  G4long ibin = FindBin( itable->second, vertex, aTrack->GetVertexMomentumDirection() );
+  if( ibin < 0 ) return false;
+
+  map<G4long,G4SBSOpticalLUTBin>::iterator ibinit = itable->second.bins.find( ibin );
+  //Bins with too few entries are left to the full optical simulation:
+  if( ibinit == itable->second.bins.end() || ibinit->second.nemitted < fMinEntries ) return false;
+
+  G4VSensitiveDetector *sd = G4SDManager::GetSDMpointer()->FindSensitiveDetector( itable->first, false );
+  G4SBSRICHSD *richsd = dynamic_cast<G4SBSRICHSD*>( sd );
+  G4SBSECalSD *ecalsd = dynamic_cast<G4SBSECalSD*>( sd );
+
+  if( richsd == NULL && ecalsd == NULL ) return false;
+
+  const G4SBSOpticalLUTBin &bin = ibinit->second;
+
+  vector<G4double>::const_iterator icum = std::upper_bound( bin.cumprob.begin(), bin.cumprob.end(), G4UniformRand() );
+
+  if( icum == bin.cumprob.end() ) return true; //photon not detected
+
+  size_t ipmt = icum - bin.cumprob.begin();
+
+  G4double delay = std::max( 0.0, G4RandGauss::shoot( bin.tmean[ipmt], bin.trms[ipmt] ) );
+  G4int PMT = bin.pmt[ipmt];
+  G4ThreeVector xgpmt = itable->second.pmtcoord[PMT];
+
+  if( richsd != NULL ){
+    richsd->InjectHit( aTrack, PMT, aTrack->GetGlobalTime() + delay, xgpmt );
+  } else {
+    ecalsd->InjectHit( aTrack, PMT, aTrack->GetGlobalTime() + delay, xgpmt );
+  }
+
+  return true;
+}
+
+void G4SBSOpticalLUT::Write( G4String fname ){
+  ofstream outfile( fname.data() );
+
+  if( !outfile.good() ){
+    fprintf(stderr, "%s: %s line %d - Error: could not open optical LUT file %s for writing\n", __PRETTY_FUNCTION__, __FILE__, __LINE__, fname.data() );
+    return;
+  }
+
+  outfile << "# g4sbs optical photon lookup table; lengths in mm, times in ns" << endl;
+  outfile << "bins " << fNbinsX << " " << fNbinsY << " " << fNbinsZ << " " << fNbinsCosTheta << " " << fNbinsPhi << endl;
+
+  for( map<G4String,G4SBSOpticalLUTTable>::iterator itable=fTables.begin(); itable!=fTables.end(); ++itable ){
+    const G4SBSOpticalLUTTable &table = itable->second;
+    G4String SDname = itable->first;
+
+    outfile << "region " << SDname << " "
+	    << table.xmin.x()/mm << " " << table.xmax.x()/mm << " "
+	    << table.xmin.y()/mm << " " << table.xmax.y()/mm << " "
+	    << table.xmin.z()/mm << " " << table.xmax.z()/mm << endl;
+
+    for( map<G4int,G4ThreeVector>::const_iterator ipmt=table.pmtcoord.begin(); ipmt!=table.pmtcoord.end(); ++ipmt ){
+      outfile << "pmt " << SDname << " " << ipmt->first << " "
+	      << ipmt->second.x()/mm << " " << ipmt->second.y()/mm << " " << ipmt->second.z()/mm << endl;
+    }
+
+    for( map<G4long,G4SBSOpticalLUTBin>::const_iterator ibin=table.bins.begin(); ibin!=table.bins.end(); ++ibin ){
+      outfile << "bin " << SDname << " " << ibin->first << " " << ibin->second.nemitted << endl;
+      for( map<G4int,G4SBSOpticalLUTChannel>::const_iterator ichan=ibin->second.channels.begin(); ichan!=ibin->second.channels.end(); ++ichan ){
+	outfile << "chan " << SDname << " " << ibin->first << " " << ichan->first << " "
+		<< ichan->second.sumw << " " << ichan->second.sumt/ns << " " << ichan->second.sumt2/(ns*ns) << endl;
+      }
+    }
+  }
+
+  G4cout << "Wrote optical LUT with " << fTables.size() << " regions to " << fname << G4endl;
+}
+
+G4bool G4SBSOpticalLUT::Read( G4String fname ){
+  ifstream infile( fname.data() );
+
+  if( !infile.good() ) return false;
+
+  fTables.clear();
+
+  string line;
+  while( std::getline( infile, line ) ){
+    if( line.empty() || line[0] == '#' ) continue;
+
+    std::istringstream is(line);
+    string keyword;
+    is >> keyword;
+
+    if( keyword == "bins" ){
+      is >> fNbinsX >> fNbinsY >> fNbinsZ >> fNbinsCosTheta >> fNbinsPhi;
+    } else if( keyword == "region" ){
+      string SDname;
+      G4double x1, x2, y1, y2, z1, z2;
+      is >> SDname >> x1 >> x2 >> y1 >> y2 >> z1 >> z2;
+      fTables[SDname].xmin = G4ThreeVector( x1, y1, z1 )*mm;
+      fTables[SDname].xmax = G4ThreeVector( x2, y2, z2 )*mm;
+    } else if( keyword == "pmt" ){
+      string SDname;
+      G4int PMT;
+      G4double x, y, z;
+      is >> SDname >> PMT >> x >> y >> z;
+      fTables[SDname].pmtcoord[PMT] = G4ThreeVector( x, y, z )*mm;
+    } else if( keyword == "bin" ){
+      string SDname;
+      G4long ibin;
+      G4double nemitted;
+      is >> SDname >> ibin >> nemitted;
+      fTables[SDname].bins[ibin].nemitted = nemitted;
+    } else if( keyword == "chan" ){
+      string SDname;
+      G4long ibin;
+      G4int PMT;
+      G4double sumw, sumt, sumt2;
+      is >> SDname >> ibin >> PMT >> sumw >> sumt >> sumt2;
+      G4SBSOpticalLUTChannel &chan = fTables[SDname].bins[ibin].channels[PMT];
+      chan.sumw = sumw;
+      chan.sumt = sumt*ns;
+      chan.sumt2 = sumt2*ns*ns;
+    }
+
+    if( is.fail() ){
+      fprintf(stderr, "%s: %s line %d - Error: malformed line in optical LUT file %s: %s\n", __PRETTY_FUNCTION__, __FILE__, __LINE__, fname.data(), line.c_str() );
+      return false;
+    }
+  }
+
+  Finalize();
+
+  fLoadedFile = fname;
+
+  G4cout << "Read optical LUT with " << fTables.size() << " regions from " << fname << G4endl;
+
+  return !fTables.empty();
+}
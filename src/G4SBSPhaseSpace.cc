@@ -0,0 +1,192 @@
+#include "G4SBSPhaseSpace.hh"
+
+#include "G4Step.hh"
+#include "G4StepPoint.hh"
+#include "G4Track.hh"
+#include "G4RunManager.hh"
+#include "G4Event.hh"
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+#include "G4ios.hh"
+
+#include <cstring>
+
+static const char *kPhaseSpaceMagic = "G4SBSPS";
+
+G4SBSPhaseSpace *G4SBSPhaseSpace::gSingleton = NULL;
+
+G4SBSPhaseSpace::G4SBSPhaseSpace(){
+  gSingleton = this;
+
+  fRecordFileName = "";
+  fRecordFile = NULL;
+  fSurfaceType = kSphere;
+  fSurfaceValue = 1.0*m;
+  fKillAtSurface = true;
+
+  fReplayFileName = "";
+  fLoadedFile = "";
+  fReplayEvent = 0;
+  fResample = 1;
+  fResampleCount = 0;
+}
+
+G4SBSPhaseSpace::~G4SBSPhaseSpace(){
+  if( fRecordFile ) fclose( fRecordFile );
+}
+
+G4SBSPhaseSpace *G4SBSPhaseSpace::GetPhaseSpace(){
+  if( gSingleton == NULL ){
+    gSingleton = new G4SBSPhaseSpace();
+  }
+  return gSingleton;
+}
+
+void G4SBSPhaseSpace::BeginOfRun(){
+  if( fRecordFileName == "" ) return;
+
+  fRecordFile = fopen( fRecordFileName.data(), "wb" );
+  if( fRecordFile == NULL ){
+    fprintf(stderr, "%s: %s line %d - Error: could not open phase space file %s for writing\n", __PRETTY_FUNCTION__, __FILE__, __LINE__, fRecordFileName.data() );
+    exit(-1);
+  }
+
+  memset( &fRecordHeader, 0, sizeof(fRecordHeader) );
+  strncpy( fRecordHeader.magic, kPhaseSpaceMagic, sizeof(fRecordHeader.magic) );
+  fRecordHeader.version = 1;
+  fRecordHeader.surface = fSurfaceType;
+  fRecordHeader.surfacevalue = fSurfaceValue/mm;
+
+  fwrite( &fRecordHeader, sizeof(fRecordHeader), 1, fRecordFile );
+
+  G4cout << "Recording particles crossing the " << (fSurfaceType == kSphere ? "sphere R = " : "plane z = ")
+	 << fSurfaceValue/cm << " cm to " << fRecordFileName << G4endl;
+}
+
+void G4SBSPhaseSpace::EndOfRun( G4int nevents ){
+  if( fRecordFile == NULL ) return;
+
+  //Rewrite the header with the final counts:
+  fRecordHeader.nsource = nevents;
+  fseek( fRecordFile, 0, SEEK_SET );
+  fwrite( &fRecordHeader, sizeof(fRecordHeader), 1, fRecordFile );
+  fclose( fRecordFile );
+  fRecordFile = NULL;
+
+  G4cout << "Phase space file " << fRecordFileName << ": " << fRecordHeader.nrecords << " particles from "
+	 << fRecordHeader.nsource << " events" << G4endl;
+}
+
+G4bool G4SBSPhaseSpace::ProcessStep( const G4Step *aStep ){
+  G4ThreeVector xpre = aStep->GetPreStepPoint()->GetPosition();
+  G4ThreeVector xpost = aStep->GetPostStepPoint()->GetPosition();
+  G4ThreeVector dx = xpost - xpre;
+
+  //Fraction of the step at which the surface is crossed outward:
+  G4double f;
+  if( fSurfaceType == kSphere ){
+    G4double R = fSurfaceValue;
+    if( xpre.mag2() >= R*R || xpost.mag2() < R*R ) return false;
+    //solve |xpre + f*dx| = R for 0 <= f <= 1:
+    G4double a = dx.mag2();
+    G4double b = 2.0*xpre.dot(dx);
+    G4double c = xpre.mag2() - R*R;
+    f = (-b + sqrt( b*b - 4.0*a*c ))/(2.0*a);
+  } else {
+    G4double Z = fSurfaceValue;
+    if( xpre.z() >= Z || xpost.z() < Z ) return false;
+    f = (Z - xpre.z())/dx.z();
+  }
+
+  G4ThreeVector x = xpre + f*dx;
+  G4ThreeVector p = aStep->GetPreStepPoint()->GetMomentum();
+  G4double t = aStep->GetPreStepPoint()->GetGlobalTime() + f*aStep->GetDeltaTime();
+
+  G4SBSPhaseSpaceRecord rec;
+  rec.event = G4RunManager::GetRunManager()->GetCurrentEvent()->GetEventID();
+  rec.pid = aStep->GetTrack()->GetParticleDefinition()->GetPDGEncoding();
+  rec.x = x.x()/mm;
+  rec.y = x.y()/mm;
+  rec.z = x.z()/mm;
+  rec.px = p.x()/MeV;
+  rec.py = p.y()/MeV;
+  rec.pz = p.z()/MeV;
+  rec.t = t/ns;
+
+  fwrite( &rec, sizeof(rec), 1, fRecordFile );
+  fRecordHeader.nrecords++;
+
+  if( fKillAtSurface ) aStep->GetTrack()->SetTrackStatus( fStopAndKill );
+
+  return true;
+}
+
+void G4SBSPhaseSpace::LoadReplayFile(){
+  if( fLoadedFile == fReplayFileName && !fReplayRecords.empty() ) return;
+
+  FILE *f = fopen( fReplayFileName.data(), "rb" );
+  if( f == NULL || fread( &fReplayHeader, sizeof(fReplayHeader), 1, f ) != 1 ||
+      strncmp( fReplayHeader.magic, kPhaseSpaceMagic, strlen(kPhaseSpaceMagic) ) != 0 ){
+    fprintf(stderr, "%s: %s line %d - Error: %s is not a valid phase space file\n", __PRETTY_FUNCTION__, __FILE__, __LINE__, fReplayFileName.data() );
+    if( f != NULL ) fclose(f);
+    exit(-1);
+  }
+
+  fReplayRecords.resize( fReplayHeader.nrecords );
+  if( fReplayHeader.nrecords == 0 ||
+      fread( &(fReplayRecords[0]), sizeof(G4SBSPhaseSpaceRecord), fReplayHeader.nrecords, f ) != size_t(fReplayHeader.nrecords) ){
+    fprintf(stderr, "%s: %s line %d - Error: phase space file %s is empty or truncated\n", __PRETTY_FUNCTION__, __FILE__, __LINE__, fReplayFileName.data() );
+    fclose(f);
+    exit(-1);
+  }
+  fclose(f);
+
+  //Records are written in event order; group them by event:
+  fReplayEventStart.clear();
+  for( size_t i=0; i<fReplayRecords.size(); i++ ){
+    if( i == 0 || fReplayRecords[i].event != fReplayRecords[i-1].event ) fReplayEventStart.push_back( i );
+  }
+  fReplayEventStart.push_back( fReplayRecords.size() );
+
+  fLoadedFile = fReplayFileName;
+  fReplayEvent = 0;
+  fResampleCount = 0;
+
+  G4cout << "Loaded phase space file " << fReplayFileName << ": " << fReplayRecords.size() << " particles in "
+	 << fReplayEventStart.size()-1 << " events, from " << fReplayHeader.nsource << " thrown" << G4endl;
+}
+
+void G4SBSPhaseSpace::NextEvent( vector<G4SBSPhaseSpaceRecord> &particles ){
+  if( fResampleCount >= fResample ){
+    fResampleCount = 0;
+    fReplayEvent++;
+    if( fReplayEvent+1 >= fReplayEventStart.size() ){
+      G4cout << "Phase space file " << fLoadedFile << " exhausted, starting over" << G4endl;
+      fReplayEvent = 0;
+    }
+  }
+
+  particles.assign( fReplayRecords.begin() + fReplayEventStart[fReplayEvent],
+		    fReplayRecords.begin() + fReplayEventStart[fReplayEvent+1] );
+
+  //Every reuse after the first gets a random rotation about the beam axis:
+  if( fResampleCount > 0 ){
+    G4double phi = CLHEP::twopi*CLHEP::RandFlat::shoot();
+    G4double c = cos(phi), s = sin(phi);
+    for( size_t i=0; i<particles.size(); i++ ){
+      G4SBSPhaseSpaceRecord &r = particles[i];
+      G4double x = r.x, y = r.y, px = r.px, py = r.py;
+      r.x = c*x - s*y;
+      r.y = s*x + c*y;
+      r.px = c*px - s*py;
+      r.py = s*px + c*py;
+    }
+  }
+
+  fResampleCount++;
+}
+
+G4double G4SBSPhaseSpace::GetReplayFraction() const {
+  if( fReplayHeader.nsource <= 0 ) return 1.0;
+  return G4double( fReplayEventStart.size()-1 )/G4double( fReplayHeader.nsource );
+}
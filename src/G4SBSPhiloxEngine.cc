@@ -0,0 +1,121 @@
+#include "G4SBSPhiloxEngine.hh"
+
+#include <cstdio>
+#include <iostream>
+
+static const uint32_t kPhiloxM0 = 0xD2511F53;
+static const uint32_t kPhiloxM1 = 0xCD9E8D57;
+static const uint32_t kPhiloxW0 = 0x9E3779B9;
+static const uint32_t kPhiloxW1 = 0xBB67AE85;
+
+G4SBSPhiloxEngine::G4SBSPhiloxEngine( long seed ){
+  setSeed( seed );
+}
+
+G4SBSPhiloxEngine::~G4SBSPhiloxEngine(){
+  ;
+}
+
+void G4SBSPhiloxEngine::SetStream( uint64_t seed, uint32_t run, uint32_t event, uint32_t consumer ){
+  fKey[0] = uint32_t( seed );
+  fKey[1] = uint32_t( seed >> 32 );
+  fCounter[0] = 0;
+  fCounter[1] = event;
+  fCounter[2] = run;
+  fCounter[3] = consumer;
+  fBufferPos = 4; //generate a new block on the next call
+  theSeed = long( seed );
+}
+
+void G4SBSPhiloxEngine::NextBlock(){
+  uint32_t c[4] = { fCounter[0], fCounter[1], fCounter[2], fCounter[3] };
+  uint32_t k[2] = { fKey[0], fKey[1] };
+
+  for( int round=0; round<10; round++ ){
+    uint64_t p0 = uint64_t(kPhiloxM0) * c[0];
+    uint64_t p1 = uint64_t(kPhiloxM1) * c[2];
+    uint32_t hi0 = uint32_t( p0 >> 32 ), lo0 = uint32_t( p0 );
+    uint32_t hi1 = uint32_t( p1 >> 32 ), lo1 = uint32_t( p1 );
+
+    c[0] = hi1 ^ c[1] ^ k[0];
+    c[1] = lo1;
+    c[2] = hi0 ^ c[3] ^ k[1];
+    c[3] = lo0;
+
+    k[0] += kPhiloxW0;
+    k[1] += kPhiloxW1;
+  }
+
+  for( int i=0; i<4; i++ ) fBuffer[i] = c[i];
+  fBufferPos = 0;
+
+  fCounter[0]++;
+}
+
+double G4SBSPhiloxEngine::flat(){
+  if( fBufferPos > 2 ) NextBlock();
+
+  //53 random bits from two 32-bit words; the result is in the open interval (0,1):
+  uint64_t a = fBuffer[fBufferPos] >> 5;
+  uint64_t b = fBuffer[fBufferPos+1] >> 6;
+  fBufferPos += 2;
+
+  return ( double( a*67108864 + b ) + 0.5 )/9007199254740992.0;
+}
+
+void G4SBSPhiloxEngine::flatArray( const int size, double *vect ){
+  for( int i=0; i<size; i++ ) vect[i] = flat();
+}
+
+G4SBSPhiloxEngine::operator unsigned int(){
+  if( fBufferPos > 3 ) NextBlock();
+  return fBuffer[fBufferPos++];
+}
+
+void G4SBSPhiloxEngine::setSeed( long seed, int ){
+  SetStream( uint64_t( seed ), 0, 0, 0 );
+}
+
+void G4SBSPhiloxEngine::setSeeds( const long *seeds, int ){
+  if( seeds == NULL || seeds[0] == 0 ){
+    setSeed( 0 );
+    return;
+  }
+  uint64_t seed = uint64_t( seeds[0] );
+  if( seeds[1] != 0 ) seed = ( seed << 32 ) ^ uint64_t( seeds[1] );
+  SetStream( seed, 0, 0, 0 );
+}
+
+void G4SBSPhiloxEngine::saveStatus( const char filename[] ) const {
+  FILE *f = fopen( filename, "w" );
+  if( f == NULL ) return;
+  fprintf( f, "G4SBSPhiloxEngine %u %u %u %u %u %u %d\n", fKey[0], fKey[1],
+	   fCounter[0], fCounter[1], fCounter[2], fCounter[3], fBufferPos );
+  fclose( f );
+}
+
+void G4SBSPhiloxEngine::restoreStatus( const char filename[] ){
+  FILE *f = fopen( filename, "r" );
+  if( f == NULL ) return;
+  uint32_t key[2], ctr[4];
+  int pos;
+  if( fscanf( f, "G4SBSPhiloxEngine %u %u %u %u %u %u %d", &key[0], &key[1],
+	      &ctr[0], &ctr[1], &ctr[2], &ctr[3], &pos ) == 7 ){
+    fKey[0] = key[0];
+    fKey[1] = key[1];
+    for( int i=0; i<4; i++ ) fCounter[i] = ctr[i];
+    //Regenerate the current block to restore the buffer:
+    fBufferPos = 4;
+    if( pos < 4 && fCounter[0] > 0 ){
+      fCounter[0]--;
+      NextBlock();
+      fBufferPos = pos;
+    }
+  }
+  fclose( f );
+}
+
+void G4SBSPhiloxEngine::showStatus() const {
+  std::cout << "G4SBSPhiloxEngine: key = (" << fKey[0] << ", " << fKey[1] << "), counter = ("
+	    << fCounter[0] << ", " << fCounter[1] << ", " << fCounter[2] << ", " << fCounter[3] << ")" << std::endl;
+}
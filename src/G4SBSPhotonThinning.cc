@@ -0,0 +1,130 @@
+#include "G4SBSPhotonThinning.hh"
+#include "G4SBSOpticalLUT.hh"
+
+#include "G4Material.hh"
+#include "G4MaterialPropertiesTable.hh"
+#include "G4Track.hh"
+#include "G4VProcess.hh"
+#include "Randomize.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+
+G4SBSPhotonThinning *G4SBSPhotonThinning::gSingleton = NULL;
+
+G4SBSPhotonThinning::G4SBSPhotonThinning(){
+  gSingleton = this;
+
+  fEnabled = false;
+  fActive = false;
+  fUserFactor = 0.0;
+  fFactor = 1.0;
+  fNphotons = 0;
+  fNkilled = 0;
+}
+
+G4SBSPhotonThinning::~G4SBSPhotonThinning(){
+  ;
+}
+
+G4SBSPhotonThinning *G4SBSPhotonThinning::GetThinning(){
+  if( gSingleton == NULL ){
+    gSingleton = new G4SBSPhotonThinning();
+  }
+  return gSingleton;
+}
+
+void G4SBSPhotonThinning::BeginOfRun(){
+  fQEcache.clear();
+  fNphotons = 0;
+  fNkilled = 0;
+  fFactor = 1.0;
+  fActive = false;
+
+  if( !fEnabled ) return;
+
+  if( G4SBSOpticalLUT::GetLUT()->GetMode() != G4SBSOpticalLUT::kOff ){
+    G4cout << "Photon thinning: not applied in optical LUT mode" << G4endl;
+    return;
+  }
+
+  //Largest quantum efficiency of all photocathode materials:
+  G4double QEmax = 0.0;
+  const G4MaterialTable *mattable = G4Material::GetMaterialTable();
+  for( size_t imat=0; imat<mattable->size(); imat++ ){
+    G4MaterialPropertiesTable *MPT = (*mattable)[imat]->GetMaterialPropertiesTable();
+    if( MPT == NULL ) continue;
+    G4MaterialPropertyVector *QEvect = (G4MaterialPropertyVector*) MPT->GetProperty("EFFICIENCY");
+    if( QEvect != NULL && QEvect->GetMaxValue() > QEmax ) QEmax = QEvect->GetMaxValue();
+  }
+
+  if( QEmax <= 0.0 || QEmax >= 1.0 ){
+    G4cout << "Photon thinning: maximum quantum efficiency = " << QEmax << ", no thinning applied" << G4endl;
+    return;
+  }
+
+  fFactor = QEmax;
+  if( fUserFactor > 0.0 ){
+    if( fUserFactor < QEmax ){
+      G4cout << "Photon thinning: factor " << fUserFactor << " is below the maximum quantum efficiency " << QEmax
+	     << ", using " << QEmax << G4endl;
+    } else {
+      fFactor = std::min( fUserFactor, 1.0 );
+    }
+  }
+
+  fActive = fFactor < 1.0;
+
+  G4cout << "Photon thinning: tracking a fraction " << fFactor << " of optical photons" << G4endl;
+}
+
+void G4SBSPhotonThinning::EndOfRun(){
+  if( !fActive ) return;
+
+  G4cout << "Photon thinning: " << fNkilled << " of " << fNphotons << " optical photons not tracked" << G4endl;
+}
+
+G4bool G4SBSPhotonThinning::KeepPhoton( const G4Track *track ){
+  if( !fActive ) return true;
+
+  //The QE/f compensation is applied once per detected photon, so each photon history may only be thinned
+  //once: at its creation by Cerenkov or scintillation, not again at WLS re-emission:
+  const G4VProcess *creator = track->GetCreatorProcess();
+  if( creator == NULL ) return true;
+  if( creator->GetProcessName() != "Cerenkov" && creator->GetProcessName() != "Scintillation" ) return true;
+
+  fNphotons++;
+  if( G4UniformRand() < fFactor ) return true;
+
+  fNkilled++;
+  return false;
+}
+
+G4double G4SBSPhotonThinning::QuantumEfficiency( const G4Material *mat, G4double Ephoton ){
+  map<const G4Material*, G4MaterialPropertyVector*>::iterator it = fQEcache.find( mat );
+
+  if( it == fQEcache.end() ){
+    G4MaterialPropertiesTable *MPT = mat->GetMaterialPropertiesTable();
+    G4MaterialPropertyVector *QEvect = NULL;
+    if( MPT != NULL ) QEvect = (G4MaterialPropertyVector*) MPT->GetProperty("EFFICIENCY");
+    it = fQEcache.insert( std::make_pair( mat, QEvect ) ).first;
+
+    if( QEvect == NULL && fActive ){
+      G4cout << "Photon thinning: WARNING material " << mat->GetName() << " has no EFFICIENCY, photons detected in it"
+	     << " are undercounted by a factor " << fFactor << G4endl;
+    }
+  }
+
+  G4MaterialPropertyVector *QEvect = it->second;
+
+  //Default to 1 in case no material properties table has been defined:
+  if( QEvect == NULL ) return 1.0;
+
+  if( Ephoton < QEvect->GetMinEnergy() || Ephoton > QEvect->GetMaxEnergy() ) return 0.0;
+
+  G4double QE = QEvect->Value( Ephoton );
+
+  if( fActive ) QE /= fFactor;
+
+  return QE;
+}
@@ -0,0 +1,426 @@
+#include "G4SBSPileup.hh"
+#include "G4SBSDetectorConstruction.hh"
+#include "G4SBSCalSD.hh"
+#include "G4SBSRunData.hh"
+#include "G4SBSRandom.hh"
+
+#include "TChain.h"
+#include "TFile.h"
+#include "TObjArray.h"
+#include "TChainElement.h"
+
+#include "G4SystemOfUnits.hh"
+#include "G4PhysicalConstants.hh"
+#include "Randomize.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+
+G4SBSPileup *G4SBSPileup::gSingleton = NULL;
+
+G4SBSPileup::G4SBSPileup(){
+  gSingleton = this;
+
+  fEnabled = false;
+  fChain = NULL;
+  fNthrown = 0.0;
+  fMeanEvents = 0.0;
+  fMeanOverride = -1.0;
+  fTmax = 0.0;
+}
+
+G4SBSPileup::~G4SBSPileup(){
+  delete fChain;
+}
+
+G4SBSPileup *G4SBSPileup::GetPileup(){
+  if( gSingleton == NULL ){
+    gSingleton = new G4SBSPileup();
+  }
+  return gSingleton;
+}
+
+void G4SBSPileup::AddLibraryFile( G4String fname ){
+  fLibraryFiles.push_back( fname );
+  //The chain is (re)built at the start of the next run:
+  delete fChain;
+  fChain = NULL;
+}
+
+void G4SBSPileup::Bind( TString branchname, vector<int> &v ){
+  fIntPtr.push_back( &v );
+  fChain->SetBranchStatus( branchname.Data(), 1 );
+  fChain->SetBranchAddress( branchname.Data(), &(fIntPtr.back()) );
+}
+
+void G4SBSPileup::Bind( TString branchname, vector<double> &v ){
+  fDoublePtr.push_back( &v );
+  fChain->SetBranchStatus( branchname.Data(), 1 );
+  fChain->SetBranchAddress( branchname.Data(), &(fDoublePtr.back()) );
+}
+
+void G4SBSPileup::BeginOfRun( G4SBSDetectorConstruction *fdetcon, G4double beamcurrent_uA ){
+  if( !fEnabled ) return;
+
+  if( fLibraryFiles.empty() ){
+    fprintf(stderr, "%s: %s line %d - Error: pile-up requested but no background library given. Use /g4sbs/pileupfile.\n", __PRETTY_FUNCTION__, __FILE__, __LINE__);
+    exit(-1);
+  }
+
+  delete fChain;
+  fChain = new TChain("T");
+  for( size_t i=0; i<fLibraryFiles.size(); i++ ) fChain->Add( fLibraryFiles[i].data() );
+
+  if( fChain->GetEntries() <= 0 ){
+    fprintf(stderr, "%s: %s line %d - Error: background library is empty\n", __PRETTY_FUNCTION__, __FILE__, __LINE__);
+    exit(-1);
+  }
+
+  //Normalization of the library: total number of beam electrons thrown, from run_data of each file:
+  fNthrown = 0.0;
+  TObjArray *files = fChain->GetListOfFiles();
+  for( G4int i=0; i<files->GetEntries(); i++ ){
+    TFile *f = new TFile( ( (TChainElement*) files->At(i) )->GetTitle(), "READ" );
+    G4SBSRunData *rd = NULL;
+    if( f->IsOpen() ) f->GetObject( "run_data", rd );
+    if( rd ) fNthrown += rd->GetNthrown();
+    f->Close();
+    delete f;
+  }
+
+  fChain->SetBranchStatus( "*", 0 );
+  fIntPtr.clear();
+  fDoublePtr.clear();
+  fLibGEM.clear();
+  fLibCAL.clear();
+  fSDtype.clear();
+  fTimeWindow.clear();
+  fTmax = 0.0;
+
+  for( set<G4String>::iterator d = (fdetcon->SDlist).begin(); d != (fdetcon->SDlist).end(); d++ ){
+    G4String SDname = *d;
+    G4SBS::SDet_t SDtype = (fdetcon->SDtype)[SDname];
+
+    if( SDtype != G4SBS::kGEM && SDtype != G4SBS::kCAL ) continue;
+
+    TString prefix = SDname.data();
+    prefix.ReplaceAll("/",".");
+
+    if( fChain->GetBranch( prefix + ".hit.nhits" ) == NULL ){
+      G4cout << "Pile-up: no branches for " << SDname << " in background library, not mixed" << G4endl;
+      continue;
+    }
+
+    fSDtype[SDname] = SDtype;
+
+    if( SDtype == G4SBS::kGEM ){
+      G4SBSGEMoutput &g = fLibGEM[SDname];
+      fTimeWindow[SDname] = g.timewindow/ns;
+
+      Bind( prefix + ".hit.plane", g.plane );
+      Bind( prefix + ".hit.strip", g.strip );
+      Bind( prefix + ".hit.x", g.x );
+      Bind( prefix + ".hit.y", g.y );
+      Bind( prefix + ".hit.z", g.z );
+      Bind( prefix + ".hit.polx", g.polx );
+      Bind( prefix + ".hit.poly", g.poly );
+      Bind( prefix + ".hit.polz", g.polz );
+      Bind( prefix + ".hit.t", g.t );
+      Bind( prefix + ".hit.trms", g.trms );
+      Bind( prefix + ".hit.tmin", g.tmin );
+      Bind( prefix + ".hit.tmax", g.tmax );
+      Bind( prefix + ".hit.tx", g.tx );
+      Bind( prefix + ".hit.ty", g.ty );
+      Bind( prefix + ".hit.xin", g.xin );
+      Bind( prefix + ".hit.yin", g.yin );
+      Bind( prefix + ".hit.zin", g.zin );
+      Bind( prefix + ".hit.xout", g.xout );
+      Bind( prefix + ".hit.yout", g.yout );
+      Bind( prefix + ".hit.zout", g.zout );
+      Bind( prefix + ".hit.txp", g.txp );
+      Bind( prefix + ".hit.typ", g.typ );
+      Bind( prefix + ".hit.xg", g.xg );
+      Bind( prefix + ".hit.yg", g.yg );
+      Bind( prefix + ".hit.zg", g.zg );
+      Bind( prefix + ".hit.trid", g.trid );
+      Bind( prefix + ".hit.mid", g.mid );
+      Bind( prefix + ".hit.pid", g.pid );
+      Bind( prefix + ".hit.vx", g.vx );
+      Bind( prefix + ".hit.vy", g.vy );
+      Bind( prefix + ".hit.vz", g.vz );
+      Bind( prefix + ".hit.p", g.p );
+      Bind( prefix + ".hit.edep", g.edep );
+      Bind( prefix + ".hit.beta", g.beta );
+    } else {
+      G4SBSCALoutput &c = fLibCAL[SDname];
+      G4SBSCalSD *calSD = (G4SBSCalSD*) fdetcon->fSDman->FindSensitiveDetector( SDname );
+      fTimeWindow[SDname] = calSD->GetTimeWindow()/ns;
+
+      Bind( prefix + ".hit.row", c.row );
+      Bind( prefix + ".hit.col", c.col );
+      Bind( prefix + ".hit.cell", c.cell );
+      Bind( prefix + ".hit.plane", c.plane );
+      Bind( prefix + ".hit.wire", c.wire );
+      Bind( prefix + ".hit.xcell", c.xcell );
+      Bind( prefix + ".hit.ycell", c.ycell );
+      Bind( prefix + ".hit.zcell", c.zcell );
+      Bind( prefix + ".hit.xcellg", c.xcellg );
+      Bind( prefix + ".hit.ycellg", c.ycellg );
+      Bind( prefix + ".hit.zcellg", c.zcellg );
+      Bind( prefix + ".hit.xhit", c.xhit );
+      Bind( prefix + ".hit.yhit", c.yhit );
+      Bind( prefix + ".hit.zhit", c.zhit );
+      Bind( prefix + ".hit.xhitg", c.xhitg );
+      Bind( prefix + ".hit.yhitg", c.yhitg );
+      Bind( prefix + ".hit.zhitg", c.zhitg );
+      Bind( prefix + ".hit.sumedep", c.sumedep );
+      Bind( prefix + ".hit.tavg", c.tavg );
+      Bind( prefix + ".hit.trms", c.trms );
+      Bind( prefix + ".hit.tmin", c.tmin );
+      Bind( prefix + ".hit.tmax", c.tmax );
+    }
+
+    fTmax = std::max( fTmax, fTimeWindow[SDname] );
+  }
+
+  //Mean number of library events in [-Tmax,+Tmax]: (beam electrons per ns) * 2 Tmax * (library entries per electron thrown):
+  G4double electrons_per_ns = beamcurrent_uA*1.0e-6/e_SI * 1.0e-9;
+  fMeanEvents = ( fNthrown > 0.0 ) ? electrons_per_ns * 2.0*fTmax * G4double(fChain->GetEntries())/fNthrown : 0.0;
+  if( fMeanOverride >= 0.0 ) fMeanEvents = fMeanOverride;
+
+  G4cout << "Pile-up: " << fChain->GetEntries() << " library events from " << fNthrown << " thrown, "
+	 << fSDtype.size() << " detectors mixed, mean of " << fMeanEvents << " background events in +/- " << fTmax << " ns" << G4endl;
+}
+
+void G4SBSPileup::SampleEvent(){
+  if( !fEnabled ) return;
+
+  for( map<G4String,G4SBS::SDet_t>::iterator it = fSDtype.begin(); it != fSDtype.end(); ++it ){
+    if( it->second == G4SBS::kGEM ) fPileGEM[it->first].Clear();
+    else fPileCAL[it->first].Clear();
+  }
+
+  CLHEP::HepRandomEngine *engine = G4SBSRandom::GetRandom()->GetEngine( G4SBSRandom::kPileup );
+
+  G4long nbkgd = CLHEP::RandPoisson::shoot( engine, fMeanEvents );
+  Long64_t nentries = fChain->GetEntries();
+
+  for( G4long ibkgd=0; ibkgd<nbkgd; ibkgd++ ){
+    G4double toffset = CLHEP::RandFlat::shoot( engine, -fTmax, fTmax );
+
+    fChain->GetEntry( Long64_t( CLHEP::RandFlat::shoot( engine )*nentries ) % nentries );
+
+    for( map<G4String,G4SBS::SDet_t>::iterator it = fSDtype.begin(); it != fSDtype.end(); ++it ){
+      G4String SDname = it->first;
+      //A detector only sees the background events within its own time window:
+      if( fabs(toffset) > fTimeWindow[SDname] ) continue;
+
+      if( it->second == G4SBS::kGEM ){
+	G4SBSGEMoutput &g = fLibGEM[SDname];
+	G4SBSGEMoutput &pile = fPileGEM[SDname];
+	for( size_t i=0; i<g.t.size(); i++ ){
+	  pile.plane.push_back( g.plane[i] );
+	  pile.strip.push_back( g.strip[i] );
+	  pile.x.push_back( g.x[i] );
+	  pile.y.push_back( g.y[i] );
+	  pile.z.push_back( g.z[i] );
+	  pile.polx.push_back( g.polx[i] );
+	  pile.poly.push_back( g.poly[i] );
+	  pile.polz.push_back( g.polz[i] );
+	  pile.t.push_back( g.t[i] + toffset );
+	  pile.trms.push_back( g.trms[i] );
+	  pile.tmin.push_back( g.tmin[i] + toffset );
+	  pile.tmax.push_back( g.tmax[i] + toffset );
+	  pile.tx.push_back( g.tx[i] );
+	  pile.ty.push_back( g.ty[i] );
+	  pile.xin.push_back( g.xin[i] );
+	  pile.yin.push_back( g.yin[i] );
+	  pile.zin.push_back( g.zin[i] );
+	  pile.xout.push_back( g.xout[i] );
+	  pile.yout.push_back( g.yout[i] );
+	  pile.zout.push_back( g.zout[i] );
+	  pile.txp.push_back( g.txp[i] );
+	  pile.typ.push_back( g.typ[i] );
+	  pile.xg.push_back( g.xg[i] );
+	  pile.yg.push_back( g.yg[i] );
+	  pile.zg.push_back( g.zg[i] );
+	  pile.trid.push_back( g.trid[i] );
+	  pile.mid.push_back( g.mid[i] );
+	  pile.pid.push_back( g.pid[i] );
+	  pile.vx.push_back( g.vx[i] );
+	  pile.vy.push_back( g.vy[i] );
+	  pile.vz.push_back( g.vz[i] );
+	  pile.p.push_back( g.p[i] );
+	  pile.edep.push_back( g.edep[i] );
+	  pile.beta.push_back( g.beta[i] );
+	}
+      } else {
+	G4SBSCALoutput &c = fLibCAL[SDname];
+	G4SBSCALoutput &pile = fPileCAL[SDname];
+	for( size_t i=0; i<c.tavg.size(); i++ ){
+	  pile.row.push_back( c.row[i] );
+	  pile.col.push_back( c.col[i] );
+	  pile.cell.push_back( c.cell[i] );
+	  pile.plane.push_back( c.plane[i] );
+	  pile.wire.push_back( c.wire[i] );
+	  pile.xcell.push_back( c.xcell[i] );
+	  pile.ycell.push_back( c.ycell[i] );
+	  pile.zcell.push_back( c.zcell[i] );
+	  pile.xcellg.push_back( c.xcellg[i] );
+	  pile.ycellg.push_back( c.ycellg[i] );
+	  pile.zcellg.push_back( c.zcellg[i] );
+	  pile.xhit.push_back( c.xhit[i] );
+	  pile.yhit.push_back( c.yhit[i] );
+	  pile.zhit.push_back( c.zhit[i] );
+	  pile.xhitg.push_back( c.xhitg[i] );
+	  pile.yhitg.push_back( c.yhitg[i] );
+	  pile.zhitg.push_back( c.zhitg[i] );
+	  pile.sumedep.push_back( c.sumedep[i] );
+	  pile.tavg.push_back( c.tavg[i] + toffset );
+	  pile.trms.push_back( c.trms[i] );
+	  pile.tmin.push_back( c.tmin[i] + toffset );
+	  pile.tmax.push_back( c.tmax[i] + toffset );
+	}
+      }
+    }
+  }
+}
+
+void G4SBSPileup::MixGEM( G4String SDname, G4SBSGEMoutput &gd ){
+  if( !fEnabled || fPileGEM.find( SDname ) == fPileGEM.end() ) return;
+
+  G4SBSGEMoutput &pile = fPileGEM[SDname];
+  size_t nsig = gd.t.size();
+  size_t nbkgd = pile.t.size();
+
+  gd.bkgd.assign( nsig, 0 );
+  if( nbkgd == 0 ) return;
+
+  gd.plane.insert( gd.plane.end(), pile.plane.begin(), pile.plane.end() );
+  gd.strip.insert( gd.strip.end(), pile.strip.begin(), pile.strip.end() );
+  gd.x.insert( gd.x.end(), pile.x.begin(), pile.x.end() );
+  gd.y.insert( gd.y.end(), pile.y.begin(), pile.y.end() );
+  gd.z.insert( gd.z.end(), pile.z.begin(), pile.z.end() );
+  gd.polx.insert( gd.polx.end(), pile.polx.begin(), pile.polx.end() );
+  gd.poly.insert( gd.poly.end(), pile.poly.begin(), pile.poly.end() );
+  gd.polz.insert( gd.polz.end(), pile.polz.begin(), pile.polz.end() );
+  gd.t.insert( gd.t.end(), pile.t.begin(), pile.t.end() );
+  gd.trms.insert( gd.trms.end(), pile.trms.begin(), pile.trms.end() );
+  gd.tmin.insert( gd.tmin.end(), pile.tmin.begin(), pile.tmin.end() );
+  gd.tmax.insert( gd.tmax.end(), pile.tmax.begin(), pile.tmax.end() );
+  gd.tx.insert( gd.tx.end(), pile.tx.begin(), pile.tx.end() );
+  gd.ty.insert( gd.ty.end(), pile.ty.begin(), pile.ty.end() );
+  gd.xin.insert( gd.xin.end(), pile.xin.begin(), pile.xin.end() );
+  gd.yin.insert( gd.yin.end(), pile.yin.begin(), pile.yin.end() );
+  gd.zin.insert( gd.zin.end(), pile.zin.begin(), pile.zin.end() );
+  gd.xout.insert( gd.xout.end(), pile.xout.begin(), pile.xout.end() );
+  gd.yout.insert( gd.yout.end(), pile.yout.begin(), pile.yout.end() );
+  gd.zout.insert( gd.zout.end(), pile.zout.begin(), pile.zout.end() );
+  gd.txp.insert( gd.txp.end(), pile.txp.begin(), pile.txp.end() );
+  gd.typ.insert( gd.typ.end(), pile.typ.begin(), pile.typ.end() );
+  gd.xg.insert( gd.xg.end(), pile.xg.begin(), pile.xg.end() );
+  gd.yg.insert( gd.yg.end(), pile.yg.begin(), pile.yg.end() );
+  gd.zg.insert( gd.zg.end(), pile.zg.begin(), pile.zg.end() );
+  gd.trid.insert( gd.trid.end(), pile.trid.begin(), pile.trid.end() );
+  gd.mid.insert( gd.mid.end(), pile.mid.begin(), pile.mid.end() );
+  gd.pid.insert( gd.pid.end(), pile.pid.begin(), pile.pid.end() );
+  gd.vx.insert( gd.vx.end(), pile.vx.begin(), pile.vx.end() );
+  gd.vy.insert( gd.vy.end(), pile.vy.begin(), pile.vy.end() );
+  gd.vz.insert( gd.vz.end(), pile.vz.begin(), pile.vz.end() );
+  gd.p.insert( gd.p.end(), pile.p.begin(), pile.p.end() );
+  gd.edep.insert( gd.edep.end(), pile.edep.begin(), pile.edep.end() );
+  gd.beta.insert( gd.beta.end(), pile.beta.begin(), pile.beta.end() );
+
+  //Background hits have no SD track information in this event:
+  if( gd.otridx.size() == nsig ){
+    gd.otridx.resize( nsig+nbkgd, -1 );
+    gd.ptridx.resize( nsig+nbkgd, -1 );
+    gd.sdtridx.resize( nsig+nbkgd, -1 );
+  }
+
+  if( gd.weight.size() == nsig ) gd.weight.resize( nsig+nbkgd, 1.0 );
+
+  gd.bkgd.resize( nsig+nbkgd, 1 );
+  gd.nhits_GEM = gd.t.size();
+}
+
+void G4SBSPileup::MixCAL( G4String SDname, G4SBSCALoutput &cd ){
+  if( !fEnabled || fPileCAL.find( SDname ) == fPileCAL.end() ) return;
+
+  G4SBSCALoutput &pile = fPileCAL[SDname];
+  size_t nsig = cd.tavg.size();
+
+  cd.bkgd.assign( nsig, 0 );
+
+  G4double tw = fTimeWindow[SDname];
+
+  for( size_t i=0; i<pile.tavg.size(); i++ ){
+    G4double E = pile.sumedep[i];
+
+    //Look for a signal hit in the same cell and time window:
+    size_t jhit = nsig;
+    for( size_t j=0; j<nsig; j++ ){
+      if( cd.cell[j] == pile.cell[i] && fabs( cd.tavg[j] - pile.tavg[i] ) < tw ){
+	jhit = j;
+	break;
+      }
+    }
+
+    if( jhit < nsig ){ //merge: energy-weighted averages of position and time
+      G4double Esig = cd.sumedep[jhit];
+      G4double Etot = Esig + E;
+      G4double tavg = (Esig*cd.tavg[jhit] + E*pile.tavg[i])/Etot;
+      G4double t2 = ( Esig*( pow(cd.trms[jhit],2) + pow(cd.tavg[jhit],2) ) + E*( pow(pile.trms[i],2) + pow(pile.tavg[i],2) ) )/Etot;
+
+      cd.xhit[jhit] = (Esig*cd.xhit[jhit] + E*pile.xhit[i])/Etot;
+      cd.yhit[jhit] = (Esig*cd.yhit[jhit] + E*pile.yhit[i])/Etot;
+      cd.zhit[jhit] = (Esig*cd.zhit[jhit] + E*pile.zhit[i])/Etot;
+      cd.xhitg[jhit] = (Esig*cd.xhitg[jhit] + E*pile.xhitg[i])/Etot;
+      cd.yhitg[jhit] = (Esig*cd.yhitg[jhit] + E*pile.yhitg[i])/Etot;
+      cd.zhitg[jhit] = (Esig*cd.zhitg[jhit] + E*pile.zhitg[i])/Etot;
+      cd.tavg[jhit] = tavg;
+      cd.trms[jhit] = sqrt( std::max( 0.0, t2 - tavg*tavg ) );
+      cd.tmin[jhit] = std::min( cd.tmin[jhit], pile.tmin[i] );
+      cd.tmax[jhit] = std::max( cd.tmax[jhit], pile.tmax[i] );
+      cd.sumedep[jhit] = Etot;
+      cd.bkgd[jhit] = 2;
+    } else { //new hit:
+      cd.row.push_back( pile.row[i] );
+      cd.col.push_back( pile.col[i] );
+      cd.cell.push_back( pile.cell[i] );
+      cd.plane.push_back( pile.plane[i] );
+      cd.wire.push_back( pile.wire[i] );
+      cd.xcell.push_back( pile.xcell[i] );
+      cd.ycell.push_back( pile.ycell[i] );
+      cd.zcell.push_back( pile.zcell[i] );
+      cd.xcellg.push_back( pile.xcellg[i] );
+      cd.ycellg.push_back( pile.ycellg[i] );
+      cd.zcellg.push_back( pile.zcellg[i] );
+      cd.xhit.push_back( pile.xhit[i] );
+      cd.yhit.push_back( pile.yhit[i] );
+      cd.zhit.push_back( pile.zhit[i] );
+      cd.xhitg.push_back( pile.xhitg[i] );
+      cd.yhitg.push_back( pile.yhitg[i] );
+      cd.zhitg.push_back( pile.zhitg[i] );
+      cd.sumedep.push_back( E );
+      cd.tavg.push_back( pile.tavg[i] );
+      cd.trms.push_back( pile.trms[i] );
+      cd.tmin.push_back( pile.tmin[i] );
+      cd.tmax.push_back( pile.tmax[i] );
+      cd.bkgd.push_back( 1 );
+
+      //Keep the per-hit optional vectors aligned:
+      if( cd.weight.size() == cd.tavg.size()-1 ) cd.weight.push_back( 1.0 );
+      if( cd.pulseshape == G4SBS::kPulseShapeDense && cd.edep_vs_time.size() == cd.tavg.size()-1 ) cd.edep_vs_time.push_back( vector<double>( cd.ntimebins, 0.0 ) );
+      if( cd.otridx.size() == cd.tavg.size()-1 ){
+	cd.otridx.push_back( -1 );
+	cd.ptridx.push_back( -1 );
+	cd.sdtridx.push_back( -1 );
+      }
+    }
+
+    cd.Esum += E;
+  }
+
+  cd.nhits_CAL = cd.tavg.size();
+}
@@ -12,6 +12,8 @@
 #include "G4SBSEventGen.hh"
 #include "G4SBSIO.hh"
 #include "G4SBSRunAction.hh"
+#include "G4SBSRandom.hh"
+#include "G4SBSProfiler.hh"
 #include "sbstypes.hh"
 #include "globals.hh"
 #include "TVector3.h"
@@ -46,6 +48,12 @@ G4SBSPrimaryGeneratorAction::G4SBSPrimaryGeneratorAction()
   sbsgen = new G4SBSEventGen();
 
   fUseGeantino = false;
+
+  fAcceptanceFilter = 0;
+  fEarmFilterDX = 15.0*deg;
+  fEarmFilterDY = 25.0*deg;
+  fHarmFilterDX = 10.0*deg;
+  fHarmFilterDY = 15.0*deg;
 }
 
 G4SBSPrimaryGeneratorAction::~G4SBSPrimaryGeneratorAction()
@@ -55,6 +63,11 @@ G4SBSPrimaryGeneratorAction::~G4SBSPrimaryGeneratorAction()
 
 void G4SBSPrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent)
 {
+  G4SBSProfiler::Scope prof( G4SBSProfiler::kGeneration );
+
+  //Position the random streams for this event, if enabled:
+  G4SBSRandom::GetRandom()->BeginOfEvent( anEvent->GetEventID() );
+
   G4ParticleTable* particleTable = G4ParticleTable::GetParticleTable();
   G4String particleName;
   G4ParticleDefinition* particle;
@@ -70,14 +83,47 @@ void G4SBSPrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent)
   int ntries = 1;
   while( !sbsgen->GenerateEvent() ){ ntries++; }
 
+  //Event thrown away by the pre-tracking acceptance filter: it is processed as an event without primaries,
+  //so that it counts in Nthrown and Ntries (and in the ev.rate normalization) exactly as if it had been
+  //tracked and missed the detectors:
+  G4bool filtered = !PassesAcceptanceFilter();
+
   // G4cout << "Got event, ntries = " << ntries << G4endl;
 
   int ntries_run = RunAction->GetNtries();
   RunAction->SetNtries( ntries_run + ntries );
+  if( filtered ) RunAction->SetNfiltered( RunAction->GetNfiltered() + 1 );
+  G4SBSProfiler::GetProfiler()->AddCount( G4SBSProfiler::kGeneration, ntries );
 
   //evdata = sbsgen->GetEventData();
   fIO->SetEventData(sbsgen->GetEventData());
 
+  //Set some of the event-level variables that will end up in the root tree here:
+  //Since the primary generator action is the only class other than the messenger that can talk directly to both the G4SBSIO and the G4SBSEventGen classes,
+  //This is the place to set these values:
+  fIO->SetTargPol( sbsgen->GetTargPolMagnitude() );
+  fIO->SetBeamPol( sbsgen->GetBeamPolMagnitude() );
+  
+  G4ThreeVector targpoldir = sbsgen->GetTargPolDirection();
+  G4ThreeVector beampoldir = sbsgen->GetBeamPolDirection();
+  
+  fIO->SetTargThetaSpin( targpoldir.theta() );
+  fIO->SetTargPhiSpin( targpoldir.phi() );
+  //In almost all cases, the beam polarization will be along Z:
+  fIO->SetBeamThetaSpin( beampoldir.theta() );
+  fIO->SetBeamPhiSpin( beampoldir.phi() );
+
+  fIO->SetAUT_Collins( sbsgen->GetAUT_Collins() );
+  fIO->SetAUT_Sivers( sbsgen->GetAUT_Sivers() );
+
+  fIO->SetAUT_Collins_min( sbsgen->GetAUT_Collins_min() );
+  fIO->SetAUT_Sivers_min( sbsgen->GetAUT_Sivers_min() );
+
+  fIO->SetAUT_Collins_max( sbsgen->GetAUT_Collins_max() );
+  fIO->SetAUT_Sivers_max( sbsgen->GetAUT_Sivers_max() );
+
+  if( filtered ) return;
+
   if( sbsgen->GetKine() == G4SBS::kPYTHIA6 ){ //PYTHIA6 event:
     G4SBSPythiaOutput Primaries = sbsgen->GetPythiaEvent();
 
@@ -108,6 +154,29 @@ void G4SBSPrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent)
     return;
   }
 
+  if( sbsgen->GetKine() == G4SBS::kPhaseSpace ){ //Replay of particles recorded on a phase space surface:
+    const vector<G4SBSPhaseSpaceRecord> &particles = sbsgen->GetPhaseSpaceEvent();
+
+    for( size_t ipart=0; ipart<particles.size(); ipart++ ){
+      const G4SBSPhaseSpaceRecord &r = particles[ipart];
+      particle = particleTable->FindParticle( r.pid );
+      if( particle == NULL ) continue;
+      
+      G4ThreeVector p( r.px*MeV, r.py*MeV, r.pz*MeV );
+      G4double M = particle->GetPDGMass();
+      
+      particleGun->SetParticleDefinition(particle);
+      particleGun->SetNumberOfParticles(1);
+      particleGun->SetParticleEnergy( sqrt( p.mag2() + M*M ) - M );
+      particleGun->SetParticleMomentumDirection( p.unit() );
+      particleGun->SetParticlePosition( G4ThreeVector( r.x*mm, r.y*mm, r.z*mm ) );
+      particleGun->SetParticleTime( r.t*ns );
+      particleGun->GeneratePrimaryVertex(anEvent);
+    }
+    
+    return;
+  }
+
   if( sbsgen->GetKine() == G4SBS::kSIMC ){ //SIMC event:
     G4SBSSIMCOutput Primaries = sbsgen->GetSIMCEvent();
     
@@ -393,29 +462,6 @@ void G4SBSPrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent)
       particleGun->GeneratePrimaryVertex(anEvent);
   }
 
-  //Set some of the event-level variables that will end up in the root tree here:
-  //Since the primary generator action is the only class other than the messenger that can talk directly to both the G4SBSIO and the G4SBSEventGen classes,
-  //This is the place to set these values:
-  fIO->SetTargPol( sbsgen->GetTargPolMagnitude() );
-  fIO->SetBeamPol( sbsgen->GetBeamPolMagnitude() );
-  
-  G4ThreeVector targpoldir = sbsgen->GetTargPolDirection();
-  G4ThreeVector beampoldir = sbsgen->GetBeamPolDirection();
-  
-  fIO->SetTargThetaSpin( targpoldir.theta() );
-  fIO->SetTargPhiSpin( targpoldir.phi() );
-  //In almost all cases, the beam polarization will be along Z:
-  fIO->SetBeamThetaSpin( beampoldir.theta() );
-  fIO->SetBeamPhiSpin( beampoldir.phi() );
-
-  fIO->SetAUT_Collins( sbsgen->GetAUT_Collins() );
-  fIO->SetAUT_Sivers( sbsgen->GetAUT_Sivers() );
-
-  fIO->SetAUT_Collins_min( sbsgen->GetAUT_Collins_min() );
-  fIO->SetAUT_Sivers_min( sbsgen->GetAUT_Sivers_min() );
-
-  fIO->SetAUT_Collins_max( sbsgen->GetAUT_Collins_max() );
-  fIO->SetAUT_Sivers_max( sbsgen->GetAUT_Sivers_max() );
   
 }
 
@@ -424,3 +470,43 @@ G4ParticleGun* G4SBSPrimaryGeneratorAction::GetParticleGun()
   return particleGun;
 } 
 
+G4bool G4SBSPrimaryGeneratorAction::PassesAcceptanceFilter(){
+  if( fAcceptanceFilter <= 0 ) return true;
+
+  G4SBS::Kine_t kine = sbsgen->GetKine();
+
+  //Events read from external files, and generators without a well-defined final state, are never filtered:
+  if( kine == G4SBS::kPYTHIA6 || kine == G4SBS::kSIMC || kine == G4SBS::kBeam || kine == G4SBS::kCosmics ||
+      kine == G4SBS::kPhaseSpace ) return true;
+
+  gen_t gendata = fIO->GetGenData();
+
+  //BigBite (electron arm) is on beam left at +thbb, SBS (hadron arm) on beam right at -thsbs.
+  //Rotate the momentum into the frame of each spectrometer and compare the projected angles to the window:
+  if( fAcceptanceFilter & 1 ){
+    G4ThreeVector pe = sbsgen->GetElectronP();
+    pe.rotateY( -gendata.thbb );
+    if( pe.z() <= 0.0 || fabs( atan( pe.x()/pe.z() ) ) > fEarmFilterDX || fabs( atan( pe.y()/pe.z() ) ) > fEarmFilterDY ) return false;
+  }
+
+  if( fAcceptanceFilter & 2 ){
+    G4ThreeVector ph = ( kine == G4SBS::kSIDIS || kine == G4SBS::kWiser ) ? sbsgen->GetHadronP() : sbsgen->GetNucleonP();
+    ph.rotateY( gendata.thsbs );
+    if( ph.z() <= 0.0 || fabs( atan( ph.x()/ph.z() ) ) > fHarmFilterDX || fabs( atan( ph.y()/ph.z() ) ) > fHarmFilterDY ) return false;
+  }
+
+  return true;
+}
+
+void G4SBSPrimaryGeneratorAction::CheckAcceptanceFilter(){
+  if( fAcceptanceFilter <= 0 ) return;
+
+  G4SBS::Kine_t kine = sbsgen->GetKine();
+
+  //DIS leaves the nucleon momentum unset and the gun only produces the "electron", so no event
+  //would ever pass the hadron arm test:
+  if( (fAcceptanceFilter & 2) && ( kine == G4SBS::kDIS || kine == G4SBS::kGun ) ){
+    fprintf(stderr, "%s: %s line %d - Error: /g4sbs/acceptancefilter %d requires a hadron or nucleon, which the %s generator does not produce; use mode 1 or 0\n", __PRETTY_FUNCTION__, __FILE__, __LINE__, fAcceptanceFilter, kine == G4SBS::kDIS ? "dis" : "gun");
+    exit(-1);
+  }
+}
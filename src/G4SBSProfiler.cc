@@ -0,0 +1,106 @@
+#include "G4SBSProfiler.hh"
+
+#include "G4ios.hh"
+
+#include "TTree.h"
+
+#include <cstdio>
+#include <cstring>
+
+G4SBSProfiler *G4SBSProfiler::gSingleton = NULL;
+
+G4SBSProfiler::G4SBSProfiler(){
+  gSingleton = this;
+
+  fEnabled = false;
+
+  const char *phasenames[kNPhases] = { "generation", "tracking", "field", "event action", "tree fill", "writer wait" };
+
+  for( G4int i=0; i<kNPhases; i++ ){
+    fName.push_back( phasenames[i] );
+  }
+  fTime.resize( kNPhases, 0.0 );
+  fNcalls.resize( kNPhases, 0 );
+  fCount.resize( kNPhases, 0 );
+  fStart.resize( kNPhases );
+}
+
+G4SBSProfiler::~G4SBSProfiler(){
+  ;
+}
+
+G4SBSProfiler *G4SBSProfiler::GetProfiler(){
+  if( gSingleton == NULL ){
+    gSingleton = new G4SBSProfiler();
+  }
+  return gSingleton;
+}
+
+G4int G4SBSProfiler::RegisterSD( G4String SDname ){
+  G4String name = "SD " + SDname;
+  for( G4int id=kNPhases; id<G4int(fName.size()); id++ ){
+    if( fName[id] == name ) return id;
+  }
+
+  fName.push_back( name );
+  fTime.push_back( 0.0 );
+  fNcalls.push_back( 0 );
+  fCount.push_back( 0 );
+  fStart.push_back( Clock_t::time_point() );
+
+  return G4int(fName.size())-1;
+}
+
+void G4SBSProfiler::BeginOfRun( G4String genname ){
+  fName[kGeneration] = "generation (" + genname + ")";
+
+  for( size_t id=0; id<fName.size(); id++ ){
+    fTime[id] = 0.0;
+    fNcalls[id] = 0;
+    fCount[id] = 0;
+  }
+}
+
+void G4SBSProfiler::EndOfRun( G4double realtime ){
+  if( !fEnabled ) return;
+
+  G4cout << "Timing report (field and SD times are included in tracking):" << G4endl;
+  G4cout << "  phase                              calls     time (s)   us/call  % of run" << G4endl;
+
+  char line[256];
+  for( size_t id=0; id<fName.size(); id++ ){
+    if( fNcalls[id] == 0 ) continue;
+    sprintf( line, "  %-30s %12ld %12.3f %9.3f %9.2f", fName[id].data(), fNcalls[id], fTime[id],
+	     1.e6*fTime[id]/double(fNcalls[id]), realtime > 0.0 ? 100.0*fTime[id]/realtime : 0.0 );
+    G4cout << line << G4endl;
+  }
+  if( fCount[kGeneration] > 0 && fNcalls[kGeneration] > 0 ){
+    G4cout << "  generation tries per event = " << double(fCount[kGeneration])/double(fNcalls[kGeneration]) << G4endl;
+  }
+}
+
+void G4SBSProfiler::Write(){
+  if( !fEnabled ) return;
+
+  char name[64];
+  Long64_t ncalls, count;
+  Double_t time;
+
+  TTree *profile = new TTree("profile", "g4sbs timing report");
+  profile->Branch( "name", name, "name/C" );
+  profile->Branch( "ncalls", &ncalls, "ncalls/L" );
+  profile->Branch( "count", &count, "count/L" );
+  profile->Branch( "time", &time, "time/D" );
+
+  for( size_t id=0; id<fName.size(); id++ ){
+    strncpy( name, fName[id].data(), sizeof(name)-1 );
+    name[sizeof(name)-1] = '\0';
+    ncalls = fNcalls[id];
+    count = fCount[id];
+    time = fTime[id];
+    profile->Fill();
+  }
+
+  profile->Write( "profile", TObject::kOverwrite );
+  delete profile;
+}
@@ -1,4 +1,5 @@
 #include "G4SBSRICHSD.hh"
+#include "G4SBSProfiler.hh"
 #include "G4SBSRICHHit.hh"
 #include "G4Step.hh"
 #include "G4HCofThisEvent.hh"
@@ -6,6 +7,12 @@
 #include "G4ios.hh"
 #include "G4Track.hh"
 #include "G4OpticalPhoton.hh"
+#include "G4LogicalVolume.hh"
+#include "G4LogicalVolumeStore.hh"
+#include "G4RunManager.hh"
+#include "G4Run.hh"
+#include "G4SBSOpticalLUT.hh"
+#include "G4SBSPhotonThinning.hh"
 
 G4SBSRICHSD::G4SBSRICHSD( G4String name, G4String collname ) : G4VSensitiveDetector(name) {
   collectionName.insert( collname );
@@ -14,6 +21,10 @@ G4SBSRICHSD::G4SBSRICHSD( G4String name, G4String collname ) : G4VSensitiveDetec
 
   SDtracks.Clear();
   SDtracks.SetSDname(name);
+
+  fProfileID = G4SBSProfiler::GetProfiler()->RegisterSD( name );
+
+  fOriginFlagsRunID = -1;
 }
 
 G4SBSRICHSD::~G4SBSRICHSD(){;}
@@ -31,9 +42,20 @@ void G4SBSRICHSD::Initialize( G4HCofThisEvent *HC ){
   HC->AddHitsCollection( HCID, hitCollection );
 
   SDtracks.Clear();
+  fLUTphotons.clear();
+
+  //The geometry may have been rebuilt between runs, so the origin volume table is rebuilt at the first event of each run:
+  const G4Run *run = G4RunManager::GetRunManager()->GetCurrentRun();
+  G4int runID = run != NULL ? run->GetRunID() : -1;
+  if( runID != fOriginFlagsRunID || fOriginFlags.empty() ){
+    BuildOriginVolumeFlags();
+    fOriginFlagsRunID = runID;
+  }
 }
 
 G4bool G4SBSRICHSD::ProcessHits( G4Step *aStep, G4TouchableHistory* ){
+  G4SBSProfiler::Scope prof( fProfileID );
+
   //G4cout << "Processing RICH hits, SDname = " << SensitiveDetectorName << G4endl;
 
   G4double edep = aStep->GetTotalEnergyDeposit();
@@ -66,19 +88,7 @@ G4bool G4SBSRICHSD::ProcessHits( G4Step *aStep, G4TouchableHistory* ){
 
   //Record where was the optical photon produced:
   //Three cases are interesting: Aerogel tiles, RICH box containing C4F10 gas, or UVT-lucite of aerogel exit window (also PMT windows, PMT cathode volume, or PMT Quartz window):
-  G4String namevol_origin = track->GetLogicalVolumeAtVertex()->GetName();
-  int origin_flag = 0; //default
-  if( namevol_origin.contains("Aerogel_tile_log") ){  //Aerogel
-    origin_flag = 1;
-  } else if (namevol_origin.contains("SBS_RICH_log") || namevol_origin.contains("GC_Tank_log") ){ //C4F10
-    origin_flag = 2;
-  } else if (namevol_origin.contains("Aero_exitwindow") ){ //UVT lucite
-    origin_flag = 3;
-  } else if (namevol_origin.contains("PMTwindow_log") || namevol_origin.contains("PMTcathode_log") || namevol_origin.contains("PMTQuartzWindow_log") || namevol_origin.contains("GC_PMT_Glass_log")  ){
-    origin_flag = 4;
-  }
-
-  newHit->SetOriginVol( origin_flag );
+  newHit->SetOriginVol( OriginVolumeFlag( track ) );
 
   newHit->Setdx( aStep->GetStepLength() );
   newHit->SetTime( prestep->GetGlobalTime() );
@@ -133,36 +143,100 @@ G4bool G4SBSRICHSD::ProcessHits( G4Step *aStep, G4TouchableHistory* ){
 
   //newHit->SetLogicalVolume( prestep->GetPhysicalVolume()->GetLogicalVolume() );
 
-  //Set quantum efficiency: default to 1 in case no material properties table has been defined:
-  newHit->SetQuantumEfficiency( 1.0 );
+  //Quantum efficiency of the photocathode (default 1 if no material properties table has been defined),
+  //rescaled if optical photons are thinned at generation:
+  newHit->SetQuantumEfficiency( G4SBSPhotonThinning::GetThinning()->QuantumEfficiency( prestep->GetPhysicalVolume()->GetLogicalVolume()->GetMaterial(), newHit->GetEnergy() ) );
 
-  G4MaterialPropertiesTable *MPT = prestep->GetPhysicalVolume()->GetLogicalVolume()->GetMaterial()->GetMaterialPropertiesTable();
+  //G4cout << "G4SDname = " << GetName() << ", Ephoton = " << newHit->GetEnergy()/CLHEP::eV << ", QE = " << newHit->GetQuantumEfficiency() << G4endl;
 
-  if( MPT != NULL ){
-    G4MaterialPropertyVector *QEvect = (G4MaterialPropertyVector*) MPT->GetProperty("EFFICIENCY");
+  //In optical LUT calibration mode, record the first step of each photon in this detector.
+  //The local time of the pre-step point is the delay since the photon was emitted:
+  G4SBSOpticalLUT *LUT = G4SBSOpticalLUT::GetLUT();
+  if( LUT->GetMode() == G4SBSOpticalLUT::kCalibrate && fLUTphotons.insert( track->GetTrackID() ).second ){
+    LUT->RecordDetection( SensitiveDetectorName, track, newHit->GetPMTnumber(), prestep->GetLocalTime(),
+			  newHit->GetQuantumEfficiency(), newHit->GetGlobalCellCoord() );
+  }
 
-    if( QEvect != NULL ){
-      G4double Ephoton = newHit->GetEnergy();
-      
-      G4bool inrange = Ephoton >= QEvect->GetMinEnergy() && Ephoton <= QEvect->GetMaxEnergy();
-      
-      G4double QEtemp = QEvect->Value( Ephoton );
+  newHit->SetOTrIdx( SDtracks.InsertOriginalTrackInformation( track ) );
+  newHit->SetPTrIdx( SDtracks.InsertPrimaryTrackInformation( track ) );
+  newHit->SetSDTrIdx( SDtracks.InsertSDTrackInformation( track ) );
+  
+  hitCollection->insert( newHit );
 
-      if( !inrange ) QEtemp = 0.0;
+  return true;
+}
 
-      newHit->SetQuantumEfficiency(QEtemp);
-    }
+void G4SBSRICHSD::BuildOriginVolumeFlags(){
+  fOriginFlags.clear();
+
+  G4LogicalVolumeStore *lvstore = G4LogicalVolumeStore::GetInstance();
+  for( size_t ilv=0; ilv<lvstore->size(); ilv++ ){
+    fOriginFlags[ (*lvstore)[ilv] ] = OriginVolumeFlag( (*lvstore)[ilv]->GetName() );
   }
+}
 
-  //G4cout << "G4SDname = " << GetName() << ", Ephoton = " << newHit->GetEnergy()/CLHEP::eV << ", QE = " << newHit->GetQuantumEfficiency() << G4endl;
+G4int G4SBSRICHSD::OriginVolumeFlag( const G4Track *track ){
+  const G4LogicalVolume *lv = track->GetLogicalVolumeAtVertex();
+
+  std::map<const G4LogicalVolume*,G4int>::iterator it = fOriginFlags.find( lv );
+  if( it != fOriginFlags.end() ) return it->second;
+
+  //Volume created after the table was built:
+  G4int origin_flag = OriginVolumeFlag( lv->GetName() );
+  fOriginFlags[lv] = origin_flag;
+  return origin_flag;
+}
+
+G4int G4SBSRICHSD::OriginVolumeFlag( const G4String &namevol_origin ){
+  int origin_flag = 0; //default
+  if( namevol_origin.contains("Aerogel_tile_log") ){  //Aerogel
+    origin_flag = 1;
+  } else if (namevol_origin.contains("SBS_RICH_log") || namevol_origin.contains("GC_Tank_log") ){ //C4F10
+    origin_flag = 2;
+  } else if (namevol_origin.contains("Aero_exitwindow") ){ //UVT lucite
+    origin_flag = 3;
+  } else if (namevol_origin.contains("PMTwindow_log") || namevol_origin.contains("PMTcathode_log") || namevol_origin.contains("PMTQuartzWindow_log") || namevol_origin.contains("GC_PMT_Glass_log")  ){
+    origin_flag = 4;
+  }
+  return origin_flag;
+}
+
+void G4SBSRICHSD::InjectHit( G4Track *track, G4int PMT, G4double time, G4ThreeVector xgpmt ){
+  //The photon is never tracked to the PMT, so the hit is placed at the PMT center, with the direction at emission.
+  //The detection probability from the table already includes the quantum efficiency:
+  G4SBSRICHHit *newHit = new G4SBSRICHHit();
+
+  newHit->SetTrackID( track->GetTrackID() );
+  newHit->SetTrackPID( track->GetParticleDefinition()->GetPDGEncoding() );
+  newHit->SetMotherID( track->GetParentID() );
+
+  newHit->SetVertex( track->GetVertexPosition() );
+  newHit->SetVertexDirection( track->GetVertexMomentumDirection() );
+  newHit->SetOriginVol( OriginVolumeFlag( track ) );
+
+  newHit->Setdx( 0.0 );
+  newHit->SetTime( time );
+  newHit->SetEdep( track->GetTotalEnergy() );
+  newHit->SetEnergy( track->GetTotalEnergy() );
+
+  newHit->SetPos( xgpmt );
+  newHit->SetLPos( G4ThreeVector(0,0,0) );
+  newHit->SetDirection( track->GetMomentumDirection() );
+  newHit->SetLDirection( track->GetMomentumDirection() );
+
+  newHit->SetPMTnumber( PMT );
+  newHit->Setrownumber( detmap.Row[PMT] );
+  newHit->Setcolnumber( detmap.Col[PMT] );
+  newHit->SetCellCoord( detmap.LocalCoord[PMT] );
+  newHit->SetGlobalCellCoord( xgpmt );
+
+  newHit->SetQuantumEfficiency( 1.0 );
 
   newHit->SetOTrIdx( SDtracks.InsertOriginalTrackInformation( track ) );
   newHit->SetPTrIdx( SDtracks.InsertPrimaryTrackInformation( track ) );
   newHit->SetSDTrIdx( SDtracks.InsertSDTrackInformation( track ) );
-  
-  hitCollection->insert( newHit );
 
-  return true;
+  hitCollection->insert( newHit );
 }
 
 void G4SBSRICHSD::EndOfEvent( G4HCofThisEvent* ){
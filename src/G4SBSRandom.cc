@@ -0,0 +1,113 @@
+#include "G4SBSRandom.hh"
+#include "G4SBSPhiloxEngine.hh"
+#include "G4SBSRun.hh"
+#include "G4SBSRunData.hh"
+
+#include "CLHEP/Random/Random.h"
+#include "G4ios.hh"
+
+G4SBSRandom *G4SBSRandom::gSingleton = NULL;
+
+//Stream event number used for random numbers drawn at the beginning of the run:
+static const uint32_t kRunLevelStream = 0xFFFFFFFF;
+//Stream event number of the event generator initialization, before the run starts:
+static const uint32_t kInitStream = 0xFFFFFFFE;
+
+G4SBSRandom::G4SBSRandom(){
+  gSingleton = this;
+
+  fEnabled = false;
+  fSeed = 0;
+  fSeedSet = false;
+  fEventOffset = 0;
+  fShardOffset = 0;
+  fRunID = -1;
+  fEventID = 0;
+
+  fEngines[kGenerator] = new G4SBSPhiloxEngine();
+  fEngines[kTransport] = fEngines[kGenerator];
+  fEngines[kDigitization] = new G4SBSPhiloxEngine();
+  fEngines[kPileup] = new G4SBSPhiloxEngine();
+
+  fDefaultEngine = NULL;
+  fInstalled = false;
+}
+
+G4SBSRandom::~G4SBSRandom(){
+  if( fInstalled ) CLHEP::HepRandom::setTheEngine( fDefaultEngine );
+  delete fEngines[kGenerator];
+  delete fEngines[kDigitization];
+  delete fEngines[kPileup];
+}
+
+G4SBSRandom *G4SBSRandom::GetRandom(){
+  if( gSingleton == NULL ){
+    gSingleton = new G4SBSRandom();
+  }
+  return gSingleton;
+}
+
+void G4SBSRandom::Install(){
+  if( !fEnabled ){
+    if( fInstalled ){
+      CLHEP::HepRandom::setTheEngine( fDefaultEngine );
+      fInstalled = false;
+    }
+    return;
+  }
+
+  if( !fInstalled ){
+    fDefaultEngine = CLHEP::HepRandom::getTheEngine();
+    CLHEP::HepRandom::setTheEngine( fEngines[kGenerator] );
+    fInstalled = true;
+  }
+
+  //The seed is recorded in run_data, so that the run can be reproduced:
+  if( !fSeedSet ) fSeed = G4SBSRun::GetRun()->GetData()->GetSeed();
+  G4SBSRun::GetRun()->GetData()->SetSeed( fSeed );
+}
+
+void G4SBSRandom::BeginInitialization(){
+  Install();
+  if( !fEnabled ) return;
+
+  //The coming run is the one after the last run of this job (run IDs count up from 0):
+  fEngines[kGenerator]->SetStream( fSeed, fRunID + 1, kInitStream, kGenerator );
+}
+
+void G4SBSRandom::BeginOfRun( G4int runID ){
+  fRunID = runID;
+
+  Install();
+  if( !fEnabled ) return;
+
+  for( G4int c=kGenerator; c<kNConsumers; c++ ){
+    if( c == kTransport ) continue; //same engine as kGenerator
+    fEngines[c]->SetStream( fSeed, fRunID, kRunLevelStream, c );
+  }
+
+  G4cout << "Per-event random streams enabled: seed = " << fSeed << ", run = " << fRunID
+	 << ", event offset = " << fEventOffset + fShardOffset << G4endl;
+}
+
+void G4SBSRandom::BeginOfEvent( G4int eventID ){
+  if( !fEnabled ) return;
+
+  fEventID = eventID + fEventOffset + fShardOffset;
+
+  for( G4int c=kGenerator; c<kNConsumers; c++ ){
+    if( c == kTransport ) continue; //same engine as kGenerator, positioned in BeginTransport
+    fEngines[c]->SetStream( fSeed, fRunID, fEventID, c );
+  }
+}
+
+void G4SBSRandom::BeginTransport(){
+  if( !fEnabled ) return;
+
+  fEngines[kTransport]->SetStream( fSeed, fRunID, fEventID, kTransport );
+}
+
+CLHEP::HepRandomEngine *G4SBSRandom::GetEngine( Consumer_t consumer ){
+  if( !fEnabled ) return CLHEP::HepRandom::getTheEngine();
+  return fEngines[consumer];
+}
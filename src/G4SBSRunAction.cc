@@ -9,6 +9,16 @@
 #include "G4ios.hh"
 #include "G4SBSTrackingAction.hh"
 #include "G4SBSSteppingAction.hh"
+#include "G4SBSOpticalLUT.hh"
+#include "G4SBSPhaseSpace.hh"
+#include "G4SBSPileup.hh"
+#include "G4SBSTrigger.hh"
+#include "G4SBSGEMDigitizer.hh"
+#include "G4SBSPhotonThinning.hh"
+#include "G4SBSCulling.hh"
+#include "G4SBSImportance.hh"
+#include "G4SBSRandom.hh"
+#include "G4SBSProfiler.hh"
 
 G4SBSRunAction::G4SBSRunAction()
 {
@@ -24,12 +34,24 @@ void G4SBSRunAction::BeginOfRunAction(const G4Run* aRun)
 {
   G4cout << "### Run " << aRun->GetRunID() << " start." << G4endl;
   timer->Start();
+  G4SBSRandom::GetRandom()->BeginOfRun( aRun->GetRunID() );
   Ntries = 0; //Keep track of total number of tries to throw Nevt events:
+  Nfiltered = 0;
   fIO->InitializeTree();
   fIO->UpdateGenDataFromDetCon();
 
   fstepact->Initialize( fIO->GetDetCon() );
   ftrkact->Initialize( fIO->GetDetCon() );
+
+  G4SBSOpticalLUT::GetLUT()->BeginOfRun();
+  G4SBSPhotonThinning::GetThinning()->BeginOfRun();
+  G4SBSPhaseSpace::GetPhaseSpace()->BeginOfRun();
+  G4SBSPileup::GetPileup()->BeginOfRun( fIO->GetDetCon(), fIO->GetGenData().Ibeam );
+  G4SBSCulling::GetCulling()->BeginOfRun();
+  G4SBSTrigger::GetTrigger()->BeginOfRun();
+  G4SBSGEMDigitizer::GetDigitizer()->BeginOfRun();
+  G4SBSImportance::GetImportance()->BeginOfRun();
+  G4SBSProfiler::GetProfiler()->BeginOfRun( G4SBSRun::GetRun()->GetData()->GetGenName() );
   
   G4SBSRunData *rmrundata = G4SBSRun::GetRun()->GetData();
 
@@ -65,17 +87,28 @@ void G4SBSRunAction::EndOfRunAction(const G4Run* aRun)
   G4cout << "number of event = " << aRun->GetNumberOfEvent() << G4endl;
   //       << " " << *timer << G4endl;
   G4cout << "number of tries = " << Ntries << G4endl;
+  if( Nfiltered > 0 ) G4cout << "number of events skipped by acceptance filter = " << Nfiltered << G4endl;
   G4cout << "Elapsed time = " << timer->GetRealElapsed() << G4endl;
   G4cout << *timer << G4endl;
 
   G4cout << "simulation rate = " << double(aRun->GetNumberOfEvent())/timer->GetRealElapsed() << " events/s" << G4endl;
   
   G4SBSRun::GetRun()->GetData()->SetNtries( Ntries );
+  G4SBSRun::GetRun()->GetData()->SetNfiltered( Nfiltered );
 
   G4SBSRunData *rmrundata = G4SBSRun::GetRun()->GetData();
   
   rmrundata->CalcNormalization();
   rmrundata->Print();
+
+  G4SBSOpticalLUT::GetLUT()->EndOfRun();
+  G4SBSPhotonThinning::GetThinning()->EndOfRun();
+  G4SBSPhaseSpace::GetPhaseSpace()->EndOfRun( aRun->GetNumberOfEvent() );
+  G4SBSCulling::GetCulling()->EndOfRun();
+  G4SBSTrigger::GetTrigger()->EndOfRun();
+  G4SBSGEMDigitizer::GetDigitizer()->EndOfRun();
+  G4SBSImportance::GetImportance()->EndOfRun( timer->GetUserElapsed() + timer->GetSystemElapsed() );
+  G4SBSProfiler::GetProfiler()->EndOfRun( timer->GetRealElapsed() );
   
   fIO->WriteTree();
 }
@@ -0,0 +1,257 @@
+#include "G4SBSRunCache.hh"
+
+#include "G4RunManager.hh"
+#include "G4VUserPhysicsList.hh"
+#include "G4UImanager.hh"
+#include "G4Version.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4ios.hh"
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <climits>
+
+G4SBSRunCache *G4SBSRunCache::gSingleton = NULL;
+
+G4SBSRunCache::G4SBSRunCache(){
+  gSingleton = this;
+
+  fDirectory = "";
+  fConfig.clear();
+  fSegment = 0;
+  fHistoryPos = 0;
+  fKey = "";
+  fConfigDir = "";
+  fPhysicsRetrieved = false;
+  fPhysicsStored = false;
+
+  //The cache key is built from the command history, which by default only keeps the last 20 commands:
+  G4UImanager::GetUIpointer()->SetMaxHistSize( INT_MAX );
+
+  //Geant4 commands that cannot change the physics tables or the event generator:
+  const char *neutral[] = { "/control/", "/vis/", "/gui/", "/random/", "/run/beamOn", "/run/verbose",
+			    "/run/printProgress", "/event/verbose", "/tracking/verbose", "/run/particle/storePhysicsTable",
+			    "/run/particle/retrievePhysicsTable", "/run/particle/verbose" };
+  for( size_t i=0; i<sizeof(neutral)/sizeof(neutral[0]); i++ ) AddNeutralCommand( neutral[i] );
+}
+
+G4SBSRunCache::~G4SBSRunCache(){
+  ;
+}
+
+G4SBSRunCache *G4SBSRunCache::GetCache(){
+  if( gSingleton == NULL ){
+    gSingleton = new G4SBSRunCache();
+  }
+  return gSingleton;
+}
+
+//64-bit FNV-1a hash, as 16 hex digits:
+G4String G4SBSRunCache::Hash( const G4String &text ){
+  unsigned long long h = 14695981039346656037ULL;
+  for( size_t i=0; i<text.size(); i++ ){
+    h ^= (unsigned char) text[i];
+    h *= 1099511628211ULL;
+  }
+
+  char hex[17];
+  snprintf( hex, sizeof(hex), "%016llx", h );
+  return G4String( hex );
+}
+
+void G4SBSRunCache::AddNeutralCommand( G4String path ){
+  if( !path.empty() && path[path.size()-1] == '/' ){
+    fNeutralDirs.push_back( path );
+  } else {
+    fNeutralCommands.insert( path );
+  }
+}
+
+G4bool G4SBSRunCache::IsNeutral( const G4String &command ) const {
+  if( fNeutralCommands.find( command ) != fNeutralCommands.end() ) return true;
+  for( size_t i=0; i<fNeutralDirs.size(); i++ ){
+    if( command.compare( 0, fNeutralDirs[i].size(), fNeutralDirs[i] ) == 0 ) return true;
+  }
+  return false;
+}
+
+void G4SBSRunCache::UpdateConfig(){
+  G4UImanager *UImanager = G4UImanager::GetUIpointer();
+
+  for( ; fHistoryPos < UImanager->GetNumberOfHistory(); fHistoryPos++ ){
+    G4String line = UImanager->GetPreviousCommand( fHistoryPos );
+
+    size_t start = line.find_first_not_of( " \t" );
+    if( start == std::string::npos ) continue;
+    size_t end = line.find_first_of( " \t", start );
+    G4String command = line.substr( start, end == std::string::npos ? std::string::npos : end - start );
+    G4String value = "";
+    if( end != std::string::npos ){
+      size_t vstart = line.find_first_not_of( " \t", end );
+      size_t vend = line.find_last_not_of( " \t" );
+      if( vstart != std::string::npos ) value = line.substr( vstart, vend - vstart + 1 );
+    }
+
+    if( IsNeutral( command ) ) continue;
+
+    //Move the command to the end; values of an earlier run segment are replaced:
+    ConfigEntry_t entry;
+    entry.command = command;
+    entry.segment = fSegment;
+    for( size_t i=0; i<fConfig.size(); i++ ){
+      if( fConfig[i].command == command ){
+	if( fConfig[i].segment == fSegment ) entry.values = fConfig[i].values;
+	fConfig.erase( fConfig.begin() + i );
+	break;
+      }
+    }
+    entry.values.push_back( value );
+    fConfig.push_back( entry );
+  }
+}
+
+G4String G4SBSRunCache::GetTmpName( G4String path ) const {
+  char suffix[64];
+  snprintf( suffix, sizeof(suffix), ".tmp.%ld", long(getpid()) );
+  return path + suffix;
+}
+
+G4bool G4SBSRunCache::Commit( G4String tmppath, G4String path ) const {
+  std::error_code ec;
+  if( !std::filesystem::exists( path.data(), ec ) ){
+    std::filesystem::rename( tmppath.data(), path.data(), ec );
+    if( !ec ) return true;
+  }
+
+  //Another job was faster:
+  std::filesystem::remove_all( tmppath.data(), ec );
+  return false;
+}
+
+void G4SBSRunCache::BeginRun(){
+  //Commands issued before this run belong to its segment, also while the cache is off:
+  UpdateConfig();
+  fSegment++;
+
+  if( !IsEnabled() ) return;
+
+  //Configuration record:
+  std::ostringstream config;
+  config << "g4sbs run cache 2\n";
+  config << G4Version << "\n";
+
+  const G4VUserPhysicsList *physics = G4RunManager::GetRunManager()->GetUserPhysicsList();
+  if( physics != NULL ) config << "defaultcut " << physics->GetDefaultCutValue()/mm << " mm\n";
+
+  for( size_t icmd=0; icmd<fConfig.size(); icmd++ ){
+    for( size_t ival=0; ival<fConfig[icmd].values.size(); ival++ ){
+      config << fConfig[icmd].command << " " << fConfig[icmd].values[ival] << "\n";
+    }
+  }
+
+  G4String key = Hash( config.str() );
+
+  if( key != fKey ){ //new configuration (the first run, or commands changed since the last run)
+    fKey = key;
+    fConfigDir = fDirectory + "/" + fKey;
+    fPhysicsRetrieved = false;
+    fPhysicsStored = false;
+  }
+
+  std::error_code ec;
+  std::filesystem::create_directories( fConfigDir.data(), ec );
+  if( ec ){
+    fprintf(stderr, "%s: %s line %d - Error: could not create cache directory %s: %s\n", __PRETTY_FUNCTION__, __FILE__, __LINE__, fConfigDir.data(), ec.message().c_str());
+    exit(-1);
+  }
+
+  G4String configfile = fConfigDir + "/config.txt";
+  if( !std::filesystem::exists( configfile.data(), ec ) ){
+    G4String tmpfile = GetTmpName( configfile );
+    std::ofstream out( tmpfile.data() );
+    out << config.str();
+    out.close();
+    Commit( tmpfile, configfile );
+  }
+
+  G4cout << "Run cache: configuration " << fKey << " in " << fDirectory << G4endl;
+
+  //Physics tables: once retrieved or built, they stay in memory for the following runs:
+  G4String physicsdir = fConfigDir + "/physics";
+  if( !fPhysicsRetrieved && !fPhysicsStored && std::filesystem::exists( physicsdir.data(), ec ) ){
+    G4cout << "Run cache: retrieving physics tables from " << physicsdir << G4endl;
+    G4UImanager::GetUIpointer()->ApplyCommand( "/run/particle/retrievePhysicsTable " + physicsdir );
+    fPhysicsRetrieved = true;
+  }
+}
+
+void G4SBSRunCache::EndRun(){
+  if( !IsEnabled() || fPhysicsRetrieved || fPhysicsStored ) return;
+
+  G4String physicsdir = fConfigDir + "/physics";
+  G4String tmpdir = GetTmpName( physicsdir );
+
+  std::error_code ec;
+  std::filesystem::create_directories( tmpdir.data(), ec );
+  if( ec ){
+    G4cout << "Run cache: WARNING could not create " << tmpdir << ", physics tables not stored" << G4endl;
+    return;
+  }
+
+  G4UImanager::GetUIpointer()->ApplyCommand( "/run/particle/storePhysicsTable " + tmpdir );
+  if( Commit( tmpdir, physicsdir ) ){
+    G4cout << "Run cache: stored physics tables in " << physicsdir << G4endl;
+  }
+
+  fPhysicsStored = true;
+}
+
+G4bool G4SBSRunCache::GetMaxWeight( G4double &w ) const {
+  if( !IsEnabled() || fConfigDir.empty() ) return false;
+
+  G4String filename = fConfigDir + "/maxweight.txt";
+  std::ifstream in( filename.data() );
+  G4double wtemp;
+  if( !(in >> wtemp) || wtemp <= 0.0 ) return false;
+
+  w = wtemp;
+  G4cout << "Run cache: max. event weight read from " << filename << G4endl;
+  return true;
+}
+
+void G4SBSRunCache::StoreMaxWeight( G4double w ){
+  if( !IsEnabled() || fConfigDir.empty() || w <= 0.0 ) return;
+
+  G4String filename = fConfigDir + "/maxweight.txt";
+  G4String tmpfile = GetTmpName( filename );
+
+  FILE *f = fopen( tmpfile.data(), "w" );
+  if( f == NULL ) return;
+  fprintf( f, "%.17g\n", w );
+  fclose( f );
+
+  Commit( tmpfile, filename );
+}
+
+G4String G4SBSRunCache::GetFieldMapFile( G4String mapfile ){
+  if( !IsEnabled() ) return G4String("");
+
+  struct stat filedata;
+  if( stat( mapfile.data(), &filedata ) != 0 ) return G4String("");
+
+  std::error_code ec;
+  std::filesystem::path abspath = std::filesystem::absolute( mapfile.data(), ec );
+
+  std::ostringstream id;
+  id << abspath.string() << " " << (long long) filedata.st_size << " " << (long long) filedata.st_mtime;
+
+  G4String dir = fDirectory + "/fieldmaps";
+  std::filesystem::create_directories( dir.data(), ec );
+  if( ec ) return G4String("");
+
+  return dir + "/" + Hash( id.str() ) + ".bin";
+}
@@ -7,6 +7,7 @@
 #include <sstream>
 #include <errno.h>
 #include <sys/stat.h>
+#include <algorithm>
 
 #include "TObjArray.h"
 #include "TObjString.h"
@@ -18,6 +19,14 @@
 G4SBSRunData::G4SBSRunData(){
     fNthrown = -1;
     fNtries = -1;
+    fNfiltered = 0;
+    fShardIndex = 0;
+    fNshards = 1;
+    fNevtTotal = -1;
+    fNmerged = 1;
+    fCompactVersion = 0;
+    fCompactPosStep = 0.0;
+    fCompactTimeStep = 0.0;
     fBeamE   = -1e9;
     fBeamCur   = -1e9;
     fExpType[0]  = '\0';
@@ -33,6 +42,14 @@ G4SBSRunData::~G4SBSRunData(){
 void G4SBSRunData::Init(){
     fNthrown = 0;
     fNtries = 0;
+    fNfiltered = 0;
+    fShardIndex = 0;
+    fNshards = 1;
+    fNevtTotal = 0;
+    fNmerged = 1;
+    fCompactVersion = 0;
+    fCompactPosStep = 0.0;
+    fCompactTimeStep = 0.0;
     fBeamE   = 0;
     fBeamCur   = 0;
     fNormalization = 1.0;
@@ -73,6 +90,12 @@ void G4SBSRunData::Print() const {
    line.push_back(msg);
    sprintf(msg,"N_tries,%ld",fNtries);
    line.push_back(msg);
+   sprintf(msg,"N_filtered,%ld",fNfiltered);
+   line.push_back(msg);
+   sprintf(msg,"Shard,%d,%d",fShardIndex,fNshards);
+   line.push_back(msg);
+   sprintf(msg,"Compact_Output,%d,%g,%g",fCompactVersion,fCompactPosStep,fCompactTimeStep);
+   line.push_back(msg);
    sprintf(msg,"Beam_Energy_GeV,%f",fBeamE);
    line.push_back(msg);
    sprintf(msg,"Beam_Current_muA,%f",fBeamCur);
@@ -131,6 +154,17 @@ void G4SBSRunData::Print(Option_t *) const {
     printf("Run Path %s\n", fRunPath);
     printf("N generated = %ld\n", fNthrown);
     printf("N tries     = %ld\n", fNtries);
+    printf("N filtered  = %ld (not tracked because of the acceptance filter, included in N generated and N tries)\n", fNfiltered);
+    if( fNshards > 1 ){
+      if( fShardIndex >= 0 ){
+	printf("Shard %d of %d of a run of %ld events\n", fShardIndex, fNshards, fNevtTotal);
+      } else {
+	printf("Merged %d of %d shards of a run of %ld events\n", fNmerged, fNshards, fNevtTotal);
+      }
+    }
+    if( fCompactVersion > 0 ){
+      printf("Compact output, schema %d: float32 hit data, positions rounded to %g m, times to %g ns\n", fCompactVersion, fCompactPosStep, fCompactTimeStep);
+    }
     printf("Beam Energy = %f GeV\n", fBeamE);
     printf("Beam Current = %f muA\n", fBeamCur);
     printf("Experiment  = %s\n", fExpType);
@@ -257,6 +291,50 @@ void G4SBSRunData::CalcNormalization(){
   SetNormalization( fMaxWeight * fGenVol * fLuminosity / double(fNtries) );
 }
 
+Long64_t G4SBSRunData::Merge( TCollection *list ){
+  if( list == NULL ) return fNmerged;
+
+  TIter next(list);
+  TObject *obj;
+
+  //Check all inputs first, so that nothing is summed if the merge is refused:
+  while( (obj = next()) ){
+    G4SBSRunData *rd = dynamic_cast<G4SBSRunData*>(obj);
+    if( rd == NULL ) continue;
+
+    //The normalization is only meaningful if all jobs ran with the same generator settings; in particular,
+    //events of rejection sampling were accepted with probability weight/MaxWeight of their own job:
+    if( strcmp( fGenName, rd->fGenName ) != 0 || fGenVol != rd->fGenVol ||
+	fLuminosity != rd->fLuminosity || fMaxWeight != rd->fMaxWeight ){
+      fprintf(stderr, "%s: %s line %d - Error: cannot merge run data with different generator settings (%s, GenVol = %g, Lumi = %g, MaxWeight = %.17g) vs. (%s, GenVol = %g, Lumi = %g, MaxWeight = %.17g)\n",
+	      __PRETTY_FUNCTION__, __FILE__, __LINE__,
+	      fGenName, fGenVol, fLuminosity, fMaxWeight, rd->fGenName, rd->fGenVol, rd->fLuminosity, rd->fMaxWeight);
+      return -1;
+    }
+  }
+
+  next.Reset();
+  while( (obj = next()) ){
+    G4SBSRunData *rd = dynamic_cast<G4SBSRunData*>(obj);
+    if( rd == NULL ) continue;
+
+    if( fNshards != rd->fNshards || fNevtTotal != rd->fNevtTotal ){
+      fprintf(stderr, "%s: %s line %d - Warning: merging shards of different runs (%d shards of %ld events vs. %d shards of %ld events)\n",
+	      __PRETTY_FUNCTION__, __FILE__, __LINE__, fNshards, fNevtTotal, rd->fNshards, rd->fNevtTotal);
+    }
+
+    fNthrown += rd->fNthrown;
+    fNtries += rd->fNtries;
+    fNfiltered += rd->fNfiltered;
+    fNmerged += rd->fNmerged;
+  }
+
+  fShardIndex = -1;
+  CalcNormalization();
+
+  return fNmerged;
+}
+
 ClassImp(G4SBSRunData)
 
 
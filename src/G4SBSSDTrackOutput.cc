@@ -1,12 +1,91 @@
 #include "G4SBSSDTrackOutput.hh"
 
+#include <algorithm>
+
+G4SBSTrackIndexTable::G4SBSTrackIndexTable(){
+  fKeys.assign( 64, 0 );
+  fIndex.assign( 64, -1 );
+  fMask = 63;
+}
+
+void G4SBSTrackIndexTable::Clear(){
+  for( size_t i=0; i<fUsed.size(); i++ ) fIndex[fUsed[i]] = -1;
+  fUsed.clear();
+}
+
+size_t G4SBSTrackIndexTable::Slot( G4long key ) const {
+  //Track IDs are mostly consecutive; the multiplication (Fibonacci hashing) spreads them over the table:
+  unsigned long long h = (unsigned long long) key * 0x9E3779B97F4A7C15ULL;
+  return size_t( h ^ (h >> 32) ) & fMask;
+}
+
+G4int G4SBSTrackIndexTable::Find( G4long key ) const {
+  for( size_t slot = Slot( key ); fIndex[slot] >= 0; slot = (slot+1) & fMask ){
+    if( fKeys[slot] == key ) return fIndex[slot];
+  }
+  return -1;
+}
+
+G4bool G4SBSTrackIndexTable::Insert( G4long key, G4int index ){
+  size_t slot = Slot( key );
+  for( ; fIndex[slot] >= 0; slot = (slot+1) & fMask ){
+    if( fKeys[slot] == key ) return false;
+  }
+
+  fKeys[slot] = key;
+  fIndex[slot] = index;
+  fUsed.push_back( slot );
+
+  //Keep the table at most half full:
+  if( 2*fUsed.size() > fIndex.size() ) Grow();
+
+  return true;
+}
+
+void G4SBSTrackIndexTable::Grow(){
+  vector<G4long> oldkeys( fKeys );
+  vector<G4int> oldindex( fIndex );
+  vector<G4int> oldused( fUsed );
+
+  fKeys.assign( 2*oldkeys.size(), 0 );
+  fIndex.assign( 2*oldindex.size(), -1 );
+  fMask = fIndex.size() - 1;
+  fUsed.clear();
+
+  for( size_t i=0; i<oldused.size(); i++ ){
+    size_t slot = Slot( oldkeys[oldused[i]] );
+    while( fIndex[slot] >= 0 ) slot = (slot+1) & fMask;
+    fKeys[slot] = oldkeys[oldused[i]];
+    fIndex[slot] = oldindex[oldused[i]];
+    fUsed.push_back( slot );
+  }
+}
+
+//Interned SD names (function-local, so they can be used during static initialization):
+static vector<G4String> &SDnames(){
+  static vector<G4String> names;
+  return names;
+}
+
+G4int G4SBSSDTrackOutput::InternSDname( const G4String &name ){
+  static map<G4String,G4int> ids;
+  std::pair<map<G4String,G4int>::iterator,bool> newname = ids.insert( std::make_pair( name, G4int(SDnames().size()) ) );
+  if( newname.second ) SDnames().push_back( name );
+  return newname.first->second;
+}
+
+const G4String &G4SBSSDTrackOutput::GetSDname( G4int sdid ){
+  return SDnames()[sdid];
+}
 
 G4SBSSDTrackOutput::G4SBSSDTrackOutput(){
+  sdnameid = InternSDname( sdname );
   Clear();
 }
 
 G4SBSSDTrackOutput::G4SBSSDTrackOutput(G4String name){
   sdname = name;
+  sdnameid = InternSDname( sdname );
   Clear();
 }
 
@@ -78,6 +157,7 @@ void G4SBSSDTrackOutput::Clear(){
   
   sdenergy.clear();
   sdtime.clear();
+  sdweight.clear();
 
   //New vertex info:
   sdvx.clear();
@@ -87,11 +167,12 @@ void G4SBSSDTrackOutput::Clear(){
   sdvny.clear();
   sdvnz.clear();
   sdEkin.clear();
+  sdsdid.clear();
   
-  //maps:
-  otracklist.clear();
-  ptracklist.clear();
-  sdtracklist.clear();
+  //track lists:
+  otracklist.Clear();
+  ptracklist.Clear();
+  sdtracklist.Clear();
 
   // otrack_hits.clear();
   // ptrack_hits.clear();
@@ -100,6 +181,7 @@ void G4SBSSDTrackOutput::Clear(){
 
 void G4SBSSDTrackOutput::SetSDname(G4String name){
   sdname = name;
+  sdnameid = InternSDname( sdname );
 }
 
 void G4SBSSDTrackOutput::ConvertToTreeUnits(){
@@ -156,9 +238,7 @@ G4int G4SBSSDTrackOutput::InsertOriginalTrackInformation( G4Track *aTrack ){
 
   int tidtemp = aTrackInfo->GetOriginalTrackID();
   
-  std::pair< map<int,int>::iterator, bool > newtrack = otracklist.insert( std::pair<int,int>(tidtemp,notracks) );
-
-  if( newtrack.second ){ //new track found: add its info to the arrays:
+  if( otracklist.Insert( tidtemp, notracks ) ){ //new track found: add its info to the arrays:
     otrid.push_back( tidtemp );
     omid.push_back( aTrackInfo->GetOriginalParentID() );
     opid.push_back( aTrackInfo->GetOriginalDefinition()->GetPDGEncoding() );
@@ -195,9 +275,7 @@ G4int G4SBSSDTrackOutput::InsertPrimaryTrackInformation( G4Track *aTrack ){
 
   int tidtemp = aTrackInfo->GetPrimaryTrackID();
 
-  std::pair< map<int,int>::iterator, bool > newtrack = ptracklist.insert( std::pair<int,int>(tidtemp,nptracks) );
-
-  if( newtrack.second ){ //new track found: add its info to the arrays:
+  if( ptracklist.Insert( tidtemp, nptracks ) ){ //new track found: add its info to the arrays:
     ptrid.push_back( tidtemp );
     //pmid.push_back( aTrackInfo->GetPrimaryParentID() );
     ppid.push_back( aTrackInfo->GetPrimaryDefinition()->GetPDGEncoding() );
@@ -233,27 +311,19 @@ G4int G4SBSSDTrackOutput::InsertPrimaryTrackInformation( G4Track *aTrack ){
 G4int G4SBSSDTrackOutput::InsertSDTrackInformation( G4Track *aTrack ){
   G4SBSTrackInformation *aTrackInfo = (G4SBSTrackInformation*) aTrack->GetUserInformation();
 
-  if( (aTrackInfo->fSDlist).find( sdname ) != (aTrackInfo->fSDlist).end() ){
-
-    //G4cout << "found track information for SD " << sdname << G4endl;
-    
-    int tidtemp = (aTrackInfo->fSDTrackID)[sdname];
-    
-    //std::pair< std::map<int,int>::iterator, bool > newtrack = sdtracklist.insert( std::pair<int,int>(tidtemp,nsdtracks) );
+  //fSDTrackID has an entry for each SD in the track's fSDlist:
+  map<G4String,G4int>::iterator sdtrack = (aTrackInfo->fSDTrackID).find( sdname );
 
-    //std::map<int,map<G4String,int> >::iterator newtrack = sdtracklist.find( tidtemp );
+  if( sdtrack != (aTrackInfo->fSDTrackID).end() ){
 
-    //bool newsdboundarycrossing = false;
-    if( sdtracklist.find(tidtemp) != sdtracklist.end() ){ //existing G4 track ID: check whether SDname exists:
-      if( sdtracklist[tidtemp].find( sdname ) != sdtracklist[tidtemp].end() ){ //existing track ID AND SDname: return mapped index value:
-	//return sdtracklist[tidtemp][sdname];
-	return tidtemp; //this is the G4 track ID. EndOfEventAction now expects this! 
-      } 
-    } 
+    int tidtemp = sdtrack->second;
 
     //if NOT pre-existing track ID/SD combination, assign the sd track list information
-    //mapped by SD track ID and SD name to the index in the array of sd tracks associated with this detector:
-    sdtracklist[tidtemp][sdname] = nsdtracks;
+    //mapped by SD track ID and SD name to the index in the array of sd tracks associated with this detector;
+    //otherwise, nothing to do:
+    if( !sdtracklist.Insert( SDTrackKey( tidtemp, sdnameid ), nsdtracks ) ){
+      return tidtemp; //this is the G4 track ID. EndOfEventAction now expects this! 
+    }
     
     sdtrid.push_back( tidtemp );
     sdmid.push_back( (aTrackInfo->fSDParentID)[sdname] );
@@ -279,6 +349,7 @@ G4int G4SBSSDTrackOutput::InsertSDTrackInformation( G4Track *aTrack ){
     
     sdenergy.push_back( (aTrackInfo->fSDEnergy)[sdname] );
     sdtime.push_back( (aTrackInfo->fSDTime)[sdname] );
+    sdweight.push_back( aTrackInfo->fSDWeight.count( sdname ) ? (aTrackInfo->fSDWeight)[sdname] : 1.0 );
 
     postemp = (aTrackInfo->fSDVertexPosition)[sdname];
     momtemp = (aTrackInfo->fSDVertexDirection)[sdname];
@@ -292,6 +363,7 @@ G4int G4SBSSDTrackOutput::InsertSDTrackInformation( G4Track *aTrack ){
     sdvnz.push_back( momtemp.z() );
 
     sdEkin.push_back( (aTrackInfo->fSDVertexKineticEnergy)[sdname] );
+    sdsdid.push_back( sdnameid );
     
     nsdtracks++;
 
@@ -301,19 +373,26 @@ G4int G4SBSSDTrackOutput::InsertSDTrackInformation( G4Track *aTrack ){
   } else { //May alter this behavior later...
     // G4cout << "no SD track info available for track " << aTrack->GetTrackID() << ", SD name = " << sdname
     // 	   << G4endl;
-    sdtracklist[-1][sdname] = -1;
-    return -1;
+    return -1; //SDTrackIndex() of track ID -1 is -1
   }
 }
 
+//Order of the SD tracks of an output by G4 track ID, then SD name:
+struct SDTrackOrder {
+  const G4SBSSDTrackOutput &sd;
+  SDTrackOrder( const G4SBSSDTrackOutput &s ) : sd(s) {}
+  bool operator()( int i, int j ) const {
+    if( sd.sdtrid[i] != sd.sdtrid[j] ) return sd.sdtrid[i] < sd.sdtrid[j];
+    return G4SBSSDTrackOutput::GetSDname( sd.sdsdid[i] ) < G4SBSSDTrackOutput::GetSDname( sd.sdsdid[j] );
+  }
+};
+
 //return a vector<int> containing a list of the new indices relative to the old ones:
 void G4SBSSDTrackOutput::Merge( G4SBSSDTrackOutput &sd ){
 
   //Start with OTracks:
   for( int i=0; i<sd.notracks; i++ ){
-    std::pair<std::map<int,int>::iterator,bool> newtrack = otracklist.insert( std::pair<int,int>(sd.otrid[i], notracks) );
-
-    if( newtrack.second ){ //new track: add to end of existing array:
+    if( otracklist.Insert( sd.otrid[i], notracks ) ){ //new track: add to end of existing array:
       otrid.push_back( sd.otrid[i] );
       omid.push_back( sd.omid[i] );
       opid.push_back( sd.opid[i] );
@@ -340,9 +419,7 @@ void G4SBSSDTrackOutput::Merge( G4SBSSDTrackOutput &sd ){
 
   //Then do PTracks:
   for( int i=0; i<sd.nptracks; i++ ){
-    std::pair<std::map<int,int>::iterator,bool> newtrack = ptracklist.insert( std::pair<int,int>(sd.ptrid[i], nptracks) );
-
-    if( newtrack.second ){ //new track: add to end of existing array:
+    if( ptracklist.Insert( sd.ptrid[i], nptracks ) ){ //new track: add to end of existing array:
       ptrid.push_back( sd.ptrid[i] );
       //pmid.push_back( sd.pmid[i] );
       ppid.push_back( sd.ppid[i] );
@@ -366,67 +443,50 @@ void G4SBSSDTrackOutput::Merge( G4SBSSDTrackOutput &sd ){
     }
   }
 
-  //loop on the sd track list to be merged into this one; compare with existing, add as needed:
-  for( map<int,map<G4String,int> >::iterator i=sd.sdtracklist.begin(); i!=sd.sdtracklist.end(); ++i ){
-    
-    int tidtemp = i->first;
-    
-    for( map<G4String,int>::iterator j=(i->second).begin(); j!= (i->second).end(); ++j ){
-      G4String sdnametemp = j->first;
+  //loop on the sd track list to be merged into this one, in order of G4 track ID and SD name;
+  //compare with existing, add as needed:
+  vector<int> order( sd.nsdtracks );
+  for( int i=0; i<sd.nsdtracks; i++ ) order[i] = i;
+  std::sort( order.begin(), order.end(), SDTrackOrder( sd ) );
 
-      int idx = j->second;
-      
-      bool addtrack = true;
-      if( sdtracklist.find(tidtemp) != sdtracklist.end() ){ //existing TID:
-	if( sdtracklist[tidtemp].find(sdnametemp) != sdtracklist[tidtemp].end() ){ //existing SDname:
-	  addtrack = false;
-	}
-      }
-
-      if( addtrack && tidtemp >= 0 && idx >= 0 ){
-
-	// G4cout << "added SD track to detector " << sdnametemp << ", TID = " 
-	//        << tidtemp << ", index in detector SD track list = " << idx
-	//        << ", index in new SD track list = " << nsdtracks << G4endl;
-	
-	sdtracklist[tidtemp][sdnametemp] = nsdtracks;
-	
-	sdtrid.push_back( sd.sdtrid[idx] );
-	sdmid.push_back( sd.sdmid[idx] );
-	sdpid.push_back( sd.sdpid[idx] );
-	sdmpid.push_back( sd.sdmpid[idx] );
-
-	sdposx.push_back( sd.sdposx[idx] );
-	sdposy.push_back( sd.sdposy[idx] );
-	sdposz.push_back( sd.sdposz[idx] );
-
-	sdmomx.push_back( sd.sdmomx[idx] );
-	sdmomy.push_back( sd.sdmomy[idx] );
-	sdmomz.push_back( sd.sdmomz[idx] );
-
-	sdpolx.push_back( sd.sdpolx[idx] );
-	sdpoly.push_back( sd.sdpoly[idx] );
-	sdpolz.push_back( sd.sdpolz[idx] );
-
-	sdenergy.push_back( sd.sdenergy[idx] );
-	sdtime.push_back( sd.sdtime[idx] );
-
-	//new vertex info:
-	sdvx.push_back( sd.sdvx[idx] );
-	sdvy.push_back( sd.sdvy[idx] );
-	sdvz.push_back( sd.sdvz[idx] );
-
-	sdvnx.push_back( sd.sdvnx[idx] );
-	sdvny.push_back( sd.sdvny[idx] );
-	sdvnz.push_back( sd.sdvnz[idx] );
-
-	sdEkin.push_back( sd.sdEkin[idx] );
-	
+  for( size_t i=0; i<order.size(); i++ ){
+    int idx = order[i];
+
+    if( sdtracklist.Insert( SDTrackKey( sd.sdtrid[idx], sd.sdsdid[idx] ), nsdtracks ) ){
+      sdtrid.push_back( sd.sdtrid[idx] );
+      sdmid.push_back( sd.sdmid[idx] );
+      sdpid.push_back( sd.sdpid[idx] );
+      sdmpid.push_back( sd.sdmpid[idx] );
+
+      sdposx.push_back( sd.sdposx[idx] );
+      sdposy.push_back( sd.sdposy[idx] );
+      sdposz.push_back( sd.sdposz[idx] );
+
+      sdmomx.push_back( sd.sdmomx[idx] );
+      sdmomy.push_back( sd.sdmomy[idx] );
+      sdmomz.push_back( sd.sdmomz[idx] );
+
+      sdpolx.push_back( sd.sdpolx[idx] );
+      sdpoly.push_back( sd.sdpoly[idx] );
+      sdpolz.push_back( sd.sdpolz[idx] );
+
+      sdenergy.push_back( sd.sdenergy[idx] );
+      sdtime.push_back( sd.sdtime[idx] );
+      sdweight.push_back( sd.sdweight[idx] );
+
+      //new vertex info:
+      sdvx.push_back( sd.sdvx[idx] );
+      sdvy.push_back( sd.sdvy[idx] );
+      sdvz.push_back( sd.sdvz[idx] );
+
+      sdvnx.push_back( sd.sdvnx[idx] );
+      sdvny.push_back( sd.sdvny[idx] );
+      sdvnz.push_back( sd.sdvnz[idx] );
+
+      sdEkin.push_back( sd.sdEkin[idx] );
+      sdsdid.push_back( sd.sdsdid[idx] );
       
-	nsdtracks++;
-	
-      }
-    }   
+      nsdtracks++;
+    }
   }
 }
-
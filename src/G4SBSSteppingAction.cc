@@ -15,6 +15,9 @@
 #include "G4Track.hh"
 #include "G4SBSTrackInformation.hh"
 #include "G4SBSDetectorConstruction.hh"
+#include "G4SBSPhaseSpace.hh"
+#include "G4SBSCulling.hh"
+#include "G4SBSImportance.hh"
 
 G4SBSSteppingAction::G4SBSSteppingAction()
 :drawFlag(false)
@@ -33,6 +36,14 @@ void G4SBSSteppingAction::UserSteppingAction(const G4Step *aStep)
   
   G4Track *theTrack = aStep->GetTrack();
   if( theTrack->GetTrackStatus() != fAlive ){ return; }
+
+  //Phase space recording for two-stage background simulation; the track may be killed at the surface:
+  G4SBSPhaseSpace *phasespace = G4SBSPhaseSpace::GetPhaseSpace();
+  if( phasespace->IsRecording() && phasespace->ProcessStep( aStep ) && theTrack->GetTrackStatus() != fAlive ){ return; }
+
+  //User-defined culling of tracks that cannot reach any SD:
+  G4SBSCulling *culling = G4SBSCulling::GetCulling();
+  if( culling->IsActive() && culling->ProcessStep( aStep ) ){ return; }
   
   G4String lvname_prestep = aStep->GetPreStepPoint()->GetPhysicalVolume()->GetLogicalVolume()->GetName();
   G4String lvname_poststep = aStep->GetPostStepPoint()->GetPhysicalVolume()->GetLogicalVolume()->GetName();
@@ -70,6 +81,11 @@ void G4SBSSteppingAction::UserSteppingAction(const G4Step *aStep)
 
     //    theTrack->SetUserInformation(theNewTrackInfo);
   }
+
+  //Importance biasing: splitting or Russian roulette at importance boundaries. This comes last so that
+  //split copies inherit the SD boundary information recorded above:
+  G4SBSImportance *importance = G4SBSImportance::GetImportance();
+  if( importance->IsActive() ) importance->ProcessStep( aStep, fpSteppingManager->GetfSecondary() );
 }
 
 
@@ -1,4 +1,5 @@
 #include "G4SBSTargetSD.hh"
+#include "G4SBSProfiler.hh"
 //______________________________________________________________________________
 G4SBSTargetSD::G4SBSTargetSD(
                             const G4String& name,
@@ -7,6 +8,7 @@ G4SBSTargetSD::G4SBSTargetSD(
    fHitsCollection(nullptr)
 {
   collectionName.insert(hitsCollectionName);
+  fProfileID = G4SBSProfiler::GetProfiler()->RegisterSD( name );
 }
 //______________________________________________________________________________
 G4SBSTargetSD::~G4SBSTargetSD()
@@ -27,6 +29,7 @@ void G4SBSTargetSD::Initialize(G4HCofThisEvent* hce)
 //______________________________________________________________________________
 G4bool G4SBSTargetSD::ProcessHits(G4Step* step,G4TouchableHistory*)
 {
+  G4SBSProfiler::Scope prof( fProfileID );
 
   // energy deposit
   auto edep = step->GetTotalEnergyDeposit();
@@ -1,10 +1,14 @@
 #include "G4SBSToscaField.hh"
+#include "G4SBSRunCache.hh"
 #include "G4ThreeVector.hh"
 #include "G4RotationMatrix.hh"
 
 #include "G4SystemOfUnits.hh"
 #include "G4PhysicalConstants.hh"
 
+#include <cstdio>
+#include <cstring>
+
 #define MAXBUFF 1024
 
 G4SBSToscaField::G4SBSToscaField( G4String filename) 
@@ -206,7 +210,13 @@ void G4SBSToscaField::ReadField(){
     }
   }
 
-  double x,y,z, ang_x, ang_y, ang_z; //define angles relative to x, y and z axis for more flexibility in orientation of field
+  G4String cachefile = G4SBSRunCache::GetCache()->GetFieldMapFile( fFilename );
+  if( !cachefile.empty() && ReadFieldCache( cachefile ) ){
+    fclose(f);
+    return;
+  }
+
+  double x,y,z, ang[3]; //define angles relative to x, y and z axis for more flexibility in orientation of field
 
   // First line is the position offset
   fscanf(f, "%lf%lf%lf", &x, &y, &z);
@@ -215,14 +225,8 @@ void G4SBSToscaField::ReadField(){
   // Second line is the rotation:
   // rotate around x, then y', then z'
     
-  fscanf(f, "%lf%lf%lf", &ang_x, &ang_y, &ang_z );
-  frm = G4RotationMatrix();
-  frm.rotateX(ang_x*deg);
-  frm.rotateY(ang_y*deg);
-  frm.rotateZ(ang_z*deg);
-
-
-  frm.print(G4cout);
+  fscanf(f, "%lf%lf%lf", &ang[0], &ang[1], &ang[2] );
+  SetRotation( ang );
 
   // Third line should have 4 values with the size of the
   // file indices
@@ -322,12 +326,111 @@ void G4SBSToscaField::ReadField(){
   for( idx=0; idx<3; idx++ ){
     fBinWidth[idx] = (fMax[idx]-fMin[idx])/double( fN[idx]-1 );
   }
+
+  fclose(f);
   
   printf("G4SBSToscaField - Field complete\n");
 
+  if( !cachefile.empty() ) WriteFieldCache( cachefile, ang );
+
   return;
 }
 
+void G4SBSToscaField::SetRotation( const double ang[3] ){
+  frm = G4RotationMatrix();
+  frm.rotateX(ang[0]*deg);
+  frm.rotateY(ang[1]*deg);
+  frm.rotateZ(ang[2]*deg);
+
+  frm.print(G4cout);
+}
+
+//Cache file layout: header tag, offset (mm), rotation angles (deg), fN, fMin and fMax (mm), and the field
+//values (internal units) in the order of fBfield:
+static const char kFieldCacheTag[16] = "G4SBSTOSCA 1";
+
+G4bool G4SBSToscaField::ReadFieldCache( G4String cachefile ){
+  FILE *f = fopen( cachefile.data(), "rb" );
+  if( f == NULL ) return false;
+
+  char tag[16];
+  double offset[3], ang[3];
+  int n[3];
+  double fmin[3], fmax[3];
+
+  G4bool ok = fread( tag, sizeof(tag), 1, f ) == 1 && memcmp( tag, kFieldCacheTag, sizeof(tag) ) == 0 &&
+    fread( offset, sizeof(double), 3, f ) == 3 && fread( ang, sizeof(double), 3, f ) == 3 &&
+    fread( n, sizeof(int), 3, f ) == 3 && fread( fmin, sizeof(double), 3, f ) == 3 && fread( fmax, sizeof(double), 3, f ) == 3 &&
+    n[0] > 1 && n[1] > 1 && n[2] > 1;
+
+  vector<double> B;
+  if( ok ){
+    B.resize( 3*size_t(n[0])*n[1]*n[2] );
+    ok = fread( &(B[0]), sizeof(double), B.size(), f ) == B.size();
+  }
+  fclose(f);
+
+  if( !ok ){
+    G4cout << "G4SBSToscaField - WARNING invalid field map cache " << cachefile << ", reading the map" << G4endl;
+    return false;
+  }
+
+  printf("G4SBSToscaField - Reading in field from cache %s\n", cachefile.data());
+
+  fOffset = G4ThreeVector( offset[0], offset[1], offset[2] );
+  SetRotation( ang );
+
+  fBfield.resize( B.size()/3 );
+  for( size_t i=0; i<fBfield.size(); i++ ) fBfield[i] = G4ThreeVector( B[3*i], B[3*i+1], B[3*i+2] );
+
+  for( int idx=0; idx<3; idx++ ){
+    fN[idx] = n[idx];
+    fMin[idx] = fmin[idx];
+    fMax[idx] = fmax[idx];
+    fBinWidth[idx] = (fMax[idx]-fMin[idx])/double( fN[idx]-1 );
+  }
+
+  G4cout << "Bfield nx,ny,nz,ntotal = " << fN[0] << ", " 
+	 << fN[1] << ", " 
+	 << fN[2] << ", " << fBfield.size() << G4endl;
+
+  printf("G4SBSToscaField - Field complete\n");
+
+  return true;
+}
+
+void G4SBSToscaField::WriteFieldCache( G4String cachefile, const double ang[3] ){
+  G4SBSRunCache *cache = G4SBSRunCache::GetCache();
+  G4String tmpfile = cache->GetTmpName( cachefile );
+
+  FILE *f = fopen( tmpfile.data(), "wb" );
+  if( f == NULL ) return;
+
+  double offset[3] = { fOffset.x(), fOffset.y(), fOffset.z() };
+
+  vector<double> B( 3*fBfield.size() );
+  for( size_t i=0; i<fBfield.size(); i++ ){
+    B[3*i] = fBfield[i].x();
+    B[3*i+1] = fBfield[i].y();
+    B[3*i+2] = fBfield[i].z();
+  }
+
+  G4bool ok = fwrite( kFieldCacheTag, sizeof(kFieldCacheTag), 1, f ) == 1 &&
+    fwrite( offset, sizeof(double), 3, f ) == 3 && fwrite( ang, sizeof(double), 3, f ) == 3 &&
+    fwrite( fN, sizeof(int), 3, f ) == 3 && fwrite( fMin, sizeof(double), 3, f ) == 3 && fwrite( fMax, sizeof(double), 3, f ) == 3 &&
+    fwrite( &(B[0]), sizeof(double), B.size(), f ) == B.size();
+  ok = ( fclose(f) == 0 ) && ok;
+
+  if( !ok ){
+    remove( tmpfile.data() );
+    return;
+  }
+
+  if( cache->Commit( tmpfile, cachefile ) ){
+    G4cout << "G4SBSToscaField - field map cached in " << cachefile << G4endl;
+  }
+}
+
 int G4SBSToscaField::GetIndex( int ix, int iy, int iz ) const {
   return iz + fN[2]*iy + fN[2]*fN[1]*ix;
 }
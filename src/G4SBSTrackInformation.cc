@@ -76,6 +76,7 @@ G4SBSTrackInformation::G4SBSTrackInformation()
   fSDPolarization.clear();
   fSDEnergy.clear();
   fSDTime.clear();
+  fSDWeight.clear();
   fSDVertexPosition.clear();
   fSDVertexDirection.clear();
   fSDVertexKineticEnergy.clear();
@@ -128,6 +129,7 @@ G4SBSTrackInformation::G4SBSTrackInformation(const G4Track* aTrack)
   fSDPolarization.clear();
   fSDEnergy.clear();
   fSDTime.clear();
+  fSDWeight.clear();
   fSDVertexPosition.clear();
   fSDVertexDirection.clear();
   fSDVertexKineticEnergy.clear();
@@ -177,6 +179,7 @@ G4SBSTrackInformation
   fSDPolarization = aTrackInfo->fSDPolarization;
   fSDEnergy = aTrackInfo->fSDEnergy;
   fSDTime = aTrackInfo->fSDTime;
+  fSDWeight = aTrackInfo->fSDWeight;
   fSDVertexPosition = aTrackInfo->fSDVertexPosition;
   fSDVertexDirection = aTrackInfo->fSDVertexDirection;
   fSDVertexKineticEnergy = aTrackInfo->fSDVertexKineticEnergy;
@@ -228,6 +231,7 @@ G4SBSTrackInformation& G4SBSTrackInformation
   fSDPolarization = aTrackInfo.fSDPolarization;
   fSDEnergy = aTrackInfo.fSDEnergy;
   fSDTime = aTrackInfo.fSDTime;
+  fSDWeight = aTrackInfo.fSDWeight;
   fSDVertexPosition = aTrackInfo.fSDVertexPosition;
   fSDVertexDirection = aTrackInfo.fSDVertexDirection;
   fSDVertexKineticEnergy = aTrackInfo.fSDVertexKineticEnergy;
@@ -276,6 +280,7 @@ void G4SBSTrackInformation::SetTrackSDInformation(G4String SDname, const G4Track
     fSDPolarization[SDname] = aTrack->GetPolarization();
     fSDEnergy[SDname] = aTrack->GetTotalEnergy();
     fSDTime[SDname] = aTrack->GetGlobalTime();
+    fSDWeight[SDname] = aTrack->GetWeight();
     fSDVertexPosition[SDname] = aTrack->GetVertexPosition();
     fSDVertexDirection[SDname] = aTrack->GetVertexMomentumDirection();
     fSDVertexKineticEnergy[SDname] = aTrack->GetVertexKineticEnergy();
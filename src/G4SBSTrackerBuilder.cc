@@ -250,6 +250,9 @@ void G4SBSTrackerBuilder::BuildComponent(G4LogicalVolume *Mother, G4RotationMatr
       } 
     }
     new G4PVPlacement( rot, plane_pos, gemlog, gemname, Mother, true, gidx+1, false );
+
+    //Hit coordinates are in the frame of Mother; the strip digitization neglects the rotation of the planes:
+    GEMSD->SetPlaneGeometry( gidx+1, plane_pos, wplanes[gidx], hplanes[gidx] );
   }
 }
 
@@ -31,10 +31,13 @@
 #include "G4SBSTrackingAction.hh"
 //#include "G4SBSTrajectory.hh"
 #include "G4SBSTrackInformation.hh"
+#include "G4SBSOpticalLUT.hh"
+#include "G4SBSPhotonThinning.hh"
 
 #include "G4TrackingManager.hh"
 #include "G4Track.hh"
 #include "G4Trajectory.hh"
+#include "G4OpticalPhoton.hh"
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo...... 
 G4SBSTrackingAction::G4SBSTrackingAction()
@@ -128,7 +131,25 @@ void G4SBSTrackingAction::PreUserTrackingAction(const G4Track* aTrack)
   
   //After appropriately modifying trackInfo, set the usertrackinformation:
   //if( aTrack->GetParentID() == 0 ) aTrack->SetUserInformation( trackInfo );
-  
+
+  //Optical photon lookup table: count emitted photons (calibration), or replace the photon transport
+  //by sampling the table and kill the photon before its first step (production):
+  G4SBSOpticalLUT *LUT = G4SBSOpticalLUT::GetLUT();
+  if( LUT->GetMode() != G4SBSOpticalLUT::kOff &&
+      aTrack->GetDefinition() == G4OpticalPhoton::OpticalPhotonDefinition() ){
+    if( LUT->GetMode() == G4SBSOpticalLUT::kCalibrate ){
+      LUT->RecordEmission( aTrack );
+    } else if( LUT->ProcessPhoton( (G4Track*) aTrack ) ){
+      ( (G4Track*) aTrack )->SetTrackStatus( fStopAndKill );
+    }
+  }
+
+  //Quantum-efficiency pre-thinning: only a fraction of the optical photons is tracked, and the
+  //detection probability in the SDs is rescaled accordingly:
+  if( aTrack->GetDefinition() == G4OpticalPhoton::OpticalPhotonDefinition() &&
+      !G4SBSPhotonThinning::GetThinning()->KeepPhoton( aTrack ) ){
+    ( (G4Track*) aTrack )->SetTrackStatus( fStopAndKill );
+  }
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo...... 
@@ -156,6 +177,9 @@ void G4SBSTrackingAction::PostUserTrackingAction(const G4Track* aTrack)
     {
       for(size_t i=0;i<nSeco;i++)
       {
+	//Split copies from importance biasing already carry a copy of the parent track information:
+	if( (*secondaries)[i]->GetUserInformation() != NULL ) continue;
+
 	// This default behavior copied from example RE01 is acceptable
 	// it copies the track information to all secondaries.
 	// The preusertrackingaction handles modifications to "OriginalTrack" when the secondaries are
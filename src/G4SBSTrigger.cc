@@ -0,0 +1,267 @@
+#include "G4SBSTrigger.hh"
+#include "G4SBSRandom.hh"
+
+#include "TTree.h"
+#include "TString.h"
+#include "TObjArray.h"
+#include "TObjString.h"
+
+#include "Randomize.hh"
+#include "G4ios.hh"
+
+#include <fstream>
+#include <cmath>
+#include <algorithm>
+
+G4SBSTrigger *G4SBSTrigger::gSingleton = NULL;
+
+G4SBSTrigger::G4SBSTrigger(){
+  gSingleton = this;
+
+  fEnabled = false;
+  fFilterMask = 0;
+
+  //Defaults: GEp ECAL and HCAL, as in root_macros/gep_trigger_analysis_L2_generic.C:
+  fSDname[kEarm] = "Earm/ECalTF1";
+  fSumFile[kEarm] = "database/GEP_ECAL_L2sums.txt";
+  fThresholdFile[kEarm] = "database/ecal_trigger_thresholds_12GeV2.txt";
+  fThreshold[kEarm] = 0.8;
+  fPhePerGeV[kEarm] = 528.0;
+
+  fSDname[kHarm] = "Harm/HCalScint";
+  fSumFile[kHarm] = "database/hcal_L2sums_4x4.txt";
+  fThresholdFile[kHarm] = "database/hcal_trigger_thresholds_12GeV2.txt";
+  fThreshold[kHarm] = 0.5;
+  fPhePerGeV[kHarm] = 2981.0;
+
+  fL2File = "database/ECAL_HCAL_L2_default.txt";
+
+  fBits = 0;
+  for( G4int arm=0; arm<kNArms; arm++ ){
+    fNfired[arm] = 0;
+    fMaxSum[arm] = 0.0;
+  }
+  fNevents = fNwritten = 0;
+  for( G4int i=0; i<3; i++ ) fNtrig[i] = 0;
+}
+
+G4SBSTrigger::~G4SBSTrigger(){
+  ;
+}
+
+G4SBSTrigger *G4SBSTrigger::GetTrigger(){
+  if( gSingleton == NULL ){
+    gSingleton = new G4SBSTrigger();
+  }
+  return gSingleton;
+}
+
+void G4SBSTrigger::SetArm( G4int arm, G4String SDname, G4String sumfile, G4String thresholdfile ){
+  fSDname[arm] = SDname;
+  fSumFile[arm] = sumfile;
+  fThresholdFile[arm] = thresholdfile;
+}
+
+void G4SBSTrigger::ReadSums( G4int arm ){
+  ifstream infile( fSumFile[arm].data() );
+  if( !infile ){
+    fprintf(stderr, "%s: %s line %d - Error: cannot open trigger logic sum table %s\n", __PRETTY_FUNCTION__, __FILE__, __LINE__, fSumFile[arm].data());
+    exit(-1);
+  }
+
+  fSumsByCell[arm].clear();
+  G4int nsums = 0;
+
+  TString currentline;
+  while( currentline.ReadLine( infile ) ){
+    if( currentline.BeginsWith("#") ) continue;
+
+    TObjArray *tokens = currentline.Tokenize(" ,\t");
+    G4int ntokens = tokens->GetEntries();
+
+    if( ntokens >= 2 ){
+      G4int node = ( (TObjString*) (*tokens)[0] )->GetString().Atoi() + 1;
+
+      //"node ncells cells" or "index center x y binx biny bin ncells cells":
+      G4int first = 2;
+      G4int ncells = ( (TObjString*) (*tokens)[1] )->GetString().Atoi();
+      if( ntokens != ncells + 2 && ntokens >= 8 ){
+	first = 8;
+	ncells = ( (TObjString*) (*tokens)[7] )->GetString().Atoi();
+      }
+
+      if( ntokens >= first + ncells ){
+	for( G4int itoken=first; itoken<first+ncells; itoken++ ){
+	  G4int cell = ( (TObjString*) (*tokens)[itoken] )->GetString().Atoi();
+	  fSumsByCell[arm][cell].push_back( node );
+	}
+	nsums = std::max( nsums, node );
+      }
+    }
+    delete tokens;
+  }
+
+  fSum[arm].assign( nsums, 0.0 );
+  fMean[arm].assign( nsums, 0.0 );
+}
+
+void G4SBSTrigger::ReadThresholds( G4int arm ){
+  ifstream infile( fThresholdFile[arm].data() );
+  if( !infile ){
+    fprintf(stderr, "%s: %s line %d - Error: cannot open trigger threshold table %s\n", __PRETTY_FUNCTION__, __FILE__, __LINE__, fThresholdFile[arm].data());
+    exit(-1);
+  }
+
+  G4int node;
+  G4double mean, sigma;
+  while( infile >> node >> mean >> sigma ){
+    if( node >= 1 && node <= G4int(fMean[arm].size()) ) fMean[arm][node-1] = mean;
+  }
+
+  G4int nmissing = 0;
+  for( size_t i=0; i<fMean[arm].size(); i++ ){
+    if( fMean[arm][i] <= 0.0 ) nmissing++;
+  }
+  if( nmissing > 0 ){
+    G4cout << "Trigger: " << nmissing << " logic sums of " << fSDname[arm] << " have no threshold in "
+	   << fThresholdFile[arm] << " and will never fire" << G4endl;
+  }
+}
+
+void G4SBSTrigger::ReadL2(){
+  fL2Earm.assign( fSum[kHarm].size(), vector<G4int>() );
+
+  ifstream infile( fL2File.data() );
+  if( !infile ){
+    fprintf(stderr, "%s: %s line %d - Error: cannot open L2 association table %s\n", __PRETTY_FUNCTION__, __FILE__, __LINE__, fL2File.data());
+    exit(-1);
+  }
+
+  TString currentline;
+  while( currentline.ReadLine( infile ) ){
+    if( currentline.BeginsWith("#") ) continue;
+
+    TObjArray *tokens = currentline.Tokenize(" ,\t");
+    G4int ntokens = tokens->GetEntries();
+
+    if( ntokens > 2 ){
+      G4int hnode = ( (TObjString*) (*tokens)[0] )->GetString().Atoi();
+      G4int N = ( (TObjString*) (*tokens)[1] )->GetString().Atoi();
+
+      if( hnode >= 1 && hnode <= G4int(fL2Earm.size()) && ntokens >= N+2 ){
+	for( G4int i=0; i<N; i++ ){
+	  G4int enode = ( (TObjString*) (*tokens)[i+2] )->GetString().Atoi();
+	  if( enode >= 1 && enode <= G4int(fSum[kEarm].size()) ) fL2Earm[hnode-1].push_back( enode );
+	}
+      }
+    }
+    delete tokens;
+  }
+}
+
+void G4SBSTrigger::BeginOfRun(){
+  fNevents = fNwritten = 0;
+  for( G4int i=0; i<3; i++ ) fNtrig[i] = 0;
+
+  if( !fEnabled ) return;
+
+  for( G4int arm=0; arm<kNArms; arm++ ){
+    ReadSums( arm );
+    ReadThresholds( arm );
+    G4cout << "Trigger: " << fSum[arm].size() << " logic sums for " << fSDname[arm] << " from " << fSumFile[arm]
+	   << ", threshold = " << fThreshold[arm] << " x elastic peak" << G4endl;
+  }
+  ReadL2();
+}
+
+void G4SBSTrigger::Branch( TTree *tree ){
+  if( !fEnabled ) return;
+
+  tree->Branch( "trig.bits", &fBits, "trig.bits/I" );
+  tree->Branch( "trig.earm_nfired", &(fNfired[kEarm]), "trig.earm_nfired/I" );
+  tree->Branch( "trig.harm_nfired", &(fNfired[kHarm]), "trig.harm_nfired/I" );
+  tree->Branch( "trig.earm_maxsum", &(fMaxSum[kEarm]), "trig.earm_maxsum/D" );
+  tree->Branch( "trig.harm_maxsum", &(fMaxSum[kHarm]), "trig.harm_maxsum/D" );
+}
+
+void G4SBSTrigger::AddCalHits( G4String SDname, const G4SBSCALoutput &cd ){
+  for( G4int arm=0; arm<kNArms; arm++ ){
+    if( SDname != fSDname[arm] ) continue;
+
+    CLHEP::HepRandomEngine *engine = G4SBSRandom::GetRandom()->GetEngine( G4SBSRandom::kDigitization );
+
+    for( G4int ihit=0; ihit<cd.nhits_CAL; ihit++ ){
+      map<G4int, vector<G4int> >::iterator sums = fSumsByCell[arm].find( cd.cell[ihit] );
+      if( sums == fSumsByCell[arm].end() ) continue;
+
+      G4double E = cd.sumedep[ihit]; //GeV
+      if( fPhePerGeV[arm] > 0.0 && E > 0.0 ){
+	G4double npe = fPhePerGeV[arm]*E;
+	E = CLHEP::RandGauss::shoot( engine, npe, sqrt(npe) )/fPhePerGeV[arm];
+      }
+
+      for( size_t i=0; i<sums->second.size(); i++ ){
+	fSum[arm][sums->second[i]-1] += E;
+      }
+    }
+  }
+}
+
+G4bool G4SBSTrigger::Evaluate(){
+  if( !fEnabled ) return true;
+
+  fBits = 0;
+
+  vector<G4bool> fired[kNArms];
+
+  for( G4int arm=0; arm<kNArms; arm++ ){
+    fNfired[arm] = 0;
+    fMaxSum[arm] = 0.0;
+    fired[arm].assign( fSum[arm].size(), false );
+
+    for( size_t i=0; i<fSum[arm].size(); i++ ){
+      if( fMean[arm][i] > 0.0 ){
+	G4double sum = fSum[arm][i]/fMean[arm][i];
+	if( sum > fMaxSum[arm] ) fMaxSum[arm] = sum;
+	if( sum > fThreshold[arm] ){
+	  fired[arm][i] = true;
+	  fNfired[arm]++;
+	}
+      }
+      fSum[arm][i] = 0.0;
+    }
+  }
+
+  if( fNfired[kEarm] > 0 ) fBits |= kEarmBit;
+  if( fNfired[kHarm] > 0 ) fBits |= kHarmBit;
+
+  for( size_t h=0; h<fL2Earm.size() && !(fBits & kL2Bit); h++ ){
+    if( !fired[kHarm][h] ) continue;
+    for( size_t e=0; e<fL2Earm[h].size(); e++ ){
+      if( fired[kEarm][fL2Earm[h][e]-1] ){
+	fBits |= kL2Bit;
+	break;
+      }
+    }
+  }
+
+  fNevents++;
+  for( G4int i=0; i<3; i++ ){
+    if( fBits & (1<<i) ) fNtrig[i]++;
+  }
+
+  G4bool keep = fFilterMask == 0 || (fBits & fFilterMask) != 0;
+  if( keep ) fNwritten++;
+
+  return keep;
+}
+
+void G4SBSTrigger::EndOfRun(){
+  if( !fEnabled ) return;
+
+  G4cout << "Trigger: " << fNevents << " events, earm = " << fNtrig[0] << ", harm = " << fNtrig[1]
+	 << ", L2 coincidence = " << fNtrig[2] << G4endl;
+  if( fFilterMask != 0 ){
+    G4cout << "Trigger: " << fNwritten << " events passed the trigger filter" << G4endl;
+  }
+}